@@ -17,14 +17,50 @@
 #include <CmdLib/AtCmdLib.h>
 #include <system/mstimer.h>
 #include <drv/GainSpan_SPI.h>
+#include <drv/UART2.h>
+#include <drv/Transport.h>
+#include <sensors/eeprom.h>
 #include "Apps.h"
 
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* EEPROM record of the SPI rate found by App_SPICalibrate ("R" and the */
+/* rate in decimal), after the CIK (40 bytes at address 5) */
+#define APP_SPI_RATE_EEPROM_ADDR        48
+#define APP_SPI_RATE_RECORD_SIZE        8
+
+/* Clean AT checks needed for a SPI rate to pass */
+#ifndef APP_SPI_CALIBRATE_ROUND_TRIPS
+#define APP_SPI_CALIBRATE_ROUND_TRIPS   5
+#endif
+
+/* Time (ms) to wait for the module to answer the link ready check */
+#ifndef APP_SPI_READY_TIMEOUT
+#define APP_SPI_READY_TIMEOUT           50
+#endif
+
+/* Clean AT checks needed for UART2_FAST_BAUD_RATE to pass */
+#ifndef APP_UART_SPEED_ROUND_TRIPS
+#define APP_UART_SPEED_ROUND_TRIPS      5
+#endif
+
 /*-------------------------------------------------------------------------*
  * Globals:
  *-------------------------------------------------------------------------*/
 uint8_t G_received[APP_MAX_RECEIVED_DATA + 1];
 uint32_t G_receivedCount = 0;
 
+/* SPI rates above SPI_BITS_PER_SECOND tried by App_SPICalibrate, slowest */
+/* first (12 MHz / 2 / (divider + 1)) */
+static const uint32_t G_App_SPIRates[] = {
+    400000,
+    500000,
+    600000,
+    750000,
+    857142,
+};
+
 /*---------------------------------------------------------------------------*
  * Routine:  App_Write
  *---------------------------------------------------------------------------*
@@ -38,24 +74,37 @@ uint32_t G_receivedCount = 0;
  *---------------------------------------------------------------------------*/
 void App_Write(const uint8_t *txData, uint32_t dataLength)
 {
-#ifdef HOST_APP_INTERFACE_SPI
-    while (dataLength--) {
-        /* Keep trying to send this data until it goes */
-        while (!GainSpan_SPI_SendByte(*txData)) {
-            /* Process any incoming data as well */
-            GainSpan_SPI_Update();
-        }
+    uint32_t sent;
 
-        txData++;
-    }
-#else
-    while (dataLength--) {
-        /* Keep trying to send this data until it goes */
-        while (!UART2_SendByte(*txData)) {
-        }
-        txData++;
+    while (1) {
+        /* Queue as much as fits and keep it going until all has gone */
+        sent = Transport_Write(txData, dataLength);
+        txData += sent;
+        dataLength -= sent;
+
+        /* Start sending in the background (and process any incoming */
+        /* data as well) */
+        Transport_Poll();
+        if (!dataLength)
+            break;
     }
-#endif
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_IsWriteReady
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback to determine if everything written with App_Write
+ *      has gone out to the module, so the module is ready for more.  Over
+ *      SPI the module must also not be holding us off with XOFF.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if ready, else false
+ *---------------------------------------------------------------------------*/
+bool App_IsWriteReady(void)
+{
+    return Transport_Flush();
 }
 
 /*---------------------------------------------------------------------------*
@@ -73,45 +122,44 @@ void App_Write(const uint8_t *txData, uint32_t dataLength)
  *---------------------------------------------------------------------------*/
 bool App_Read(uint8_t *rxData, uint32_t dataLength, uint8_t blockFlag)
 {
-#ifdef HOST_APP_INTERFACE_SPI
     bool got_data = false;
+    uint32_t count;
 
     /* Keep getting data if we have a number of bytes to fetch */
     while (dataLength) {
-        /* Try to get a byte */
-        if (GainSpan_SPI_ReceiveByte(rxData)) {
-            /* Got a byte, move up to the next position */
-            rxData++;
-            dataLength--;
+        /* Try to get what has arrived */
+        count = Transport_Read(rxData, dataLength);
+        if (count) {
+            /* Got bytes, move up to the next position */
+            rxData += count;
+            dataLength -= count;
             got_data = true;
         } else {
             /* Did not get a byte, are we block?  If not, stop here */
             if (!blockFlag)
                 break;
+            Transport_Poll();
         }
     }
 
     return got_data;
-#else
-    bool got_data = false;
+}
 
-    /* Keep getting data if we have a number of bytes to fetch */
-//    while (dataLength) {
-        /* Try to get a byte */
-//        if (UART2_ReceiveByte(rxData)) {
-            /* Got a byte, move up to the next position */
-//            rxData++;
-//            dataLength--;
-//            got_data = true;
-//        } else {
-            /* Did not get a byte, are we block?  If not, stop here */
-//            if (!blockFlag)
-//            break;
-//        }
-//    }
-//
-    return got_data;
-#endif
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ReadAvailable
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback to read the bytes that have already arrived from
+ *      the module.  Never waits.
+ * Inputs:
+ *      uint8_t *rxData -- Pointer to a place to store a string of bytes
+ *      uint32_t maxLength -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t App_ReadAvailable(uint8_t *rxData, uint32_t maxLength)
+{
+    return Transport_Read(rxData, maxLength);
 }
 
 /*---------------------------------------------------------------------------*
@@ -126,6 +174,8 @@ bool App_Read(uint8_t *rxData, uint32_t dataLength, uint8_t blockFlag)
  *---------------------------------------------------------------------------*/
 void App_PrepareIncomingData(uint8_t cid)
 {
+    (void)cid;
+
     G_receivedCount = 0;
     G_received[0] = '\0';
 }
@@ -144,10 +194,278 @@ void App_PrepareIncomingData(uint8_t cid)
  *---------------------------------------------------------------------------*/
 void App_ProcessIncomingData(uint8_t cid, uint8_t rxData)
 {
-    if (G_receivedCount < APP_MAX_RECEIVED_DATA) {
-        G_received[G_receivedCount++] = rxData;
-        G_received[G_receivedCount] = '\0';
+    App_ProcessIncomingSpan(cid, &rxData, 1);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ProcessIncomingSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback that is called when a run of bytes has come in
+ *      for a specific connection.  Bytes that do not fit in G_received
+ *      are dropped.
+ * Inputs:
+ *      uint8_t cid -- Connection receiving data
+ *      const uint8_t *rxData -- Bytes received
+ *      uint32_t dataLength -- Number of bytes received
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength)
+{
+    (void)cid;
+
+    if (dataLength > (APP_MAX_RECEIVED_DATA - G_receivedCount))
+        dataLength = APP_MAX_RECEIVED_DATA - G_receivedCount;
+    memcpy(G_received + G_receivedCount, rxData, dataLength);
+    G_receivedCount += dataLength;
+    G_received[G_receivedCount] = '\0';
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IApp_SPILinkReady
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Send the SPI link ready check and wait for the module to answer
+ *      it.  Anything else that comes back is thrown away.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if the module answered, else false
+ *---------------------------------------------------------------------------*/
+static bool IApp_SPILinkReady(void)
+{
+    uint32_t start = MSTimerGet();
+    uint8_t rx[16];
+    uint32_t count;
+    uint32_t i;
+
+    /* Sent as is, not escaped */
+    GainSpan_SPI_SendByteLowLevel(HOST_APP_SPI_READY_CHECK);
+    while (MSTimerDelta(start) < APP_SPI_READY_TIMEOUT) {
+        count = GainSpan_SPI_ReceiveData(rx, sizeof(rx));
+        for (i = 0; i < count; i++) {
+            if (rx[i] == HOST_APP_SPI_READY_ACK)
+                return true;
+        }
     }
+    return false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IApp_SPITestRate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Switch the SPI bus to the given rate and check the link with the
+ *      link ready exchange and APP_SPI_CALIBRATE_ROUND_TRIPS AT checks.
+ * Inputs:
+ *      uint32_t rate -- SPI rate (bits per second) to try
+ * Outputs:
+ *      bool -- true if every exchange was clean, else false
+ *---------------------------------------------------------------------------*/
+static bool IApp_SPITestRate(uint32_t rate)
+{
+    uint8_t i;
+
+    /* Let what is going out finish at the old rate */
+    while (!GainSpan_SPI_IsTransmitEmpty())
+        GainSpan_SPI_Update();
+    SPI_CSI10_ChannelSetBitRate(SPI_WIFI_CHANNEL, rate);
+
+    if (!IApp_SPILinkReady())
+        return false;
+
+    /* End any partial command left from a failed rate */
+    App_Write((const uint8_t *)"\r\n", 2);
+    MSTimerDelay(10);
+    for (i = 0; i < APP_SPI_CALIBRATE_ROUND_TRIPS; i++) {
+        AtLib_FlushIncomingMessage();
+        if (AtLibGs_Check() != HOST_APP_MSG_ID_OK)
+            return false;
+    }
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IApp_SPIRateLoad
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the SPI rate saved in EEPROM by App_SPICalibrate.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Saved rate, or 0 if none (or not one we try)
+ *---------------------------------------------------------------------------*/
+static uint32_t IApp_SPIRateLoad(void)
+{
+    uint8_t record[APP_SPI_RATE_RECORD_SIZE];
+    uint32_t rate = 0;
+    uint8_t i;
+
+    EEPROM_Seq_Read(APP_SPI_RATE_EEPROM_ADDR, record, sizeof(record));
+    if (record[0] != 'R')
+        return 0;
+    for (i = 1; (i < sizeof(record)) && (record[i] >= '0')
+            && (record[i] <= '9'); i++)
+        rate = (rate * 10) + (record[i] - '0');
+
+    for (i = 0; i < sizeof(G_App_SPIRates) / sizeof(G_App_SPIRates[0]); i++) {
+        if (G_App_SPIRates[i] == rate)
+            return rate;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IApp_SPIRateSave
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Save the SPI rate in EEPROM for the next start up.
+ * Inputs:
+ *      uint32_t rate -- SPI rate (bits per second)
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IApp_SPIRateSave(uint32_t rate)
+{
+    char record[APP_SPI_RATE_RECORD_SIZE + 1];
+    char digits[APP_SPI_RATE_RECORD_SIZE];
+    uint8_t n = 0;
+    uint8_t i = 0;
+
+    do {
+        digits[n++] = '0' + (rate % 10);
+        rate /= 10;
+    } while ((rate) && (n < APP_SPI_RATE_RECORD_SIZE - 1));
+
+    record[i++] = 'R';
+    while (n)
+        record[i++] = digits[--n];
+    /* Pad so no digits of an older record are left behind */
+    while (i < APP_SPI_RATE_RECORD_SIZE)
+        record[i++] = ' ';
+    record[i] = '\0';
+
+    EEPROM_Write(APP_SPI_RATE_EEPROM_ADDR, record);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_SPICalibrate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Find the fastest SPI rate the module and board wiring handle.
+ *      The rate saved in EEPROM is tried first.  Otherwise the rates in
+ *      G_App_SPIRates are stepped up from SPI_BITS_PER_SECOND until one
+ *      fails the link ready exchange or an AT check.  The link is left
+ *      at the fastest rate that passed and that rate is saved.
+ *      Call after the module has answered AtLibGs_Check.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- SPI rate in use (bits per second)
+ *---------------------------------------------------------------------------*/
+uint32_t App_SPICalibrate(void)
+{
+    uint32_t saved = IApp_SPIRateLoad();
+    uint32_t best = SPI_BITS_PER_SECOND;
+    uint8_t i;
+
+    if ((saved) && (IApp_SPITestRate(saved)))
+        return saved;
+
+    for (i = 0; i < sizeof(G_App_SPIRates) / sizeof(G_App_SPIRates[0]); i++) {
+        if (G_App_SPIRates[i] <= best)
+            continue;
+        if (!IApp_SPITestRate(G_App_SPIRates[i]))
+            break;
+        best = G_App_SPIRates[i];
+    }
+
+    /* Back to the best rate and get the module in step again */
+    SPI_CSI10_ChannelSetBitRate(SPI_WIFI_CHANNEL, best);
+    App_Write((const uint8_t *)"\r\n", 2);
+    do {
+        MSTimerDelay(10);
+        AtLib_FlushIncomingMessage();
+    } while (AtLibGs_Check() != HOST_APP_MSG_ID_OK);
+
+    if (best != saved)
+        IApp_SPIRateSave(best);
+
+    return best;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IApp_UARTSetRate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Let what is going out finish at the old rate, then switch UART2
+ *      to the given rate and throw away anything garbled by the switch.
+ * Inputs:
+ *      uint32_t baud -- baud rate (bits per second)
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IApp_UARTSetRate(uint32_t baud)
+{
+    while (!App_IsWriteReady())
+        Transport_Poll();
+    UART2_SetBaudRate(baud);
+    MSTimerDelay(10);
+    AtLib_FlushIncomingMessage();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_UARTSpeedUp
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Move the UART2 link from UART2_BAUD_RATE, the module's rate at
+ *      reset, to UART2_FAST_BAUD_RATE.  The module is told with ATB=
+ *      and answers at the old rate before it switches.  If the module
+ *      refuses, or the link fails APP_UART_SPEED_ROUND_TRIPS AT checks
+ *      at the new rate, both ends go back to UART2_BAUD_RATE.
+ *      Call after the module has answered AtLibGs_Check, with the
+ *      UART2 transport selected.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- UART2 rate in use (bits per second)
+ *---------------------------------------------------------------------------*/
+uint32_t App_UARTSpeedUp(void)
+{
+    uint8_t i;
+
+    /* Still at the old rate if refused */
+    if (AtLibGs_SetBaudRate(UART2_FAST_BAUD_RATE) == HOST_APP_MSG_ID_ERROR)
+        return UART2_BAUD_RATE;
+
+    IApp_UARTSetRate(UART2_FAST_BAUD_RATE);
+    App_Write((const uint8_t *)"\r\n", 2);
+    MSTimerDelay(10);
+    for (i = 0; i < APP_UART_SPEED_ROUND_TRIPS; i++) {
+        AtLib_FlushIncomingMessage();
+        if (AtLibGs_Check() != HOST_APP_MSG_ID_OK)
+            break;
+    }
+    if (i == APP_UART_SPEED_ROUND_TRIPS)
+        return UART2_FAST_BAUD_RATE;
+
+    /* The module may still hear us when we cannot hear it, so ask it */
+    /* back before we go back ourselves */
+    AtLibGs_SetBaudRate(UART2_BAUD_RATE);
+    IApp_UARTSetRate(UART2_BAUD_RATE);
+
+    /* Get the module in step again */
+    App_Write((const uint8_t *)"\r\n", 2);
+    do {
+        MSTimerDelay(10);
+        AtLib_FlushIncomingMessage();
+    } while (AtLibGs_Check() != HOST_APP_MSG_ID_OK);
+
+    return UART2_BAUD_RATE;
 }
 
 /*-------------------------------------------------------------------------*
@@ -17,12 +17,14 @@
 #include <HostApp.h>
 #include <system/platform.h>
 #include <CmdLib/AtCmdLib.h>
+#include <CmdLib/AtEvent.h>
 #include <sensors/Temperature_ADT7420.h>
 #include <sensors/Potentiometer.h>
 #include <sensors/eeprom.h>
 #include <drv/Glyph/lcd.h>
 #include <system/mstimer.h>
-#include <system/console.h>
+#include <system/log.h>
+#include <drv/Transport.h>
 #include "Apps.h"
 
 /*-------------------------------------------------------------------------*
@@ -30,25 +32,41 @@
  *-------------------------------------------------------------------------*/
 #define EXOSITE_DEMO_UPDATE_INTERVAL            4000 // ms
 
-#define DATA_TO_SEND_TO_SERVER_ALL_LINES \
+/* Pieces of the HTTP requests, sent around the CIK, the query and the */
+/* body with AtLib_SendTcpDataAuto */
+#define DATA_TO_SEND_TO_SERVER_START \
         "POST /api:v1/stack/alias HTTP/1.1\r\n" \
         "Host: m2.exosite.com\r\n" \
-        "X-Exosite-CIK: %s\r\n" \
+        "X-Exosite-CIK: "
+#define DATA_TO_SEND_TO_SERVER_AFTER_CIK \
+        "\r\n" \
         "Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n" \
-        "Content-Length: %d\r\n\r\n"   
+        "Content-Length: "
 
-#define GET_DATA_ALL_LINES \
-        "GET /api:v1/stack/alias?%s HTTP/1.1\r\n" \
+#define GET_DATA_START \
+        "GET /api:v1/stack/alias?"
+#define GET_DATA_AFTER_QUERY \
+        " HTTP/1.1\r\n" \
         "Host: m2.exosite.com\r\n" \
-        "X-Exosite-CIK: %s\r\n" \
+        "X-Exosite-CIK: "
+#define GET_DATA_AFTER_CIK \
+        "\r\n" \
         "Accept: application/x-www-form-urlencoded; charset=utf-8\r\n\r\n"
 
-#define DEVICE_ACTIVATE_ALL_LINE \
+#define DEVICE_ACTIVATE_START \
         "POST /provision/activate HTTP/1.1\r\n" \
         "Host: m2.exosite.com\r\n" \
         "Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n" \
         "Accept: text/plain; charset=utf-8\r\n" \
-        "Content-Length: %d\r\n\r\n"
+        "Content-Length: "
+
+#define HTTP_HEADER_END                     "\r\n\r\n"
+
+/* Most pieces in one request */
+#define EXOSITE_REQUEST_MAX_PARTS           6
+
+/* Add a constant piece of text to G_request */
+#define Exosite_AddText(text)   Exosite_Add((text), sizeof(text) - 1)
 
 /* IP Address of the remote TCP Server */
 #define EXOSITE_DEMO_REMOTE_TCP_SRVR_IP     "173.255.209.28" // m2.exosite.com
@@ -72,15 +90,30 @@ static char G_temp_int[2] = { 0, 0 };
 static char G_activated = 0;
 static char UserCIK[41];
 static char myCIK[41];
-static char G_command[HOST_APP_TX_CMD_MAX_SIZE];
+static char G_activateBody[96];
+static char G_contentLength[6];
+static HOST_APP_IOV_T G_request[EXOSITE_REQUEST_MAX_PARTS];
+static uint8_t G_requestParts = 0;
 static char WifiMAC[17];
 static Exosite_State es = EXOSITE_ACTIVATION;
 
+/* Set by Exosite_Event, cleared before each connection */
+static bool G_linkLost = false;
+static uint8_t G_closedCid = HOST_APP_INVALID_CID;
+
+/* Association queued with AtLibGs_AssocAsync and not done yet */
+static bool G_assocPending = false;
+
+/* PSK calculation queued with AtLibGs_CalcNStorePSKAsync and not done yet */
+static bool G_pskPending = false;
+
 
     
 /*-------------------------------------------------------------------------*
  * Prototypes:
  *-------------------------------------------------------------------------*/
+static void Exosite_Add(const char *pText, uint32_t length);
+static void Exosite_AddContent(const char *pContent);
 
 /*---------------------------------------------------------------------------*
  * Routine:  TemperatureReading
@@ -184,6 +217,57 @@ void UpdateReadings(void)
     DisplayLCD(LCD_LINE8, "");
 }
 
+#if defined(HOST_APP_SEC_PSK) || defined(HOST_APP_WPA) \
+    || defined(HOST_APP_WPA2)
+/*---------------------------------------------------------------------------*
+ * Routine:  WIFI_StorePSKDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLibGs_CalcNStorePSKAsync callback.  Queue the calculation again
+ *      if the module refused it.
+ * Inputs:
+ *      uint8_t handle -- not used
+ *      HOST_APP_MSG_ID_E msgId -- Response to the calculation
+ *      void *pContext -- not used
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void WIFI_StorePSKDone(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext)
+{
+  (void)handle;
+  (void)pContext;
+
+  if ((HOST_APP_MSG_ID_OK != msgId) && (AtLibGs_CalcNStorePSKAsync(
+          HOST_APP_AP_SSID, HOST_APP_AP_SEC_PSK, WIFI_StorePSKDone, NULL)))
+    return;
+  G_pskPending = false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  WIFI_StorePSK
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue the calculation of the PSK value and its storage.  This
+ *      takes the module a few seconds; the commands sent after it wait
+ *      for it, the readings keep updating meanwhile.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void WIFI_StorePSK(void)
+{
+  DisplayLCD(LCD_LINE8, "Setting PSK");
+  while (!AtLibGs_CalcNStorePSKAsync(HOST_APP_AP_SSID, HOST_APP_AP_SEC_PSK,
+          WIFI_StorePSKDone, NULL))
+    AtLib_Poll();
+  G_pskPending = true;
+}
+#endif
+
 /*---------------------------------------------------------------------------*
  * Routine:  WIFI_init
  *---------------------------------------------------------------------------*
@@ -199,9 +283,7 @@ HOST_APP_MSG_ID_E WIFI_init(void)
 {
   HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
   // Check the link
-#ifdef HOST_APP_DEBUG_ENABLE
-    ConsolePrintf("Checking link\r\n");
-#endif
+  LOG(LOG_LEVEL_INFO, LOG_ID_CHECKING_LINK);
 
   AtLib_Init();
   // Wait for the banner
@@ -214,6 +296,15 @@ HOST_APP_MSG_ID_E WIFI_init(void)
     rxMsgId = AtLibGs_Check();
   } while (HOST_APP_MSG_ID_OK != rxMsgId);
 
+  /* Run the link to the module as fast as it and the board allow */
+  if (Transport_GetSelected() == TRANSPORT_SPI) {
+    DisplayLCD(LCD_LINE8, "SPI Speed...");
+    App_SPICalibrate();
+  } else if (Transport_GetSelected() == TRANSPORT_UART2) {
+    DisplayLCD(LCD_LINE8, "UART Speed...");
+    App_UARTSpeedUp();
+  }
+
   /* Get MAC Address & Show */
   rxMsgId = AtLibGs_GetMAC();    
   if (rxMsgId == HOST_APP_MSG_ID_OK)
@@ -250,11 +341,8 @@ HOST_APP_MSG_ID_E WIFI_init(void)
 #endif
     
 #ifdef HOST_APP_SEC_PSK
-  /* Store the PSK value. This call takes might take few seconds to return */
-  do {
-    DisplayLCD(LCD_LINE8, "Setting PSK");
-    rxMsgId = AtLibGs_CalcNStorePSK(HOST_APP_AP_SSID, HOST_APP_AP_SEC_PSK);
-  } while (HOST_APP_MSG_ID_OK != rxMsgId);
+  /* Store the PSK value in the background, it takes a few seconds */
+  WIFI_StorePSK();
 #endif
 
 #ifdef HOST_APP_SEC_OPEN
@@ -272,11 +360,8 @@ HOST_APP_MSG_ID_E WIFI_init(void)
     rxMsgId = AtLibGs_SetWAUTH(0);
   } while (HOST_APP_MSG_ID_OK != rxMsgId);
 
-  /* Store the PSK value. This call takes might take few seconds to return */
-  do {
-    DisplayLCD(LCD_LINE8, "Setting PSK");
-    rxMsgId = AtLibGs_CalcNStorePSK(HOST_APP_AP_SSID, HOST_APP_AP_SEC_PSK);
-  } while (HOST_APP_MSG_ID_OK != rxMsgId);   
+  /* Store the PSK value in the background, it takes a few seconds */
+  WIFI_StorePSK();
 
   /* Security Configuration */
   do {
@@ -292,11 +377,8 @@ HOST_APP_MSG_ID_E WIFI_init(void)
     rxMsgId = AtLibGs_SetWAUTH(0);
   } while (HOST_APP_MSG_ID_OK != rxMsgId);
     
-  /* Store the PSK value. This call takes might take few seconds to return */
-  do {
-    DisplayLCD(LCD_LINE8, "Setting PSK");
-    rxMsgId = AtLibGs_CalcNStorePSK(HOST_APP_AP_SSID, HOST_APP_AP_SEC_PSK);
-  } while (HOST_APP_MSG_ID_OK != rxMsgId);   
+  /* Store the PSK value in the background, it takes a few seconds */
+  WIFI_StorePSK();
 
   /* Security Configuration */
   do {
@@ -309,10 +391,9 @@ HOST_APP_MSG_ID_E WIFI_init(void)
   DisplayLCD(LCD_LINE6, "  EXOSITE  ");
   DisplayLCD(LCD_LINE5, "           ");
 
-  /* Enable Bulk transfer */
-//  do {
-//    rxMsgId = AtLibGs_BData(1);        
-//  } while (HOST_APP_MSG_ID_OK != rxMsgId);  
+  /* Enable Bulk transfer.  If the module refuses, the data is just */
+  /* sent in <ESC>S frames (see AtLib_SendTcpDataAuto) */
+  AtLibGs_BData(1);
 
 /*
   // If need,Set the MAC Address
@@ -345,9 +426,7 @@ HOST_APP_MSG_ID_E WIFI_Associate(void)
   rxMsgId = AtLibGs_Assoc(HOST_APP_AP_SSID, NULL, HOST_APP_AP_CHANNEL);
   if (HOST_APP_MSG_ID_OK != rxMsgId) {
     /* Association error - we can retry */
-#ifdef HOST_APP_DEBUG_ENABLE
-        ConsolePrintf("\n Association error - retry now \n");
-#endif
+    LOG(LOG_LEVEL_ERROR, LOG_ID_ASSOCIATION_ERROR);
     DisplayLCD(LCD_LINE7, "** Failed **");
     MSTimerDelay(2000);
     DisplayLCD(LCD_LINE7, "");
@@ -362,6 +441,37 @@ HOST_APP_MSG_ID_E WIFI_Associate(void)
   return rxMsgId;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  WIFI_AssociateDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLibGs_AssocAsync callback.  Show the result on the LCD.
+ * Inputs:
+ *      uint8_t handle -- not used
+ *      HOST_APP_MSG_ID_E msgId -- Response to the association
+ *      void *pContext -- not used
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void WIFI_AssociateDone(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext)
+{
+  (void)handle;
+  (void)pContext;
+
+  G_assocPending = false;
+  if (HOST_APP_MSG_ID_OK != msgId) {
+    /* Association error - retried on the next cycle */
+    DisplayLCD(LCD_LINE7, "** Failed **");
+  } else {
+    /* Association success */
+    AtLib_SetNodeAssociationFlag();
+    DisplayLCD(LCD_LINE7, " Connected");
+  }
+}
+
 /*---------------------------------------------------------------------------*
  * Routine: Get Device CIK 
  *---------------------------------------------------------------------------*
@@ -437,7 +547,6 @@ void SetCIK(char *pcik)
  *---------------------------------------------------------------------------*/
 void DeviceActivation(void)
 {
-  char content[256];
   HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
   //Get MAC address
   rxMsgId = AtLibGs_GetMAC();
@@ -445,23 +554,74 @@ void DeviceActivation(void)
   if (rxMsgId == HOST_APP_MSG_ID_OK)
     AtLib_ParseGetMacResponse(WifiMAC);
 
+  G_activateBody[0] = '\0';
   if (strlen(WifiMAC) >0)
-    sprintf(content, "vendor=%s&model=%s&sn=%s&osn=Micrium-Ex3&osv=3.01.2",
+    sprintf(G_activateBody, "vendor=%s&model=%s&sn=%s&osn=Micrium-Ex3&osv=3.01.2",
             "renesas", "YRDKRL78GSWIFI",WifiMAC);
 
-  sprintf(G_command, DEVICE_ACTIVATE_ALL_LINE, strlen(content));
-  strcat(G_command, content);
+  G_requestParts = 0;
+  Exosite_AddText(DEVICE_ACTIVATE_START);
+  Exosite_AddContent(G_activateBody);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Exosite_Add
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Add a piece to the request in G_request.  The text is not copied
+ *      and must stay unchanged until the request is sent.
+ * Inputs:
+ *      const char *pText -- Text to add
+ *      uint32_t length -- Number of characters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void Exosite_Add(const char *pText, uint32_t length)
+{
+  if (G_requestParts < EXOSITE_REQUEST_MAX_PARTS) {
+    G_request[G_requestParts].iData = (const uint8_t *)pText;
+    G_request[G_requestParts].iLength = length;
+    G_requestParts++;
+  }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Exosite_AddContent
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      End the request headers with the Content-Length of the body and
+ *      add the body.
+ * Inputs:
+ *      const char *pContent -- Body of the request
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void Exosite_AddContent(const char *pContent)
+{
+  uint32_t length = strlen(pContent);
+
+  Exosite_Add(G_contentLength, sprintf(G_contentLength, "%d", (int)length));
+  Exosite_AddText(HTTP_HEADER_END);
+  Exosite_Add(pContent, length);
 }
 
 void Exosite_Write(char *pContent)
 {
-  sprintf(G_command, DATA_TO_SEND_TO_SERVER_ALL_LINES,myCIK, strlen(pContent));
-  strcat(G_command, pContent);
+  G_requestParts = 0;
+  Exosite_AddText(DATA_TO_SEND_TO_SERVER_START);
+  Exosite_Add(myCIK, strlen(myCIK));
+  Exosite_AddText(DATA_TO_SEND_TO_SERVER_AFTER_CIK);
+  Exosite_AddContent(pContent);
 }
 
 void Exosite_Read(char *pContent)
 {
-  sprintf(G_command, GET_DATA_ALL_LINES, pContent,myCIK);
+  G_requestParts = 0;
+  Exosite_AddText(GET_DATA_START);
+  Exosite_Add(pContent, strlen(pContent));
+  Exosite_AddText(GET_DATA_AFTER_QUERY);
+  Exosite_Add(myCIK, strlen(myCIK));
+  Exosite_AddText(GET_DATA_AFTER_CIK);
 }
 
 /*---------------------------------------------------------------------------*
@@ -603,6 +763,34 @@ void ParseReceiveData(char* pData)
   }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  Exosite_Event
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtEvent callback.  Note a lost association, a module reset or a
+ *      closed connection so the main loop stops waiting and reconnects.
+ * Inputs:
+ *      const ATEVENT_T *pEvent -- Event from the module
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void Exosite_Event(const ATEVENT_T *pEvent)
+{
+  switch (pEvent->iMsgId) {
+    case HOST_APP_MSG_ID_DISCONNECT:
+      G_closedCid = pEvent->iCid;
+      break;
+    case HOST_APP_MSG_ID_DISASSOCIATION_EVENT:
+    case HOST_APP_MSG_ID_APP_RESET:
+    case HOST_APP_MSG_ID_UNEXPECTED_WARM_BOOT:
+    case HOST_APP_MSG_ID_WELCOME_MSG:
+      G_linkLost = true;
+      break;
+    default:
+      break;
+  }
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  App_Exosite
  *---------------------------------------------------------------------------*
@@ -621,8 +809,11 @@ void App_Exosite(void)
   uint32_t start;
   uint32_t end;
   uint32_t postTime;
+  uint32_t replyTimeout;
   uint32_t count;
+  uint32_t lastUpdate;
   uint8_t RWcount = 10;
+  bool replied;
   char *pRx1,*pRx2;
 #ifdef HOST_APP_TCP_DEBUG 
   static uint16_t parsererror = 0;
@@ -637,6 +828,7 @@ void App_Exosite(void)
   MSTimerDelay(1000);
 
   rxMsgId = WIFI_init();
+  AtEvent_Subscribe(Exosite_Event);
 
   //if (rxMsgId != HOST_APP_MSG_ID_OK) 
   WIFI_Associate();
@@ -653,10 +845,17 @@ void App_Exosite(void)
   while (1) {
     start = MSTimerGet();
     UpdateReadings();
-
-    // Do we need to connect to the AP?
-    if (!AtLib_IsNodeAssociated())
-      WIFI_Associate();
+    G_linkLost = false;
+    G_closedCid = HOST_APP_INVALID_CID;
+
+    // Do we need to connect to the AP?  Associate in the background
+    // so the readings keep updating while the module works on it.
+    if ((!AtLib_IsNodeAssociated()) && (!G_assocPending) && (!G_pskPending)) {
+      DisplayLCD(LCD_LINE7, " Connecting ");
+      if (AtLibGs_AssocAsync(HOST_APP_AP_SSID, NULL, HOST_APP_AP_CHANNEL,
+              WIFI_AssociateDone, NULL))
+        G_assocPending = true;
+    }
 
     // Send data
     if (AtLib_IsNodeAssociated()) {
@@ -667,9 +866,7 @@ void App_Exosite(void)
                EXOSITE_DEMO_REMOTE_TCP_SRVR_PORT);
       if (HOST_APP_MSG_ID_OK != rxMsgId) {
         /* TCP connection error */
-#ifdef HOST_APP_DEBUG_ENABLE
-        ConsolePrintf("\n TCP Connection ERROR !\n");
-#endif
+        LOG(LOG_LEVEL_ERROR, LOG_ID_TCP_CONNECT_ERROR);
         AtLibGs_CloseAll();
         DisplayLCD(LCD_LINE7, "         ");
         continue;
@@ -682,9 +879,7 @@ void App_Exosite(void)
       AtLib_SaveTcpCid(cid);
       if (HOST_APP_INVALID_CID == cid) {
         /* TCP connection response parsing error */
-#ifdef HOST_APP_DEBUG_ENABLE
-        ConsolePrintf("\nTCP connection response parsing error!\n");
-#endif
+        LOG(LOG_LEVEL_ERROR, LOG_ID_TCP_RESPONSE_ERROR);
         // Eat the extra data and start over
         AtLib_FlushIncomingMessage();
         cid = AtLib_ParseTcpClientCid();
@@ -703,60 +898,63 @@ void App_Exosite(void)
         continue;
       }
 
-      App_PrepareIncomingData(cid);
-      postTime = MSTimerGet();
-
-      while (MSTimerDelta(postTime) < 5000) { // wait up to 5 seconds for a response 
-
-        switch(es)
-        {
-        case EXOSITE_ACTIVATION:
-             DeviceActivation();
-             break;   
-        case EXOSITE_WRITE:
+      /* Build the request for this connection */
+      switch(es)
+      {
+      case EXOSITE_ACTIVATION:
+           DeviceActivation();
+           break;   
+      case EXOSITE_WRITE:
 #ifdef HOST_APP_TCP_DEBUG
-             if (updateError) {
-               sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d&pecount=%d\r\n",
-                       G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
-                       ping,parsererror);
-               updateError = 0;
-             } else {
-               sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d\r\n",
-                       G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
-                       ping);
-             }
-#else
+           if (updateError) {
+             sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d&pecount=%d\r\n",
+                     G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
+                     ping,parsererror);
+             updateError = 0;
+           } else {
              sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d\r\n",
                      G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
                      ping);
+           }
+#else
+           sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d\r\n",
+                   G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
+                   ping);
 #endif
-             ping++;
-             if (ping >= 100)
-               ping = 0;
-             Exosite_Write(content);
-             break;
-        case EXOSITE_READ:
-             sprintf(content, "led_ctrl");
-             Exosite_Read(content);
-             break;
-        }
-
-        /* Use bulk Transfer */
-        //AtLib_BulkDataTransfer(cid, (uint8_t *)G_command, strlen(G_command));
+           ping++;
+           if (ping >= 100)
+             ping = 0;
+           Exosite_Write(content);
+           break;
+      case EXOSITE_READ:
+           sprintf(content, "led_ctrl");
+           Exosite_Read(content);
+           break;
+      }
 
-        /* Use normal Transfer */
-        AtLib_SendTcpData(cid, (uint8_t *)G_command, strlen(G_command));
+      /* Send the pieces of the request straight from where they are, */
+      /* once: the response to it is collected below */
+      App_PrepareIncomingData(cid);
+      replied = false;
+      postTime = MSTimerGet();
+      if (!AtLib_SendTcpDataAuto(cid, G_request, G_requestParts)) {
+        /* The module did not take the request, start over */
+        LOG(LOG_LEVEL_ERROR, LOG_ID_TCP_SEND_ERROR);
+        AtLibGs_Close(cid);
+        DisplayLCD(LCD_LINE7, "");
+        continue;
+      }
 
-        AtLib_ReceiveDataHandle();
+      /* Wait for the server as long as its measured reply time allows */
+      replyTimeout = AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_SERVER);
+      while (MSTimerDelta(postTime) < replyTimeout) {
+        /* Returns without waiting, a partial response continues next pass */
+        rxMsgId = AtLib_ReceiveDataHandle();
 
-#ifdef HOST_APP_DEBUG_ENABLE
-        if (G_receivedCount > 0) {
-          ConsoleSendString((const char *)G_received + 2);
-          ConsoleSendString("\r\n");
-        }
-#endif
-        /* Check Receive data */ 
-        if (G_receivedCount > 17) {
+        /* Check Receive data once a complete frame is in */ 
+        if ((rxMsgId != HOST_APP_MSG_ID_NONE) && (G_receivedCount > 17)) {
+          LOG_DATA(LOG_LEVEL_DEBUG, LOG_ID_EXOSITE_RESPONSE, G_received + 2,
+              G_receivedCount - 2);
           pRx1 = (char*)&G_received[11];
           pRx2 = strstr(pRx1+6,"TTP/1.1");
 
@@ -773,35 +971,50 @@ void App_Exosite(void)
               ParseReceiveData(pRx2);
             }    
           }
+          AtLib_TimeoutSample(HOST_APP_TIMEOUT_CLASS_SERVER,
+              MSTimerDelta(postTime));
+          replied = true;
           break;
         }
-        MSTimerDelay(500);
-
-        if (G_activated) {
-          RWcount++;
-          if ( RWcount > 2)
-            RWcount=0;
-                
-          if ( RWcount == 0)
-            es = EXOSITE_WRITE;
-          else
-            es = EXOSITE_READ;
-         }
-       } // Receive while loop end
+
+        /* Stop waiting at once if the connection or the link went away */
+        AtEvent_Dispatch();
+        if ((G_linkLost) || (G_closedCid == cid))
+          break;
+      } // Receive while loop end
+
+      /* Only a finished exchange moves on to the next request */
+      if ((replied) && (G_activated)) {
+        RWcount++;
+        if ( RWcount > 2)
+          RWcount=0;
+              
+        if ( RWcount == 0)
+          es = EXOSITE_WRITE;
+        else
+          es = EXOSITE_READ;
+      }
+       if ((!replied) && (MSTimerDelta(postTime) >= replyTimeout))
+         AtLib_TimeoutExpired(HOST_APP_TIMEOUT_CLASS_SERVER);
 
        AtLibGs_Close(cid);
        DisplayLCD(LCD_LINE7, "");
      }
 
      /* Wait a little bit after server disconnecting client before connecting again*/
+     /* but keep listening to the module so a lost link is handled at once */
+     lastUpdate = MSTimerGet();
      while (1) {
+       AtLib_Poll();
+       AtEvent_Dispatch();
+       if (G_linkLost)
+         break;
        end = MSTimerGet();
        if ((start + EXOSITE_DEMO_UPDATE_INTERVAL - end)
            < EXOSITE_DEMO_UPDATE_INTERVAL) {
          count = start + EXOSITE_DEMO_UPDATE_INTERVAL - end;
-         if (count > 250){
-           count = 250;
-           MSTimerDelay(count);
+         if ((count > 250) && (MSTimerDelta(lastUpdate) >= 250)) {
+           lastUpdate = MSTimerGet();
            UpdateReadings();
          }
        } else {
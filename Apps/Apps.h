@@ -30,10 +30,18 @@ extern uint32_t G_receivedCount;
  *-------------------------------------------------------------------------*/
 void App_Exosite(void);
 void App_Write(const uint8_t *txData, uint32_t dataLength);
+bool App_IsWriteReady(void);
 bool App_Read(uint8_t *rxData, uint32_t dataLength, uint8_t blockFlag);
+uint32_t App_ReadAvailable(uint8_t *rxData, uint32_t maxLength);
 void App_PrepareIncomingData(uint8_t cid);
 void App_ProcessIncomingData(uint8_t cid, uint8_t rxData);
+void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength);
 void App_CheckDataIN(void);
+uint32_t App_SPICalibrate(void);
+uint32_t App_UARTSpeedUp(void);
 #endif // APPS_H_
 /*-------------------------------------------------------------------------*
  * End of File:  Apps.h
@@ -0,0 +1,425 @@
+/*-------------------------------------------------------------------------*
+ * File:  AtCidRx.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Per connection (CID) receive buffers.  A small pool of ring
+ *      buffers is handed out to the CIDs that are opened so several
+ *      connections (e.g. a control connection, a telemetry connection
+ *      and a UDP listener) can receive at the same time.  Each CID has
+ *      its own data callback and overflow counter.  When the module
+ *      reports a CID closed its ring takes no more data but can still be
+ *      read, and is released once empty or when the CID is opened again.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "AtCidRx.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef ATCIDRX_NUM_RINGS
+#define ATCIDRX_NUM_RINGS           2
+#endif
+
+#ifndef ATCIDRX_RING_SIZE
+#define ATCIDRX_RING_SIZE           128
+#endif
+
+#define ATCIDRX_NO_RING             0xFF
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t iBuffer[ATCIDRX_RING_SIZE];
+    uint16_t iIn;
+    uint16_t iOut;
+    AtCidRx_Callback iCallback;
+    bool iDisconnected;
+} ATCIDRX_RING_T;
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static ATCIDRX_RING_T G_AtCidRx_Rings[ATCIDRX_NUM_RINGS];
+
+/* Ring used by each CID, or ATCIDRX_NO_RING if not open */
+static uint8_t G_AtCidRx_RingIndex[ATCIDRX_MAX_CID];
+
+/* Bytes dropped per CID because its ring was full */
+static uint16_t G_AtCidRx_Overflow[ATCIDRX_MAX_CID];
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IAtCidRx_Index
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Convert a CID as sent by the module (ASCII hex digit) into an
+ *      index from 0 to ATCIDRX_MAX_CID-1.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      uint8_t -- Index, or ATCIDRX_MAX_CID if not a valid CID
+ *---------------------------------------------------------------------------*/
+static uint8_t IAtCidRx_Index(uint8_t cid)
+{
+    if ((cid >= '0') && (cid <= '9'))
+        return cid - '0';
+    if ((cid >= 'a') && (cid <= 'f'))
+        return cid - 'a' + 10;
+    if ((cid >= 'A') && (cid <= 'F'))
+        return cid - 'A' + 10;
+    return ATCIDRX_MAX_CID;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IAtCidRx_Ring
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Find the ring buffer of an open CID.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      ATCIDRX_RING_T * -- Ring buffer, or 0 if the CID is not open
+ *---------------------------------------------------------------------------*/
+static ATCIDRX_RING_T *IAtCidRx_Ring(uint8_t cid)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+
+    if ((index >= ATCIDRX_MAX_CID)
+            || (G_AtCidRx_RingIndex[index] == ATCIDRX_NO_RING))
+        return 0;
+    return &G_AtCidRx_Rings[G_AtCidRx_RingIndex[index]];
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IAtCidRx_Disconnect
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Stop a CID's ring taking data, releasing it if nothing is left to
+ *      read.
+ * Inputs:
+ *      uint8_t index -- CID index from IAtCidRx_Index
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IAtCidRx_Disconnect(uint8_t index)
+{
+    ATCIDRX_RING_T *p;
+
+    if (G_AtCidRx_RingIndex[index] == ATCIDRX_NO_RING)
+        return;
+    p = &G_AtCidRx_Rings[G_AtCidRx_RingIndex[index]];
+    if (p->iIn == p->iOut)
+        G_AtCidRx_RingIndex[index] = ATCIDRX_NO_RING;
+    else
+        p->iDisconnected = true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Init
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Close all CIDs and clear the overflow counters.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtCidRx_Init(void)
+{
+    memset(G_AtCidRx_RingIndex, ATCIDRX_NO_RING, sizeof(G_AtCidRx_RingIndex));
+    memset(G_AtCidRx_Overflow, 0, sizeof(G_AtCidRx_Overflow));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Open
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Give a CID its own receive ring buffer.  Opening a CID that is
+ *      already open only replaces the callback.  Opening a CID reported
+ *      closed empties its ring for the new connection.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ *      AtCidRx_Callback callback -- Routine to call when data arrives,
+ *          or 0 for none.
+ * Outputs:
+ *      bool -- true if open, false if invalid CID or no free ring buffer
+ *---------------------------------------------------------------------------*/
+bool AtCidRx_Open(uint8_t cid, AtCidRx_Callback callback)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+    uint8_t ring;
+    uint8_t i;
+    bool used;
+
+    if (index >= ATCIDRX_MAX_CID)
+        return false;
+
+    ring = G_AtCidRx_RingIndex[index];
+    if (ring == ATCIDRX_NO_RING) {
+        /* Find a ring buffer not used by another CID */
+        for (ring = 0; ring < ATCIDRX_NUM_RINGS; ring++) {
+            used = false;
+            for (i = 0; i < ATCIDRX_MAX_CID; i++) {
+                if (G_AtCidRx_RingIndex[i] == ring)
+                    used = true;
+            }
+            if (!used)
+                break;
+        }
+        if (ring == ATCIDRX_NUM_RINGS)
+            return false;
+
+        G_AtCidRx_Rings[ring].iIn = G_AtCidRx_Rings[ring].iOut = 0;
+        G_AtCidRx_Rings[ring].iDisconnected = false;
+        G_AtCidRx_RingIndex[index] = ring;
+    } else if (G_AtCidRx_Rings[ring].iDisconnected) {
+        /* A new connection reusing the CID, drop the old data */
+        G_AtCidRx_Rings[ring].iIn = G_AtCidRx_Rings[ring].iOut = 0;
+        G_AtCidRx_Rings[ring].iDisconnected = false;
+    }
+    G_AtCidRx_Rings[ring].iCallback = callback;
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Close
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Release the ring buffer of a CID.  Any unread data is lost.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtCidRx_Close(uint8_t cid)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+
+    if (index < ATCIDRX_MAX_CID)
+        G_AtCidRx_RingIndex[index] = ATCIDRX_NO_RING;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Disconnect
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The module closed a CID: data arriving for it from now on (a new
+ *      connection given the same CID) no longer goes to its ring buffer
+ *      or callback.  What is left in the ring can still be read.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtCidRx_Disconnect(uint8_t cid)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+
+    if (index < ATCIDRX_MAX_CID)
+        IAtCidRx_Disconnect(index);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_DisconnectAll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The module closed all its connections, see AtCidRx_Disconnect.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtCidRx_DisconnectAll(void)
+{
+    uint8_t index;
+
+    for (index = 0; index < ATCIDRX_MAX_CID; index++)
+        IAtCidRx_Disconnect(index);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_IsOpen
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine if a CID has a ring buffer taking data.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      bool -- true if open, false if not open or reported closed
+ *---------------------------------------------------------------------------*/
+bool AtCidRx_IsOpen(uint8_t cid)
+{
+    ATCIDRX_RING_T *p = IAtCidRx_Ring(cid);
+
+    return ((p) && (!p->iDisconnected)) ? true : false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Write
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put received data in the ring buffer of its CID and call the CID's
+ *      callback.  Bytes that do not fit are counted as overflow and
+ *      dropped.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ *      const uint8_t *aData -- Data received
+ *      uint32_t aLen -- Number of bytes received
+ * Outputs:
+ *      bool -- true if the CID is open and took the data, false if the
+ *          data needs to go elsewhere.
+ *---------------------------------------------------------------------------*/
+bool AtCidRx_Write(uint8_t cid, const uint8_t *aData, uint32_t aLen)
+{
+    ATCIDRX_RING_T *p = IAtCidRx_Ring(cid);
+    uint16_t *pOverflow;
+    uint32_t space;
+    uint32_t run;
+
+    if ((!p) || (p->iDisconnected))
+        return false;
+
+    /* One slot always stays empty to tell full from empty */
+    if (p->iIn >= p->iOut)
+        space = ATCIDRX_RING_SIZE - 1 - (p->iIn - p->iOut);
+    else
+        space = p->iOut - p->iIn - 1;
+    if (aLen > space) {
+        pOverflow = &G_AtCidRx_Overflow[IAtCidRx_Index(cid)];
+        if ((uint32_t)*pOverflow + (aLen - space) > 0xFFFF)
+            *pOverflow = 0xFFFF;
+        else
+            *pOverflow += (uint16_t)(aLen - space);
+        aLen = space;
+    }
+
+    /* Copy in at most two pieces, up to the end and then from the start */
+    while (aLen) {
+        run = ATCIDRX_RING_SIZE - p->iIn;
+        if (run > aLen)
+            run = aLen;
+        memcpy(p->iBuffer + p->iIn, aData, run);
+        p->iIn += run;
+        if (p->iIn == ATCIDRX_RING_SIZE)
+            p->iIn = 0;
+        aData += run;
+        aLen -= run;
+    }
+
+    if (p->iCallback)
+        p->iCallback(cid);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Read
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take received data out of the ring buffer of a CID.  The ring of
+ *      a CID reported closed is released once it is empty.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ *      uint8_t *aData -- Place to store the data
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t AtCidRx_Read(uint8_t cid, uint8_t *aData, uint32_t aMaxLen)
+{
+    ATCIDRX_RING_T *p = IAtCidRx_Ring(cid);
+    uint32_t count = 0;
+    uint32_t run;
+
+    if (!p)
+        return 0;
+
+    while ((count < aMaxLen) && (p->iOut != p->iIn)) {
+        /* Contiguous bytes from iOut */
+        if (p->iIn > p->iOut)
+            run = p->iIn - p->iOut;
+        else
+            run = ATCIDRX_RING_SIZE - p->iOut;
+        if (run > (aMaxLen - count))
+            run = aMaxLen - count;
+        memcpy(aData + count, p->iBuffer + p->iOut, run);
+        p->iOut += run;
+        if (p->iOut == ATCIDRX_RING_SIZE)
+            p->iOut = 0;
+        count += run;
+    }
+    if ((p->iDisconnected) && (p->iOut == p->iIn))
+        G_AtCidRx_RingIndex[IAtCidRx_Index(cid)] = ATCIDRX_NO_RING;
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_Available
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of unread bytes of a CID.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      uint32_t -- Number of bytes waiting, 0 if not open
+ *---------------------------------------------------------------------------*/
+uint32_t AtCidRx_Available(uint8_t cid)
+{
+    ATCIDRX_RING_T *p = IAtCidRx_Ring(cid);
+
+    if (!p)
+        return 0;
+    if (p->iIn >= p->iOut)
+        return p->iIn - p->iOut;
+    return ATCIDRX_RING_SIZE - (p->iOut - p->iIn);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_GetOverflowCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of bytes dropped for a CID because its ring buffer
+ *      was full.  Stops counting at 0xFFFF.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      uint16_t -- Bytes dropped
+ *---------------------------------------------------------------------------*/
+uint16_t AtCidRx_GetOverflowCount(uint8_t cid)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+
+    if (index >= ATCIDRX_MAX_CID)
+        return 0;
+    return G_AtCidRx_Overflow[index];
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtCidRx_ClearOverflowCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Reset the overflow counter of a CID.
+ * Inputs:
+ *      uint8_t cid -- Connection id
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtCidRx_ClearOverflowCount(uint8_t cid)
+{
+    uint8_t index = IAtCidRx_Index(cid);
+
+    if (index < ATCIDRX_MAX_CID)
+        G_AtCidRx_Overflow[index] = 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  AtCidRx.c
+ *-------------------------------------------------------------------------*/
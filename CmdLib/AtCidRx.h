@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------*
+ * File:  AtCidRx.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Per connection (CID) receive buffers.  Data arriving for a CID
+ *      that has been opened here is kept in its own ring buffer instead
+ *      of going to App_ProcessIncomingData/App_ProcessIncomingSpan.
+ *-------------------------------------------------------------------------*/
+#ifndef _GS_ATCIDRX_H_
+#define _GS_ATCIDRX_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define ATCIDRX_MAX_CID             16  /* CIDs 0-f used by the S2W app */
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Called after new data has been put in the ring of the given CID */
+typedef void (*AtCidRx_Callback)(uint8_t cid);
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+void AtCidRx_Init(void);
+bool AtCidRx_Open(uint8_t cid, AtCidRx_Callback callback);
+void AtCidRx_Close(uint8_t cid);
+void AtCidRx_Disconnect(uint8_t cid);
+void AtCidRx_DisconnectAll(void);
+bool AtCidRx_IsOpen(uint8_t cid);
+bool AtCidRx_Write(uint8_t cid, const uint8_t *aData, uint32_t aLen);
+uint32_t AtCidRx_Read(uint8_t cid, uint8_t *aData, uint32_t aMaxLen);
+uint32_t AtCidRx_Available(uint8_t cid);
+uint16_t AtCidRx_GetOverflowCount(uint8_t cid);
+void AtCidRx_ClearOverflowCount(uint8_t cid);
+
+#endif /* _GS_ATCIDRX_H_ */
+/*-------------------------------------------------------------------------*
+ * End of File:  AtCidRx.h
+ *-------------------------------------------------------------------------*/
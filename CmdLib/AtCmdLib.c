@@ -18,14 +18,167 @@
 #include <ctype.h>
 #include "HostApp.h"
 #include "AtCmdLib.h"
-#include <system/console.h>
+#include "AtCidRx.h"
+#include "AtEvent.h"
+#include <system/log.h>
 #include <system/mstimer.h>
 #include <system/platform.h>
 
 /*-------------------------------------------------------------------------*
  * Constants:
  *-------------------------------------------------------------------------*/
-#define ATLIB_RESPONSE_HANDLE_TIMEOUT   20000 /* ms */
+/* Adaptive timeout = SRTT + ATLIB_TIMEOUT_VARIATION_FACTOR * RTTVAR, */
+/* with SRTT and RTTVAR gains of 1/8 and 1/4 (as for TCP, RFC 6298) */
+#define ATLIB_TIMEOUT_VARIATION_FACTOR  4
+#define ATLIB_TIMEOUT_SRTT_SHIFT        3
+#define ATLIB_TIMEOUT_RTTVAR_SHIFT      2
+#define ATLIB_RX_CHUNK_SIZE             64    /* bytes read per App_ReadAvailable */
+
+/* After a response timeout "AT" is sent (up to ATLIB_RESYNC_TRIES times) */
+/* and responses are dropped until its OK is followed by */
+/* ATLIB_RESYNC_QUIET_MS without another response line */
+#ifndef ATLIB_RESYNC_TRIES
+#define ATLIB_RESYNC_TRIES              3
+#endif
+#ifndef ATLIB_RESYNC_QUIET_MS
+#define ATLIB_RESYNC_QUIET_MS           100
+#endif
+
+/* Commands waiting behind the one being executed */
+#ifndef ATLIB_CMD_QUEUE_SIZE
+#define ATLIB_CMD_QUEUE_SIZE            2
+#endif
+
+/* Longest command (with CR LF) that can be queued */
+#ifndef ATLIB_CMD_QUEUE_CMD_SIZE
+#define ATLIB_CMD_QUEUE_CMD_SIZE        128
+#endif
+
+/* Start offsets of the response lines kept in MRBuffer */
+#ifndef ATLIB_MAX_LINES
+#define ATLIB_MAX_LINES                 12
+#endif
+
+/* Fields of a response kept by AtLib_ResponseTokenize */
+#ifndef ATLIB_MAX_TOKENS
+#define ATLIB_MAX_TOKENS                20
+#endif
+#define ATLIB_TOKENS_INVALID            0xFF  /* Response not tokenized yet */
+#define ATLIB_IP_STRING_SIZE            16    /* "255.255.255.255" */
+#define ATLIB_MAC_STRING_LENGTH         17    /* "00:00:00:00:00:00" */
+
+/* Bulk data frames: largest the module takes, smallest data worth */
+/* a bulk frame, and longest wait for the module to take a header (ms) */
+#ifndef ATLIB_BULK_MAX_SIZE
+#define ATLIB_BULK_MAX_SIZE             1400
+#endif
+#ifndef ATLIB_BULK_MIN_SIZE
+#define ATLIB_BULK_MIN_SIZE             128
+#endif
+#ifndef ATLIB_BULK_READY_TIMEOUT
+#define ATLIB_BULK_READY_TIMEOUT        100
+#endif
+
+/* Flag actions taken when a line is identified by AtLib_checkEOFMessage */
+#define ATLIB_EOF_ACTION_NONE                   0x00
+#define ATLIB_EOF_ACTION_CLEAR_ASSOCIATION      0x01
+#define ATLIB_EOF_ACTION_SET_RESET              0x02
+#define ATLIB_EOF_ACTION_CLEAR_CID              0x04
+#define ATLIB_EOF_ACTION_EVENT                  0x08 /* Post to AtEvent queue */
+
+/* Index of the first token of each group in G_AtLibEOFTokens */
+#define ATLIB_EOF_FIRST_O                       0
+#define ATLIB_EOF_FIRST_E                       4
+#define ATLIB_EOF_FIRST_I                       7
+#define ATLIB_EOF_FIRST_D                       8
+#define ATLIB_EOF_FIRST_A                       11
+#define ATLIB_EOF_FIRST_U                       12
+#define ATLIB_EOF_FIRST_S                       13
+#define ATLIB_EOF_NUM_TOKENS                    14
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    const char *iToken;         /* Text searched for in the line */
+    uint8_t iLength;            /* strlen(iToken) */
+    uint8_t iPriority;          /* 0 is highest when several tokens match */
+    uint8_t iActions;           /* ATLIB_EOF_ACTION_* flags */
+    HOST_APP_MSG_ID_E iMsgId;   /* Returned message id */
+} ATLIB_EOF_TOKEN_T;
+
+/* Converts the text of a field into a value, returns true if valid */
+typedef uint8_t (*ATLIB_TOKEN_CONVERT_T)(
+        const char *pText,
+        uint16_t length,
+        void *pValue);
+
+/* Progress through the header and payload of an <ESC> data frame */
+typedef enum {
+    ATLIB_RX_PHASE_CID = 0,
+    ATLIB_RX_PHASE_LENGTH,
+    ATLIB_RX_PHASE_DATA
+} ATLIB_RX_PHASE_E;
+
+/* Getting back in step with the module after a response timeout */
+typedef enum {
+    ATLIB_RESYNC_IDLE = 0,      /* Responses belong to the command sent */
+    ATLIB_RESYNC_WAIT_OK,       /* "AT" sent, waiting for an OK */
+    ATLIB_RESYNC_QUIET          /* OK seen, waiting for silence */
+} ATLIB_RESYNC_STATE_E;
+
+/* Limits of the adaptive timeout of a class (ms) */
+typedef struct {
+    uint32_t iInitial;          /* Used until the first round trip */
+    uint32_t iMinimum;
+    uint32_t iMaximum;          /* Also the limit of the back off */
+} ATLIB_TIMEOUT_LIMITS_T;
+
+/* Commands that are not HOST_APP_TIMEOUT_CLASS_FAST */
+typedef struct {
+    const char *iPrefix;        /* Start of the command text */
+    HOST_APP_TIMEOUT_CLASS_E iClass;
+} ATLIB_TIMEOUT_COMMAND_T;
+
+/* A command waiting for (or executing until) its response */
+typedef struct {
+    AtLib_CommandCallback iCallback;    /* Called with the response */
+    void *iContext;                     /* Passed to iCallback */
+    uint32_t iTimeout;                  /* ms allowed without a response */
+                                        /* line, or */
+                                        /* HOST_APP_TIMEOUT_ADAPTIVE */
+    uint32_t iStartTime;                /* MSTimerGet() when sent */
+    HOST_APP_TIMEOUT_CLASS_E iClass;    /* Round trip measured for */
+    uint8_t iHandle;                    /* Returned by AtLib_CommandQueue */
+    AtLib_LineCallback iLineCallback;   /* Streams the lines, or 0 */
+    void *iLineContext;                 /* Passed to iLineCallback */
+} ATLIB_CMD_T;
+
+typedef struct {
+    ATLIB_CMD_T iCmd;
+    char iText[ATLIB_CMD_QUEUE_CMD_SIZE];
+} ATLIB_CMD_QUEUE_ENTRY_T;
+
+/* Updates the library's state from the OK response of a command */
+typedef void (*ATLIB_CMD_PARSER_T)(const HOST_APP_CMD_ARG_T *pArgs);
+
+/* Entry of the command descriptor table (G_AtLibCommands).  The */
+/* conversions (%s, %u, %d, %c) of the template give the argument types. */
+typedef struct {
+    const char *iTemplate;              /* Command text without CR LF */
+    HOST_APP_TIMEOUT_CLASS_E iClass;    /* Round trip measured for */
+    ATLIB_CMD_PARSER_T iParser;         /* Called on OK, or 0 */
+} ATLIB_CMD_DESC_T;
+
+/* Everything AtLib_ReceiveDataProcess needs to resume on the next byte */
+typedef struct {
+    HOST_APP_RX_STATE_E iState;     /* Current receive state */
+    ATLIB_RX_PHASE_E iPhase;        /* Position within a data frame */
+    uint8_t iCid;                   /* Connection id of the data frame */
+    uint8_t iEscapePending;         /* ESC held back inside <ESC>S data */
+    uint8_t iLengthCharCount;       /* Length digits received so far */
+    uint32_t iDataLength;           /* Data length, then bytes remaining */
+} ATLIB_RX_CONTEXT_T;
 
 /*-------------------------------------------------------------------------*
  * Globals:
@@ -42,11 +195,169 @@ static uint8_t nodeAssociationFlag = true;
 static uint8_t nodeResetFlag = false; /* Flag to indicate whether S2w Node has rebooted after initialisation  */
 static uint8_t tcpClientCid = HOST_APP_INVALID_CID; /* TCP client CID */
 static uint8_t udpClientCid = HOST_APP_INVALID_CID; /* UDP client CID */
+static uint8_t G_AtLibBulkEnabled = false; /* AT+BDATA=1 accepted */
+
+/* Receive state machine context and worst case stall measurements */
+static ATLIB_RX_CONTEXT_T G_AtLibRx = { HOST_APP_RX_STATE_START };
+static HOST_APP_RX_STATS_T G_AtLibRxStats;
+
+/* Bytes read from the module but not processed yet */
+static uint8_t G_AtLibRxChunk[ATLIB_RX_CHUNK_SIZE];
+static uint8_t G_AtLibRxChunkIndex = 0;
+static uint8_t G_AtLibRxChunkLen = 0;
+
+/* Command queue and the command being executed */
+static ATLIB_CMD_QUEUE_ENTRY_T G_AtLibCmdQueue[ATLIB_CMD_QUEUE_SIZE];
+static uint8_t G_AtLibCmdIn = 0;
+static uint8_t G_AtLibCmdOut = 0;
+static uint8_t G_AtLibCmdCount = 0;
+static uint8_t G_AtLibCmdNextHandle = 1;
+static ATLIB_CMD_T G_AtLibCmdActive;
+static bool G_AtLibCmdIsActive = false;
+static uint32_t G_AtLibCmdLastRx;
+
+/* Response lines received, not counting event lines.  A command's */
+/* timeout restarts only when this changes, not on data frames. */
+static uint16_t G_AtLibRxLines = 0;
+
+/* Resynchronisation after a response timeout */
+static ATLIB_RESYNC_STATE_E G_AtLibResync = ATLIB_RESYNC_IDLE;
+static uint8_t G_AtLibResyncTries;
+static uint8_t G_AtLibResyncDropped;
+static uint32_t G_AtLibResyncTime;
+
+/* Round trip measurements per timeout class */
+static HOST_APP_TIMEOUT_STATS_T G_AtLibTimeouts[HOST_APP_TIMEOUT_CLASS_MAX];
+
+static const ATLIB_TIMEOUT_LIMITS_T
+        G_AtLibTimeoutLimits[HOST_APP_TIMEOUT_CLASS_MAX] = {
+    { 1000, 250, 20000 },           /* HOST_APP_TIMEOUT_CLASS_FAST */
+    { 5000, 1000, 20000 },          /* HOST_APP_TIMEOUT_CLASS_FLASH */
+    { 20000, 5000, 60000 },         /* HOST_APP_TIMEOUT_CLASS_ASSOC */
+    { 30000, 10000, 60000 },        /* HOST_APP_TIMEOUT_CLASS_PSK */
+    { 20000, 2000, 40000 },         /* HOST_APP_TIMEOUT_CLASS_CONNECT */
+    { 5000, 1000, 10000 },          /* HOST_APP_TIMEOUT_CLASS_SERVER */
+};
+
+static const ATLIB_TIMEOUT_COMMAND_T G_AtLibTimeoutCommands[] = {
+    { "AT+WA=", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+WS", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+WWPS", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+NDHCP", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+RESTORENWCONN", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+PSSTBY", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+FWUP", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "ATA", HOST_APP_TIMEOUT_CLASS_ASSOC },
+    { "AT+WPAPSK=", HOST_APP_TIMEOUT_CLASS_PSK },
+    { "AT+NCTCP=", HOST_APP_TIMEOUT_CLASS_CONNECT },
+    { "AT+NCUDP=", HOST_APP_TIMEOUT_CLASS_CONNECT },
+    { "AT+NSTCP=", HOST_APP_TIMEOUT_CLASS_CONNECT },
+    { "AT+NSUDP=", HOST_APP_TIMEOUT_CLASS_CONNECT },
+    { "AT+DNSLOOKUP=", HOST_APP_TIMEOUT_CLASS_CONNECT },
+    { "AT&W", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT&F", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "ATZ", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+STORENWCONN", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+NSET=", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+NCLOSE", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+WD", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+WM=", HOST_APP_TIMEOUT_CLASS_FLASH },
+    { "AT+VER=", HOST_APP_TIMEOUT_CLASS_FLASH },
+};
+
+/* Lines of the response in MRBuffer and start of the line being received */
+static uint16_t G_AtLibLineOffsets[ATLIB_MAX_LINES];
+static uint8_t G_AtLibLineCount = 0;
+static uint16_t G_AtLibLineStart = 0;
+
+/* Fields of the response in MRBuffer, split on first use */
+static HOST_APP_TOKEN_T G_AtLibTokens[ATLIB_MAX_TOKENS];
+static uint8_t G_AtLibTokenCount = ATLIB_TOKENS_INVALID;
+
+/* Lines identified by AtLib_checkEOFMessage.  Tokens are grouped by */
+/* their first character (see ATLIB_EOF_FIRST_*). */
+#define ATLIB_EOF_TOKEN(text)   text, sizeof(text) - 1
+static const ATLIB_EOF_TOKEN_T G_AtLibEOFTokens[ATLIB_EOF_NUM_TOKENS] = {
+    { ATLIB_EOF_TOKEN("OK"), 0,
+            ATLIB_EOF_ACTION_NONE,
+            HOST_APP_MSG_ID_OK },
+    { ATLIB_EOF_TOKEN("Out of StandBy-Alarm"), 9,
+            ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_OUT_OF_STBY_ALARM },
+    { ATLIB_EOF_TOKEN("Out of StandBy-Timer"), 10,
+            ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_OUT_OF_STBY_TIMER },
+    { ATLIB_EOF_TOKEN("Out of Deep Sleep"), 12,
+            ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_OUT_OF_DEEP_SLEEP },
+    { ATLIB_EOF_TOKEN("ERROR: IP CONFIG FAIL"), 1,
+            ATLIB_EOF_ACTION_NONE,
+            HOST_APP_MSG_ID_ERROR_IP_CONFIG_FAIL },
+    { ATLIB_EOF_TOKEN("ERROR: SOCKET FAILURE"), 2,
+            ATLIB_EOF_ACTION_CLEAR_CID,
+            HOST_APP_MSG_ID_ERROR_SOCKET_FAIL },
+    { ATLIB_EOF_TOKEN("ERROR"), 3,
+            ATLIB_EOF_ACTION_NONE,
+            HOST_APP_MSG_ID_ERROR },
+    { ATLIB_EOF_TOKEN("INVALID INPUT"), 4,
+            ATLIB_EOF_ACTION_NONE,
+            HOST_APP_MSG_ID_INVALID_INPUT },
+    { ATLIB_EOF_TOKEN("DISASSOCIATED"), 5,
+            ATLIB_EOF_ACTION_CLEAR_ASSOCIATION | ATLIB_EOF_ACTION_CLEAR_CID
+                    | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_DISASSOCIATION_EVENT },
+    { ATLIB_EOF_TOKEN("DISCONNECT"), 7,
+            ATLIB_EOF_ACTION_CLEAR_CID | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_DISCONNECT },
+    { ATLIB_EOF_TOKEN("Disassociation Event"), 8,
+            ATLIB_EOF_ACTION_CLEAR_ASSOCIATION | ATLIB_EOF_ACTION_CLEAR_CID
+                    | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_DISASSOCIATION_EVENT },
+    { ATLIB_EOF_TOKEN("APP Reset-APP SW Reset"), 6,
+            ATLIB_EOF_ACTION_CLEAR_ASSOCIATION | ATLIB_EOF_ACTION_SET_RESET
+                    | ATLIB_EOF_ACTION_CLEAR_CID | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_APP_RESET },
+    { ATLIB_EOF_TOKEN("UnExpected Warm Boot"), 11,
+            ATLIB_EOF_ACTION_CLEAR_ASSOCIATION | ATLIB_EOF_ACTION_SET_RESET
+                    | ATLIB_EOF_ACTION_CLEAR_CID | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_UNEXPECTED_WARM_BOOT },
+    { ATLIB_EOF_TOKEN("Serial2WiFi APP"), 13,
+            ATLIB_EOF_ACTION_CLEAR_ASSOCIATION | ATLIB_EOF_ACTION_SET_RESET
+                    | ATLIB_EOF_ACTION_CLEAR_CID | ATLIB_EOF_ACTION_EVENT,
+            HOST_APP_MSG_ID_WELCOME_MSG },
+};
 
 /*-------------------------------------------------------------------------*
  * Function Prototypes:
  *-------------------------------------------------------------------------*/
 void AtLib_FlushRxBuffer(void);
+static uint32_t AtLib_ReceiveDataSpan(
+        const uint8_t *rxBuf,
+        uint32_t bufLen,
+        HOST_APP_MSG_ID_E *pMsgId);
+static uint32_t AtLib_ReceiveNext(HOST_APP_MSG_ID_E *pMsgId);
+static HOST_APP_MSG_ID_E AtLib_ReceiveAvailable(uint32_t *pNumBytes);
+static uint8_t AtLib_LineStream(uint8_t isPartial);
+static void AtLib_LineAdd(void);
+static void AtLib_CommandStart(
+        const char *pCommand,
+        const ATLIB_CMD_T *pCmd);
+static uint8_t AtLib_CommandAdd(
+        const char *pCommand,
+        const ATLIB_CMD_T *pCmd);
+static HOST_APP_MSG_ID_E AtLib_CommandSendClass(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        AtLib_LineCallback lineCallback,
+        void *pContext);
+static uint8_t AtLib_ResponseConnectCid(void);
+static void AtLib_CommandSendDone(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext);
+static uint8_t AtLib_IsEventMessage(HOST_APP_MSG_ID_E msgId);
+static void AtLib_CountStaleResponses(uint8_t count);
+static void AtLib_ResyncSend(void);
+static void AtLib_ResyncCheck(void);
 
 /*---------------------------<AT command list >--------------------------------------------------------------------------
  _________________________________________________________________________________________________________________________
@@ -329,2199 +640,2395 @@ void AtLib_FlushRxBuffer(void);
  _________________________________________________________________________________________________________________________*/
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Check
+ * Routine:  AtLib_CommandParseTcpClient
  *---------------------------------------------------------------------------*
  * Description:
- *      Send command:
- *          AT
- *      and wait for response.
+ *      Save the CID of a TCP client connection that was opened.
  * Inputs:
- *      void
+ *      const HOST_APP_CMD_ARG_T *pArgs -- not used
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_Check(void)
+static void AtLib_CommandParseTcpClient(const HOST_APP_CMD_ARG_T *pArgs)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "\r\nAT\r\n");
+    uint8_t cid = AtLib_ResponseConnectCid();
 
-    rxMsgId = AtLib_CommandSend();
+    (void)pArgs;
 
-    return rxMsgId;
+    if (HOST_APP_INVALID_CID != cid)
+        AtLib_SaveTcpCid(cid);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Check
+ * Routine:  AtLib_CommandParseUdpClient
  *---------------------------------------------------------------------------*
  * Description:
- *      Send command to turn on or off the character echo:
- *          ATE<0|1>
- *      and wait for response.
+ *      Save the CID of a UDP client connection that was opened.
  * Inputs:
- *      uint8_t mode -- 1=to turn on echo, 0=turn off echo
+ *      const HOST_APP_CMD_ARG_T *pArgs -- not used
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetEcho(uint8_t mode)
+static void AtLib_CommandParseUdpClient(const HOST_APP_CMD_ARG_T *pArgs)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    uint8_t cid = AtLib_ResponseConnectCid();
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATE" _F8_ "\r\n", mode);
+    (void)pArgs;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    if (HOST_APP_INVALID_CID != cid)
+        AtLib_SaveUdpCid(cid);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_MACSet
+ * Routine:  AtLib_CommandParseCloseAll
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the network MAC address for this module.
- *      Sends the command:
- *          AT+NMAC=<mac address>
- *      and waits for a response.
- *      <mac address> is the format "00:11:22:33:44:55"
+ *      Forget the saved CIDs once all connections are closed.
  * Inputs:
- *      uint8_t mode -- 1=to turn on echo, 0=turn off echo
+ *      const HOST_APP_CMD_ARG_T *pArgs -- not used
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_MACSet(int8_t *pAddr)
+static void AtLib_CommandParseCloseAll(const HOST_APP_CMD_ARG_T *pArgs)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NMAC=%s\r\n", pAddr);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    (void)pArgs;
+    AtLib_ClearAllCid();
 }
+
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_ATA
+ * Routine:  AtLib_CommandParseBData
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the network MAC address for this module.
- *      Sends the command:
- *          ATA
- *      and waits for a response"CONNECT"
+ *      Remember if bulk data mode is on (see AtLib_SendTcpDataAuto).
  * Inputs:
- *      
+ *      const HOST_APP_CMD_ARG_T *pArgs -- Arguments of AT+BDATA=<mode>
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_ATA(void)
-{
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATA\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+static void AtLib_CommandParseBData(const HOST_APP_CMD_ARG_T *pArgs)
+{
+    G_AtLibBulkEnabled = (pArgs[0].iNumber) ? true : false;
+}
+
+/* Commands sent by AtLib_CommandExecute, one entry for each HOST_APP_CMD_E */
+static const ATLIB_CMD_DESC_T G_AtLibCommands[HOST_APP_CMD_MAX] = {
+    [HOST_APP_CMD_CHECK] = { "\r\nAT", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SET_ECHO] = { "ATE%u", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_MAC_SET] = { "AT+NMAC=%s", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_ATA] = { "ATA", HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_GET_MAC] = { "AT+NMAC=?", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_CALC_PSK] = { "AT+WPAPSK=%s,%s",
+            HOST_APP_TIMEOUT_CLASS_PSK, 0 },
+    [HOST_APP_CMD_SET_WEP1] = { "AT+WWEP1=%s",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_WLAN_CONN_STAT] = { "AT+NSTAT=?",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SET_WAUTH] = { "AT+WAUTH=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SET_SECURITY] = { "AT+WSEC=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_DHCP_SET] = { "AT+NDHCP=%u",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_ASSOC] = { "AT+WA=%s,%s,%s",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_ASSOC_SSID] = { "AT+WA=%s",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_TCP_CLIENT] = { "AT+NCTCP=%s,%s",
+            HOST_APP_TIMEOUT_CLASS_CONNECT, AtLib_CommandParseTcpClient },
+    [HOST_APP_CMD_UDP_CLIENT] = { "AT+NCUDP=%s,%s,%s",
+            HOST_APP_TIMEOUT_CLASS_CONNECT, AtLib_CommandParseUdpClient },
+    [HOST_APP_CMD_CLOSE_ALL] = { "AT+NCLOSEALL",
+            HOST_APP_TIMEOUT_CLASS_FLASH, AtLib_CommandParseCloseAll },
+    [HOST_APP_CMD_BATTERY_CHK_START] = { "AT+BCHKSTRT=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_GOTO_STANDBY] = { "AT+PSSTBY=%s,%u,%u,%u",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_SET_PASSPHRASE] = { "AT+WWPA=%s",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_DEEP_SLEEP] = { "AT+PSDPSLEEP",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_STORE_NW_CONN] = { "AT+STORENWCONN",
+            HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_RESTORE_NW_CONN] = { "AT+RESTORENWCONN",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_IP_SET] = { "AT+NSET=%s,%s,%s",
+            HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_SAVE_PROFILE] = { "AT&W%u",
+            HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_LOAD_PROFILE] = { "ATZ%u", HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_FACTORY_DEFAULTS] = { "AT&F",
+            HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_GET_RSSI] = { "AT+WRSSI=?", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_DISASSOC] = { "AT+WD", HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_FW_UPGRADE] = { "AT+FWUP=%s,%u,%u,%s",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_BATTERY_CHK_STOP] = { "AT+BCHKSTOP",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_MULTICAST] = { "AT+MCSTSET=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_VERSION] = { "AT+VER=?", HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_MODE] = { "AT+WM=%u", HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_UDP_SERVER] = { "AT+NSUDP=%s",
+            HOST_APP_TIMEOUT_CLASS_CONNECT, 0 },
+    [HOST_APP_CMD_TCP_SERVER] = { "AT+NSTCP=%s",
+            HOST_APP_TIMEOUT_CLASS_CONNECT, 0 },
+    [HOST_APP_CMD_DNS_LOOKUP] = { "AT+DNSLOOKUP=%s",
+            HOST_APP_TIMEOUT_CLASS_CONNECT, 0 },
+    [HOST_APP_CMD_CLOSE] = { "AT+NCLOSE=%c", HOST_APP_TIMEOUT_CLASS_FLASH, 0 },
+    [HOST_APP_CMD_SET_WRETRY] = { "AT+WRETRY=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_GET_ERR_COUNT] = { "AT+ERRCOUNT=?",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_ENABLE_RADIO] = { "AT+WRXACTIVE=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_ENABLE_PW_SAVE] = { "AT+WRXPS=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SET_TIME] = { "AT+SETTIME=%s,%s",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_EXTERNAL_PA] = { "AT+EXTPA=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SYNC_LOSS_INTERVAL] = { "AT+WSYNCINTRL=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_PS_POLL_INTERVAL] = { "AT+PSPOLLINTRL=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_SET_TX_POWER] = { "AT+WP=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_DNS_SET] = { "AT+DNSSET=%s",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_DNS_SET2] = { "AT+DNSSET=%s,%s",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_AUTO_CONNECT] = { "ATC%u", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_STORE_WAUTO] = { "AT+WAUTO=0,%s,,%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_STORE_NAUTO] = { "AT+NAUTO=0,0,%s,%d",
+            HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_STORE_ATS] = { "ATS%u=%u", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+    [HOST_APP_CMD_BDATA] = { "AT+BDATA=%u",
+            HOST_APP_TIMEOUT_CLASS_FAST, AtLib_CommandParseBData },
+    [HOST_APP_CMD_WPS_PUSH] = { "AT+WWPS=1", HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_WPS_PIN] = { "AT+WWPS=2,%s",
+            HOST_APP_TIMEOUT_CLASS_ASSOC, 0 },
+    [HOST_APP_CMD_SET_BAUD] = { "ATB=%u", HOST_APP_TIMEOUT_CLASS_FAST, 0 },
+};
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_FormatNumber
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write a number in decimal.
+ * Inputs:
+ *      char *p -- Place to write the digits
+ *      const char *pEnd -- End of the room for the digits
+ *      uint32_t value -- Number to write
+ * Outputs:
+ *      char * -- Place after the digits, or 0 if there is not enough room
+ *---------------------------------------------------------------------------*/
+static char *AtLib_FormatNumber(char *p, const char *pEnd, uint32_t value)
+{
+    char digits[10];
+    uint8_t count = 0;
+
+    do {
+        digits[count++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value);
+
+    if ((pEnd - p) < count)
+        return 0;
+    while (count)
+        *p++ = digits[--count];
 
-    return rxMsgId;
+    return p;
 }
 
-HOST_APP_MSG_ID_E AtLibGs_ATZ1(void)
-{
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATZ1\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-}
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_GetMAC
+ * Routine:  AtLib_CommandFormat
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the network MAC address for this module.
- *      Sends the command:
- *          AT+NMAC=?
- *      and waits for a response.
- *      Then call AtLib_ParseGetMacResponse() to get the response.
+ *      Build the text of a command in G_ATCmdBuf from its template,
+ *      followed by CR LF.  Each % of the template takes the next
+ *      argument:
+ *          %s -- iString (0 gives nothing)
+ *          %u -- iNumber in decimal
+ *          %d -- iNumber as an int32_t in decimal
+ *          %c -- iNumber as one character
  * Inputs:
- *      void
+ *      const char *pTemplate -- Command template
+ *      const HOST_APP_CMD_ARG_T *pArgs -- Arguments of the template
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if built, false if too long for G_ATCmdBuf
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_GetMAC(void)
+static uint8_t AtLib_CommandFormat(
+        const char *pTemplate,
+        const HOST_APP_CMD_ARG_T *pArgs)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    /* Leave room for the CR LF and the terminator */
+    const char *pEnd = G_ATCmdBuf + HOST_APP_TX_CMD_MAX_SIZE - 3;
+    char *p = G_ATCmdBuf;
+    const char *pString;
+    uint32_t value;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NMAC=?\r\n");
+    while ((*pTemplate) && (p)) {
+        if (*pTemplate != '%') {
+            if (p == pEnd)
+                return false;
+            *p++ = *pTemplate++;
+            continue;
+        }
+        pTemplate++;
+        switch (*pTemplate++) {
+            case 's':
+                pString = pArgs->iString;
+                if (pString) {
+                    while (*pString) {
+                        if (p == pEnd)
+                            return false;
+                        *p++ = *pString++;
+                    }
+                }
+                break;
+            case 'c':
+                if (p == pEnd)
+                    return false;
+                *p++ = (char)pArgs->iNumber;
+                break;
+            case 'd':
+                value = pArgs->iNumber;
+                if ((int32_t)value < 0) {
+                    if (p == pEnd)
+                        return false;
+                    *p++ = '-';
+                    value = 0 - value;
+                }
+                p = AtLib_FormatNumber(p, pEnd, value);
+                break;
+            default:
+                p = AtLib_FormatNumber(p, pEnd, pArgs->iNumber);
+                break;
+        }
+        pArgs++;
+    }
+    if (!p)
+        return false;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    *p++ = '\r';
+    *p++ = '\n';
+    *p = '\0';
 
-    return rxMsgId;
+    return true;
 }
+
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_CalcNStorePSK
+ * Routine:  AtLib_CommandExecute
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the network MAC address for this module.
- *      Sends the command:
- *          AT+WPAPSK=<SSID>,<PassPhrase>
- *      and waits for a response.
+ *      Send a command of the descriptor table (G_AtLibCommands) and wait
+ *      for the response.  The text is built from the command's template
+ *      and arguments (see AtLib_CommandFormat) and the module is given
+ *      the adaptive timeout of the command's class.  When the module
+ *      answers OK, the command's parser (if any) updates the library's
+ *      state from the response.  The AtLibGs_* routines in AtCmdLib.h
+ *      call this with their arguments.
  * Inputs:
- *      int8_t *pSsid -- SSID (1 to 32 characters)
- *      int8_t *pPsk -- Pass phrase (8 to 63 characters)
+ *      HOST_APP_CMD_E cmd -- Command to send
+ *      const HOST_APP_CMD_ARG_T *pArgs -- One argument for each % of the
+ *          template, or 0 if none
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      HOST_APP_MSG_ID_E -- response type, HOST_APP_MSG_ID_INVALID_INPUT
+ *          if the command is too long
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_CalcNStorePSK(int8_t *pSsid, int8_t *pPsk)
+HOST_APP_MSG_ID_E AtLib_CommandExecute(
+        HOST_APP_CMD_E cmd,
+        const HOST_APP_CMD_ARG_T *pArgs)
 {
+    const ATLIB_CMD_DESC_T *pDesc = &G_AtLibCommands[cmd];
     HOST_APP_MSG_ID_E rxMsgId;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WPAPSK=%s,%s\r\n", pSsid, pPsk);
+    /* Let the commands already queued go first.  Their callbacks may */
+    /* queue more commands, which are built in G_ATCmdBuf too */
+    while (AtLib_IsCommandBusy())
+        AtLib_Poll();
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (!AtLib_CommandFormat(pDesc->iTemplate, pArgs))
+        return HOST_APP_MSG_ID_INVALID_INPUT;
+
+    rxMsgId = AtLib_CommandSendClass(pDesc->iClass, 0, 0);
+    if ((HOST_APP_MSG_ID_OK == rxMsgId) && (pDesc->iParser))
+        pDesc->iParser(pArgs);
 
     return rxMsgId;
 }
+
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_WEP1
+ * Routine:  AtLib_CommandExecuteAsync
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the WEP key for association
- *      and waits for a response.
+ *      Same as AtLib_CommandExecute but the command is queued (see
+ *      AtLib_CommandQueue) with the adaptive timeout of its class.  The
+ *      command's parser is not called; the callback gets the response.
  * Inputs:
- *      int8_t *pWEP -- Pass phrase (10-26 characters)
+ *      HOST_APP_CMD_E cmd -- Command to send
+ *      const HOST_APP_CMD_ARG_T *pArgs -- One argument for each % of the
+ *          template, or 0 if none
+ *      AtLib_CommandCallback callback -- Routine to call with the
+ *          response, or 0 for none
+ *      void *pContext -- Passed to the callback
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Handle passed to the callback, or 0 if the queue is
+ *          full or the command is too long
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetWEP1( int8_t *pWEP)
+uint8_t AtLib_CommandExecuteAsync(
+        HOST_APP_CMD_E cmd,
+        const HOST_APP_CMD_ARG_T *pArgs,
+        AtLib_CommandCallback callback,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    ATLIB_CMD_T queued;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WWEP1=%s\r\n", pWEP);
+    if (!AtLib_CommandFormat(G_AtLibCommands[cmd].iTemplate, pArgs))
+        return 0;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    queued.iCallback = callback;
+    queued.iContext = pContext;
+    queued.iTimeout = HOST_APP_TIMEOUT_ADAPTIVE;
+    queued.iClass = G_AtLibCommands[cmd].iClass;
+    queued.iLineCallback = 0;
+    queued.iLineContext = pContext;
 
-    return rxMsgId;
+    return AtLib_CommandAdd(G_ATCmdBuf, &queued);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_WlanConnStat
+ * Routine:  AtLibGs_SwitchFromAutoToCmd
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the network MAC address for this module.
- *      Sends the command:
- *          AT+NSTAT=?
- *      and waits for a response.
- *      Use the routine AtLib_ParseNodeIpAddress() or
- *      AtLib_ParseRssiResponse() to parse the returned data for RSSI or
- *      AtLib_ParseWlanConnStat() to parse for the wireless connection status.
+ *      Leave auto connection (data) mode and go back to command mode by
+ *      sending +++, waiting a second and sending CR LF.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_WlanConnStat(void)
+void AtLibGs_SwitchFromAutoToCmd(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    App_Write((const uint8_t *)"+++", 3);
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NSTAT=?\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    MSTimerDelay(1000);
 
-    return rxMsgId;
+    App_Write((const uint8_t *)"\r\n", 2);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetWAUTH
+ * Routine:  AtLib_LineAdd
  *---------------------------------------------------------------------------*
  * Description:
- *      Set authentication mode.
- *      Sends the command:
- *          AT+WAUTH=<0|1|2>
- *      and waits for a response.
+ *      Record the line just completed in MRBuffer in the line index and
+ *      start the next line after it.  Lines past ATLIB_MAX_LINES stay in
+ *      MRBuffer but are not indexed.
  * Inputs:
- *      uint8_t mode -- 0=None, 1=Open, 2=Share with WEP 
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetWAUTH(uint8_t mode)
+static void AtLib_LineAdd(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WAUTH=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    if (G_AtLibLineCount < ATLIB_MAX_LINES)
+        G_AtLibLineOffsets[G_AtLibLineCount++] = G_AtLibLineStart;
+    G_AtLibLineStart = MRBufferIndex;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetSecurityType
+ * Routine:  AtLib_LineStream
  *---------------------------------------------------------------------------*
  * Description:
- *      Set authentication mode.
- *      Sends the command:
- *          AT+WSEC=  
- *                  0       Auto
- *                  1       Open
- *                  2       Wep
- *                  4       WPA
- *                  8       WPA2
- *                  16      WPA  - Enterprise
- *                  32      WPA2 - Enterprise
- *                  64      WPA2 - acs +tkip security
- *      and waits for a response.
+ *      If the executing command streams its response, hand the line
+ *      being received to its line callback (without CR LF) and empty
+ *      MRBuffer for the next one.
  * Inputs:
- *      uint8_t mode -- 0=disable DHCP, 1=enable DHCP
+ *      uint8_t isPartial -- true if MRBuffer is full and the line
+ *          continues
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if the line was streamed, false if it stays in
+ *          MRBuffer
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetSecurityType(uint8_t type)
+static uint8_t AtLib_LineStream(uint8_t isPartial)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const char *pLine = (const char *)MRBuffer + G_AtLibLineStart;
+    uint16_t length = MRBufferIndex - G_AtLibLineStart;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WSEC="_F8_"\r\n", type);
+    if ((!G_AtLibCmdIsActive) || (!G_AtLibCmdActive.iLineCallback))
+        return false;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (!isPartial) {
+        while ((length) && ((pLine[length - 1] == HOST_APP_LF_CHAR)
+                || (pLine[length - 1] == HOST_APP_CR_CHAR)))
+            length--;
+    }
+    G_AtLibCmdActive.iLineCallback(pLine, length, isPartial,
+            G_AtLibCmdActive.iLineContext);
 
-    return rxMsgId;
+    MRBufferIndex = G_AtLibLineStart;
+
+    return true;
 }
+
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_DHCPSet
+ * Routine:  AtLib_ResponseNumLines
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable or disable DHCP.
- *      Sends the command:
- *          AT+NDHCP=<0|1>
- *      and waits for a response.
+ *      Get the number of lines of the last response kept in MRBuffer.
  * Inputs:
- *      uint8_t mode -- 0=disable DHCP, 1=enable DHCP
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Number of lines (at most ATLIB_MAX_LINES)
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_DHCPSet(uint8_t mode)
+uint8_t AtLib_ResponseNumLines(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NDHCP=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return G_AtLibLineCount;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Assoc
+ * Routine:  AtLib_ResponseLine
  *---------------------------------------------------------------------------*
  * Description:
- *      Associate to network or form ad-hoc network
- *      Sends the command:
- *          AT+WA=<SSID>[[,<BSSID>][,<Ch>]]
- *      and waits for a response.
+ *      Get a line of the last response without searching MRBuffer.  The
+ *      line is not terminated and stays valid until the next response
+ *      starts arriving.
  * Inputs:
- *      int8_t *pSsid -- SSID to connect to (1 to 32 characters)
- *      int8_t *pBssid -- Ad-hoc network id, or 0 for none
- *      int8_t *pChan -- Channel of network
+ *      uint8_t index -- Line number, from 0
+ *      uint16_t *pLength -- Place to store the length without CR LF
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      const char * -- Start of the line, or 0 if there are not that many
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_Assoc(int8_t *pSsid, int8_t *pBssid, int8_t *pChan)
+const char *AtLib_ResponseLine(uint8_t index, uint16_t *pLength)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const char *pLine;
+    uint16_t length = 0;
 
-    /* Construct the AT command */
-    if (pChan) {
-        sprintf(G_ATCmdBuf, "AT+WA=%s,%s,%s\r\n", pSsid,
-                (pBssid) ? pBssid : "", pChan);
-    } else {
-        sprintf(G_ATCmdBuf, "AT+WA=%s\r\n", pSsid);
-    }
+    if (index >= G_AtLibLineCount)
+        return 0;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    pLine = (const char *)MRBuffer + G_AtLibLineOffsets[index];
+    while ((pLine[length] != HOST_APP_LF_CHAR) && (pLine[length] != '\0'))
+        length++;
+    if ((length) && (pLine[length - 1] == HOST_APP_CR_CHAR))
+        length--;
+    *pLength = length;
 
-    return rxMsgId;
+    return pLine;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_TcpClientStart
+ * Routine:  AtLib_TokenToInt
  *---------------------------------------------------------------------------*
  * Description:
- *      Open TCP client connection.
- *      Sends the command:
- *          AT+NCTCP=<IP>,<Port>
- *      and waits for a response.
- *      <IP> is in the format "12:34:56:78"
- *      <Port> is the number of the port connection.
- *      Use AtLib_ParseTcpClientCid() afterward to parse the response.
+ *      Convert the text of a field holding a decimal number with an
+ *      optional sign.
  * Inputs:
- *      int8_t *pRemoteTcpSrvIp -- IP address string in format 12:34:56:78
- *      int8_t *pRemoteTcpSrvPort -- Port string
+ *      const char *pText -- Field text (not terminated)
+ *      uint16_t length -- Number of characters
+ *      void *pValue -- int32_t to store the number
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if the whole field is a number that fits an
+ *          int32_t, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_TcpClientStart(
-        int8_t *pRemoteTcpSrvIp,
-        int8_t *pRemoteTcpSrvPort)
+static uint8_t AtLib_TokenToInt(const char *pText, uint16_t length, void *pValue)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NCTCP=%s,%s\r\n", pRemoteTcpSrvIp,
-            pRemoteTcpSrvPort);
+    const char *pEnd = pText + length;
+    uint8_t negative = false;
+    uint32_t value = 0;
+    uint32_t digit;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if ((pText < pEnd) && ((*pText == '-') || (*pText == '+'))) {
+        negative = (*pText == '-') ? true : false;
+        pText++;
+    }
+    if (pText == pEnd)
+        return false;
+    while (pText < pEnd) {
+        if (!isdigit((uint8_t)*pText))
+            return false;
+        digit = *pText++ - '0';
+        if (value > (0x7FFFFFFFUL - digit) / 10)
+            return false;
+        value = (value * 10) + digit;
+    }
+    *(int32_t *)pValue = (negative) ? -(int32_t)value : (int32_t)value;
 
-    return rxMsgId;
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_UdpClientStart
+ * Routine:  AtLib_TokenToIP
  *---------------------------------------------------------------------------*
  * Description:
- *      Open UDP client
- *      Sends the command:
- *          AT+NCUDP=<IP>,<RemotePort>,[<LocalPort>]
- *      and waits for a response.
- *      <IP> is in the format "12:34:56:78"
- *      <RemotePort> is the number of the port connection.
- *      <LocalPort> is the port on this machine.
- *      Use AtLib_ParseUdpClientCid() afterward to parse the response.
+ *      Convert the text of a field holding a dotted IP address
+ *      (e.g. "192.168.1.5").
  * Inputs:
- *      int8_t *pRemoteUdpSrvIp -- IP address string in format 12:34:56:78
- *      int8_t *pRemoteUdpSrvPort -- Remote connection port string
- *      int8_t *pUdpLocalPort -- Local port string
+ *      const char *pText -- Field text (not terminated)
+ *      uint16_t length -- Number of characters
+ *      void *pValue -- uint8_t[4] to store the address
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if the whole field is an IP address, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_UdpClientStart(
-        int8_t *pRemoteUdpSrvIp,
-        int8_t *pRemoteUdpSrvPort,
-        int8_t *pUdpLocalPort)
+static uint8_t AtLib_TokenToIP(const char *pText, uint16_t length, void *pValue)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const char *pEnd = pText + length;
+    uint8_t *pIp = (uint8_t *)pValue;
+    uint16_t octet;
+    uint8_t digits;
+    uint8_t i;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NCUDP=%s,%s,%s\r\n", pRemoteUdpSrvIp,
-            pRemoteUdpSrvPort, pUdpLocalPort);
-
-    /* Send command to S2w App node */
-    ConsolePrintf("{\r\n");
-    rxMsgId = AtLib_CommandSend();
-    ConsolePrintf("}\r\n");
+    for (i = 0; i < 4; i++) {
+        if (i) {
+            if ((pText == pEnd) || (*pText != '.'))
+                return false;
+            pText++;
+        }
+        octet = 0;
+        for (digits = 0; (pText < pEnd) && isdigit((uint8_t)*pText); digits++)
+            octet = (octet * 10) + (*pText++ - '0');
+        if ((digits == 0) || (digits > 3) || (octet > 255))
+            return false;
+        pIp[i] = (uint8_t)octet;
+    }
 
-    return rxMsgId;
+    return (pText == pEnd) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_CloseAll
+ * Routine:  AtLib_TokenToMAC
  *---------------------------------------------------------------------------*
  * Description:
- *      Close all open connections.
- *      Sends the command:
- *          AT+NCLOSEALL
- *      and waits for a response.
+ *      Convert the text of a field holding a MAC address
+ *      (e.g. "00:1D:C9:01:02:03").
  * Inputs:
- *      void
+ *      const char *pText -- Field text (not terminated)
+ *      uint16_t length -- Number of characters
+ *      void *pValue -- uint8_t[6] to store the address
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if the whole field is a MAC address, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_CloseAll(void)
+static uint8_t AtLib_TokenToMAC(const char *pText, uint16_t length, void *pValue)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NCLOSEALL\r\n");
+    uint8_t *pMac = (uint8_t *)pValue;
+    uint8_t nibble;
+    uint8_t i;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (length != ATLIB_MAC_STRING_LENGTH)
+        return false;
+    for (i = 0; i < ATLIB_MAC_STRING_LENGTH; i++) {
+        if ((i % 3) == 2) {
+            if (pText[i] != ':')
+                return false;
+            continue;
+        }
+        if (isdigit((uint8_t)pText[i]))
+            nibble = pText[i] - '0';
+        else if (isxdigit((uint8_t)pText[i]))
+            nibble = (toupper((uint8_t)pText[i]) - 'A') + 10;
+        else
+            return false;
+        if ((i % 3) == 0)
+            pMac[i / 3] = nibble << 4;
+        else
+            pMac[i / 3] |= nibble;
+    }
 
-    return rxMsgId;
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_BatteryChkStart
+ * Routine:  AtLib_ResponseTokenize
  *---------------------------------------------------------------------------*
  * Description:
- *      Start the batt check.
- *      Sends the command:
- *          AT+BCHKSTRT=<Measure interval>
- *      and waits for a response.
+ *      Split the response in MRBuffer into fields in one pass.  Fields
+ *      are separated by white space.  A field is "key=value", "key:value"
+ *      (only if the key is all letters and the field is not a MAC
+ *      address) or a value on its own.  A single word just before a
+ *      "key=value" on the same line is part of the key ("IP addr=").
+ *      A value in quotes may hold spaces.  Nothing is copied; the fields
+ *      point into MRBuffer.
  * Inputs:
- *      uint32_t interval -- Interval of 1..100
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_BatteryChkStart(uint32_t interval)
-{
-    HOST_APP_MSG_ID_E rxMsgId;
+static void AtLib_ResponseTokenize(void)
+{
+    const char *p = (const char *)MRBuffer;
+    const char *pEnd = p + HOST_APP_RX_CMD_MAX_SIZE - 1;
+    const char *pWord;
+    const char *pSep;
+    HOST_APP_TOKEN_T *pToken;
+    HOST_APP_TOKEN_T *pPrev = 0;
+    uint8_t mac[6];
+
+    G_AtLibTokenCount = 0;
+    while ((p < pEnd) && (*p) && (G_AtLibTokenCount < ATLIB_MAX_TOKENS)) {
+        if (isspace((uint8_t)*p)) {
+            /* A key never continues onto the next line */
+            if ((*p == HOST_APP_CR_CHAR) || (*p == HOST_APP_LF_CHAR))
+                pPrev = 0;
+            p++;
+            continue;
+        }
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+BCHKSTRT=" _F32_ "\r\n", interval);
+        /* Find the end of the field and its first '=' */
+        pWord = p;
+        pSep = 0;
+        while ((p < pEnd) && (*p) && (!isspace((uint8_t)*p))) {
+            if ((*p == '=') && (!pSep)) {
+                pSep = p;
+                if (p[1] == '"') {
+                    /* Quoted value, up to and including the closing quote */
+                    for (p += 2; (p < pEnd) && (*p) && (*p != '"'); p++)
+                        ;
+                    if ((p < pEnd) && (*p == '"'))
+                        p++;
+                    break;
+                }
+            }
+            p++;
+        }
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+        if (!pSep) {
+            /* "IP:10.0.0.1" but not "AB:CD:EF:01:02:03" */
+            for (pSep = pWord; (pSep < p) && isalpha((uint8_t)*pSep); pSep++)
+                ;
+            if ((pSep == pWord) || (pSep == p) || (*pSep != ':')
+                    || AtLib_TokenToMAC(pWord, p - pWord, mac))
+                pSep = 0;
+        }
 
-    return rxMsgId;
+        if ((pSep) && (pPrev) && (!pPrev->iKey)
+                && (pPrev->iValue + pPrev->iValueLen + 1 == pWord)) {
+            /* "IP addr=...", replace the word by the whole field */
+            pToken = pPrev;
+            pWord = pPrev->iValue;
+        } else {
+            pToken = &G_AtLibTokens[G_AtLibTokenCount++];
+        }
+
+        if (pSep) {
+            pToken->iKey = pWord;
+            pToken->iKeyLen = pSep - pWord;
+            pToken->iValue = pSep + 1;
+            pToken->iValueLen = p - (pSep + 1);
+            if ((pToken->iValueLen) && (pToken->iValue[0] == '"')) {
+                pToken->iValue++;
+                pToken->iValueLen--;
+                if ((pToken->iValueLen)
+                        && (pToken->iValue[pToken->iValueLen - 1] == '"'))
+                    pToken->iValueLen--;
+            }
+        } else {
+            pToken->iKey = 0;
+            pToken->iKeyLen = 0;
+            pToken->iValue = pWord;
+            pToken->iValueLen = p - pWord;
+        }
+        pPrev = pToken;
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_GotoSTNDBy
+ * Routine:  AtLib_ResponseNumTokens
  *---------------------------------------------------------------------------*
  * Description:
- *      Start the batt check.
- *      Sends the command:
- *          AT+PSSTBY=x[,<DELAY TIME>,<ALARM1 POL>,<ALARM2 POL>]
- *      and waits for a response.
+ *      Get the number of fields in the last response, splitting it up
+ *      first if not already done.
  * Inputs:
- *      uint32_t *nsec -- Standby time in milliseconds
- *      uint32_t dealy -- Delay time in milliseconds before going into
- *                          standby.
- *      uint32_t alarm1_Pol -- polarity of pin 31 that will trigger an alarm
- *      uint32_t alarm2_Pol -- polarity of pin 36 that will trigger an alarm
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Number of fields (at most ATLIB_MAX_TOKENS)
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_GotoSTNDBy(
-        int8_t *nsec,
-        uint32_t dealy,
-        uint32_t alarm1_Pol,
-        uint32_t alarm2_Pol)
+uint8_t AtLib_ResponseNumTokens(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+PSSTBY=%s," _F32_ "," _F32_ "," _F32_ "\r\n", nsec, dealy, alarm1_Pol,
-            alarm2_Pol);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (G_AtLibTokenCount == ATLIB_TOKENS_INVALID)
+        AtLib_ResponseTokenize();
 
-    return rxMsgId;
+    return G_AtLibTokenCount;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetPassPhrase
+ * Routine:  AtLib_ResponseToken
  *---------------------------------------------------------------------------*
  * Description:
- *      Set WPA passphrase (8 - 63 chars).
- *      Sends the command:
- *          AT+WWPA=<passphrase>
- *      and waits for a response.
+ *      Get a field of the last response by position.  The field stays
+ *      valid until the next response starts arriving.
  * Inputs:
- *      int8_t *pPhrase -- Passphrase string (8 - 63 characters)
+ *      uint8_t index -- Field number, from 0
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      const HOST_APP_TOKEN_T * -- Field, or 0 if there are not that many
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetPassPhrase(int8_t *pPhrase)
+const HOST_APP_TOKEN_T *AtLib_ResponseToken(uint8_t index)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WWPA=%s\r\n", pPhrase);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (index >= AtLib_ResponseNumTokens())
+        return 0;
 
-    return rxMsgId;
+    return &G_AtLibTokens[index];
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetPassPhrase
+ * Routine:  AtLib_ResponseFind
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable deep sleep.
- *      Sends the command:
- *          AT+PSDPSLEEP
- *      and waits for a response.
+ *      Find the first field of the last response with the given key.
  * Inputs:
- *      void
+ *      const char *pKey -- Key to look for (e.g. "IP addr")
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      const HOST_APP_TOKEN_T * -- Field, or 0 if not found
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_EnableDeepSleep(void)
+const HOST_APP_TOKEN_T *AtLib_ResponseFind(const char *pKey)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    uint16_t keyLen = strlen(pKey);
+    uint8_t count = AtLib_ResponseNumTokens();
+    uint8_t i;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+PSDPSLEEP\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    for (i = 0; i < count; i++) {
+        if ((G_AtLibTokens[i].iKey) && (G_AtLibTokens[i].iKeyLen == keyLen)
+                && (memcmp(G_AtLibTokens[i].iKey, pKey, keyLen) == 0))
+            return &G_AtLibTokens[i];
+    }
 
-    return rxMsgId;
+    return 0;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_StoreNwConn
+ * Routine:  AtLib_ResponseFindValue
  *---------------------------------------------------------------------------*
  * Description:
- *      Store the network context.
- *      Sends the command:
- *          AT+STORENWCONN
- *      and waits for a response.
+ *      Find a field and convert its value.  With a key, the first field
+ *      with that key must convert.  Without a key (0), the first field
+ *      that has no key and converts is used (e.g. the "-45" returned by
+ *      AT+WRSSI=?).
  * Inputs:
- *      void
+ *      const char *pKey -- Key to look for, or 0
+ *      ATLIB_TOKEN_CONVERT_T convert -- Conversion of the value text
+ *      void *pValue -- Place to store the converted value
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      const HOST_APP_TOKEN_T * -- Field converted, or 0 if none
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StoreNwConn(void)
+static const HOST_APP_TOKEN_T *AtLib_ResponseFindValue(
+        const char *pKey,
+        ATLIB_TOKEN_CONVERT_T convert,
+        void *pValue)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const HOST_APP_TOKEN_T *pToken;
+    uint8_t count;
+    uint8_t i;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+STORENWCONN\r\n");
+    if (pKey) {
+        pToken = AtLib_ResponseFind(pKey);
+        if ((pToken) && (convert(pToken->iValue, pToken->iValueLen, pValue)))
+            return pToken;
+        return 0;
+    }
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    count = AtLib_ResponseNumTokens();
+    for (i = 0; i < count; i++) {
+        pToken = &G_AtLibTokens[i];
+        if ((!pToken->iKey)
+                && (convert(pToken->iValue, pToken->iValueLen, pValue)))
+            return pToken;
+    }
 
-    return rxMsgId;
+    return 0;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_ReStoreNwConn
+ * Routine:  AtLib_ResponseGetInt
  *---------------------------------------------------------------------------*
  * Description:
- *      Restore the network context.
- *      Sends the command:
- *          AT+STORENWCONN
- *      and waits for a response.
+ *      Get a decimal number from the last response.
  * Inputs:
- *      void
+ *      const char *pKey -- Key of the field, or 0 for the first number
+ *          without a key
+ *      int32_t *pValue -- Place to store the number
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if found, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_ReStoreNwConn(void)
+uint8_t AtLib_ResponseGetInt(const char *pKey, int32_t *pValue)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+RESTORENWCONN\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-
+    return (AtLib_ResponseFindValue(pKey, AtLib_TokenToInt, pValue)) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_IPSet
+ * Routine:  AtLib_ResponseGetIP
  *---------------------------------------------------------------------------*
  * Description:
- *      Configure network IP address.
- *      Sends the command:
- *          AT+NSET=<IP>,<NetMask>,<Gateway>
- *      and waits for a response.
- *      <IP> is in the format ##:##:##:##
- *      <Netmask> is in the format ##:##:##:##
- *      <Gateway> is in the format ##:##:##:##
+ *      Get an IP address from the last response.
  * Inputs:
- *      int8_t* pIpAddr -- IP Address string
- *      int8_t* pSubnet -- Subnet mask string
- *      int8_t* pGateway -- Gateway string
+ *      const char *pKey -- Key of the field, or 0 for the first address
+ *          without a key
+ *      uint8_t *pIp -- Place to store the 4 bytes of the address
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if found, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_IPSet(
-        int8_t* pIpAddr,
-        int8_t* pSubnet,
-        int8_t *pGateway)
+uint8_t AtLib_ResponseGetIP(const char *pKey, uint8_t *pIp)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NSET=%s,%s,%s\r\n", pIpAddr, pSubnet, pGateway);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return (AtLib_ResponseFindValue(pKey, AtLib_TokenToIP, pIp)) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SaveProfile
+ * Routine:  AtLib_ResponseGetMAC
  *---------------------------------------------------------------------------*
  * Description:
- *      Save Settings to profile 0 or 1.
- *      Sends the command:
- *          AT&W<0|1>
- *      and waits for a response.
+ *      Get a MAC address from the last response.
  * Inputs:
- *      uint8_t profile -- profile 0 or 1
+ *      const char *pKey -- Key of the field, or 0 for the first address
+ *          without a key
+ *      uint8_t *pMac -- Place to store the 6 bytes of the address
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if found, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SaveProfile(uint8_t profile)
+uint8_t AtLib_ResponseGetMAC(const char *pKey, uint8_t *pMac)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT&W" _F8_ "\r\n", profile);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return (AtLib_ResponseFindValue(pKey, AtLib_TokenToMAC, pMac)) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_LoadProfile
+ * Routine:  AtLib_ResponseGetString
  *---------------------------------------------------------------------------*
  * Description:
- *      Load Settings from profile 0 or 1.
- *      Sends the command:
- *          ATZ<0|1>
- *      and waits for a response.
+ *      Copy the value of a field of the last response as a string.  The
+ *      string is cut short if it does not fit.
  * Inputs:
- *      uint8_t profile -- profile 0 or 1
+ *      const char *pKey -- Key of the field
+ *      char *pString -- Place to store the string
+ *      uint16_t maxLen -- Size of pString, including the terminator
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint16_t -- Length of the string stored, 0 if not found
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_LoadProfile(uint8_t profile)
+uint16_t AtLib_ResponseGetString(
+        const char *pKey,
+        char *pString,
+        uint16_t maxLen)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const HOST_APP_TOKEN_T *pToken = AtLib_ResponseFind(pKey);
+    uint16_t len;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATZ" _F8_ "\r\n", profile);
+    if ((!pToken) || (!maxLen))
+        return 0;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    len = pToken->iValueLen;
+    if (len >= maxLen)
+        len = maxLen - 1;
+    memcpy(pString, pToken->iValue, len);
+    pString[len] = '\0';
 
-    return rxMsgId;
+    return len;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_ResetFactoryDefaults
+ * Routine:  AtLib_ResponseConnectCid
  *---------------------------------------------------------------------------*
  * Description:
- *      Reset factory defaults.
- *      Sends the command:
- *          AT&F
- *      and waits for a response.
+ *      Find "CONNECT <cid>" in the last response.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- <cid>, or HOST_APP_INVALID_CID if not found
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_ResetFactoryDefaults(void)
+static uint8_t AtLib_ResponseConnectCid(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    const HOST_APP_TOKEN_T *pToken = G_AtLibTokens;
+    uint8_t count = AtLib_ResponseNumTokens();
+    uint8_t i;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT&F\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    for (i = 0; i + 1 < count; i++, pToken++) {
+        /* The CID directly follows "CONNECT " on the same line */
+        if ((!pToken->iKey) && (pToken->iValueLen == 7)
+                && (memcmp(pToken->iValue, "CONNECT", 7) == 0)
+                && (!pToken[1].iKey) && (pToken[1].iValue
+                == pToken->iValue + HOST_APP_TCP_CLIENT_CID_OFFSET_BYTE))
+            return pToken[1].iValue[0];
+    }
 
-    return rxMsgId;
+    return HOST_APP_INVALID_CID;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_GetRssi
+ * Routine:  AtLib_ParseTcpClientCid
  *---------------------------------------------------------------------------*
  * Description:
- *      Query the current RSSI value.
- *      Sends the command:
- *          AT+WRSSI=?
- *      and waits for a response.
- *      Call AtLib_ParseRssiResponse() to get the final result.
+ *      Parses the last line returned after connecting with TCPIP.
+ *      If a CONNECT <id> is returned, returns <id>.  Otherwise, responds
+ *      with HOST_APP_INVALID_CID.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returned connection id or HOST_APP_INVALID_CID.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_GetRssi(void)
+uint8_t AtLib_ParseTcpClientCid(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WRSSI=?\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return AtLib_ResponseConnectCid();
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_DisAssoc
+ * Routine:  AtLib_ParseUdpClientCid
  *---------------------------------------------------------------------------*
  * Description:
- *      Disassociate from current network.
- *      Sends the command:
- *          AT+WD
- *      and waits for a response.
+ *      Parses the last line returned for a UDP Client connection.
+ *      If a CONNECT <id> is returned, return <id>.  Otherwise, respond with
+ *      HOST_APP_INVALID_CID.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returned connection id or HOST_APP_INVALID_CID.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_DisAssoc(void)
+uint8_t AtLib_ParseUdpClientCid(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WD\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return AtLib_ResponseConnectCid();
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_FWUpgrade
+ * Routine:  AtLib_ParseWlanConnStat
  *---------------------------------------------------------------------------*
  * Description:
- *      Initiate a firmware update to the given server.
- *      Sends the command:
- *          AT+FWUP=<SrvIp>,<SrvPort>,<SrcPort>
- *      and waits for a response.
+ *      Parses the last line returned after doing a AtLibGs_WlanConnStat()
+ *      command and determines if there is a wireless association.
  * Inputs:
- *      int8_t *pSrvip -- IP address of the firmware upgrade server string
- *      uint32_t srvport -- server port number to be used for firmware
- *                              upgrade string
- *      uint32_t srcPort -- adapter port number to be used for firmware
- *                              upgrade.
- *      int8_t *pSrcIP -- Retry is the number of times the node will repeat
- *                              the firmware upgrade attempt if failures
- *                              are encountered.
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns true if associated, else false.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_FWUpgrade(
-        int8_t *pSrvip,
-        uint32_t srvport,
-        uint32_t srcPort,
-        int8_t *pSrcIP)
+uint8_t AtLib_ParseWlanConnStat(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+FWUP=%s," _F32_ "," _F32_ ",%s\r\n", pSrvip, srvport, srcPort,
-            pSrcIP);
+    uint8_t bssid[6];
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    /* Not associated if the response has "BSSID=00:00:00:00:00:00" */
+    if ((AtLib_ResponseGetMAC("BSSID", bssid)) && (!bssid[0]) && (!bssid[1])
+            && (!bssid[2]) && (!bssid[3]) && (!bssid[4]) && (!bssid[5]))
+        return false;
 
-    return rxMsgId;
+    /* Already associated */
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_BatteryChkStop
+ * Routine:  AtLib_ParseGetMacResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Stop the battery check.
- *      Sends the command:
- *          AT+BCHKSTOP
- *      and waits for a response.
+ *      Parses the last line returned after doing a AtLibGs_GetMAC()
+ *      command.  The MAC address is copied as 12 hex digits (without
+ *      the ':' separators and without a terminator) to pMAC.
  * Inputs:
- *      void
+ *      char *pMAC -- Place to store the 12 hex digits
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns true if a MAC address was found, else false.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_BatteryChkStop(void)
+uint8_t AtLib_ParseGetMacResponse(char *pMAC)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+BCHKSTOP\r\n");
+    const HOST_APP_TOKEN_T *pToken;
+    uint8_t mac[6];
+    uint16_t i;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    pToken = AtLib_ResponseFindValue(0, AtLib_TokenToMAC, mac);
+    if (!pToken) {
+        /* Failed to get MAC address information */
+        return false;
+    }
 
-    return rxMsgId;
+    for (i = 0; i < pToken->iValueLen; i++) {
+        if (pToken->iValue[i] != ':')
+            *pMAC++ = pToken->iValue[i];
+    }
 
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_MultiCast
+ * Routine:  AtLib_ParseNodeIpAddress
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable or disable multicast reception.
- *      Sends the command:
- *          AT+MCSTSET=<0|1>
- *      and waits for a response.
+ *      Parses the last line returned after doing a AtLibGs_WlanConnStat()
+ *      command and copies the "IP addr=" field to pIpAddr.
  * Inputs:
- *      uint8_t mode -- 0=disable multicast reception,
- *                      1=enable multicast reception
+ *      int8_t *pIpAddr -- Place to store the IP address string (at least
+ *          16 characters)
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 0 if no or invalid IP address (0.x.x.x), 1 if
+ *          a valid IP address was found.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_MultiCast(uint8_t mode)
+uint8_t AtLib_ParseNodeIpAddress(int8_t *pIpAddr)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    uint8_t ip[4];
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+MCSTSET=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (!AtLib_ResponseGetString("IP addr", (char *)pIpAddr,
+            ATLIB_IP_STRING_SIZE)) {
+        /* Failed */
+        return 0;
+    }
+    if ((!AtLib_ResponseGetIP("IP addr", ip)) || (ip[0] == 0)) {
+        /* Failed */
+        return 0;
+    }
 
-    return rxMsgId;
+    /* Success */
+    return 1;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Version
+ * Routine:  AtLib_ParseRssiResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the Version Info.
- *      Sends the command:
- *          AT+VER=?
- *      and waits for a response.
+ *      Parses the last line returned after doing a AtLibGs_GetRssi()
+ *      command.  The RSSI value is returned by reference.
  * Inputs:
- *      uint8_t mode -- 0=disable multicast reception,
- *                      1=enable multicast reception
+ *      int16_t *pRSSI -- Returned passed in value
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if RSSI value found and valid, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_Version(void)
+uint8_t AtLib_ParseRssiResponse(int16_t *pRssi)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    int32_t rssi;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+VER=?\r\n");
+    if ((AtLib_ResponseGetInt(0, &rssi)) && (rssi < 0)) {
+        *pRssi = (int16_t)rssi;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+        return 1;
+    } else {
+        return 0;
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Mode
+ * Routine:  AtLib_ParseUdpServerStartResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Set mode to Infrastructure or Ad-Hoc
- *      Sends the command:
- *          AT+WM=<0|1>
- *      and waits for a response.
+ *      Parses the last line returned after doing a AtLibGs_UdpServer_Start()
+ *      command.  If connected, parses the UDP server connection id.
+ *      Otherwise, no connection is returned.
  * Inputs:
- *      uint32_t mode -- 0=Infrastructure, 1=Ad Hoc
+ *      int16_t *pConnId -- Returned connection id (if any)
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if connected, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_Mode(uint32_t mode)
+uint8_t AtLib_ParseUdpServerStartResponse(uint8_t *pConnId)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WM=" _F32_ "\r\n", mode);
+    uint8_t cid = AtLib_ResponseConnectCid();
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    if (cid != HOST_APP_INVALID_CID) {
+        *pConnId = cid;
 
-    return rxMsgId;
+        /* Success */
+        return 1;
+    } else {
+        /* Failed (DISASSOCIATED, SOCKET FAILURE or no response) */
+        return 0;
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_UdpServer_Start
+ * Routine:  AtLib_ParseUdpServerStartResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Open UDP server on given port.
- *      Sends the command:
- *          AT+NSUDP=<Port>
- *      and waits for a response.
- *      The <Port> for the UDP Server to receive packets.
- *      Call AtLib_ParseUdpServerStartResponse() to parse the response
- *      into a connection id.
+ *      Parses the last line returned after doing a AtLibGs_TcpServer_Start()
+ *      command.  If connected, parses the TCP server connection id.
+ *      Otherwise, no connection is returned.
  * Inputs:
- *      int8_t *pUdpSrvPort -- Port on server string.
+ *      int16_t *pConnId -- Returned connection id (if any)
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if connected, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_UdpServer_Start(int8_t *pUdpSrvPort)
+uint8_t AtLib_ParseTcpServerStartResponse(uint8_t *pConnId)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    uint8_t cid = AtLib_ResponseConnectCid();
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NSUDP=%s\r\n", pUdpSrvPort);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    if (cid != HOST_APP_INVALID_CID) {
+        *pConnId = cid;
+        return 1;/* Success */
+    } else {
+        return 0; /* Failed  */
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_TcpServer_Start
+ * Routine:  AtLib_ParseDNSLookupResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Set mode to Infrastructure or Ad-Hoc
- *      Sends the command:
- *          AT+NSTCP=<Port>
- *      and waits for a response.
- *      The <Port> for the TCP Server to receive packets.
- *      Call AtLib_ParseTcpServerStartResponse() to parse the response
- *      into a connection id.
+ *      Parses the last line returned after doing a AtLibGs_DNSLookup()
+ *      command.  If the name was found, the "IP:" field is copied to
+ *      ipAddr.
  * Inputs:
- *      int8_t *pTcpSrvPort -- TCP port string
+ *      char *ipAddr -- Place to store the IP address string (at least
+ *          16 characters)
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if found, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_TcpServer_Start(int8_t* pTcpSrvPort)
+uint8_t AtLib_ParseDNSLookupResponse(char *ipAddr)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NSTCP=%s\r\n", pTcpSrvPort);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-
+    if (AtLib_ResponseGetString("IP", ipAddr, ATLIB_IP_STRING_SIZE)) {
+        return 1; /* Success */
+    } else {
+        return 0; /* Failed  */
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_DNSLookup
+ * Routine:  AtLib_ParseWPSPUSHResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the IP number from host name.
- *      Sends the command:
- *          AT+DNSLOOKUP=<name>
- *      and waits for a response.
- *      <name> is the URL of the address to lookup.
- *      Call AtLib_ParseDNSLookupResponse() to parse the response.
+ *      Parses the last line returned after doing a AtLibGs_StartWPSPUSH()
+ *      command.  If the WPS worked (and an SSID is reported), 1 is
+ *      returned.  If fails, it returns 0.
  * Inputs:
- *      int8_t *pUrl -- URL to parse.
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if WPS is successful, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_DNSLookup(int8_t* pUrl)
+uint8_t AtLib_ParseWPSPUSHResponse(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+DNSLOOKUP=%s\r\n", pUrl);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    if (AtLib_ResponseFind("SSID") != NULL) {
+        return 1; /* Success */
+    } else {
+        return 0; /* Failed  */
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_Close
+ * Routine:  AtLib_ParseWPSPINResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Close a previously opened connection
- *      Sends the command:
- *          AT+NCLOSE=<cid>
- *      and waits for a response.
- *      <cid> is the connection id
+ *      Parses the last line returned after doing a AtLibGs_StartWPSPIN()
+ *      command.  If the WPS worked (and an SSID is reported), 1 is
+ *      returned.  If fails, it returns 0.
  * Inputs:
- *      uint8_t cid -- Connection id
+ *      uint32_t pin -- not used
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Returns 1 if WPS is successful, else 0.
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_Close(uint8_t cid)
+uint8_t AtLib_ParseWPSPINResponse(uint32_t pin)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NCLOSE=%c\r\n", cid);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    (void)pin;
+    if (AtLib_ResponseFind("SSID") != NULL) {
+        return 1; /* Success */
+    } else {
+        return 0; /* Failed  */
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetWRetryCount
+ * Routine:  AtLib_CommandSend
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the wireless retry count.
- *      Sends the command:
- *          AT+WRETRY=<n>
- *      and waits for a response.
- *      <n> is the number of retries (default is 5)
+ *      Sends an AT command to the module and waits for a response.  If
+ *      data is returned, it is collected into MRBuffer.  Commands queued
+ *      earlier with AtLib_CommandQueue are completed first; build the
+ *      command in G_ATCmdBuf only once AtLib_IsCommandBusy is false, as
+ *      the callbacks of those commands may use G_ATCmdBuf.  This is a
+ *      blocking wrapper around the command engine driven by AtLib_Poll.
+ *      The module is given the adaptive timeout of the command's class
+ *      (see AtLib_GetTimeoutClass) to answer.
  * Inputs:
- *      uint8_t count -- Number of wireless retries
+ *      void
  * Outputs:
  *      HOST_APP_MSG_ID_E -- response type
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetWRetryCount(uint32_t count)
+HOST_APP_MSG_ID_E AtLib_CommandSend(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WRETRY=" _F32_ "\r\n", count);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-
+    return AtLib_CommandSendStream(0, 0);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_GetErrCount
+ * Routine:  AtLib_CommandSendStream
  *---------------------------------------------------------------------------*
  * Description:
- *      Get the error counts
- *      Sends the command:
- *          AT+ERRCOUNT=?
- *      and waits for a response.
- *      TODO: Parsing has to be done manually by looking at MRBuffer.
+ *      Same as AtLib_CommandSend but each line of the response is handed
+ *      to a callback as it arrives instead of being collected in
+ *      MRBuffer.  Use for responses that may not fit in MRBuffer (scan
+ *      results, AT+NSTAT=?, version strings).  Only the last line
+ *      (e.g. "OK") is left in MRBuffer.
  * Inputs:
- *      void
+ *      AtLib_LineCallback lineCallback -- Routine to call with each line,
+ *          or 0 to collect the response in MRBuffer
+ *      void *pContext -- Passed to lineCallback
  * Outputs:
  *      HOST_APP_MSG_ID_E -- response type
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_GetErrCount(void)
+HOST_APP_MSG_ID_E AtLib_CommandSendStream(
+        AtLib_LineCallback lineCallback,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+ERRCOUNT=?\r\n");
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return AtLib_CommandSendClass(AtLib_GetTimeoutClass(G_ATCmdBuf),
+            lineCallback, pContext);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_EnableRadio
+ * Routine:  AtLib_CommandSendClass
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable or disable the radio.
- *      Sends the command:
- *          AT+WRXACTIVE=<mode>
- *      and waits for a response.
- *      <mode> is 0 when disabling the radio, 1 when enabled the radio.
+ *      Send the command in G_ATCmdBuf and wait for the response (see
+ *      AtLib_CommandSendStream), with the adaptive timeout of the given
+ *      class.
  * Inputs:
- *      uint8_t mode -- 0 to disable the radio, 1 to enable the radio
+ *      HOST_APP_TIMEOUT_CLASS_E timeoutClass -- Class of the command
+ *      AtLib_LineCallback lineCallback -- Routine to call with each line,
+ *          or 0 to collect the response in MRBuffer
+ *      void *pContext -- Passed to lineCallback
  * Outputs:
  *      HOST_APP_MSG_ID_E -- response type
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_EnableRadio(uint8_t mode)
+static HOST_APP_MSG_ID_E AtLib_CommandSendClass(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        AtLib_LineCallback lineCallback,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
+    ATLIB_CMD_T cmd;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WRXACTIVE=" _F8_ "\r\n", mode);
+    /* Let the commands already queued go first (the callers have */
+    /* waited for them before building G_ATCmdBuf) */
+    while (AtLib_IsCommandBusy())
+        AtLib_Poll();
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    /* Now send the command to S2w App node */
+    cmd.iCallback = AtLib_CommandSendDone;
+    cmd.iContext = &rxMsgId;
+    cmd.iTimeout = HOST_APP_TIMEOUT_ADAPTIVE;
+    cmd.iClass = timeoutClass;
+    cmd.iHandle = 0;
+    cmd.iLineCallback = lineCallback;
+    cmd.iLineContext = pContext;
+    AtLib_CommandStart(G_ATCmdBuf, &cmd);
+
+    /* Wait for the response while collecting data into the MRBuffer */
+    while (HOST_APP_MSG_ID_NONE == rxMsgId)
+        AtLib_Poll();
 
     return rxMsgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_EnablePwSave
+ * Routine:  AtLib_CommandSendDone
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable or disable the 802.11 power save mode.
- *      Sends the command:
- *          AT+WRXPS=<mode>
- *      and waits for a response.
- *      <mode> is 0 to disable power save mode, 1 to enable power save.
- *          The default is enabled.
+ *      Completion callback of AtLib_CommandSend.  Stores the response
+ *      in the caller's variable.
  * Inputs:
- *      uint8_t mode -- 0 to disabe power save mode, 1 to enable
+ *      uint8_t handle -- not used
+ *      HOST_APP_MSG_ID_E msgId -- response type
+ *      void *pContext -- HOST_APP_MSG_ID_E to fill in
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_EnablePwSave(uint8_t mode)
+static void AtLib_CommandSendDone(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WRXPS=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    (void)handle;
+    *(HOST_APP_MSG_ID_E *)pContext = msgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetTime
+ * Routine:  AtLib_CommandStart
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the system time.
- *      Sends the command:
- *          AT+SETTIME=<date>,<time>
- *      and waits for a response.
- *      <date> is in the format "dd/mm/yyyy"
- *      <time> is in the format "HH:MM:SS"
+ *      Send a command to the module and make it the one waiting for a
+ *      response.  The response buffer (MRBuffer) is cleared first.
  * Inputs:
- *      int8_t* pDate -- Date string in format "dd/mm/yyyy"
- *      int8_t* pTime -- Time string in format "HH:MM:SS"
+ *      const char *pCommand -- Command text, with CR LF
+ *      const ATLIB_CMD_T *pCmd -- Callback, context, timeout, class and
+ *          handle
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetTime(int8_t* pDate, int8_t *pTime)
+static void AtLib_CommandStart(
+        const char *pCommand,
+        const ATLIB_CMD_T *pCmd)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    LOG_DATA(LOG_LEVEL_DEBUG, LOG_ID_AT_COMMAND, pCommand, strlen(pCommand));
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+SETTIME=%s,%s\r\n", pDate, pTime);
+    /* Reset the receive buffer */
+    AtLib_FlushRxBuffer();
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    G_AtLibCmdActive = *pCmd;
+    if (G_AtLibCmdActive.iTimeout == HOST_APP_TIMEOUT_ADAPTIVE)
+        G_AtLibCmdActive.iTimeout = AtLib_GetTimeout(G_AtLibCmdActive.iClass);
+    G_AtLibCmdIsActive = true;
+    G_AtLibCmdLastRx = G_AtLibCmdActive.iStartTime = MSTimerGet();
 
-    return rxMsgId;
+    App_Write((const uint8_t *)pCommand, strlen(pCommand));
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_EnableExternalPA
+ * Routine:  AtLib_CommandQueue
  *---------------------------------------------------------------------------*
  * Description:
- *      This command enables or disables the external PA (patch antenna).
- *      Sends the command:
- *          AT+EXTPA=<mode>
- *      and waits for a response.
- *      <mode> is 1 to enable the external PA, or 0 to disable external PA.
- *      NOTE: If enabled, this command forces the adapter to standby and
- *          comes back immediately causing all configured parameters and
- *          network connections to be lost.
+ *      Queue a command without waiting for it.  The command is sent by
+ *      AtLib_Poll when all commands before it have completed and the
+ *      callback is called from AtLib_Poll (or AtLib_ReceiveDataHandle)
+ *      with the response.  MRBuffer holds the response lines during the
+ *      callback, so the AtLib_Parse* routines can be used there.  The
+ *      module answers commands in order, so the response always belongs
+ *      to the command that was sent last (see AtLib_Poll for timeouts).
  * Inputs:
- *      void
+ *      const char *pCommand -- Command text, with CR LF.  It is copied.
+ *      uint32_t timeout -- ms allowed without a response line (data
+ *          frames do not count), or HOST_APP_TIMEOUT_ADAPTIVE for the
+ *          timeout of the command's class (see AtLib_GetTimeoutClass)
+ *      AtLib_CommandCallback callback -- Routine to call with the
+ *          response, or 0 for none
+ *      void *pContext -- Passed to the callback
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Handle passed to the callback, or 0 if the queue is
+ *          full or the command is too long
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_EnableExternalPA(uint8_t mode)
+uint8_t AtLib_CommandQueue(
+        const char *pCommand,
+        uint32_t timeout,
+        AtLib_CommandCallback callback,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+EXTPA=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return AtLib_CommandQueueStream(pCommand, timeout, 0, callback, pContext);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SyncLossInterval
+ * Routine:  AtLib_CommandQueueStream
  *---------------------------------------------------------------------------*
  * Description:
- *      Configure the sync loss interval in TBTT interval.
- *      Sends the command:
- *          AT+WSYNCINTRL=<interval>
- *      and waits for a response.
- *      <interval> is the sync loss interval with a range of 1 to 65535.
- *          Default value is 30.
+ *      Same as AtLib_CommandQueue but each line of the response is handed
+ *      to lineCallback as it arrives (see AtLib_CommandSendStream).
+ *      Only the last line is left in MRBuffer for the completion
+ *      callback.
  * Inputs:
- *      void
+ *      const char *pCommand -- Command text, with CR LF.  It is copied.
+ *      uint32_t timeout -- ms allowed without a response line, or
+ *          HOST_APP_TIMEOUT_ADAPTIVE
+ *      AtLib_LineCallback lineCallback -- Routine to call with each line,
+ *          or 0 to collect the response in MRBuffer
+ *      AtLib_CommandCallback callback -- Routine to call with the
+ *          response, or 0 for none
+ *      void *pContext -- Passed to both callbacks
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Handle passed to the callback, or 0 if the queue is
+ *          full or the command is too long
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SyncLossInterval(uint16_t interval)
+uint8_t AtLib_CommandQueueStream(
+        const char *pCommand,
+        uint32_t timeout,
+        AtLib_LineCallback lineCallback,
+        AtLib_CommandCallback callback,
+        void *pContext)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WSYNCINTRL=" _F16_ "\r\n", interval);
+    ATLIB_CMD_T queued;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    queued.iCallback = callback;
+    queued.iContext = pContext;
+    queued.iTimeout = timeout;
+    queued.iClass = AtLib_GetTimeoutClass(pCommand);
+    queued.iLineCallback = lineCallback;
+    queued.iLineContext = pContext;
 
-    return rxMsgId;
+    return AtLib_CommandAdd(pCommand, &queued);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_PSPollInterval
+ * Routine:  AtLib_CommandAdd
  *---------------------------------------------------------------------------*
  * Description:
- *      Configure the Association Keep Alive Timer (PS) poll interval in
- *      seconds.
- *      Sends the command:
- *          AT+PSPOLLINTRL=<interval>
- *      and waits for a response.
- *      <interval> is the number of seconds to keep alive.  Default is 45.
- *          Range is 0 to 65535 seconds.  A value of 0 disables.
+ *      Put a command at the end of the queue and give it a handle.
  * Inputs:
- *      uint16_t interval
+ *      const char *pCommand -- Command text, with CR LF.  It is copied.
+ *      const ATLIB_CMD_T *pCmd -- Callbacks, contexts, timeout and class
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- Handle, or 0 if the queue is full or the command is
+ *          too long
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_PSPollInterval(uint16_t interval)
+static uint8_t AtLib_CommandAdd(
+        const char *pCommand,
+        const ATLIB_CMD_T *pCmd)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    ATLIB_CMD_QUEUE_ENTRY_T *p;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+PSPOLLINTRL=" _F16_ "\r\n", interval);
+    if ((G_AtLibCmdCount >= ATLIB_CMD_QUEUE_SIZE)
+            || (strlen(pCommand) >= ATLIB_CMD_QUEUE_CMD_SIZE))
+        return 0;
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    p = &G_AtLibCmdQueue[G_AtLibCmdIn];
+    strcpy(p->iText, pCommand);
+    p->iCmd = *pCmd;
+    p->iCmd.iHandle = G_AtLibCmdNextHandle++;
+    if (G_AtLibCmdNextHandle == 0)
+        G_AtLibCmdNextHandle = 1;
+    if (++G_AtLibCmdIn == ATLIB_CMD_QUEUE_SIZE)
+        G_AtLibCmdIn = 0;
+    G_AtLibCmdCount++;
 
-    return rxMsgId;
+    return p->iCmd.iHandle;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetTxPower
+ * Routine:  AtLib_IsCommandBusy
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the transmit power.
- *      Sends the command:
- *          AT+WP=<power>
- *      and waits for a response.
- *      <power> is the transmit power.
- *      Transmit power can be 0 to 7 for internal PA GS101x with a default of
- *      0.  Transmit power can be 2 to 15 for external PA GS101x with a
- *      default power of 2.
+ *      Determine if a command is executing or waiting in the queue, or
+ *      the library is getting back in step with the module after a
+ *      timeout.
  * Inputs:
- *      uint32_t power -- Power level (see above notes)
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint8_t -- true if busy, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetTxPower(uint32_t power)
+uint8_t AtLib_IsCommandBusy(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WP=" _F32_ "\r\n", power);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return ((G_AtLibCmdIsActive) || (G_AtLibCmdCount)
+            || (G_AtLibResync != ATLIB_RESYNC_IDLE)) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SetDNSServerIP
+ * Routine:  AtLib_GetTimeoutClass
  *---------------------------------------------------------------------------*
  * Description:
- *      Set static DNS IP address(es).
- *      Sends the command:
- *          AT+WSYNCINTRL=<dns1>[,<dns2>]
- *      and waits for a response.
- *      <dns1> is the primary DNS address in "##.##.##.##" format.
- *      <dns2> is the optional secondary DNS address in "##.##.##.##" format.
+ *      Determine the timeout class of a command from its text.
  * Inputs:
- *      int8_t *pDNS1 -- Primary DNS address string in "##.##.##.##" format.
- *      int8_t *pDNS2 -- Secondary DNS address string in "##.##.##.##" format.
- *          If NULL, no secondary DNS address is used.
+ *      const char *pCommand -- Command text
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      HOST_APP_TIMEOUT_CLASS_E -- Class, HOST_APP_TIMEOUT_CLASS_FAST if
+ *          not listed in G_AtLibTimeoutCommands
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_SetDNSServerIP(int8_t *pDNS1, int8_t *pDNS2)
+HOST_APP_TIMEOUT_CLASS_E AtLib_GetTimeoutClass(const char *pCommand)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    uint8_t i;
 
-    /* Construct the AT command */
-    if (pDNS2 == NULL) {
-        sprintf(G_ATCmdBuf, "AT+DNSSET=%s", pDNS1);
-    } else {
-        sprintf(G_ATCmdBuf, "AT+DNSSET=%s,%s", pDNS1, pDNS2);
+    for (i = 0; i < sizeof(G_AtLibTimeoutCommands)
+            / sizeof(G_AtLibTimeoutCommands[0]); i++) {
+        if (strncmp(pCommand, G_AtLibTimeoutCommands[i].iPrefix,
+                strlen(G_AtLibTimeoutCommands[i].iPrefix)) == 0)
+            return G_AtLibTimeoutCommands[i].iClass;
     }
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-
+    return HOST_APP_TIMEOUT_CLASS_FAST;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_EnableAutoConnect
+ * Routine:  AtLib_GetTimeout
  *---------------------------------------------------------------------------*
  * Description:
- *      Disable or enable auto connection.
- *      Sends the command:
- *          AT+ATC<mode>
- *      and waits for a response.
- *      NOTE: The resulting change only takes effect on the next reboot or
- *          an ATA command.
+ *      Get the current adaptive timeout of a class.
  * Inputs:
- *      uint8_t mode -- 0 to disable auto connect, 1 to enable auto connect.
- *          Default is disabled.
+ *      HOST_APP_TIMEOUT_CLASS_E timeoutClass -- Class of command
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      uint32_t -- Timeout in ms
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_EnableAutoConnect(uint8_t mode)
+uint32_t AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_E timeoutClass)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATC" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    return G_AtLibTimeouts[timeoutClass].iTimeoutMS;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_SwitchFromAutoToCmd
+ * Routine:  AtLib_TimeoutSample
  *---------------------------------------------------------------------------*
  * Description:
- *
- *      Sends the command:
- *          AT+WSYNCINTRL=<interval>
- *      and waits for a response.
+ *      Update the round trip estimate of a class with a new measurement
+ *      and recalculate its timeout as SRTT + 4 * RTTVAR, kept within the
+ *      limits of the class.  Called when a command completes; the
+ *      application can also call it for HOST_APP_TIMEOUT_CLASS_SERVER.
  * Inputs:
- *      void
+ *      HOST_APP_TIMEOUT_CLASS_E timeoutClass -- Class of command
+ *      uint32_t roundTripMS -- Time from sending to the response
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-void AtLibGs_SwitchFromAutoToCmd(void)
+void AtLib_TimeoutSample(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        uint32_t roundTripMS)
 {
-    uint32_t command_length;
-
-    sprintf(G_ATCmdBuf, "+++");
-    /* Get the command length */
-    command_length = strlen((const char *)G_ATCmdBuf);
-
-    App_Write((uint8_t *)&G_ATCmdBuf[0], command_length);
+    HOST_APP_TIMEOUT_STATS_T *p = &G_AtLibTimeouts[timeoutClass];
+    const ATLIB_TIMEOUT_LIMITS_T *pLimits = &G_AtLibTimeoutLimits[timeoutClass];
+    int32_t delta;
+    uint32_t timeout;
 
-    MSTimerDelay(1000);
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "\r\n");
-    command_length = strlen((const char *)G_ATCmdBuf);
+    if (p->iSamples == 0) {
+        p->iSmoothedMS = roundTripMS;
+        p->iVariationMS = roundTripMS / 2;
+    } else {
+        delta = (int32_t)roundTripMS - (int32_t)p->iSmoothedMS;
+        p->iSmoothedMS += delta >> ATLIB_TIMEOUT_SRTT_SHIFT;
+        if (delta < 0)
+            delta = -delta;
+        p->iVariationMS += (delta - (int32_t)p->iVariationMS)
+                >> ATLIB_TIMEOUT_RTTVAR_SHIFT;
+    }
+    if (p->iSamples != 0xFFFF)
+        p->iSamples++;
 
-    App_Write((uint8_t *)&G_ATCmdBuf[0], strlen(G_ATCmdBuf));
+    timeout = p->iSmoothedMS
+            + (ATLIB_TIMEOUT_VARIATION_FACTOR * p->iVariationMS);
+    if (timeout < pLimits->iMinimum)
+        timeout = pLimits->iMinimum;
+    if (timeout > pLimits->iMaximum)
+        timeout = pLimits->iMaximum;
+    p->iTimeoutMS = timeout;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_
+ * Routine:  AtLib_TimeoutExpired
  *---------------------------------------------------------------------------*
  * Description:
- *
- *      Sends the command:
- *          AT+WSYNCINTRL=<interval>
- *      and waits for a response.
+ *      Count a response that did not arrive in time and double the
+ *      timeout of its class (up to the class maximum) so a slow module
+ *      is not given up on again and again.
  * Inputs:
- *      void
+ *      HOST_APP_TIMEOUT_CLASS_E timeoutClass -- Class of command
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StoreWAutoConn(int8_t * pSsid, uint8_t channel)
+void AtLib_TimeoutExpired(HOST_APP_TIMEOUT_CLASS_E timeoutClass)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
+    HOST_APP_TIMEOUT_STATS_T *p = &G_AtLibTimeouts[timeoutClass];
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WAUTO=0,%s,," _F8_ "\r\n", pSsid, channel);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    if (p->iTimeouts != 0xFFFF)
+        p->iTimeouts++;
+    p->iTimeoutMS *= 2;
+    if (p->iTimeoutMS > G_AtLibTimeoutLimits[timeoutClass].iMaximum)
+        p->iTimeoutMS = G_AtLibTimeoutLimits[timeoutClass].iMaximum;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_StoreNAutoConn
+ * Routine:  AtLib_GetTimeoutStats
  *---------------------------------------------------------------------------*
  * Description:
- *      Configure auto connection network parameters (for client connection).
- *      Sends the command:
- *          AT+NAUTO=0,0,<ip addr>,<port>
- *      and waits for a response.
- *      <ip addr> is the IP address of the remote server
- *      <port> is the port address of the remote server
+ *      Get the round trip measurements and current timeout of a class.
  * Inputs:
- *      int8_t *pIpAddr -- IP address string in format "##.##.##.##"
- *      int16_t pRmtPort -- Port address of remote system
+ *      HOST_APP_TIMEOUT_CLASS_E timeoutClass -- Class of command
+ *      HOST_APP_TIMEOUT_STATS_T *pStats -- Place to copy the measurements
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StoreNAutoConn(int8_t* pIpAddr, int16_t pRmtPort)
+void AtLib_GetTimeoutStats(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        HOST_APP_TIMEOUT_STATS_T *pStats)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+NAUTO=0,0,%s," _F16_ "\r\n", pIpAddr, pRmtPort);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
+    *pStats = G_AtLibTimeouts[timeoutClass];
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_StoreATS
- *---------------------------------------------------------------------------*
- * Description:
- *      Store network and configuration parameters.  See documentation
- *      for configuration parameters.
- *          0=Network Connection Timeout
- *              Maximum time to establish auto connection in 10 ms
- *              intervals.  Default is 1000 or 10 seconds.
- *          1=Auto Associate Timeout
- *              Maximum time to associate to desired wireless network in
- *              10 ms intervals.  Default is 1000 or 10 seconds.
- *          2=TCP Connection Timeout
- *              Maximum time to establish TCP client connection in
- *              10 ms intervals.  Default is 500 or 5 seconds.
- *          3=Association Retry Count
- *              Not currently supported
- *          4=Nagle Algorithm Wait Time
- *              Maximum time for serial data sent in Auto Connect Mode
- *              to be buffered in 10 ms intervals.  Default is 10 or 100 ms.
- *          5=Scan Time
- *              Maximum time for scanning in one radio chanenel in
- *              milliseconds.  Default is 20 or 20 ms.
- *      Sends the command:
- *          AT+ATS<param>=<time>
- *      and waits for a response.
- *      <param> is the numeric parameter from the above.
- *      <time> is the value to be used for the given <param> (see above).
- * Inputs:
- *      uint8_t param -- Timing parameter to set
- *      uint8_t value -- Timing value to use
- * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
- *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StoreATS(uint8_t param, uint8_t value)
-{
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "ATS" _F8_ "=" _F8_ "\r\n", param, value);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
-
-    return rxMsgId;
-}
-
-/*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_BData
+ * Routine:  AtLib_ClearTimeoutStats
  *---------------------------------------------------------------------------*
  * Description:
- *      Enable or disable bulk data reception.
- *      Sends the command:
- *          AT+BDATA=<mode>
- *      and waits for a response.
- *      <mode> is 1 to enable, or 0 to disable.
+ *      Forget all round trip measurements and go back to the initial
+ *      timeout of each class.
  * Inputs:
- *      uint8_t mode -- 0 to disable bulk data reception, or 1 to enable.
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_BData(uint8_t mode)
+void AtLib_ClearTimeoutStats(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+BDATA=" _F8_ "\r\n", mode);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    uint8_t i;
 
-    return rxMsgId;
+    memset(G_AtLibTimeouts, 0, sizeof(G_AtLibTimeouts));
+    for (i = 0; i < HOST_APP_TIMEOUT_CLASS_MAX; i++)
+        G_AtLibTimeouts[i].iTimeoutMS = G_AtLibTimeoutLimits[i].iInitial;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_StartWPSPUSH
+ * Routine:  AtLib_Poll
  *---------------------------------------------------------------------------*
  * Description:
- *      Associate to an access point (AP) using Wi-Fi Protected Setup (WPS)
- *      using the push button method.
- *      Sends the command:
- *          AT+WWPS=1
- *      and waits for a response.
- *      Use AtLib_ParseWPSPUSHResponse() immediately afterward to get the
- *      response.
+ *      Run the command engine.  Call often from the main loop.  Sends the
+ *      next queued command if none is executing, processes the data that
+ *      has arrived (see AtLib_ReceiveDataHandle) and completes the
+ *      executing command when its response or timeout is found.  Never
+ *      starts a command after completing one, so MRBuffer stays valid
+ *      until the next call.  After a timeout no command is sent until
+ *      the module has answered an "AT" (see AtLib_ResyncCheck), so a
+ *      late response is not taken for the next command's.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      HOST_APP_MSG_ID_E -- Last data frame completed (HOST_APP_MSG_ID_*_RX)
+ *          or HOST_APP_MSG_ID_NONE if no frame was completed
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StartWPSPUSH(void)
+HOST_APP_MSG_ID_E AtLib_Poll(void)
 {
+    ATLIB_CMD_QUEUE_ENTRY_T *p;
+    ATLIB_CMD_T cmd;
     HOST_APP_MSG_ID_E rxMsgId;
 
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WWPS=1");
+    if ((!G_AtLibCmdIsActive) && (G_AtLibCmdCount)
+            && (G_AtLibResync == ATLIB_RESYNC_IDLE)) {
+        /* Take the next command off the queue and send it */
+        p = &G_AtLibCmdQueue[G_AtLibCmdOut];
+        if (++G_AtLibCmdOut == ATLIB_CMD_QUEUE_SIZE)
+            G_AtLibCmdOut = 0;
+        G_AtLibCmdCount--;
+        AtLib_CommandStart(p->iText, &p->iCmd);
+    }
 
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    rxMsgId = AtLib_ReceiveDataHandle();
+
+    if ((G_AtLibCmdIsActive)
+            && (MSTimerDelta(G_AtLibCmdLastRx) >= G_AtLibCmdActive.iTimeout)) {
+        /* The module stopped answering */
+        G_AtLibCmdIsActive = false;
+        cmd = G_AtLibCmdActive;
+        AtLib_TimeoutExpired(cmd.iClass);
+        G_AtLibResyncTries = 0;
+        G_AtLibResyncDropped = 0;
+        AtLib_ResyncSend();
+        if (cmd.iCallback)
+            cmd.iCallback(cmd.iHandle, HOST_APP_MSG_ID_RESPONSE_TIMEOUT,
+                    cmd.iContext);
+    } else if (G_AtLibResync != ATLIB_RESYNC_IDLE) {
+        AtLib_ResyncCheck();
+    }
 
     return rxMsgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLibGs_StartWPSPIN
+ * Routine:  AtLib_ResyncSend
  *---------------------------------------------------------------------------*
  * Description:
- *      Associate to an access point (AP) using Wi-Fi Protected Setup (WPS)
- *          using the Personal Identification Number (PIN) method.
- *      Sends the command:
- *          AT+WWPS=2,<pin>
- *      and waits for a response.
- *      <pin> is a unique PIN.
- *      Use AtLib_ParseWPSPINResponse() to parse the response.
+ *      Send "AT" to find the end of the responses still coming for
+ *      commands that timed out.
  * Inputs:
- *      int8_t* pin -- PIN string to pass in when doing WPS
+ *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      void
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLibGs_StartWPSPIN(int8_t* pin)
+static void AtLib_ResyncSend(void)
 {
-    HOST_APP_MSG_ID_E rxMsgId;
-
-    /* Construct the AT command */
-    sprintf(G_ATCmdBuf, "AT+WWPS=2,%s", pin);
-
-    /* Send command to S2w App node */
-    rxMsgId = AtLib_CommandSend();
+    static const char resync[] = "AT\r\n";
 
-    return rxMsgId;
+    G_AtLibResync = ATLIB_RESYNC_WAIT_OK;
+    G_AtLibResyncTries++;
+    G_AtLibResyncTime = MSTimerGet();
+    App_Write((const uint8_t *)resync, sizeof(resync) - 1);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseTcpClientCid
+ * Routine:  AtLib_ResyncCheck
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after connecting with TCPIP.
- *      If a CONNECT <id> is returned, returns <id>.  Otherwise, responds
- *      with HOST_APP_INVALID_CID.
+ *      Finish resynchronising once the OK of "AT" has been followed by
+ *      ATLIB_RESYNC_QUIET_MS without a response line, or send "AT" again
+ *      if no OK came.  After ATLIB_RESYNC_TRIES the module is left to the
+ *      timeouts of the next commands.
  * Inputs:
  *      void
  * Outputs:
- *      uint8_t -- Returned connection id or HOST_APP_INVALID_CID.
+ *      void
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseTcpClientCid(void)
+static void AtLib_ResyncCheck(void)
 {
-    uint8_t cid;
-    uint8_t *result = NULL;
-
-    if ((result = (uint8_t *)strstr((const char *)MRBuffer, "CONNECT")) != NULL) {
-        /* Succesfull connection done for TCP client */
-        cid = result[HOST_APP_TCP_CLIENT_CID_OFFSET_BYTE];
-    } else {
-        /* Not able to extract the CID */
-        cid = HOST_APP_INVALID_CID;
+    if (G_AtLibResync == ATLIB_RESYNC_QUIET) {
+        if (MSTimerDelta(G_AtLibResyncTime) >= ATLIB_RESYNC_QUIET_MS) {
+            /* The last OK was the one of "AT", the rest were late */
+            G_AtLibResync = ATLIB_RESYNC_IDLE;
+            AtLib_CountStaleResponses(G_AtLibResyncDropped - 1);
+        }
+    } else if (MSTimerDelta(G_AtLibResyncTime)
+            >= AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_FAST)) {
+        if (G_AtLibResyncTries < ATLIB_RESYNC_TRIES)
+            AtLib_ResyncSend();
+        else
+            G_AtLibResync = ATLIB_RESYNC_IDLE;
     }
-
-    return cid;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseUdpClientCid
+ * Routine:  AtLib_DataSend
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned for a UDP Client connection.
- *      If a CONNECT <id> is returned, return <id>.  Otherwise, respond with
- *      HOST_APP_INVALID_CID.
+ *      Send data to the module.
  * Inputs:
- *      void
+ *      const uint8_t *pTxData -- Data to send
+ *      uint32_t dataLen -- Length of data to send
  * Outputs:
- *      uint8_t -- Returned connection id or HOST_APP_INVALID_CID.
+ *      void
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseUdpClientCid(void)
+void AtLib_DataSend(const uint8_t *pTxData, uint32_t dataLen)
 {
-    uint8_t cid;
-    uint8_t *result = NULL;
-
-    if ((result = (uint8_t *)strstr((const char *)MRBuffer, "CONNECT")) != NULL) {
-        /* Succesfull connection done for UDP client */
-        cid = result[HOST_APP_UDP_CLIENT_CID_OFFSET_BYTE];
-    } else {
-        /* Not able to extract the CID */
-        cid = HOST_APP_INVALID_CID;
-    }
-
-    return cid;
+    App_Write(pTxData, dataLen);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseWlanConnStat
+ * Routine:  AtLib_SendTcpData
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_WlanConnStat()
- *      command and determines if there is a wireless association.
+ *      Send data to the given TCP connection.  The data is converted into
+ *      the following byte format:
+ *          <ESC><'S'><cid><N bytes><ESC><'E'>
+ *      <ESC> is the escape character 0x1B
+ *      <'S'> is the letter 'S'
+ *      <cid> is the connection ID.
+ *      <N bytes> is a number of bytes
+ *      <'E'> is the letter 'E'
  * Inputs:
- *      void
+ *      uint8_t cid -- Connection ID
+ *      const uint8_t *pTxData -- Data to send to the TCP connection
+ *      uint32_t dataLen -- Length of data to send
  * Outputs:
- *      uint8_t -- Returns true if associated, else false.
+ *      void
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseWlanConnStat(void)
+void AtLib_SendTcpData(uint8_t cid, const uint8_t *txBuf, uint32_t dataLen)
 {
-    char *pSubStr;
-
-    /* Check whether response message contains the following */
-    /* string "BSSID=00:00:00:00:00:00" */
-    pSubStr = strstr((const char *)MRBuffer, "BSSID=00:00:00:00:00:00");
+    HOST_APP_IOV_T part;
 
-    if (pSubStr) {
-        /* Not been associated */
-        return false;
-    } else {
-        /* Already associated */
-        return true;
-    }
+    part.iData = txBuf;
+    part.iLength = dataLen;
+    AtLib_SendTcpDataV(cid, &part, 1);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseGetMacResponse
+ * Routine:  AtLib_SendTcpDataV
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_GetMAC()
- *      command.  The passed in MAC Id is compared to the returned MAC
- *      address.  If the returned MAC address is "00:00:00:00:00:00" or
- *      the MAC address does not match the passed in MAC address, false
- *      is returned.  If the MAC address returned matches the passed in
- *      MAC address, true is returned.
- * Inputs:
- *      int8_t *pRefNodeMacId -- MAC address to compare to
- * Outputs:
- *      uint8_t -- Returns true if matching MAC address and not 0's,
- *          else false.
- *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseGetMacResponse(char *pMAC) //int8_t *pRefNodeMacId)
-{
-    char *pSubStr;
-    char currNodeMac[20] = "00:00:00:00:00:00";
-
-    /* Set the node MAC address, If the MAC is already set, */
-    /* then skip the flash write operation */
-    pSubStr = strstr((const char *)MRBuffer, ":");
-
-    if (pSubStr) {
-        /* Setup a copy to compare with */
-        memcpy(currNodeMac, (pSubStr - 2), 17);
-        currNodeMac[17] = '\0';
-        
-        pSubStr = &currNodeMac[0];
-        while (*pSubStr != '\0')
-        {
-          if (*pSubStr != ':')
-          {
-               *pMAC = *pSubStr;
-               pMAC++;
-          }
-          pSubStr++;
+ *      Send data made of several pieces to the given TCP connection as
+ *      one <ESC><'S'><cid><N bytes><ESC><'E'> frame (see
+ *      AtLib_SendTcpData).  Each piece is written straight from where it
+ *      is (e.g. constant text in flash, a key in RAM, a formatted value)
+ *      so the data never has to be put together in one buffer.
+ * Inputs:
+ *      uint8_t cid -- Connection ID
+ *      const HOST_APP_IOV_T *pParts -- Pieces of data, in order
+ *      uint8_t numParts -- Number of pieces
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_SendTcpDataV(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts)
+{
+    uint8_t frame[3];
+
+    if (HOST_APP_INVALID_CID != cid) {
+        /* Now send the data START indication message  to S2w node */
+        frame[0] = HOST_APP_ESC_CHAR;
+        frame[1] = HOST_APP_DATA_MODE_NORMAL_START_CHAR_S;
+        frame[2] = cid;
+        App_Write(frame, 3);
+
+        /* Now send the actual data, piece by piece */
+        for (; numParts; numParts--, pParts++) {
+            if (pParts->iLength)
+                AtLib_DataSend(pParts->iData, pParts->iLength);
         }
-          
-        return true;
 
-    } else {
-        /* Failed to get MAC address information */
-        return false;
+        /* Now send the data END indication message  to S2w node */
+        frame[1] = HOST_APP_DATA_MODE_NORMAL_END_CHAR_E;
+        App_Write(frame, 2);
     }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseNodeIpAddress
+ * Routine:  AtLib_SendUdpData
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_WlanConnStat()
- *      command.  The passed in IP number is compared to the returned IP
- *      number (if any), and if it matches, 1 is returned.  Otherwise,
- *      returns 1.
+ *      Send data to the given UDP connection.  The data is converted into
+ *      the following byte format when UDP client:
+ *          <ESC><'S'><cid><N bytes><ESC><'E'>
+ *      When UDP server, transmit in the following format:
+ *          <ESC><'U'><cid><ip><port><N bytes><ESC><'E'>
+ *      <ESC> is the escape character 0x1B
+ *      <'S'> is the letter 'S'
+ *      <cid> is the connection ID.
+ *      <N bytes> is a number of bytes
+ *      <'E'> is the letter 'E'
+ *      <'U'> is the letter 'U'
+ *      <ip> is the ip number of the client
+ *      <port> is the port number of the client
  * Inputs:
- *      int8_t *pIpAddr -- Passed in IP address to compare
+ *      uint8_t cid -- Connection ID
+ *      const uint8_t *pTxData -- Data to send to the TCP connection
+ *      uint32_t dataLen -- Length of data to send
+ *      HOST_APP_CON_TYPE conType -- Type of connection
+ *          (HOST_APP_CON_UDP_SERVER or HOST_APP_CON_UDP_CLIENT)
+ *      uint8_t *pUdpClientIP -- String with client IP number
+ *      uint16_t udpClientPort -- Port id of client
  * Outputs:
- *      uint8_t -- Returns 0 if invalid IP address, 1 if valid ip address and
- *          matches the passed in IP number.
+ *      void
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseNodeIpAddress(int8_t *pIpAddr)
+void AtLib_SendUdpData(
+        uint8_t cid,
+        const uint8_t *txBuf,
+        uint32_t dataLen,
+        HOST_APP_CON_TYPE conType,
+        const uint8_t *pUdpClientIP,
+        uint16_t udpClientPort)
 {
-    char *pSubStr;
+    const char *pEnd = G_ATCmdBuf + HOST_APP_TX_CMD_MAX_SIZE;
+    char *p = G_ATCmdBuf;
 
-    pSubStr = strstr((const char *)MRBuffer, "IP addr=");
-    if (pSubStr) {
-        strcpy((char *)pIpAddr, strtok((pSubStr + 8), ": "));
-        if (pIpAddr[0] == '0') {
-            pIpAddr = NULL;
-
-            /* Failed */
-            return 0;
+    if (HOST_APP_INVALID_CID != cid) {
+        /* Construct the data start indication message */
+        *p++ = HOST_APP_ESC_CHAR;
+        if (HOST_APP_CON_UDP_SERVER == conType) {
+            /* <ESC> < U>  <cid> <ip address><:> <port numer><:> <data> <ESC> < E> */
+            *p++ = 'U';
+            *p++ = cid;
+            /* Leave room for ":<port>:" after the address */
+            while ((*pUdpClientIP) && (p < pEnd - 7))
+                *p++ = *pUdpClientIP++;
+            *p++ = ':';
+            p = AtLib_FormatNumber(p, pEnd, udpClientPort);
+            *p++ = ':';
+        } else {
+            /* <ESC> < S>  <cid>  <data> <ESC> < E> */
+            *p++ = HOST_APP_DATA_MODE_NORMAL_START_CHAR_S;
+            *p++ = cid;
         }
-    } else {
-        /* Failed */
-        return 0;
-    }
 
-    /* Success */
-    return 1;
+        /* Now send the data START indication message  to S2w node */
+        App_Write((uint8_t *)G_ATCmdBuf, p - G_ATCmdBuf);
 
+        /* Now send the actual data */
+        AtLib_DataSend(txBuf, dataLen);
+
+        /* Now send the data END indication message  to S2w node */
+        G_ATCmdBuf[1] = HOST_APP_DATA_MODE_NORMAL_END_CHAR_E;
+        App_Write((uint8_t *)G_ATCmdBuf, 2);
+    }
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseRssiResponse
+ * Routine:  AtLib_WaitWriteReady
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_WlanConnStat()
- *      command.  The RSSI value is returned by reference.
+ *      Wait until everything written has gone to the module and the module
+ *      is ready for more (see App_IsWriteReady), but no longer than
+ *      ATLIB_BULK_READY_TIMEOUT.
  * Inputs:
- *      int16_t *pRSSI -- Returned passed in value
+ *      void
  * Outputs:
- *      uint8_t -- Returns 1 if RSSI value found and valid, else 0.
+ *      bool -- true if ready, false if timed out
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseRssiResponse(int16_t *pRssi)
+static bool AtLib_WaitWriteReady(void)
 {
-    char *pSubStr;
+    uint32_t start = MSTimerGet();
 
-    if ((pSubStr = strstr((const char *)MRBuffer, "-")) != NULL) {
-        *pRssi = atoi((pSubStr));
-
-        return 1;
-    } else {
-        return 0;
+    while (!App_IsWriteReady()) {
+        if (MSTimerDelta(start) >= ATLIB_BULK_READY_TIMEOUT)
+            return false;
     }
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseUdpServerStartResponse
+ * Routine:  AtLib_BulkDataTransfer
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_UdpServer_Start()
- *      command.  If connected, parses the UDP server connection id.
- *      Otherwise, no connection is returned.
+ *      Send bulk data to a current transfer.  Bulk data is transferred in
+ *      the following format:
+ *          <ESC><'Z'><cid><data length><N bytes>
+ *      <ESC> is the escape character 0x1B
+ *      <'Z'> is the letter 'Z'
+ *      <cid> is the connection ID
+ *      <data length> is 4 ASCII characters with the data length
+ *      <N bytes> is a number of bytes, <= 1400 bytes
+ *      Longer data is sent as several frames (see AtLib_BulkDataTransferV).
  * Inputs:
- *      int16_t *pConnId -- Returned connection id (if any)
+ *      uint8_t cid -- Connection ID
+ *      const uint8_t *pData -- Data to send to the TCP connection
+ *      uint32_t dataLen -- Length of data to send
  * Outputs:
- *      uint8_t -- Returns 1 if connected, else 0.
+ *      uint8_t -- true if sent, false if the module did not take it (see
+ *          AtLib_BulkDataTransferV)
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseUdpServerStartResponse(uint8_t *pConnId)
+uint8_t AtLib_BulkDataTransfer(
+        uint8_t cid,
+        const uint8_t *pData,
+        uint32_t dataLen)
 {
-    char * result = NULL;
-
-    if ((result = strstr((const char *)MRBuffer, "CONNECT")) != NULL) {
-        *pConnId = result[8];
+    HOST_APP_IOV_T part;
 
-        /* Success */
-        return 1;
-    } else if (((result = strstr((const char *)MRBuffer, "DISASSOCIATED"))
-            !=NULL) || (strstr((const char *)MRBuffer, "SOCKET FAILURE")
-            != NULL)) {
-        /* Failed  */
-        return 0;
-    } else {
-        /* Failed  */
-        return 0;
-    }
+    part.iData = pData;
+    part.iLength = dataLen;
+    return AtLib_BulkDataTransferV(cid, &part, 1);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseUdpServerStartResponse
+ * Routine:  AtLib_BulkDataTransferV
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_TcpServer_Start()
- *      command.  If connected, parses the TCP server connection id.
- *      Otherwise, no connection is returned.
+ *      Send data made of several pieces to the given connection as bulk
+ *      data frames (see AtLib_BulkDataTransfer).  The data is cut into
+ *      frames of at most ATLIB_BULK_MAX_SIZE bytes.  Instead of a fixed
+ *      delay after each frame header, the header is followed by the data
+ *      as soon as the module has taken the header (App_IsWriteReady).
+ *      If the module is not ready for a header, or has not taken one,
+ *      within ATLIB_BULK_READY_TIMEOUT, the transfer stops there: no data
+ *      follows a header the module has not taken.  The module may then
+ *      be left waiting for the rest of a frame; close the connection.
+ *      Bulk mode must have been turned on with AtLibGs_BData(1).
  * Inputs:
- *      int16_t *pConnId -- Returned connection id (if any)
+ *      uint8_t cid -- Connection ID
+ *      const HOST_APP_IOV_T *pParts -- Pieces of data, in order
+ *      uint8_t numParts -- Number of pieces
  * Outputs:
- *      uint8_t -- Returns 1 if connected, else 0.
+ *      uint8_t -- true if all the data was sent, false if the transfer
+ *          stopped (or the CID is not valid)
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseTcpServerStartResponse(uint8_t *pConnId)
+uint8_t AtLib_BulkDataTransferV(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts)
 {
-    char* pSubStr = NULL;
+    /*<Esc> <Z> <Cid> <Data Length xxxx 4 ascii char> <data> */
+    uint8_t header[3 + HOST_APP_BULK_DATA_LEN_STRING_SIZE + 1];
+    uint32_t total = 0;
+    uint32_t frameLen;
+    uint32_t offset = 0;
+    uint32_t run;
+    uint8_t i;
+
+    if (HOST_APP_INVALID_CID == cid)
+        return false;
 
-    if ((pSubStr = strstr((const char *)MRBuffer, "CONNECT")) != NULL) {
-        *pConnId = pSubStr[8];
-        return 1;/* Success */
-    } else if (((strstr((const char *)MRBuffer, "DISASSOCIATED")) != NULL)
-            || (strstr((const char *)MRBuffer, "SOCKET FAILURE") != NULL)) {
-        return 0; /* Failed  */
-    } else {
-        return 0; /* Failed  */
+    for (i = 0; i < numParts; i++)
+        total += pParts[i].iLength;
+
+    header[0] = HOST_APP_ESC_CHAR;
+    header[1] = HOST_APP_DATA_MODE_BULK_START_CHAR_Z;
+    header[2] = cid;
+    while (total) {
+        frameLen = total;
+        if (frameLen > ATLIB_BULK_MAX_SIZE)
+            frameLen = ATLIB_BULK_MAX_SIZE;
+        total -= frameLen;
+
+        /* Send the bulk data START indication message once the module */
+        /* can take it, then give the module the time to take it */
+        if (!AtLib_WaitWriteReady())
+            return false;
+        AtLib_ConvertNumberTo4DigitASCII(frameLen, (int8_t *)&header[3]);
+        App_Write(header, 3 + HOST_APP_BULK_DATA_LEN_STRING_SIZE);
+        if (!AtLib_WaitWriteReady())
+            return false;
+
+        /* Now send the frame's data, crossing pieces as needed */
+        while (frameLen) {
+            run = pParts->iLength - offset;
+            if (run > frameLen)
+                run = frameLen;
+            AtLib_DataSend(pParts->iData + offset, run);
+            frameLen -= run;
+            offset += run;
+            if (offset == pParts->iLength) {
+                pParts++;
+                offset = 0;
+            }
+        }
     }
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseDNSLookupResponse
+ * Routine:  AtLib_SendTcpDataAuto
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_DNSLookup()
- *      command.  If connected, parses the TCP server connection id.
- *      Otherwise, no connection is returned.
+ *      Send data made of several pieces to the given TCP connection in
+ *      the best mode.  Bulk data frames are used if bulk mode is on and
+ *      the data is at least ATLIB_BULK_MIN_SIZE bytes long or contains
+ *      an <ESC> (which cannot be sent in an <ESC><'S'> frame).  Else the
+ *      data is sent with AtLib_SendTcpDataV, which has less overhead for
+ *      short data.
  * Inputs:
- *      int16_t *pConnId -- Returned connection id (if any)
+ *      uint8_t cid -- Connection ID
+ *      const HOST_APP_IOV_T *pParts -- Pieces of data, in order
+ *      uint8_t numParts -- Number of pieces
  * Outputs:
- *      uint8_t -- Returns 1 if connected, else 0.
+ *      uint8_t -- true if sent, false if a bulk transfer stopped (see
+ *          AtLib_BulkDataTransferV)
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseDNSLookupResponse(char *ipAddr)
-{
-    char *pSubStr = NULL;
+uint8_t AtLib_SendTcpDataAuto(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts)
+{
+    uint32_t total = 0;
+    bool useBulk = false;
+    uint8_t i;
+
+    if (G_AtLibBulkEnabled) {
+        for (i = 0; i < numParts; i++) {
+            total += pParts[i].iLength;
+            if ((pParts[i].iLength) && (memchr(pParts[i].iData,
+                    HOST_APP_ESC_CHAR, pParts[i].iLength)))
+                useBulk = true;
+        }
+        if (total >= ATLIB_BULK_MIN_SIZE)
+            useBulk = true;
+    }
 
-    pSubStr = strstr((const char *)MRBuffer, "IP:");
-    if (pSubStr) {
-        strcpy(ipAddr, (pSubStr + 3));
+    if (useBulk)
+        return AtLib_BulkDataTransferV(cid, pParts, numParts);
 
-        return 1; /* Success */
-    } else {
-        return 0; /* Failed  */
-    }
+    AtLib_SendTcpDataV(cid, pParts, numParts);
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseWPSPUSHResponse
+ * Routine:  AtLib_IsBulkEnabled
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_StartWPSPUSH()
- *      command.  If the WPS worked (and an SSID is reported), 1 is
- *      returned.  If fails, it returns 0.
+ *      Determine if bulk data mode was turned on with AtLibGs_BData.
  * Inputs:
  *      void
  * Outputs:
- *      uint8_t -- Returns 1 if WPS is successful, else 0.
+ *      uint8_t -- true if on, else false
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseWPSPUSHResponse(void)
+uint8_t AtLib_IsBulkEnabled(void)
 {
-    if (strstr((const char *)MRBuffer, "SSID=") != NULL) {
-        return 1; /* Success */
-    } else {
-        return 0; /* Failed  */
-    }
+    return G_AtLibBulkEnabled;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ParseWPSPINResponse
+ * Routine:  AtLib_checkEOFMessage
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_StartWPSPIN()
- *      command.  If the WPS worked (and an SSID is reported), 1 is
- *      returned.  If fails, it returns 0.
+ *      This functions is used to check the completion of Commands
+ *      This function will be called after receiving each line.
+ *      The line is scanned only once.  At each character, only the tokens
+ *      in G_AtLibEOFTokens that start with that character are compared.
+ *      If several tokens are found in the line, the one with the lowest
+ *      priority number wins and its flag actions are applied.
+ *      Unsolicited notifications are also posted to the AtEvent queue
+ *      with the CID that follows the token (e.g. "DISCONNECT 1"), if any.
  * Inputs:
- *      void
+ *      const uint8_t *pBuffer -- Line of data to check
  * Outputs:
- *      uint8_t -- Returns 1 if WPS is successful, else 0.
+ *      HOST_APP_MSG_ID_E -- response type, HOST_APP_MSG_ID_NONE is returned
+ *          if the passed line is not identified.
  *---------------------------------------------------------------------------*/
-uint8_t AtLib_ParseWPSPINResponse(uint32_t pin)
+HOST_APP_MSG_ID_E AtLib_checkEOFMessage(const uint8_t *pBuffer)
 {
-    if (strstr((const char *)MRBuffer, "SSID=") != NULL) {
-        return 1; /* Success */
-    } else {
-        return 0; /* Failed  */
+    const ATLIB_EOF_TOKEN_T *pToken;
+    const ATLIB_EOF_TOKEN_T *pFound = NULL;
+    const uint8_t *pMatch = NULL;
+    uint8_t cid;
+    uint8_t i;
+
+    for (; (*pBuffer != '\0') && ((pFound == NULL) || (pFound->iPriority != 0));
+            pBuffer++) {
+        /* Find the first token starting with this character */
+        switch (*pBuffer) {
+            case 'O':
+                i = ATLIB_EOF_FIRST_O;
+                break;
+            case 'E':
+                i = ATLIB_EOF_FIRST_E;
+                break;
+            case 'I':
+                i = ATLIB_EOF_FIRST_I;
+                break;
+            case 'D':
+                i = ATLIB_EOF_FIRST_D;
+                break;
+            case 'A':
+                i = ATLIB_EOF_FIRST_A;
+                break;
+            case 'U':
+                i = ATLIB_EOF_FIRST_U;
+                break;
+            case 'S':
+                i = ATLIB_EOF_FIRST_S;
+                break;
+            default:
+                /* No token starts with this character */
+                continue;
+        }
+
+        /* Compare all the tokens of this group */
+        for (pToken = &G_AtLibEOFTokens[i];
+                (i < ATLIB_EOF_NUM_TOKENS) && (pToken->iToken[0] == *pBuffer);
+                i++, pToken++) {
+            if (((pFound == NULL) || (pToken->iPriority < pFound->iPriority))
+                    && (strncmp((const char *)pBuffer, pToken->iToken,
+                            pToken->iLength) == 0)) {
+                pFound = pToken;
+                pMatch = pBuffer;
+            }
+        }
+    }
+
+    if (pFound == NULL) {
+        /* Not identified (including the echoed back "AT+" command) */
+        return HOST_APP_MSG_ID_NONE;
+    }
+
+    /* The CID, if one follows the token */
+    pMatch += pFound->iLength;
+    cid = (pMatch[0] == ' ' && isxdigit(pMatch[1])) ? pMatch[1]
+            : HOST_APP_INVALID_CID;
+
+    /* Reset the local flags */
+    if (pFound->iActions & ATLIB_EOF_ACTION_CLEAR_ASSOCIATION)
+        AtLib_ClearNodeAssociationFlag();
+    if (pFound->iActions & ATLIB_EOF_ACTION_SET_RESET)
+        AtLib_SetNodeResetFlag();
+    if (pFound->iActions & ATLIB_EOF_ACTION_CLEAR_CID) {
+        AtLib_ClearAllCid();
+
+        /* Detach the receive rings of the closed connections so data */
+        /* for a reused CID does not reach the old owner */
+        if (cid != HOST_APP_INVALID_CID)
+            AtCidRx_Disconnect(cid);
+        else
+            AtCidRx_DisconnectAll();
     }
+
+    if (pFound->iActions & ATLIB_EOF_ACTION_EVENT) {
+        /* Tell the application, with the CID if one follows */
+        AtEvent_Post(pFound->iMsgId, cid);
+    }
+
+    return pFound->iMsgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_CommandSend
+ * Routine:  AtLib_ReceiveDataHandle
  *---------------------------------------------------------------------------*
  * Description:
- *      Sends an AT command to the module and waits for a response.  If
- *      data is returned, it is collected into MRBuffer.
+ *      Handle data coming in on a TCP or UDP connection.  Process all
+ *      non-blocking data reads and return.  A data frame that is only
+ *      partially received is continued on the next call.  A response
+ *      completes the command queued with AtLib_CommandQueue.  The time and
+ *      number of bytes spent in this call are recorded for AtLib_GetRxStats.
  * Inputs:
  *      void
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      HOST_APP_MSG_ID_E -- Last data frame completed (HOST_APP_MSG_ID_*_RX)
+ *          or HOST_APP_MSG_ID_NONE if no frame was completed
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLib_CommandSend(void)
+HOST_APP_MSG_ID_E AtLib_ReceiveDataHandle(void)
 {
     HOST_APP_MSG_ID_E rxMsgId;
+    uint32_t start = MSTimerGet();
+    uint32_t numBytes;
+    uint32_t elapsed;
 
-#ifdef HOST_APP_DEBUG_ENABLE
-    ConsolePrintf(">%s\n", G_ATCmdBuf);
-#endif    
-
-    /* Now send the command to S2w App node */
-    App_Write((uint8_t *)&G_ATCmdBuf[0], strlen((const char *)G_ATCmdBuf));
+    rxMsgId = AtLib_ReceiveAvailable(&numBytes);
 
-    /* Wait for the response while collecting data into the MRBuffer */
-    rxMsgId = AtLib_ResponseHandle();
+    /* Track the worst case time the caller was held up */
+    elapsed = MSTimerDelta(start);
+    if (elapsed > G_AtLibRxStats.iMaxStallMS)
+        G_AtLibRxStats.iMaxStallMS = elapsed;
+    if (numBytes > G_AtLibRxStats.iMaxStallBytes)
+        G_AtLibRxStats.iMaxStallBytes = numBytes;
 
     return rxMsgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_DataSend
+ * Routine:  AtLib_ReceiveNext
  *---------------------------------------------------------------------------*
  * Description:
- *      Send data to the module.
+ *      Process the bytes read from the module up to the next message.
+ *      When the bytes read earlier are used up, reads what has arrived
+ *      since (non-blocking) in chunks of ATLIB_RX_CHUNK_SIZE.  Bytes
+ *      after a message are kept for the next call.
  * Inputs:
- *      const uint8_t *pTxData -- Data to send
- *      uint32_t dataLen -- Length of data to send
+ *      HOST_APP_MSG_ID_E *pMsgId -- Message completed, or
+ *          HOST_APP_MSG_ID_NONE
  * Outputs:
- *      void
+ *      uint32_t -- Number of bytes processed, 0 if nothing has arrived
  *---------------------------------------------------------------------------*/
-void AtLib_DataSend(const uint8_t *pTxData, uint32_t dataLen)
+static uint32_t AtLib_ReceiveNext(HOST_APP_MSG_ID_E *pMsgId)
 {
-    App_Write(pTxData, dataLen);
+    uint32_t done;
+
+    *pMsgId = HOST_APP_MSG_ID_NONE;
+    if (G_AtLibRxChunkIndex >= G_AtLibRxChunkLen) {
+        G_AtLibRxChunkIndex = 0;
+        G_AtLibRxChunkLen = App_ReadAvailable(G_AtLibRxChunk,
+                ATLIB_RX_CHUNK_SIZE);
+        if (!G_AtLibRxChunkLen)
+            return 0;
+        LOG_DATA(LOG_LEVEL_DEBUG, LOG_ID_AT_RECEIVE, G_AtLibRxChunk,
+                G_AtLibRxChunkLen);
+    }
+    done = AtLib_ReceiveDataSpan(G_AtLibRxChunk + G_AtLibRxChunkIndex,
+            G_AtLibRxChunkLen - G_AtLibRxChunkIndex, pMsgId);
+    G_AtLibRxChunkIndex += done;
+
+    return done;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_SendTcpData
+ * Routine:  AtLib_ReceiveAvailable
  *---------------------------------------------------------------------------*
  * Description:
- *      Send data to the given TCP connection.  The data is converted into
- *      the following byte format:
- *          <ESC><'S'><cid><N bytes><ESC><'E'>
- *      <ESC> is the escape character 0x1B
- *      <'S'> is the letter 'S'
- *      <cid> is the connection ID.
- *      <N bytes> is a number of bytes
- *      <'E'> is the letter 'E'
+ *      Process everything that has arrived from the module.  A response
+ *      completes the executing command (see AtLib_CommandQueue); the
+ *      rest of the data is then left for the next call so MRBuffer is
+ *      not overwritten before the command's caller looks at it.
  * Inputs:
- *      uint8_t cid -- Connection ID
- *      const uint8_t *pTxData -- Data to send to the TCP connection
- *      uint32_t dataLen -- Length of data to send
+ *      uint32_t *pNumBytes -- Number of bytes processed
  * Outputs:
- *      void
+ *      HOST_APP_MSG_ID_E -- Last data frame completed (HOST_APP_MSG_ID_*_RX)
+ *          or HOST_APP_MSG_ID_NONE if no frame was completed
  *---------------------------------------------------------------------------*/
-void AtLib_SendTcpData(uint8_t cid, const uint8_t *txBuf, uint32_t dataLen)
+static HOST_APP_MSG_ID_E AtLib_ReceiveAvailable(uint32_t *pNumBytes)
 {
-  if (HOST_APP_INVALID_CID != cid) {
-        /* Construct the data start indication message */
-        sprintf(G_ATCmdBuf, "%c%c%c", HOST_APP_ESC_CHAR, 'S', cid);
-
-        /* Now send the data START indication message  to S2w node */
-        App_Write((uint8_t *)&G_ATCmdBuf[0], 3);
-
-        /* Now send the actual data */
-        AtLib_DataSend(txBuf, dataLen);
-
-        /* Construct the data start indication message */
-        sprintf(G_ATCmdBuf, "%c%c", HOST_APP_ESC_CHAR, 'E');
-
-        /* Now send the data END indication message  to S2w node */
-        App_Write((uint8_t *)&G_ATCmdBuf[0], 2);
+    HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
+    HOST_APP_MSG_ID_E msgId;
+    ATLIB_CMD_T cmd;
+    uint32_t done;
+    uint16_t lines = G_AtLibRxLines;
+
+    *pNumBytes = 0;
+    while ((done = AtLib_ReceiveNext(&msgId)) != 0) {
+        *pNumBytes += done;
+        if (lines != G_AtLibRxLines) {
+            /* The module is answering, restart the timeout */
+            lines = G_AtLibRxLines;
+            G_AtLibCmdLastRx = G_AtLibResyncTime = MSTimerGet();
+        }
+        if (AtLib_IsDataMessage(msgId)) {
+            rxMsgId = msgId;
+        } else if ((msgId == HOST_APP_MSG_ID_NONE)
+                || (AtLib_IsEventMessage(msgId))) {
+            /* Nothing yet, or a notification (see AtEvent) that is */
+            /* never the response of a command */
+            continue;
+        } else if (G_AtLibResync != ATLIB_RESYNC_IDLE) {
+            /* Late response of a command that timed out, or the OK of */
+            /* "AT" (see AtLib_ResyncCheck) */
+            if (G_AtLibResyncDropped != 0xFF)
+                G_AtLibResyncDropped++;
+            if (msgId == HOST_APP_MSG_ID_OK)
+                G_AtLibResync = ATLIB_RESYNC_QUIET;
+        } else if (G_AtLibCmdIsActive) {
+            /* Response to the executing command */
+            G_AtLibCmdIsActive = false;
+            cmd = G_AtLibCmdActive;
+            AtLib_TimeoutSample(cmd.iClass, MSTimerDelta(cmd.iStartTime));
+            if (cmd.iCallback)
+                cmd.iCallback(cmd.iHandle, msgId, cmd.iContext);
+            break;
+        } else {
+            /* No command is waiting (resynchronising gave up) */
+            AtLib_CountStaleResponses(1);
+        }
     }
+
+    return rxMsgId;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_SendUdpData
+ * Routine:  AtLib_IsDataMessage
  *---------------------------------------------------------------------------*
  * Description:
- *      Send data to the given UDP connection.  The data is converted into
- *      the following byte format when UDP client:
- *          <ESC><'S'><cid><N bytes><ESC><'E'>
- *      When UDP server, transmit in the following format:
- *          <ESC><'U'><cid><ip><port><N bytes><ESC><'E'>
- *      <ESC> is the escape character 0x1B
- *      <'S'> is the letter 'S'
- *      <cid> is the connection ID.
- *      <N bytes> is a number of bytes
- *      <'E'> is the letter 'E'
- *      <'U'> is the letter 'U'
- *      <ip> is the ip number of the client
- *      <port> is the port number of the client
+ *      Determine if a message id reports the end of a received data frame
+ *      rather than a command response.
  * Inputs:
- *      uint8_t cid -- Connection ID
- *      const uint8_t *pTxData -- Data to send to the TCP connection
- *      uint32_t dataLen -- Length of data to send
- *      HOST_APP_CON_TYPE conType -- Type of connection
- *          (HOST_APP_CON_UDP_SERVER or HOST_APP_CON_UDP_CLIENT)
- *      uint8_t *pUdpClientIP -- String with client IP number
- *      uint16_t udpClientPort -- Port id of client
+ *      HOST_APP_MSG_ID_E msgId -- Message id to check
  * Outputs:
- *      void
+ *      uint8_t -- true if end of a data frame, else false
  *---------------------------------------------------------------------------*/
-void AtLib_SendUdpData(
-        uint8_t cid,
-        const uint8_t *txBuf,
-        uint32_t dataLen,
-        HOST_APP_CON_TYPE conType,
-        const uint8_t *pUdpClientIP,
-        uint16_t udpClientPort)
+uint8_t AtLib_IsDataMessage(HOST_APP_MSG_ID_E msgId)
 {
-    if (HOST_APP_INVALID_CID != cid) {
-        /* Construct the data start indication message */
-        if (HOST_APP_CON_UDP_SERVER == conType) {
-            /* <ESC> < U>  <cid> <ip address><:> <port numer><:> <data> <ESC> < E> */
-            sprintf(G_ATCmdBuf, "%c%c%c%s:" _F16_ ":", HOST_APP_ESC_CHAR, 'U', cid,
-                    pUdpClientIP, udpClientPort);
-        } else {
-            /* <ESC> < S>  <cid>  <data> <ESC> < E> */
-            sprintf(G_ATCmdBuf, "%c%c%c", HOST_APP_ESC_CHAR, 'S', cid);
-        }
-
-        /* Now send the data START indication message  to S2w node */
-        App_Write((uint8_t *)&G_ATCmdBuf[0], strlen(G_ATCmdBuf));
-
-        /* Now send the actual data */
-        AtLib_DataSend(txBuf, dataLen);
-
-        /* Construct the data start indication message  */
-        sprintf(G_ATCmdBuf, "%c%c", HOST_APP_ESC_CHAR, 'E');
-
-        /* Now send the data END indication message  to S2w node */
-        App_Write((uint8_t *)&G_ATCmdBuf[0], strlen(G_ATCmdBuf));
-    }
+    return ((msgId == HOST_APP_MSG_ID_DATA_RX)
+            || (msgId == HOST_APP_MSG_ID_BULK_DATA_RX)
+            || (msgId == HOST_APP_MSG_ID_HTTP_RESPONSE_DATA_RX)
+            || (msgId == HOST_APP_MSG_ID_RAW_DATA_RX)) ? true : false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_BulkDataTransfer
+ * Routine:  AtLib_CountStaleResponses
  *---------------------------------------------------------------------------*
  * Description:
- *      Send bulk data to a current transfer.  Bulk data is transferred in
- *      the following format:
- *          <ESC><'Z'><cid><data length><N bytes><ESC><'E'>
- *      <ESC> is the escape character 0x1B
- *      <'Z'> is the letter 'Z'
- *      <cid> is the connection ID
- *      <data length> is 4 ASCII characters with the data length
- *      <N bytes> is a number of bytes, <= 1400 bytes
- *      <'E'> is the letter 'E'
+ *      Add responses that came for no waiting command to the receive
+ *      statistics, stopping at 0xFFFF.
  * Inputs:
- *      uint8_t cid -- Connection ID
- *      const uint8_t *pTxData -- Data to send to the TCP connection
- *      uint32_t dataLen -- Length of data to send
- *      HOST_APP_CON_TYPE conType -- Type of connection
- *          (HOST_APP_CON_UDP_SERVER or HOST_APP_CON_UDP_CLIENT)
- *      uint8_t *pUdpClientIP -- String with client IP number
- *      uint16_t udpClientPort -- Port id of client
+ *      uint8_t count -- Responses dropped
  * Outputs:
  *      void
  *---------------------------------------------------------------------------*/
-void AtLib_BulkDataTransfer(uint8_t cid, const uint8_t *pData, uint32_t dataLen)
+static void AtLib_CountStaleResponses(uint8_t count)
 {
-    /*<Esc> <Z> <Cid> <Data Length xxxx 4 ascii char> <data> */
-    int8_t digits[5];
-
-    /* Construct the bulk data start indication message  */
-    AtLib_ConvertNumberTo4DigitASCII(dataLen, digits);
-    sprintf(&(G_ATCmdBuf[0]), "%c%c%c%s", HOST_APP_ESC_CHAR, 'Z', cid, digits);
-
-    /* Now send the bulk data START indication message  to S2w node */
-    App_Write((uint8_t *)&G_ATCmdBuf[0], strlen(G_ATCmdBuf));
-
-    /* wait for GS1011 to process above command LeZ */
-    MSTimerDelay(100);
-
-    /* Now send the actual data */
-    App_Write(pData, dataLen);
+    if ((uint32_t)G_AtLibRxStats.iStaleResponses + count > 0xFFFF)
+        G_AtLibRxStats.iStaleResponses = 0xFFFF;
+    else
+        G_AtLibRxStats.iStaleResponses += count;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_checkEOFMessage
+ * Routine:  AtLib_IsEventMessage
  *---------------------------------------------------------------------------*
  * Description:
- *      This functions is used to check the completion of Commands
- *      This function will be called after receiving each line.
+ *      Determine if a message id is for a line the module sends on its
+ *      own (an ATLIB_EOF_ACTION_EVENT token) rather than a response.
  * Inputs:
- *      const uint8_t *pBuffer -- Line of data to check
+ *      HOST_APP_MSG_ID_E msgId -- Message id to check
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type, HOST_APP_MSG_ID_NONE is returned
- *          if the passed line is not identified.
+ *      uint8_t -- true if an event, else false
  *---------------------------------------------------------------------------*/
-HOST_APP_MSG_ID_E AtLib_checkEOFMessage(const uint8_t *pBuffer)
+static uint8_t AtLib_IsEventMessage(HOST_APP_MSG_ID_E msgId)
 {
+    uint8_t i;
 
-    if ((strstr((const char *)pBuffer, "OK") != NULL)) {
-        return HOST_APP_MSG_ID_OK;
-    } else if ((strstr((const char *)pBuffer, "ERROR") != NULL)) {
-        return HOST_APP_MSG_ID_ERROR;
-    } else if ((strstr((const char *)pBuffer, "INVALID INPUT") != NULL)) {
-        return HOST_APP_MSG_ID_INVALID_INPUT;
-    } else if ((strstr((const char *)pBuffer, "DISASSOCIATED") != NULL)) {
-        /* Reset the local flags */
-        AtLib_ClearNodeAssociationFlag();
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_DISASSOCIATION_EVENT;
-    } else if ((strstr((const char *)pBuffer, "ERROR: IP CONFIG FAIL") != NULL)) {
-        return HOST_APP_MSG_ID_ERROR_IP_CONFIG_FAIL;
-    } else if (strstr((const char *)pBuffer, "ERROR: SOCKET FAILURE") != NULL) {
-        /* Reset the local flags */
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_ERROR_SOCKET_FAIL;
-    } else if ((strstr((const char *)pBuffer, "APP Reset-APP SW Reset"))
-            != NULL) {
-        /* Reset the local flags */
-        AtLib_ClearNodeAssociationFlag();
-        AtLib_SetNodeResetFlag();
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_APP_RESET;
-    } else if (((uint8_t *)strstr((const char *)pBuffer, "DISCONNECT")) != NULL) {
-        /* Reset the local flags */
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_DISCONNECT;
-    } else if ((strstr((const char *)pBuffer, "Disassociation Event")) != NULL) {
-        /* reset the association flag */
-        AtLib_ClearNodeAssociationFlag();
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_DISASSOCIATION_EVENT;
-    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Alarm")) != NULL) {
-        return HOST_APP_MSG_ID_OUT_OF_STBY_ALARM;
-    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Timer")) != NULL) {
-        return HOST_APP_MSG_ID_OUT_OF_STBY_TIMER;
-    } else if ((strstr((const char *)pBuffer, "UnExpected Warm Boot")) != NULL) {
-        /* Reset the local flags */
-        AtLib_ClearNodeAssociationFlag();
-        AtLib_SetNodeResetFlag();
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_UNEXPECTED_WARM_BOOT;
-    } else if ((strstr((const char *)pBuffer, "Out of Deep Sleep")) != NULL) {
-        return HOST_APP_MSG_ID_OUT_OF_DEEP_SLEEP;
-    } else if ((strstr((const char *)pBuffer, "Serial2WiFi APP")) != NULL) {
-        /* Reset the local flags */
-        AtLib_ClearNodeAssociationFlag();
-        AtLib_SetNodeResetFlag();
-        AtLib_ClearAllCid();
-        return HOST_APP_MSG_ID_WELCOME_MSG;
-    } else if ((pBuffer[0] == 'A') && (pBuffer[1] == 'T')
-            && (pBuffer[2] == '+')) {/* Handle the echoed back AT Command, if Echo is enabled.  "AT+" . */
-        return HOST_APP_MSG_ID_NONE;
+    for (i = 0; i < ATLIB_EOF_NUM_TOKENS; i++) {
+        if ((G_AtLibEOFTokens[i].iMsgId == msgId)
+                && (G_AtLibEOFTokens[i].iActions & ATLIB_EOF_ACTION_EVENT))
+            return true;
     }
 
-    return HOST_APP_MSG_ID_NONE;
+    return false;
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  AtLib_ReceiveDataHandle
+ * Routine:  AtLib_GetRxStats
  *---------------------------------------------------------------------------*
  * Description:
- *      Handle data coming in on a TCP or UDP connection.  Process all
- *      non-blocking data reads and return.
+ *      Get the worst case stall measured in AtLib_ReceiveDataHandle and
+ *      the late responses dropped since the last AtLib_ClearRxStats.
  * Inputs:
- *      void
+ *      HOST_APP_RX_STATS_T *pStats -- Place to copy the measurements
  * Outputs:
  *      void
  *---------------------------------------------------------------------------*/
-void AtLib_ReceiveDataHandle(void)
+void AtLib_GetRxStats(HOST_APP_RX_STATS_T *pStats)
 {
-    uint8_t rxData;
+    *pStats = G_AtLibRxStats;
+}
 
-    /* Read one byte at a time - Use non-blocking call */
-    while (App_Read(&rxData, 1, 0)) {
-        /* Process the received data */
-        AtLib_ReceiveDataProcess(rxData);
-    }
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_ClearRxStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Reset the stall measurements of AtLib_ReceiveDataHandle and the
+ *      count of late responses.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_ClearRxStats(void)
+{
+    G_AtLibRxStats.iMaxStallMS = 0;
+    G_AtLibRxStats.iMaxStallBytes = 0;
+    G_AtLibRxStats.iStaleResponses = 0;
 }
 
 /*---------------------------------------------------------------------------*
  * Routine:  AtLib_ReceiveDataProcess
  *---------------------------------------------------------------------------*
  * Description:
- *      Process individually received characters
+ *      Process individually received characters.  Never waits for more
+ *      data; all progress through a data frame is kept in G_AtLibRx so
+ *      the next character continues where this one left off.
  * Inputs:
  *      uint8_t rxData -- Character to process
  * Outputs:
- *      HOST_APP_MSG_ID_E -- response type
+ *      HOST_APP_MSG_ID_E -- response type, or HOST_APP_MSG_ID_*_RX when
+ *          the last character of a data frame is processed
  *---------------------------------------------------------------------------*/
 HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
 {
-    /* receive data handling state */
-    static HOST_APP_RX_STATE_E receive_state = HOST_APP_RX_STATE_START;
-    static uint32_t specialDataLen = 0;
-    static uint8_t rxCurrentCid = 0;
-    static uint8_t prevChar = 0;
-    static uint32_t specialDataLenCharCount = 0;
-
     HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
-
-#ifdef HOST_APP_DEBUG_ENABLE
-    if ((isprint(rxData)) || (isspace(rxData)))
-        ConsolePrintf("%c", rxData);
-#endif  
+    uint8_t isEvent;
 
     /* Process the received data */
-    switch (receive_state) {
+    switch (G_AtLibRx.iState) {
         case HOST_APP_RX_STATE_START:
             switch (rxData) {
                 case HOST_APP_CR_CHAR:
@@ -2532,18 +3039,23 @@ HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
 
                 case HOST_APP_ESC_CHAR:
                     /* ESCAPE sequence detected */
-                    receive_state = HOST_APP_RX_STATE_ESCAPE_START;
+                    G_AtLibRx.iState = HOST_APP_RX_STATE_ESCAPE_START;
                     MRBufferIndex = 0;
-                    specialDataLen = 0;
-                    rxCurrentCid = 0;
+                    G_AtLibRx.iDataLength = 0;
+                    G_AtLibRx.iLengthCharCount = 0;
+                    G_AtLibRx.iCid = 0;
+                    G_AtLibRx.iEscapePending = false;
                     break;
 
                 default:
                     /* Not start of ESC char, not start of any CR or NL */
                     MRBufferIndex = 0;
+                    G_AtLibTokenCount = ATLIB_TOKENS_INVALID;
+                    G_AtLibLineCount = 0;
+                    G_AtLibLineStart = 0;
                     MRBuffer[MRBufferIndex] = rxData;
                     MRBufferIndex++;
-                    receive_state = HOST_APP_RX_STATE_CMD_RESP;
+                    G_AtLibRx.iState = HOST_APP_RX_STATE_CMD_RESP;
                     break;
             }
             break;
@@ -2556,27 +3068,55 @@ HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
                 // terminate string with NULL for strstr()
                 MRBufferIndex++;
                 MRBuffer[MRBufferIndex] = '\0';
-                rxMsgId = AtLib_checkEOFMessage(MRBuffer);
-
-                if (HOST_APP_MSG_ID_NONE != rxMsgId) {
+                G_AtLibTokenCount = ATLIB_TOKENS_INVALID;
+
+                /* The earlier lines were not identified, so only the */
+                /* new line needs to be checked */
+                rxMsgId = AtLib_checkEOFMessage(MRBuffer + G_AtLibLineStart);
+                isEvent = AtLib_IsEventMessage(rxMsgId);
+                if (!isEvent)
+                    G_AtLibRxLines++;
+
+                if ((isEvent) && (G_AtLibLineStart != 0)) {
+                    /* A notification in the middle of a response, keep */
+                    /* the lines before it for the response */
+                    MRBufferIndex = G_AtLibLineStart;
+                } else if (HOST_APP_MSG_ID_NONE != rxMsgId) {
                     /* command echo or end of response detected */
+                    AtLib_LineAdd();
+
                     /* Now reset the  state machine */
-                    receive_state = HOST_APP_RX_STATE_START;
+                    G_AtLibRx.iState = HOST_APP_RX_STATE_START;
                     MRBufferIndex = 0;
+                } else {
+                    if (!AtLib_LineStream(false)) {
+                        /* Keep the line in MRBuffer */
+                        AtLib_LineAdd();
+                    }
+
+                    /* The next line needs room for a character, its LF */
+                    /* and the terminator */
+                    if (MRBufferIndex >= HOST_APP_RX_CMD_MAX_SIZE - 2) {
+                        /* Message buffer overflow */
+                        MRBufferIndex = 0;
+                        G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+                    }
                 }
             } else if (HOST_APP_ESC_CHAR == rxData) {
                 /* Defensive check - This should not happen */
-                receive_state = HOST_APP_RX_STATE_START;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
             } else {
                 MRBuffer[MRBufferIndex] = rxData;
                 MRBufferIndex++;
 
-                if (MRBufferIndex >= HOST_APP_RX_CMD_MAX_SIZE) {
+                /* Keep room for the LF and the terminator */
+                if ((MRBufferIndex >= HOST_APP_RX_CMD_MAX_SIZE - 1)
+                        && (!AtLib_LineStream(true))) {
                     /* Message buffer overflow. Something seriousely wrong. */
                     MRBufferIndex = 0;
 
                     /* Now reset the  state machine */
-                    receive_state = HOST_APP_RX_STATE_START;
+                    G_AtLibRx.iState = HOST_APP_RX_STATE_START;
                 }
             }
             break;
@@ -2585,145 +3125,134 @@ HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
             if (HOST_APP_DATA_MODE_BULK_START_CHAR_H == rxData) {
                 /* HTTP Bulk data handling start */
                 /* <Esc>H<1 Byte - CID><4 bytes - Length of the data><data> */
-                receive_state = HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE;
-                specialDataLen = 0;
-                specialDataLenCharCount = 0;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_CID;
             } else if ((HOST_APP_DATA_MODE_BULK_START_CHAR_Z == rxData) ||
                        (HOST_APP_DATA_MODE_BULK_START_CHAR_K == rxData)){
                 /* Bulk data handling start */
                 /* <Esc>Z<Cid><Data Length xxxx 4 ascii char><data>   */
-                receive_state = HOST_APP_RX_STATE_BULK_DATA_HANDLE;
-                specialDataLen = 0;
-                specialDataLenCharCount = 0;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_BULK_DATA_HANDLE;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_CID;
             } else if (HOST_APP_DATA_MODE_NORMAL_START_CHAR_S == rxData) {
                 /* Start of data */
                 /* ESC S  cid  <----data --- > ESC E  */
-                receive_state = HOST_APP_RX_STATE_DATA_HANDLE;
-            } else if (HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL == rxData) {
+                G_AtLibRx.iState = HOST_APP_RX_STATE_DATA_HANDLE;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_CID;
+            } else if ((HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_R == rxData) ||
+                       (HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL == rxData)) {
                 /* Start of raw data  */
                 /* ESC R : datalen : <----data --- >
                  Unlike other data format, there is no ESC E at the end .
                  So extract datalength to find out the incoming data size */
-                receive_state = HOST_APP_RX_STATE_RAW_DATA_HANDLE;
-                specialDataLen = 0;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_RAW_DATA_HANDLE;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_LENGTH;
             } else if (HOST_APP_DATA_MODE_ESC_OK_CHAR_O == rxData) {
                 /* ESC command response OK */
                 /* Note: No need to take any action. Its just an data reception */
                 /* acknowledgement S2w node */
-                receive_state = HOST_APP_RX_STATE_START;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
             } else if (HOST_APP_DATA_MODE_ESC_FAIL_CHAR_F == rxData) {
                 /* ESC command response FAILED */
                 /* Note: Error reported from S2w node, you can use it */
                 /* for debug purpose. */
-                receive_state = HOST_APP_RX_STATE_START;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
             } else {
                 /* ESC sequence parse error !  */
                 /* Reset the receive buffer */
-                receive_state = HOST_APP_RX_STATE_START;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
             }
             break;
 
         case HOST_APP_RX_STATE_DATA_HANDLE:
-            rxCurrentCid = rxData;
-            prevChar = 0x00;
-
-            do {
-                /* keep recieving data till you get ESC E */
-                App_Read(&rxData, 1, 1);
-
-                /* Read one byte at a time - blocking call */
+            if (G_AtLibRx.iPhase == ATLIB_RX_PHASE_CID) {
+                /* First byte after <ESC>S is the connection id */
+                G_AtLibRx.iCid = rxData;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_DATA;
+                break;
+            }
+            if (G_AtLibRx.iEscapePending) {
+                G_AtLibRx.iEscapePending = false;
                 if (HOST_APP_DATA_MODE_NORMAL_END_CHAR_E == rxData) {
-                    if (HOST_APP_ESC_CHAR == prevChar) {
-                        /* End of data detected */
-                        /* Reset the RX state machine */
-                        receive_state = HOST_APP_RX_STATE_START;
-                    } else {
-                        AtLib_ProcessIncomingData(rxCurrentCid, rxData);
-                        prevChar = rxData;
-                    }
-                } else {
-                    AtLib_ProcessIncomingData(rxCurrentCid, rxData);
-                    prevChar = rxData;
+                    /* End of data detected */
+                    /* Reset the RX state machine */
+                    G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+                    rxMsgId = HOST_APP_MSG_ID_DATA_RX;
+                    break;
                 }
-            } while (receive_state != HOST_APP_RX_STATE_START);
-            break;
-
-        case HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE:
-            /* HTTP response CID */
-            rxCurrentCid = rxData;
-            do {
-                /* extracting  the rx data length*/
-                /* Read one byte at a time */
-                App_Read(&rxData, 1, 1);
-
-                /* Read one byte at a time - blocking call */
-                specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
-                specialDataLenCharCount++;
-            } while (specialDataLenCharCount
-                    < HOST_APP_HTTP_RESP_DATA_LEN_STRING_SIZE);
-
-            /* Now read actual data */
-            while (specialDataLen) {
-                /* Read one byte at a time */
-                App_Read(&rxData, 1, 1);
-
-                /* Read one byte at a time - blocking call */
-                specialDataLen--;
-                AtLib_ProcessIncomingData(rxCurrentCid, rxData);
+                /* Not <ESC>E, the held back ESC was part of the data */
+                AtLib_ProcessIncomingData(G_AtLibRx.iCid, HOST_APP_ESC_CHAR);
+            }
+            if (HOST_APP_ESC_CHAR == rxData) {
+                /* Hold back the ESC until we know if <ESC>E follows */
+                G_AtLibRx.iEscapePending = true;
+            } else {
+                AtLib_ProcessIncomingData(G_AtLibRx.iCid, rxData);
             }
-            receive_state = HOST_APP_RX_STATE_START;
             break;
 
+        case HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE:
         case HOST_APP_RX_STATE_BULK_DATA_HANDLE:
-            do {
-                /* extracting  the rx data length*/
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
-
-                specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
-                specialDataLenCharCount++;
-            } while (specialDataLenCharCount
-                    < HOST_APP_BULK_DATA_LEN_STRING_SIZE);
-            /* Now read actual data */
-            while (specialDataLen) {
-                /* Read one byte at a time */
-                specialDataLen--;
-                AtLib_ProcessIncomingData(rxCurrentCid, rxData);
-            };
-            receive_state = HOST_APP_RX_STATE_START;
+            /* <Esc>H or <Esc>Z<Cid><Data Length xxxx 4 ascii char><data> */
+            if (G_AtLibRx.iPhase == ATLIB_RX_PHASE_CID) {
+                G_AtLibRx.iCid = rxData;
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_LENGTH;
+                break;
+            }
+            if (G_AtLibRx.iPhase == ATLIB_RX_PHASE_LENGTH) {
+                /* extracting the rx data length */
+                G_AtLibRx.iDataLength = (G_AtLibRx.iDataLength * 10)
+                        + ((rxData) - '0');
+                G_AtLibRx.iLengthCharCount++;
+                if (G_AtLibRx.iLengthCharCount
+                        < HOST_APP_BULK_DATA_LEN_STRING_SIZE)
+                    break;
+                /* Now read actual data */
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_DATA;
+            } else {
+                AtLib_ProcessIncomingData(G_AtLibRx.iCid, rxData);
+                G_AtLibRx.iDataLength--;
+            }
+            if (G_AtLibRx.iDataLength == 0) {
+                /* All the data received */
+                rxMsgId = (G_AtLibRx.iState
+                        == HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE) ?
+                        HOST_APP_MSG_ID_HTTP_RESPONSE_DATA_RX :
+                        HOST_APP_MSG_ID_BULK_DATA_RX;
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+            }
             break;
 
         case HOST_APP_RX_STATE_RAW_DATA_HANDLE:
-            if (HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL == rxData) {
-                specialDataLenCharCount = 0;
-            }
-
-            /* Now reset the buffer and state machine */
-            receive_state = HOST_APP_RX_STATE_START;
-
-            do {
-                /* extracting the rx data length*/
-                /* Read one byte at a time */
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
-
-                if (rxData != HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL) {
-                    specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
-                    specialDataLenCharCount++;
+            /* ESC R : datalen : <----data --- > */
+            if (G_AtLibRx.iPhase == ATLIB_RX_PHASE_LENGTH) {
+                if (HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL != rxData) {
+                    /* extracting the rx data length */
+                    if (G_AtLibRx.iLengthCharCount
+                            >= HOST_APP_RAW_DATA_STRING_SIZE_MAX) {
+                        /* Length too long, parse error. */
+                        G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+                        break;
+                    }
+                    G_AtLibRx.iDataLength = (G_AtLibRx.iDataLength * 10)
+                            + ((rxData) - '0');
+                    G_AtLibRx.iLengthCharCount++;
+                    break;
+                }
+                if (G_AtLibRx.iLengthCharCount == 0) {
+                    /* Colon in front of the length */
+                    break;
                 }
-            } while ((rxData != HOST_APP_DATA_MODE_RAW_INDICATION_CHAR_COL)
-                    && (specialDataLenCharCount
-                            < HOST_APP_BULK_DATA_LEN_STRING_SIZE));
-
-            /* Now read actual data */
-            while (specialDataLen) {
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
-                specialDataLen--;
-                AtLib_ProcessIncomingData(rxCurrentCid, rxData);
+                /* Colon after the length, now read actual data */
+                G_AtLibRx.iPhase = ATLIB_RX_PHASE_DATA;
+            } else {
+                AtLib_ProcessIncomingData(G_AtLibRx.iCid, rxData);
+                G_AtLibRx.iDataLength--;
+            }
+            if (G_AtLibRx.iDataLength == 0) {
+                /* All the data received */
+                G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+                rxMsgId = HOST_APP_MSG_ID_RAW_DATA_RX;
             }
-
-            receive_state = HOST_APP_RX_STATE_START;
             break;
 
         default:
@@ -2734,12 +3263,106 @@ HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
     return rxMsgId;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_ReceiveDataSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Process received characters up to and including the first one that
+ *      completes a message.  Payload runs inside data frames (found with
+ *      memchr() for <ESC>S frames or from the frame length) are handed
+ *      over in one AtLib_ProcessIncomingSpan call and response lines are
+ *      copied up to their LF in one go.  Everything else goes through
+ *      AtLib_ReceiveDataProcess a character at a time.
+ * Inputs:
+ *      const uint8_t *rxBuf -- Pointer to bytes
+ *      uint32_t bufLen -- Number of bytes in receive buffer
+ *      HOST_APP_MSG_ID_E *pMsgId -- Message completed, or
+ *          HOST_APP_MSG_ID_NONE if all bytes were used without one
+ * Outputs:
+ *      uint32_t -- Number of bytes processed
+ *---------------------------------------------------------------------------*/
+static uint32_t AtLib_ReceiveDataSpan(
+        const uint8_t *rxBuf,
+        uint32_t bufLen,
+        HOST_APP_MSG_ID_E *pMsgId)
+{
+    const uint8_t *p = rxBuf;
+    const uint8_t *pEnd = rxBuf + bufLen;
+    const uint8_t *pStop;
+    uint32_t runLen;
+    HOST_APP_MSG_ID_E rxMsgId = HOST_APP_MSG_ID_NONE;
+
+    while ((p < pEnd) && (rxMsgId == HOST_APP_MSG_ID_NONE)) {
+        runLen = 0;
+        switch (G_AtLibRx.iState) {
+            case HOST_APP_RX_STATE_DATA_HANDLE:
+                if ((G_AtLibRx.iPhase == ATLIB_RX_PHASE_DATA)
+                        && (!G_AtLibRx.iEscapePending)) {
+                    /* Everything up to the next ESC is data */
+                    pStop = memchr(p, HOST_APP_ESC_CHAR, pEnd - p);
+                    runLen = ((pStop) ? pStop : pEnd) - p;
+                }
+                break;
+
+            case HOST_APP_RX_STATE_HTTP_RESPONSE_DATA_HANDLE:
+            case HOST_APP_RX_STATE_BULK_DATA_HANDLE:
+            case HOST_APP_RX_STATE_RAW_DATA_HANDLE:
+                if (G_AtLibRx.iPhase == ATLIB_RX_PHASE_DATA) {
+                    /* Leave the last byte to AtLib_ReceiveDataProcess */
+                    /* so it ends the frame */
+                    runLen = pEnd - p;
+                    if (runLen >= G_AtLibRx.iDataLength)
+                        runLen = G_AtLibRx.iDataLength - 1;
+                }
+                break;
+
+            case HOST_APP_RX_STATE_CMD_RESP:
+                /* Copy the line up to its LF (or a stray ESC) and leave */
+                /* room for the overflow check on the next character */
+                pStop = memchr(p, HOST_APP_LF_CHAR, pEnd - p);
+                runLen = ((pStop) ? pStop : pEnd) - p;
+                pStop = memchr(p, HOST_APP_ESC_CHAR, runLen);
+                if (pStop)
+                    runLen = pStop - p;
+                if (MRBufferIndex >= HOST_APP_RX_CMD_MAX_SIZE - 2)
+                    runLen = 0;
+                else if (runLen > (uint32_t)(HOST_APP_RX_CMD_MAX_SIZE - 2
+                        - MRBufferIndex))
+                    runLen = HOST_APP_RX_CMD_MAX_SIZE - 2 - MRBufferIndex;
+                if (runLen) {
+                    memcpy(MRBuffer + MRBufferIndex, p, runLen);
+                    MRBufferIndex += runLen;
+                    p += runLen;
+                    continue;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (runLen) {
+            /* Hand the whole run over at once */
+            AtLib_ProcessIncomingSpan(G_AtLibRx.iCid, p, runLen);
+            if (G_AtLibRx.iState != HOST_APP_RX_STATE_DATA_HANDLE)
+                G_AtLibRx.iDataLength -= runLen;
+            p += runLen;
+        } else {
+            rxMsgId = AtLib_ReceiveDataProcess(*p++);
+        }
+    }
+
+    *pMsgId = rxMsgId;
+    return p - rxBuf;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLib_ResponseHandle
  *---------------------------------------------------------------------------*
  * Description:
  *      Wait for a response after sending a command.  Keep parsing the
- *      data until a response is found.
+ *      data until a response is found or the adaptive timeout of the
+ *      command in G_ATCmdBuf passes without a response line.
  * Inputs:
  *      void
  * Outputs:
@@ -2748,39 +3371,41 @@ HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData)
 HOST_APP_MSG_ID_E AtLib_ResponseHandle(void)
 {
     HOST_APP_MSG_ID_E responseMsgId;
-    uint8_t rxData;
+    HOST_APP_TIMEOUT_CLASS_E timeoutClass =
+            AtLib_GetTimeoutClass(G_ATCmdBuf);
     uint32_t timeout = MSTimerGet();
-    uint8_t gotData = 0;
+    uint16_t lines = G_AtLibRxLines;
 
     /* Reset the receive buffer */
     AtLib_FlushRxBuffer();
 
-    /* Reset the message ID */
-    responseMsgId = HOST_APP_MSG_ID_NONE;
-
     /* Now process the response from S2w App node */
-    while (HOST_APP_MSG_ID_NONE == responseMsgId) {
-        gotData = 1;
-        /* Read one byte at a time - non-blocking call, block here */
-        timeout = MSTimerGet();
-        while (!App_Read(&rxData, 1, 0)) {
-            if (MSTimerDelta(timeout) >= ATLIB_RESPONSE_HANDLE_TIMEOUT) {
-                gotData = 0;
-                responseMsgId = HOST_APP_MSG_ID_RESPONSE_TIMEOUT;
-                break;
+    while (1) {
+        /* Process what has arrived - non-blocking call, block here */
+        if (!AtLib_ReceiveNext(&responseMsgId)) {
+            if (MSTimerDelta(timeout) >= AtLib_GetTimeout(timeoutClass)) {
+                AtLib_TimeoutExpired(timeoutClass);
+
+                /* Keep AtLib_Poll from sending until the late response */
+                /* has gone by */
+                G_AtLibResyncTries = 0;
+                G_AtLibResyncDropped = 0;
+                AtLib_ResyncSend();
+                return HOST_APP_MSG_ID_RESPONSE_TIMEOUT;
             }
+            continue;
         }
-        if (gotData) {
-            /* Process the received data */
-            responseMsgId = AtLib_ReceiveDataProcess(rxData);
-            if (responseMsgId != HOST_APP_MSG_ID_NONE) {
-                /* Message successfully received from S2w App node */
-                break;
-            }
+        if (lines != G_AtLibRxLines) {
+            lines = G_AtLibRxLines;
+            timeout = MSTimerGet();
+        }
+        if ((responseMsgId != HOST_APP_MSG_ID_NONE)
+                && (!AtLib_IsDataMessage(responseMsgId))
+                && (!AtLib_IsEventMessage(responseMsgId))) {
+            /* Message successfully received from S2w App node */
+            return responseMsgId;
         }
     }
-
-    return responseMsgId;
 }
 
 /*---------------------------------------------------------------------------*
@@ -2797,19 +3422,24 @@ HOST_APP_MSG_ID_E AtLib_ResponseHandle(void)
 HOST_APP_MSG_ID_E AtLib_ProcessRxChunk(const uint8_t *rxBuf, uint32_t bufLen)
 {
     HOST_APP_MSG_ID_E rxMsgId;
+    uint32_t done;
 
     rxMsgId = HOST_APP_MSG_ID_NONE;
+    LOG_DATA(LOG_LEVEL_DEBUG, LOG_ID_AT_RECEIVE, rxBuf, bufLen);
 
     /* Parse the received data and check whether any valid message present in the chunk */
     while (bufLen) {
         /* Process the received data */
-        rxMsgId = AtLib_ReceiveDataProcess(*rxBuf);
-        if (rxMsgId != HOST_APP_MSG_ID_NONE) {
+        done = AtLib_ReceiveDataSpan(rxBuf, bufLen, &rxMsgId);
+        if (AtLib_IsDataMessage(rxMsgId)) {
+            /* End of a data frame is not a response message */
+            rxMsgId = HOST_APP_MSG_ID_NONE;
+        } else if (rxMsgId != HOST_APP_MSG_ID_NONE) {
             /* Message received from S2w App node */
             break;
         }
-        rxBuf++;
-        bufLen--;
+        rxBuf += done;
+        bufLen -= done;
     }
 
     return rxMsgId;
@@ -2829,18 +3459,19 @@ void AtLib_FlushIncomingMessage(void)
 {
     /* This function will read all incoming data until nothing happens */
     /* for 100 ms */
-    uint8_t rxData;
     uint32_t start;
+    uint32_t len;
+
+    /* Drop what was read but not processed yet */
+    G_AtLibRxChunkIndex = G_AtLibRxChunkLen = 0;
 
-    /* Read one byte at a time - non-blocking call */
+    /* Read whatever has arrived - non-blocking call */
     start = MSTimerGet();
     while (MSTimerDelta(start) < 100) {
-        if (App_Read(&rxData, 1, 0)) {
+        len = App_ReadAvailable(G_AtLibRxChunk, ATLIB_RX_CHUNK_SIZE);
+        if (len) {
             start = MSTimerGet();
-#ifdef HOST_APP_DEBUG_ENABLE
-            /* If required you can print the received characters on debug UART port. */
-            ConsolePrintf("%c", rxData);
-#endif
+            LOG_DATA(LOG_LEVEL_DEBUG, LOG_ID_AT_RECEIVE, G_AtLibRxChunk, len);
         }
     };
 }
@@ -2864,7 +3495,8 @@ uint8_t AtLib_IsNodeResetDetected(void)
  * Routine:  AtLib_SetNodeResetFlag
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the module reset flag.
+ *      Set the module reset flag.  A module that reset is back out of
+ *      bulk data mode.
  * Inputs:
  *      void
  * Outputs:
@@ -2873,6 +3505,7 @@ uint8_t AtLib_IsNodeResetDetected(void)
 void AtLib_SetNodeResetFlag(void)
 {
     nodeResetFlag = true;
+    G_AtLibBulkEnabled = false;
 }
 
 /*---------------------------------------------------------------------------*
@@ -3040,35 +3673,32 @@ int32_t AtLib_strcasecmp(const char *s1, const char *s2)
  * Routine:  AtLib_ConvertNumberTo4DigitASCII
  *---------------------------------------------------------------------------*
  * Description:
- *      Equivalent of sprintf("%04d"), number to convert a number to
- *      four characters.
+ *      Equivalent of sprintf("%04d") for numbers below 10000: convert a
+ *      number to four digits followed by a terminator.
  * Inputs:
  *      uint32_t myNum -- Number to convert to text
- *      int8_t *pStr -- Place to store characters
+ *      int8_t *pStr -- Place to store characters (at least 5)
  * Outputs:
- *      int32_t -- result of comparison.  0 if matches.  <0 if s1 before s2.
- *          >0 if s1 after s2.
+ *      void
  *---------------------------------------------------------------------------*/
 void AtLib_ConvertNumberTo4DigitASCII(uint32_t myNum, int8_t *pStr)
 {
-    uint8_t digit1;
-    uint8_t digit2;
-    uint8_t digit3;
-    uint8_t digit4;
+    uint8_t i;
 
-    digit1 = myNum / 1000;
-    digit2 = (myNum % 1000) / 100;
-    digit3 = ((myNum % 1000) % 100) / 10;
-    digit4 = ((myNum % 1000) % 100) % 10;
-
-    sprintf((char *)pStr, _F8_ _F8_ _F8_ _F8_, digit1, digit2, digit3, digit4);
+    pStr[4] = '\0';
+    for (i = 4; i; i--) {
+        pStr[i - 1] = (int8_t)('0' + (myNum % 10));
+        myNum /= 10;
+    }
 }
 
 /*---------------------------------------------------------------------------*
  * Routine:  AtLib_ProcessIncomingData
  *---------------------------------------------------------------------------*
  * Description:
- *      Process a bytes coming from the given connection.
+ *      Process a bytes coming from the given connection.  Goes to the
+ *      connection's ring buffer if opened with AtCidRx_Open, else to the
+ *      application.
  * Inputs:
  *      uint8_t cid -- connection id
  *      uint8_t rxData -- Data to process
@@ -3077,7 +3707,31 @@ void AtLib_ConvertNumberTo4DigitASCII(uint32_t myNum, int8_t *pStr)
  *---------------------------------------------------------------------------*/
 void AtLib_ProcessIncomingData(uint8_t cid, uint8_t rxData)
 {
-    App_ProcessIncomingData(cid, rxData);
+    if (!AtCidRx_Write(cid, &rxData, 1))
+        App_ProcessIncomingData(cid, rxData);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_ProcessIncomingSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Process a run of bytes coming from the given connection.  Goes to
+ *      the connection's ring buffer if opened with AtCidRx_Open, else to
+ *      the application.
+ * Inputs:
+ *      uint8_t cid -- connection id
+ *      const uint8_t *rxData -- Data to process
+ *      uint32_t dataLength -- Number of bytes in rxData
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength)
+{
+    if (!AtCidRx_Write(cid, rxData, dataLength))
+        App_ProcessIncomingSpan(cid, rxData, dataLength);
 }
 
 /*---------------------------------------------------------------------------*
@@ -3095,6 +3749,9 @@ void AtLib_FlushRxBuffer(void)
     /* Reset the response receive buffer */
     MRBufferIndex = 0;
     memset(MRBuffer, '\0', HOST_APP_RX_CMD_MAX_SIZE);
+    G_AtLibTokenCount = ATLIB_TOKENS_INVALID;
+    G_AtLibLineCount = 0;
+    G_AtLibLineStart = 0;
 }
 
 /*---------------------------------------------------------------------------*
@@ -3117,6 +3774,20 @@ void AtLib_Init(void)
     nodeResetFlag = false;
     tcpClientCid = HOST_APP_INVALID_CID;
     udpClientCid = HOST_APP_INVALID_CID;
+    G_AtLibBulkEnabled = false;
+
+    /* Reset the receive state machine and the command queue */
+    G_AtLibRx.iState = HOST_APP_RX_STATE_START;
+    G_AtLibRxChunkIndex = G_AtLibRxChunkLen = 0;
+    AtLib_ClearRxStats();
+    AtLib_ClearTimeoutStats();
+    G_AtLibCmdIn = G_AtLibCmdOut = G_AtLibCmdCount = 0;
+    G_AtLibCmdIsActive = false;
+    G_AtLibResync = ATLIB_RESYNC_IDLE;
+
+    /* No connection has its own receive buffer yet */
+    AtCidRx_Init();
+    AtEvent_Init();
 }
 
 /*-------------------------------------------------------------------------*
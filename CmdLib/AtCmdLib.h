@@ -78,6 +78,138 @@ typedef enum {
     HOST_APP_MSG_ID_MAX
 } HOST_APP_MSG_ID_E;
 
+typedef struct {
+    uint32_t iMaxStallMS;       /* Longest time spent in one AtLib_ReceiveDataHandle() call */
+    uint32_t iMaxStallBytes;    /* Most bytes processed in one AtLib_ReceiveDataHandle() call */
+    uint16_t iStaleResponses;   /* Late responses dropped after a timeout */
+} HOST_APP_RX_STATS_T;
+
+/* One piece of the data sent by AtLib_SendTcpDataV */
+typedef struct {
+    const uint8_t *iData;
+    uint32_t iLength;
+} HOST_APP_IOV_T;
+
+/* Classes of commands with their own adaptive response timeout */
+typedef enum {
+    HOST_APP_TIMEOUT_CLASS_FAST = 0,    /* Local commands answered at once */
+    HOST_APP_TIMEOUT_CLASS_FLASH,       /* Flash writes, mode changes, */
+                                        /* closing connections */
+    HOST_APP_TIMEOUT_CLASS_ASSOC,       /* Association, scan, WPS, DHCP */
+    HOST_APP_TIMEOUT_CLASS_PSK,         /* PSK computation (AT+WPAPSK) */
+    HOST_APP_TIMEOUT_CLASS_CONNECT,     /* TCP/UDP connect, DNS lookup */
+    HOST_APP_TIMEOUT_CLASS_SERVER,      /* Reply of a remote server, */
+                                        /* measured by the application */
+    HOST_APP_TIMEOUT_CLASS_MAX
+} HOST_APP_TIMEOUT_CLASS_E;
+
+/* Round trip measurements of a timeout class (as for TCP's RTO) */
+typedef struct {
+    uint32_t iSmoothedMS;       /* Smoothed round trip time (SRTT) */
+    uint32_t iVariationMS;      /* Round trip time variation (RTTVAR) */
+    uint32_t iTimeoutMS;        /* Current timeout (RTO) */
+    uint16_t iSamples;          /* Round trips measured */
+    uint16_t iTimeouts;         /* Responses not received in time */
+} HOST_APP_TIMEOUT_STATS_T;
+
+/* Timeout passed to AtLib_CommandQueue to use the adaptive timeout */
+#define HOST_APP_TIMEOUT_ADAPTIVE   0
+
+/* Commands of the descriptor table sent by AtLib_CommandExecute.  The */
+/* order must match G_AtLibCommands in AtCmdLib.c. */
+typedef enum {
+    HOST_APP_CMD_CHECK = 0,             /* AT */
+    HOST_APP_CMD_SET_ECHO,              /* ATE<mode> */
+    HOST_APP_CMD_MAC_SET,               /* AT+NMAC=<mac> */
+    HOST_APP_CMD_ATA,                   /* ATA */
+    HOST_APP_CMD_GET_MAC,               /* AT+NMAC=? */
+    HOST_APP_CMD_CALC_PSK,              /* AT+WPAPSK=<ssid>,<passphrase> */
+    HOST_APP_CMD_SET_WEP1,              /* AT+WWEP1=<key> */
+    HOST_APP_CMD_WLAN_CONN_STAT,        /* AT+NSTAT=? */
+    HOST_APP_CMD_SET_WAUTH,             /* AT+WAUTH=<mode> */
+    HOST_APP_CMD_SET_SECURITY,          /* AT+WSEC=<type> */
+    HOST_APP_CMD_DHCP_SET,              /* AT+NDHCP=<mode> */
+    HOST_APP_CMD_ASSOC,                 /* AT+WA=<ssid>,<bssid>,<channel> */
+    HOST_APP_CMD_ASSOC_SSID,            /* AT+WA=<ssid> */
+    HOST_APP_CMD_TCP_CLIENT,            /* AT+NCTCP=<ip>,<port> */
+    HOST_APP_CMD_UDP_CLIENT,            /* AT+NCUDP=<ip>,<port>,<local port> */
+    HOST_APP_CMD_CLOSE_ALL,             /* AT+NCLOSEALL */
+    HOST_APP_CMD_BATTERY_CHK_START,     /* AT+BCHKSTRT=<interval> */
+    HOST_APP_CMD_GOTO_STANDBY,          /* AT+PSSTBY=<n>,<delay>,<pol1>,<pol2> */
+    HOST_APP_CMD_SET_PASSPHRASE,        /* AT+WWPA=<passphrase> */
+    HOST_APP_CMD_DEEP_SLEEP,            /* AT+PSDPSLEEP */
+    HOST_APP_CMD_STORE_NW_CONN,         /* AT+STORENWCONN */
+    HOST_APP_CMD_RESTORE_NW_CONN,       /* AT+RESTORENWCONN */
+    HOST_APP_CMD_IP_SET,                /* AT+NSET=<ip>,<subnet>,<gateway> */
+    HOST_APP_CMD_SAVE_PROFILE,          /* AT&W<profile> */
+    HOST_APP_CMD_LOAD_PROFILE,          /* ATZ<profile> */
+    HOST_APP_CMD_FACTORY_DEFAULTS,      /* AT&F */
+    HOST_APP_CMD_GET_RSSI,              /* AT+WRSSI=? */
+    HOST_APP_CMD_DISASSOC,              /* AT+WD */
+    HOST_APP_CMD_FW_UPGRADE,            /* AT+FWUP=<ip>,<port>,<port>,<ip> */
+    HOST_APP_CMD_BATTERY_CHK_STOP,      /* AT+BCHKSTOP */
+    HOST_APP_CMD_MULTICAST,             /* AT+MCSTSET=<mode> */
+    HOST_APP_CMD_VERSION,               /* AT+VER=? */
+    HOST_APP_CMD_MODE,                  /* AT+WM=<mode> */
+    HOST_APP_CMD_UDP_SERVER,            /* AT+NSUDP=<port> */
+    HOST_APP_CMD_TCP_SERVER,            /* AT+NSTCP=<port> */
+    HOST_APP_CMD_DNS_LOOKUP,            /* AT+DNSLOOKUP=<url> */
+    HOST_APP_CMD_CLOSE,                 /* AT+NCLOSE=<cid> */
+    HOST_APP_CMD_SET_WRETRY,            /* AT+WRETRY=<count> */
+    HOST_APP_CMD_GET_ERR_COUNT,         /* AT+ERRCOUNT=? */
+    HOST_APP_CMD_ENABLE_RADIO,          /* AT+WRXACTIVE=<mode> */
+    HOST_APP_CMD_ENABLE_PW_SAVE,        /* AT+WRXPS=<mode> */
+    HOST_APP_CMD_SET_TIME,              /* AT+SETTIME=<date>,<time> */
+    HOST_APP_CMD_EXTERNAL_PA,           /* AT+EXTPA=<mode> */
+    HOST_APP_CMD_SYNC_LOSS_INTERVAL,    /* AT+WSYNCINTRL=<interval> */
+    HOST_APP_CMD_PS_POLL_INTERVAL,      /* AT+PSPOLLINTRL=<interval> */
+    HOST_APP_CMD_SET_TX_POWER,          /* AT+WP=<power> */
+    HOST_APP_CMD_DNS_SET,               /* AT+DNSSET=<dns1> */
+    HOST_APP_CMD_DNS_SET2,              /* AT+DNSSET=<dns1>,<dns2> */
+    HOST_APP_CMD_AUTO_CONNECT,          /* ATC<mode> */
+    HOST_APP_CMD_STORE_WAUTO,           /* AT+WAUTO=0,<ssid>,,<channel> */
+    HOST_APP_CMD_STORE_NAUTO,           /* AT+NAUTO=0,0,<ip>,<port> */
+    HOST_APP_CMD_STORE_ATS,             /* ATS<param>=<value> */
+    HOST_APP_CMD_BDATA,                 /* AT+BDATA=<mode> */
+    HOST_APP_CMD_WPS_PUSH,              /* AT+WWPS=1 */
+    HOST_APP_CMD_WPS_PIN,               /* AT+WWPS=2,<pin> */
+    HOST_APP_CMD_SET_BAUD,              /* ATB=<baud> */
+    HOST_APP_CMD_MAX
+} HOST_APP_CMD_E;
+
+/* Argument of a command sent by AtLib_CommandExecute, one for each % of */
+/* the command's template */
+typedef union {
+    const char *iString;        /* For %s, 0 is sent as an empty string */
+    uint32_t iNumber;           /* For %u, %d (as int32_t) and %c */
+} HOST_APP_CMD_ARG_T;
+
+/* One field of a response, pointing into the response buffer (MRBuffer). */
+/* "IP addr=192.168.1.5" gives key "IP addr" and value "192.168.1.5", */
+/* "IP:10.0.0.1" gives key "IP" and "CONNECT" has no key (iKey is 0). */
+/* The text is not terminated; use the lengths. */
+typedef struct {
+    const char *iKey;           /* Key text, or 0 if the field has no key */
+    const char *iValue;         /* Value text (quotes removed) */
+    uint16_t iKeyLen;
+    uint16_t iValueLen;
+} HOST_APP_TOKEN_T;
+
+/* Completion callback of a command queued with AtLib_CommandQueue */
+typedef void (*AtLib_CommandCallback)(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext);
+
+/* Called with each response line of a streamed command (without CR LF). */
+/* A line too long for MRBuffer comes in pieces with isPartial true for */
+/* all but the last. */
+typedef void (*AtLib_LineCallback)(
+        const char *pLine,
+        uint16_t length,
+        uint8_t isPartial,
+        void *pContext);
+
 #define  HOST_APP_CR_CHAR          0x0D     /* octet value in hex representing Carriage return    */
 #define  HOST_APP_LF_CHAR          0x0A     /* octet value in hex representing Line feed             */
 #define  HOST_APP_ESC_CHAR         0x1B     /* octet value in hex representing application level ESCAPE sequence */
@@ -114,81 +246,573 @@ typedef enum {
 /*************<Function prototye forward delarations >***************/
 
 HOST_APP_MSG_ID_E AtLib_CommandSend(void);
-HOST_APP_MSG_ID_E AtLibGs_Check(void);
-HOST_APP_MSG_ID_E AtLibGs_SetEcho(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_MACSet(int8_t *pAddr);
-HOST_APP_MSG_ID_E AtLibGs_CalcNStorePSK(int8_t *pSsid, int8_t *pPsk);
-HOST_APP_MSG_ID_E AtLibGs_WlanConnStat(void);
-HOST_APP_MSG_ID_E AtLibGs_DHCPSet(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_Assoc(int8_t *pSsid, int8_t *pBssid, int8_t *pChan);
-HOST_APP_MSG_ID_E AtLibGs_TcpClientStart(
+HOST_APP_MSG_ID_E AtLib_CommandSendStream(
+        AtLib_LineCallback lineCallback,
+        void *pContext);
+uint8_t AtLib_CommandQueue(
+        const char *pCommand,
+        uint32_t timeout,
+        AtLib_CommandCallback callback,
+        void *pContext);
+uint8_t AtLib_CommandQueueStream(
+        const char *pCommand,
+        uint32_t timeout,
+        AtLib_LineCallback lineCallback,
+        AtLib_CommandCallback callback,
+        void *pContext);
+uint8_t AtLib_IsCommandBusy(void);
+HOST_APP_TIMEOUT_CLASS_E AtLib_GetTimeoutClass(const char *pCommand);
+uint32_t AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_E timeoutClass);
+void AtLib_TimeoutSample(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        uint32_t roundTripMS);
+void AtLib_TimeoutExpired(HOST_APP_TIMEOUT_CLASS_E timeoutClass);
+void AtLib_GetTimeoutStats(
+        HOST_APP_TIMEOUT_CLASS_E timeoutClass,
+        HOST_APP_TIMEOUT_STATS_T *pStats);
+void AtLib_ClearTimeoutStats(void);
+HOST_APP_MSG_ID_E AtLib_Poll(void);
+HOST_APP_MSG_ID_E AtLib_CommandExecute(
+        HOST_APP_CMD_E cmd,
+        const HOST_APP_CMD_ARG_T *pArgs);
+uint8_t AtLib_CommandExecuteAsync(
+        HOST_APP_CMD_E cmd,
+        const HOST_APP_CMD_ARG_T *pArgs,
+        AtLib_CommandCallback callback,
+        void *pContext);
+void AtLibGs_SwitchFromAutoToCmd(void);
+
+/*************<Command wrappers, see G_AtLibCommands in AtCmdLib.c>********/
+
+/* Check that the module answers */
+static inline HOST_APP_MSG_ID_E AtLibGs_Check(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_CHECK, 0);
+}
+
+/* Turn the character echo on (1) or off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetEcho(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_ECHO, args);
+}
+
+/* Set the MAC address ("xx:xx:xx:xx:xx:xx") */
+static inline HOST_APP_MSG_ID_E AtLibGs_MACSet(int8_t *pAddr)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pAddr;
+    return AtLib_CommandExecute(HOST_APP_CMD_MAC_SET, args);
+}
+
+/* Start auto connection */
+static inline HOST_APP_MSG_ID_E AtLibGs_ATA(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_ATA, 0);
+}
+
+/* Get the MAC address, see AtLib_ParseGetMacResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_GetMAC(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_GET_MAC, 0);
+}
+
+/* Compute and store the WPA2 PSK of an SSID and passphrase */
+static inline HOST_APP_MSG_ID_E AtLibGs_CalcNStorePSK(
+        int8_t *pSsid,
+        int8_t *pPsk)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pSsid;
+    args[1].iString = (const char *)pPsk;
+    return AtLib_CommandExecute(HOST_APP_CMD_CALC_PSK, args);
+}
+
+/* Same as AtLibGs_CalcNStorePSK without waiting, see AtLib_CommandQueue */
+static inline uint8_t AtLibGs_CalcNStorePSKAsync(
+        int8_t *pSsid,
+        int8_t *pPsk,
+        AtLib_CommandCallback callback,
+        void *pContext)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pSsid;
+    args[1].iString = (const char *)pPsk;
+    return AtLib_CommandExecuteAsync(HOST_APP_CMD_CALC_PSK, args,
+            callback, pContext);
+}
+
+/* Set WEP key 1 */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetWEP1(int8_t *pWEP)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pWEP;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_WEP1, args);
+}
+
+/* Get the network status, see AtLib_ParseWlanConnStat */
+static inline HOST_APP_MSG_ID_E AtLibGs_WlanConnStat(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_WLAN_CONN_STAT, 0);
+}
+
+/* Set the authentication mode (0=none, 1=open WEP, 2=shared WEP) */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetWAUTH(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_WAUTH, args);
+}
+
+/* Set the security type (0=auto, 1=open, 2=WEP, 4=WPA-PSK, 8=WPA2-PSK) */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetSecurityType(uint8_t type)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = type;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_SECURITY, args);
+}
+
+/* Turn the DHCP client on (1) or off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_DHCPSet(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_DHCP_SET, args);
+}
+
+/* Associate to a network.  pBssid and pChan can be 0, if pChan is 0 */
+/* only the SSID is sent */
+static inline HOST_APP_MSG_ID_E AtLibGs_Assoc(
+        int8_t *pSsid,
+        int8_t *pBssid,
+        int8_t *pChan)
+{
+    HOST_APP_CMD_ARG_T args[3];
+
+    args[0].iString = (const char *)pSsid;
+    args[1].iString = (const char *)pBssid;
+    args[2].iString = (const char *)pChan;
+    return AtLib_CommandExecute(
+            (pChan) ? HOST_APP_CMD_ASSOC : HOST_APP_CMD_ASSOC_SSID, args);
+}
+
+/* Same as AtLibGs_Assoc without waiting, see AtLib_CommandQueue */
+static inline uint8_t AtLibGs_AssocAsync(
+        int8_t *pSsid,
+        int8_t *pBssid,
+        int8_t *pChan,
+        AtLib_CommandCallback callback,
+        void *pContext)
+{
+    HOST_APP_CMD_ARG_T args[3];
+
+    args[0].iString = (const char *)pSsid;
+    args[1].iString = (const char *)pBssid;
+    args[2].iString = (const char *)pChan;
+    return AtLib_CommandExecuteAsync(
+            (pChan) ? HOST_APP_CMD_ASSOC : HOST_APP_CMD_ASSOC_SSID, args,
+            callback, pContext);
+}
+
+/* Open a TCP client connection.  The CID is saved (AtLib_GetTcpCid) */
+static inline HOST_APP_MSG_ID_E AtLibGs_TcpClientStart(
         int8_t *pRemoteTcpSrvIp,
-        int8_t *pRemoteTcpSrvPort);
-HOST_APP_MSG_ID_E AtLibGs_UdpClientStart(
+        int8_t *pRemoteTcpSrvPort)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pRemoteTcpSrvIp;
+    args[1].iString = (const char *)pRemoteTcpSrvPort;
+    return AtLib_CommandExecute(HOST_APP_CMD_TCP_CLIENT, args);
+}
+
+/* Open a UDP client connection.  The CID is saved (AtLib_GetUdpCid) */
+static inline HOST_APP_MSG_ID_E AtLibGs_UdpClientStart(
         int8_t *pRemoteUdpSrvIp,
         int8_t *pRemoteUdpSrvPort,
-        int8_t *pUdpLocalPort);
+        int8_t *pUdpLocalPort)
+{
+    HOST_APP_CMD_ARG_T args[3];
+
+    args[0].iString = (const char *)pRemoteUdpSrvIp;
+    args[1].iString = (const char *)pRemoteUdpSrvPort;
+    args[2].iString = (const char *)pUdpLocalPort;
+    return AtLib_CommandExecute(HOST_APP_CMD_UDP_CLIENT, args);
+}
 
-HOST_APP_MSG_ID_E AtLibGs_CloseAll(void);
-HOST_APP_MSG_ID_E AtLibGs_ATA(void);
-HOST_APP_MSG_ID_E AtLibGs_ATZ1(void);
+/* Close all connections */
+static inline HOST_APP_MSG_ID_E AtLibGs_CloseAll(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_CLOSE_ALL, 0);
+}
 
+/* Start checking the battery every interval packets */
+static inline HOST_APP_MSG_ID_E AtLibGs_BatteryChkStart(uint32_t interval)
+{
+    HOST_APP_CMD_ARG_T args[1];
 
-HOST_APP_MSG_ID_E AtLibGs_BatteryChkStart(uint32_t interval);
-HOST_APP_MSG_ID_E AtLibGs_GotoSTNDBy(
+    args[0].iNumber = interval;
+    return AtLib_CommandExecute(HOST_APP_CMD_BATTERY_CHK_START, args);
+}
+
+/* Go to standby for nsec ms after a delay, with the alarm polarities */
+static inline HOST_APP_MSG_ID_E AtLibGs_GotoSTNDBy(
         int8_t *nsec,
         uint32_t dealy,
         uint32_t alarm1_Pol,
-        uint32_t alarm2_Pol);
-HOST_APP_MSG_ID_E AtLibGs_PSK(int8_t *pPsk);
-HOST_APP_MSG_ID_E AtLibGs_SetWEP1(int8_t *pPsk);
-HOST_APP_MSG_ID_E AtLibGs_EnableDeepSleep(void);
-HOST_APP_MSG_ID_E AtLibGs_StoreNwConn(void);
-HOST_APP_MSG_ID_E AtLibGs_ReStoreNwConn(void);
-HOST_APP_MSG_ID_E AtLibGs_IPSet(
-        int8_t* pIpAddr,
-        int8_t* pSubnet,
-        int8_t *pGateway);
-
-HOST_APP_MSG_ID_E AtLibGs_SaveProfile(uint8_t profile);
-HOST_APP_MSG_ID_E AtLibGs_LoadProfile(uint8_t profile);
-HOST_APP_MSG_ID_E AtLibGs_ResetFactoryDefaults(void);
-HOST_APP_MSG_ID_E AtLibGs_GetRssi(void);
-HOST_APP_MSG_ID_E AtLibGs_DisAssoc(void);
-HOST_APP_MSG_ID_E AtLibGs_FWUpgrade(
+        uint32_t alarm2_Pol)
+{
+    HOST_APP_CMD_ARG_T args[4];
+
+    args[0].iString = (const char *)nsec;
+    args[1].iNumber = dealy;
+    args[2].iNumber = alarm1_Pol;
+    args[3].iNumber = alarm2_Pol;
+    return AtLib_CommandExecute(HOST_APP_CMD_GOTO_STANDBY, args);
+}
+
+/* Set the WPA passphrase */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetPassPhrase(int8_t *pPhrase)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pPhrase;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_PASSPHRASE, args);
+}
+
+/* Go to deep sleep */
+static inline HOST_APP_MSG_ID_E AtLibGs_EnableDeepSleep(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_DEEP_SLEEP, 0);
+}
+
+/* Store the network context before standby */
+static inline HOST_APP_MSG_ID_E AtLibGs_StoreNwConn(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_STORE_NW_CONN, 0);
+}
+
+/* Restore the network context after standby */
+static inline HOST_APP_MSG_ID_E AtLibGs_ReStoreNwConn(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_RESTORE_NW_CONN, 0);
+}
+
+/* Set a static IP address, subnet mask and gateway */
+static inline HOST_APP_MSG_ID_E AtLibGs_IPSet(
+        int8_t *pIpAddr,
+        int8_t *pSubnet,
+        int8_t *pGateway)
+{
+    HOST_APP_CMD_ARG_T args[3];
+
+    args[0].iString = (const char *)pIpAddr;
+    args[1].iString = (const char *)pSubnet;
+    args[2].iString = (const char *)pGateway;
+    return AtLib_CommandExecute(HOST_APP_CMD_IP_SET, args);
+}
+
+/* Save the settings to profile 0 or 1 */
+static inline HOST_APP_MSG_ID_E AtLibGs_SaveProfile(uint8_t profile)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = profile;
+    return AtLib_CommandExecute(HOST_APP_CMD_SAVE_PROFILE, args);
+}
+
+/* Load the settings from profile 0 or 1 */
+static inline HOST_APP_MSG_ID_E AtLibGs_LoadProfile(uint8_t profile)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = profile;
+    return AtLib_CommandExecute(HOST_APP_CMD_LOAD_PROFILE, args);
+}
+
+/* Load the settings from profile 1 */
+static inline HOST_APP_MSG_ID_E AtLibGs_ATZ1(void)
+{
+    return AtLibGs_LoadProfile(1);
+}
+
+/* Restore the factory default settings */
+static inline HOST_APP_MSG_ID_E AtLibGs_ResetFactoryDefaults(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_FACTORY_DEFAULTS, 0);
+}
+
+/* Get the signal strength, see AtLib_ParseRssiResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_GetRssi(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_GET_RSSI, 0);
+}
+
+/* Leave the current network */
+static inline HOST_APP_MSG_ID_E AtLibGs_DisAssoc(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_DISASSOC, 0);
+}
+
+/* Upgrade the firmware from a server */
+static inline HOST_APP_MSG_ID_E AtLibGs_FWUpgrade(
         int8_t *pSrvip,
         uint32_t srvport,
         uint32_t srcPort,
-        int8_t *pSrcIP);
-HOST_APP_MSG_ID_E AtLibGs_BatteryChkStop(void);
-HOST_APP_MSG_ID_E AtLibGs_MultiCast(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_Version(void);
-HOST_APP_MSG_ID_E AtLibGs_Mode(uint32_t mode);
-HOST_APP_MSG_ID_E AtLibGs_UdpServer_Start(int8_t *pUdpSrvPort);
-HOST_APP_MSG_ID_E AtLibGs_TcpServer_Start(int8_t* pTcpSrvPort);
-HOST_APP_MSG_ID_E AtLibGs_DNSLookup(int8_t* pUrl);
-HOST_APP_MSG_ID_E AtLibGs_Close(uint8_t cid);
-HOST_APP_MSG_ID_E AtLibGs_SetWRetryCount(uint32_t count);
-HOST_APP_MSG_ID_E AtLibGs_GetErrCount(void);
-HOST_APP_MSG_ID_E AtLibGs_EnableRadio(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_EnablePwSave(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_SetTime(int8_t* pDate, int8_t *pTime);
-HOST_APP_MSG_ID_E AtLibGs_EnableExternalPA(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_SyncLossInterval(uint16_t interval);
-HOST_APP_MSG_ID_E AtLibGs_PSPollInterval(uint16_t interval);
-HOST_APP_MSG_ID_E AtLibGs_SetTxPower(uint32_t power);
-HOST_APP_MSG_ID_E AtLibGs_SetDNSServerIP(int8_t *pDNS1, int8_t *pDNS2);
-HOST_APP_MSG_ID_E AtLibGs_EnableAutoConnect(uint8_t mode);
-void AtLibGs_SwitchFromAutoToCmd(void);
-HOST_APP_MSG_ID_E AtLibGs_StoreWAutoConn(int8_t * pSsid, uint8_t channel);
-HOST_APP_MSG_ID_E AtLibGs_StoreNAutoConn(int8_t* pIpAddr, int16_t pRmtPort);
-HOST_APP_MSG_ID_E AtLibGs_StoreATS(uint8_t param, uint8_t value);
-HOST_APP_MSG_ID_E AtLibGs_BData(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_StartWPSPUSH(void);
-HOST_APP_MSG_ID_E AtLibGs_StartWPSPIN(int8_t* pin);
-HOST_APP_MSG_ID_E AtLibGs_SetWAUTH(uint8_t mode);
-HOST_APP_MSG_ID_E AtLibGs_SetSecurityType(uint8_t type);
-HOST_APP_MSG_ID_E AtLibGs_GetMAC(void);
+        int8_t *pSrcIP)
+{
+    HOST_APP_CMD_ARG_T args[4];
+
+    args[0].iString = (const char *)pSrvip;
+    args[1].iNumber = srvport;
+    args[2].iNumber = srcPort;
+    args[3].iString = (const char *)pSrcIP;
+    return AtLib_CommandExecute(HOST_APP_CMD_FW_UPGRADE, args);
+}
+
+/* Stop checking the battery */
+static inline HOST_APP_MSG_ID_E AtLibGs_BatteryChkStop(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_BATTERY_CHK_STOP, 0);
+}
+
+/* Turn multicast reception on (1) or off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_MultiCast(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_MULTICAST, args);
+}
+
+/* Get the firmware versions */
+static inline HOST_APP_MSG_ID_E AtLibGs_Version(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_VERSION, 0);
+}
+
+/* Set the wireless mode (0=infrastructure, 1=ad hoc) */
+static inline HOST_APP_MSG_ID_E AtLibGs_Mode(uint32_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_MODE, args);
+}
+
+/* Start a UDP server, see AtLib_ParseUdpServerStartResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_UdpServer_Start(int8_t *pUdpSrvPort)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pUdpSrvPort;
+    return AtLib_CommandExecute(HOST_APP_CMD_UDP_SERVER, args);
+}
+
+/* Start a TCP server, see AtLib_ParseTcpServerStartResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_TcpServer_Start(int8_t *pTcpSrvPort)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pTcpSrvPort;
+    return AtLib_CommandExecute(HOST_APP_CMD_TCP_SERVER, args);
+}
+
+/* Look up a host name, see AtLib_ParseDNSLookupResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_DNSLookup(int8_t *pUrl)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pUrl;
+    return AtLib_CommandExecute(HOST_APP_CMD_DNS_LOOKUP, args);
+}
+
+/* Close one connection */
+static inline HOST_APP_MSG_ID_E AtLibGs_Close(uint8_t cid)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = cid;
+    return AtLib_CommandExecute(HOST_APP_CMD_CLOSE, args);
+}
+
+/* Set the wireless retry count */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetWRetryCount(uint32_t count)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = count;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_WRETRY, args);
+}
+
+/* Get the error counts */
+static inline HOST_APP_MSG_ID_E AtLibGs_GetErrCount(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_GET_ERR_COUNT, 0);
+}
+
+/* Keep the radio on (1) or let it turn off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_EnableRadio(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_ENABLE_RADIO, args);
+}
+
+/* Turn the 802.11 power save mode on (1) or off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_EnablePwSave(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_ENABLE_PW_SAVE, args);
+}
+
+/* Set the clock ("dd/mm/yyyy", "HH:MM:SS") */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetTime(int8_t *pDate, int8_t *pTime)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pDate;
+    args[1].iString = (const char *)pTime;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_TIME, args);
+}
+
+/* Use the external power amplifier (1) or not (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_EnableExternalPA(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_EXTERNAL_PA, args);
+}
+
+/* Set the sync loss interval (TU) */
+static inline HOST_APP_MSG_ID_E AtLibGs_SyncLossInterval(uint16_t interval)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = interval;
+    return AtLib_CommandExecute(HOST_APP_CMD_SYNC_LOSS_INTERVAL, args);
+}
+
+/* Set the power save poll interval (beacons) */
+static inline HOST_APP_MSG_ID_E AtLibGs_PSPollInterval(uint16_t interval)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = interval;
+    return AtLib_CommandExecute(HOST_APP_CMD_PS_POLL_INTERVAL, args);
+}
+
+/* Set the transmit power level */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetTxPower(uint32_t power)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = power;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_TX_POWER, args);
+}
+
+/* Set the DNS servers, pDNS2 can be 0 */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetDNSServerIP(
+        int8_t *pDNS1,
+        int8_t *pDNS2)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pDNS1;
+    args[1].iString = (const char *)pDNS2;
+    return AtLib_CommandExecute(
+            (pDNS2) ? HOST_APP_CMD_DNS_SET2 : HOST_APP_CMD_DNS_SET, args);
+}
+
+/* Turn auto connection on (1) or off (0) */
+static inline HOST_APP_MSG_ID_E AtLibGs_EnableAutoConnect(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_AUTO_CONNECT, args);
+}
+
+/* Store the network used by auto connection */
+static inline HOST_APP_MSG_ID_E AtLibGs_StoreWAutoConn(
+        int8_t *pSsid,
+        uint8_t channel)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pSsid;
+    args[1].iNumber = channel;
+    return AtLib_CommandExecute(HOST_APP_CMD_STORE_WAUTO, args);
+}
+
+/* Store the TCP client used by auto connection */
+static inline HOST_APP_MSG_ID_E AtLibGs_StoreNAutoConn(
+        int8_t *pIpAddr,
+        int16_t pRmtPort)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iString = (const char *)pIpAddr;
+    args[1].iNumber = (uint32_t)(int32_t)pRmtPort;
+    return AtLib_CommandExecute(HOST_APP_CMD_STORE_NAUTO, args);
+}
+
+/* Set an S register (timeout) of the module */
+static inline HOST_APP_MSG_ID_E AtLibGs_StoreATS(uint8_t param, uint8_t value)
+{
+    HOST_APP_CMD_ARG_T args[2];
+
+    args[0].iNumber = param;
+    args[1].iNumber = value;
+    return AtLib_CommandExecute(HOST_APP_CMD_STORE_ATS, args);
+}
+
+/* Turn bulk data mode on (1) or off (0), see AtLib_IsBulkEnabled */
+static inline HOST_APP_MSG_ID_E AtLibGs_BData(uint8_t mode)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = mode;
+    return AtLib_CommandExecute(HOST_APP_CMD_BDATA, args);
+}
+
+/* Associate with WPS push button, see AtLib_ParseWPSPUSHResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_StartWPSPUSH(void)
+{
+    return AtLib_CommandExecute(HOST_APP_CMD_WPS_PUSH, 0);
+}
+
+/* Associate with WPS PIN, see AtLib_ParseWPSPINResponse */
+static inline HOST_APP_MSG_ID_E AtLibGs_StartWPSPIN(int8_t *pin)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iString = (const char *)pin;
+    return AtLib_CommandExecute(HOST_APP_CMD_WPS_PIN, args);
+}
+
+/* Change the module's UART rate.  The module answers at the old rate */
+/* and then switches, see App_UARTSpeedUp */
+static inline HOST_APP_MSG_ID_E AtLibGs_SetBaudRate(uint32_t baud)
+{
+    HOST_APP_CMD_ARG_T args[1];
+
+    args[0].iNumber = baud;
+    return AtLib_CommandExecute(HOST_APP_CMD_SET_BAUD, args);
+}
 
 uint8_t AtLib_ParseTcpClientCid(void);
 uint8_t AtLib_ParseUdpClientCid(void);
@@ -202,9 +826,26 @@ uint8_t AtLib_ParseDNSLookupResponse(char *ipAddr);
 uint8_t AtLib_ParseWPSPUSHResponse(void);
 uint8_t AtLib_ParseWPSPINResponse(uint32_t pin);
 
+uint8_t AtLib_ResponseNumLines(void);
+const char *AtLib_ResponseLine(uint8_t index, uint16_t *pLength);
+uint8_t AtLib_ResponseNumTokens(void);
+const HOST_APP_TOKEN_T *AtLib_ResponseToken(uint8_t index);
+const HOST_APP_TOKEN_T *AtLib_ResponseFind(const char *pKey);
+uint8_t AtLib_ResponseGetInt(const char *pKey, int32_t *pValue);
+uint8_t AtLib_ResponseGetIP(const char *pKey, uint8_t *pIp);
+uint8_t AtLib_ResponseGetMAC(const char *pKey, uint8_t *pMac);
+uint16_t AtLib_ResponseGetString(
+        const char *pKey,
+        char *pString,
+        uint16_t maxLen);
+
 HOST_APP_MSG_ID_E AtLib_CommandSend(void);
 void AtLib_DataSend(const uint8_t *pTxData, uint32_t dataLen);
 void AtLib_SendTcpData(uint8_t cid, const uint8_t *txBuf, uint32_t dataLen);
+void AtLib_SendTcpDataV(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts);
 void AtLib_SendUdpData(
         uint8_t cid,
         const uint8_t *txBuf,
@@ -213,13 +854,32 @@ void AtLib_SendUdpData(
         const uint8_t *pUdpClientIP,
         uint16_t udpClientPort);
 
-void AtLib_BulkDataTransfer(uint8_t cid, const uint8_t *pData, uint32_t dataLen);
+uint8_t AtLib_BulkDataTransfer(
+        uint8_t cid,
+        const uint8_t *pData,
+        uint32_t dataLen);
+uint8_t AtLib_BulkDataTransferV(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts);
+uint8_t AtLib_SendTcpDataAuto(
+        uint8_t cid,
+        const HOST_APP_IOV_T *pParts,
+        uint8_t numParts);
+uint8_t AtLib_IsBulkEnabled(void);
 HOST_APP_MSG_ID_E AtLib_checkEOFMessage(const uint8_t * pBuffer);
-void AtLib_ReceiveDataHandle(void);
+HOST_APP_MSG_ID_E AtLib_ReceiveDataHandle(void);
 HOST_APP_MSG_ID_E AtLib_ReceiveDataProcess(uint8_t rxData);
+uint8_t AtLib_IsDataMessage(HOST_APP_MSG_ID_E msgId);
+void AtLib_GetRxStats(HOST_APP_RX_STATS_T *pStats);
+void AtLib_ClearRxStats(void);
 HOST_APP_MSG_ID_E AtLib_ResponseHandle(void);
 HOST_APP_MSG_ID_E AtLib_ProcessRxChunk(const uint8_t *rxBuf, uint32_t bufLen);
 void AtLib_ProcessIncomingData(uint8_t cid, uint8_t rxData);
+void AtLib_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength);
 void AtLib_LinkCheck(void);
 void AtLib_FlushIncomingMessage(void);
 uint8_t AtLib_IsNodeResetDetected(void);
@@ -245,9 +905,15 @@ extern void AtLib_Init(void);
 
 // User supplied routines
 extern void App_ProcessIncomingData(uint8_t cid, uint8_t rxData);
+extern void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength);
 void App_DelayMS(uint32_t cnt);
 void App_Write(const uint8_t *txData, uint32_t dataLength);
+bool App_IsWriteReady(void);
 bool App_Read(uint8_t *rxData, uint32_t dataLength, uint8_t blockFlag);
+uint32_t App_ReadAvailable(uint8_t *rxData, uint32_t maxLength);
 
 #endif /* _GS_ATCMDLIB_H_ */
 
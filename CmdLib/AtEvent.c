@@ -0,0 +1,218 @@
+/*-------------------------------------------------------------------------*
+ * File:  AtEvent.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Queue of unsolicited notifications from the GainSpan node.
+ *      Events are posted by the AT command library (or an interrupt
+ *      routine) into a fixed size FIFO and handed to the subscribed
+ *      callbacks by AtEvent_Dispatch.  Posting and getting are done with
+ *      interrupts disabled so either side can run at interrupt level.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <system/platform.h>
+#include <system/mstimer.h>
+#include "AtEvent.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef ATEVENT_QUEUE_SIZE
+#define ATEVENT_QUEUE_SIZE          8
+#endif
+
+#ifndef ATEVENT_MAX_SUBSCRIBERS
+#define ATEVENT_MAX_SUBSCRIBERS     2
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static ATEVENT_T G_AtEvent_Queue[ATEVENT_QUEUE_SIZE];
+static volatile uint8_t G_AtEvent_In = 0;
+static volatile uint8_t G_AtEvent_Out = 0;
+static volatile uint8_t G_AtEvent_Count = 0;
+static volatile uint16_t G_AtEvent_Dropped = 0;
+
+static AtEvent_Callback G_AtEvent_Subscribers[ATEVENT_MAX_SUBSCRIBERS];
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Init
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Empty the event queue and reset the drop counter.  Subscribers
+ *      are kept.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtEvent_Init(void)
+{
+    __istate_t state = __get_interrupt_state();
+
+    DI();
+    G_AtEvent_In = G_AtEvent_Out = G_AtEvent_Count = 0;
+    G_AtEvent_Dropped = 0;
+    __set_interrupt_state(state);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Post
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put an event at the end of the queue, stamped with the current
+ *      millisecond timer.  If the queue is full the event is dropped and
+ *      counted.  Can be called from an interrupt routine.
+ * Inputs:
+ *      HOST_APP_MSG_ID_E msgId -- Notification received
+ *      uint8_t cid -- Connection concerned, or HOST_APP_INVALID_CID
+ * Outputs:
+ *      bool -- true if queued, false if dropped
+ *---------------------------------------------------------------------------*/
+bool AtEvent_Post(HOST_APP_MSG_ID_E msgId, uint8_t cid)
+{
+    __istate_t state = __get_interrupt_state();
+    ATEVENT_T *p;
+    bool queued = false;
+
+    DI();
+    if (G_AtEvent_Count < ATEVENT_QUEUE_SIZE) {
+        p = &G_AtEvent_Queue[G_AtEvent_In];
+        p->iTime = MSTimerGet();
+        p->iMsgId = msgId;
+        p->iCid = cid;
+        if (++G_AtEvent_In == ATEVENT_QUEUE_SIZE)
+            G_AtEvent_In = 0;
+        G_AtEvent_Count++;
+        queued = true;
+    } else if (G_AtEvent_Dropped != 0xFFFF) {
+        G_AtEvent_Dropped++;
+    }
+    __set_interrupt_state(state);
+
+    return queued;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Get
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take the oldest event out of the queue.
+ * Inputs:
+ *      ATEVENT_T *pEvent -- Place to store the event
+ * Outputs:
+ *      bool -- true if an event was stored, false if the queue is empty
+ *---------------------------------------------------------------------------*/
+bool AtEvent_Get(ATEVENT_T *pEvent)
+{
+    __istate_t state = __get_interrupt_state();
+    bool got = false;
+
+    DI();
+    if (G_AtEvent_Count) {
+        *pEvent = G_AtEvent_Queue[G_AtEvent_Out];
+        if (++G_AtEvent_Out == ATEVENT_QUEUE_SIZE)
+            G_AtEvent_Out = 0;
+        G_AtEvent_Count--;
+        got = true;
+    }
+    __set_interrupt_state(state);
+
+    return got;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Subscribe
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Add a callback to be called by AtEvent_Dispatch for every event.
+ * Inputs:
+ *      AtEvent_Callback callback -- Routine to call
+ * Outputs:
+ *      bool -- true if added (or already there), false if no room
+ *---------------------------------------------------------------------------*/
+bool AtEvent_Subscribe(AtEvent_Callback callback)
+{
+    uint8_t i;
+
+    for (i = 0; i < ATEVENT_MAX_SUBSCRIBERS; i++) {
+        if (G_AtEvent_Subscribers[i] == callback)
+            return true;
+    }
+    for (i = 0; i < ATEVENT_MAX_SUBSCRIBERS; i++) {
+        if (!G_AtEvent_Subscribers[i]) {
+            G_AtEvent_Subscribers[i] = callback;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Unsubscribe
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Remove a callback added with AtEvent_Subscribe.
+ * Inputs:
+ *      AtEvent_Callback callback -- Routine to remove
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtEvent_Unsubscribe(AtEvent_Callback callback)
+{
+    uint8_t i;
+
+    for (i = 0; i < ATEVENT_MAX_SUBSCRIBERS; i++) {
+        if (G_AtEvent_Subscribers[i] == callback)
+            G_AtEvent_Subscribers[i] = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_Dispatch
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Hand all queued events, oldest first, to every subscriber.  Call
+ *      from the main loop (not from an interrupt routine).
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtEvent_Dispatch(void)
+{
+    ATEVENT_T event;
+    uint8_t i;
+
+    while (AtEvent_Get(&event)) {
+        for (i = 0; i < ATEVENT_MAX_SUBSCRIBERS; i++) {
+            if (G_AtEvent_Subscribers[i])
+                G_AtEvent_Subscribers[i](&event);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtEvent_GetDropCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of events lost because the queue was full.  Stops
+ *      counting at 0xFFFF.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint16_t -- Events dropped since AtEvent_Init
+ *---------------------------------------------------------------------------*/
+uint16_t AtEvent_GetDropCount(void)
+{
+    return G_AtEvent_Dropped;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  AtEvent.c
+ *-------------------------------------------------------------------------*/
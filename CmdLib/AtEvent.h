@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------*
+ * File:  AtEvent.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Queue of unsolicited notifications from the GainSpan node
+ *      (disconnects, disassociation, resets, wake ups).  Each event is
+ *      stamped with the millisecond timer and the CID it concerns.
+ *      The application subscribes a callback and calls AtEvent_Dispatch
+ *      from its main loop.
+ *-------------------------------------------------------------------------*/
+#ifndef _GS_ATEVENT_H_
+#define _GS_ATEVENT_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include "AtCmdLib.h"
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t iTime;             /* MSTimerGet() when the event was posted */
+    HOST_APP_MSG_ID_E iMsgId;   /* Notification received */
+    uint8_t iCid;               /* Connection, or HOST_APP_INVALID_CID */
+} ATEVENT_T;
+
+typedef void (*AtEvent_Callback)(const ATEVENT_T *pEvent);
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+void AtEvent_Init(void);
+bool AtEvent_Post(HOST_APP_MSG_ID_E msgId, uint8_t cid);
+bool AtEvent_Get(ATEVENT_T *pEvent);
+bool AtEvent_Subscribe(AtEvent_Callback callback);
+void AtEvent_Unsubscribe(AtEvent_Callback callback);
+void AtEvent_Dispatch(void);
+uint16_t AtEvent_GetDropCount(void);
+
+#endif /* _GS_ATEVENT_H_ */
+/*-------------------------------------------------------------------------*
+ * End of File:  AtEvent.h
+ *-------------------------------------------------------------------------*/
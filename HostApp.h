@@ -1,16 +1,18 @@
 #ifndef HOST_APP_H_
 #define HOST_APP_H_
 
-#include <drv\SPI_CSI10.h>
+#include <drv/SPI_CSI10.h>
 
 #define VERSION_MAJOR       1
 #define VERSION_MINOR       0
 #define VERSION_TEXT        "1.01"
 
 //#define HOST_APP_DEBUG_ENABLE  // output information on the serial port to PC
+//#define LOG_LEVEL   LOG_LEVEL_ERROR  // log level (see system/log.h), DEBUG if HOST_APP_DEBUG_ENABLE
 //#define HOST_APP_TCP_DEBUG   // Post TCP Connection error to Exosite
 
 // Choose one of the following:  SPI or UART communications
+// (the transport used at start up, see Transport_Select to change it)
 // NOTE that the GainSpan module requires the correct firmware to be loaded.
 #define  HOST_APP_INTERFACE_SPI      /* SPI interface is used for GS1011 S2w App communication */
 //#define  HOST_APP_INTERFACE_UART   /* UART interface is used for GS1011 S2w App communication */
@@ -18,9 +20,10 @@
 #define SPI_WIFI_CHANNEL    SPI_CSI10_WIFI_CHANNEL  /* Use this line if you connect to Application Header (J6) */
 //#define SPI_WIFI_CHANNEL    SPI_CSI10_PMOD1_CHANNEL   /* Use this line if you connect to PMOD1 (J11) */
 
-#define SPI_BITS_PER_SECOND         312500   // Max 857142
+#define SPI_BITS_PER_SECOND         312500   // Max 857142, raised by App_SPICalibrate
 #define UART0_BAUD_RATE             115200   // COM Port - 115200 max
-#define UART2_BAUD_RATE             9600     // WIFI Application Header UART
+#define UART2_BAUD_RATE             9600     // WIFI Application Header UART, the module's rate at reset
+#define UART2_FAST_BAUD_RATE        460800   // Max 460800, switched to by App_UARTSpeedUp
 
 // Demo configuration
 
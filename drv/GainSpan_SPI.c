@@ -4,9 +4,12 @@
  * Description:
  *     GainSpan SPI Serial Driver.  Emulates the same API as a UART
  *     driver.  It has a FIFO buffer for sending and receiving.
- *     By making multiple calls to GainSpan_SPI_Update, the receive
- *     FIFO buffer will automatically be filled as data is available as
- *     well as data waiting to be sent can be sent.
+ *     Transfers are interrupt driven: the rising edge of the module's
+ *     data ready line starts one, and the end of each transfer starts
+ *     the next from the FIFOs, so data moves in the background.
+ *     GainSpan_SPI_Update starts sending what was written and retries
+ *     whatever could not go from the interrupts (bus in use by another
+ *     device, flow control).
  *-------------------------------------------------------------------------*/
 
 /*-------------------------------------------------------------------------*
@@ -15,6 +18,7 @@
 #include <string.h>
 #include <system/platform.h>
 #include <HostApp.h>
+#include <system/mstimer.h>
 #include "SPI_CSI10.h"
 #include "GainSpan_SPI.h"
 
@@ -29,24 +33,93 @@
 #define GAINSPAN_SPI_TX_BUFFER_SIZE     256
 #endif
 
+/* FIFO positions wrap with a mask, so the sizes must be powers of two */
+#if (GAINSPAN_SPI_RX_BUFFER_SIZE & (GAINSPAN_SPI_RX_BUFFER_SIZE - 1))
+#error "GAINSPAN_SPI_RX_BUFFER_SIZE must be a power of two"
+#endif
+#if (GAINSPAN_SPI_TX_BUFFER_SIZE & (GAINSPAN_SPI_TX_BUFFER_SIZE - 1))
+#error "GAINSPAN_SPI_TX_BUFFER_SIZE must be a power of two"
+#endif
+#define GAINSPAN_SPI_RX_MASK            (GAINSPAN_SPI_RX_BUFFER_SIZE - 1)
+#define GAINSPAN_SPI_TX_MASK            (GAINSPAN_SPI_TX_BUFFER_SIZE - 1)
+
+/* Most IDLE characters clocked out at once to pull in the module's data */
+#ifndef GAINSPAN_SPI_IDLE_BURST_MAX
+#define GAINSPAN_SPI_IDLE_BURST_MAX     64
+#endif
+
+/* Longest time (ms) data to send is held back by an XOFF or by a full */
+/* receive FIFO before it is sent anyway */
+#ifndef GAINSPAN_SPI_STALL_TIMEOUT
+#define GAINSPAN_SPI_STALL_TIMEOUT      500
+#endif
+
+/* Priority of the data ready interrupt, kept the same as the SPI */
+/* interrupt so the two never nest */
+#ifndef GAINSPAN_SPI_DATA_READY_INT_PRIORITY
+#define GAINSPAN_SPI_DATA_READY_INT_PRIORITY    1U
+#endif
+
+/* Classes of the bytes returned by the module (see G_GainSpan_SPI_CharClass) */
+#define GAINSPAN_SPI_CLASS_DATA         0   /* Stored as is */
+#define GAINSPAN_SPI_CLASS_IDLE         1   /* Fill, dropped */
+#define GAINSPAN_SPI_CLASS_ESC          2   /* Next byte is xor 0x20 */
+#define GAINSPAN_SPI_CLASS_XON          3   /* Module can take data again */
+#define GAINSPAN_SPI_CLASS_XOFF         4   /* Module cannot take data */
+
 /*-------------------------------------------------------------------------*
  * Globals:
  *-------------------------------------------------------------------------*/
 /* Transmit FIFO buffer */
 static uint8_t G_GainSpan_SPI_RXBuffer[GAINSPAN_SPI_RX_BUFFER_SIZE];
-static uint16_t G_GainSpan_SPI_RXIn = 0;
-static uint16_t G_GainSpan_SPI_RXOut = 0;
+static volatile uint16_t G_GainSpan_SPI_RXIn = 0;
+static volatile uint16_t G_GainSpan_SPI_RXOut = 0;
 
 /* Transmit FIFO buffer */
 static uint8_t G_GainSpan_SPI_TXBuffer[GAINSPAN_SPI_TX_BUFFER_SIZE];
-static uint16_t G_GainSpan_SPI_TXIn = 0;
-static uint16_t G_GainSpan_SPI_TXOut = 0;
+static volatile uint16_t G_GainSpan_SPI_TXIn = 0;
+static volatile uint16_t G_GainSpan_SPI_TXOut = 0;
 static volatile bool G_GainSpan_SPI_TX_Empty;
 
-static bool G_GainSpan_SPI_IsTransferComplete;
-static bool G_GainSpan_SPI_IsTransferActive;
+static volatile bool G_GainSpan_SPI_IsTransferActive;
 static uint16_t G_GainSpan_SPI_NumSent;
 static bool G_GainSpan_SPI_EscapeCode;
+static GAINSPAN_SPI_STATS_T G_GainSpan_SPI_Stats;
+
+/* IDLE characters clocked out to read the module's data, replaced by */
+/* the bytes returned */
+static uint8_t G_GainSpan_SPI_IdleBuffer[GAINSPAN_SPI_IDLE_BURST_MAX];
+static bool G_GainSpan_SPI_IsIdleTransfer;
+
+/* Flow control: XOFF received, and since when data is held back */
+static volatile bool G_GainSpan_SPI_XOff;
+static bool G_GainSpan_SPI_IsStalled;
+static uint32_t G_GainSpan_SPI_StallStart;
+
+/* Class of each byte value returned by the module */
+static const uint8_t G_GainSpan_SPI_CharClass[256] = {
+    [GAINSPAN_SPI_CHAR_IDLE] = GAINSPAN_SPI_CLASS_IDLE,
+    [GAINSPAN_SPI_CHAR_ESC] = GAINSPAN_SPI_CLASS_ESC,
+    [GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON] = GAINSPAN_SPI_CLASS_XON,
+    [GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF] = GAINSPAN_SPI_CLASS_XOFF,
+};
+
+/* Byte values that must be sent escaped (ESC, then the byte xor 0x20) */
+static const bool G_GainSpan_SPI_IsSpecial[256] = {
+    [GAINSPAN_SPI_CHAR_IDLE] = true,
+    [GAINSPAN_SPI_CHAR_ESC] = true,
+    [GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON] = true,
+    [GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF] = true,
+    [GAINSPAN_SPI_CHAR_INACTIVE_LINK] = true,
+    [GAINSPAN_SPI_CHAR_INACTIVE_LINK2] = true,
+    [GAINSPAN_SPI_CHAR_LINK_READY] = true,
+};
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static void IGainSpan_SPI_TransferComplete(void);
+static void IGainSpan_SPI_BusFree(void);
 
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_Start
@@ -65,9 +138,22 @@ void GainSpan_SPI_Start(void)
     G_GainSpan_SPI_RXIn = G_GainSpan_SPI_RXOut = 0;
     G_GainSpan_SPI_TX_Empty = true;
     G_GainSpan_SPI_EscapeCode = false;
-    G_GainSpan_SPI_IsTransferComplete = false;
     G_GainSpan_SPI_IsTransferActive = false;
     G_GainSpan_SPI_NumSent = 0;
+    G_GainSpan_SPI_IsIdleTransfer = false;
+    G_GainSpan_SPI_XOff = false;
+    G_GainSpan_SPI_IsStalled = false;
+    GainSpan_SPI_ClearStats();
+    SPI_CSI10_ChannelSetBusFreeHandler(SPI_WIFI_CHANNEL, IGainSpan_SPI_BusFree);
+
+    /* Interrupt on the rising edge of data ready (P74/INTP8) */
+    PMK8 = 1U;
+    PIF8 = 0U;
+    EGP1 |= 0x01U;
+    EGN1 &= ~0x01U;
+    PPR18 = GAINSPAN_SPI_DATA_READY_INT_PRIORITY;
+    PPR08 = GAINSPAN_SPI_DATA_READY_INT_PRIORITY;
+    PMK8 = 0U;
 }
 
 /*---------------------------------------------------------------------------*
@@ -82,35 +168,155 @@ void GainSpan_SPI_Start(void)
  *---------------------------------------------------------------------------*/
 void GainSpan_SPI_Stop(void)
 {
-    /* Do nothing for now */
+    /* No more transfers started by data ready or a free bus */
+    PMK8 = 1U;
+    PIF8 = 0U;
+    SPI_CSI10_ChannelSetBusFreeHandler(SPI_WIFI_CHANNEL, 0);
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  IGainSpan_SPI_TransferComplete
+ * Routine:  IGainSpan_SPI_ReceiveSpace
  *---------------------------------------------------------------------------*
  * Description:
- *      Interrupt Service Routine callback taht marks a transfer as
- *      completed.
+ *      Determine how many bytes the receive FIFO can still take.
  * Inputs:
  *      void
  * Outputs:
+ *      uint16_t -- Number of free bytes
+ *---------------------------------------------------------------------------*/
+static uint16_t IGainSpan_SPI_ReceiveSpace(void)
+{
+    /* One slot always stays empty to tell full from empty */
+    return (G_GainSpan_SPI_RXOut - G_GainSpan_SPI_RXIn - 1)
+            & GAINSPAN_SPI_RX_MASK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_TransmitSpace
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine how many bytes the transmit FIFO can still take.
+ * Inputs:
  *      void
+ * Outputs:
+ *      uint16_t -- Number of free bytes
  *---------------------------------------------------------------------------*/
-static void IGainSpan_SPI_TransferComplete(void)
+static uint16_t IGainSpan_SPI_TransmitSpace(void)
 {
-    /* Note that the transfer is complete and processing needs to be done */
-    G_GainSpan_SPI_IsTransferComplete = true;
+    /* One slot always stays empty to tell full from empty */
+    return (G_GainSpan_SPI_TXOut - G_GainSpan_SPI_TXIn - 1)
+            & GAINSPAN_SPI_TX_MASK;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_StoreRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put a run of received data bytes into the receive FIFO, in at most
+ *      two copies (up to the end of the buffer and then from the start).
+ *      Bytes that do not fit are dropped and counted.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to store
+ *      uint16_t aLen -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_StoreRun(const uint8_t *aData, uint16_t aLen)
+{
+    uint16_t space = IGainSpan_SPI_ReceiveSpace();
+    uint16_t run;
+
+    if (aLen > space) {
+        G_GainSpan_SPI_Stats.iBytesDropped += aLen - space;
+        aLen = space;
+    }
+    G_GainSpan_SPI_Stats.iBytesReceived += aLen;
+
+    while (aLen) {
+        run = GAINSPAN_SPI_RX_BUFFER_SIZE - G_GainSpan_SPI_RXIn;
+        if (run > aLen)
+            run = aLen;
+        memcpy(G_GainSpan_SPI_RXBuffer + G_GainSpan_SPI_RXIn, aData, run);
+        G_GainSpan_SPI_RXIn = (G_GainSpan_SPI_RXIn + run)
+                & GAINSPAN_SPI_RX_MASK;
+        aData += run;
+        aLen -= run;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_Decode
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Decode bytes returned by the module and put the data into the
+ *      receive FIFO.  Escape codes are translated, IDLE characters are
+ *      ignored and XON/XOFF turn the transmit flow control on and off.
+ *      Most of what comes back is long runs of IDLE fill or of plain
+ *      data, so the bytes are looked up in G_GainSpan_SPI_CharClass and
+ *      handled a run at a time: IDLE runs are skipped and data runs are
+ *      copied into the receive FIFO as a block.
+ * Inputs:
+ *      const uint8_t *p -- Bytes returned
+ *      uint16_t count -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_Decode(const uint8_t *p, uint16_t count)
+{
+    uint16_t run;
+    uint8_t charClass;
+    uint8_t c;
+
+    while (count) {
+        /* Was the last character an escape code? */
+        if (G_GainSpan_SPI_EscapeCode) {
+            /* Use this character xor 0x20 and now no longer in escape mode */
+            c = *p++ ^ 0x20;
+            count--;
+            G_GainSpan_SPI_EscapeCode = false;
+            IGainSpan_SPI_StoreRun(&c, 1);
+            continue;
+        }
+
+        /* Find the run of bytes of the same class */
+        charClass = G_GainSpan_SPI_CharClass[*p];
+        run = 1;
+        switch (charClass) {
+            case GAINSPAN_SPI_CLASS_ESC:
+                /* Don't use this character, go into escape mode */
+                G_GainSpan_SPI_EscapeCode = true;
+                break;
+            case GAINSPAN_SPI_CLASS_XON:
+                G_GainSpan_SPI_XOff = false;
+                break;
+            case GAINSPAN_SPI_CLASS_XOFF:
+                if (!G_GainSpan_SPI_XOff)
+                    G_GainSpan_SPI_Stats.iXOffs++;
+                G_GainSpan_SPI_XOff = true;
+                break;
+            default:
+                while ((run < count)
+                        && (G_GainSpan_SPI_CharClass[p[run]] == charClass))
+                    run++;
+                if (charClass == GAINSPAN_SPI_CLASS_DATA)
+                    IGainSpan_SPI_StoreRun(p, run);
+                break;
+        }
+        p += run;
+        count -= run;
+    }
 }
 
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_ProcessIncoming
  *---------------------------------------------------------------------------*
  * Description:
- *      Process any incoming data bytes and put into the receive FIFO.
- *      Escape codes are also translated and IDLE characters are ignored.
+ *      Process any incoming data bytes and put into the receive FIFO
+ *      (see IGainSpan_SPI_Decode).
  *      The number of bytes processed is based on G_GainSpan_SPI_NumSent
  *      and the bytes sitting in the FIFO going out (the outgoing bytes are
- *      replaced by the SPI low level routine with incoming bytes)
+ *      replaced by the SPI low level routine with incoming bytes), or in
+ *      the IDLE buffer after an IDLE burst.
  * Inputs:
  *      void
  * Outputs:
@@ -118,52 +324,152 @@ static void IGainSpan_SPI_TransferComplete(void)
  *---------------------------------------------------------------------------*/
 static void GainSpan_SPI_ProcessIncoming(void)
 {
-    bool storeChar;
-    uint16_t next;
-    uint8_t c;
+    uint16_t count;
+
+    G_GainSpan_SPI_Stats.iTransfers++;
+    G_GainSpan_SPI_Stats.iBytesClocked += G_GainSpan_SPI_NumSent;
+
+    if (G_GainSpan_SPI_IsIdleTransfer) {
+        IGainSpan_SPI_Decode(G_GainSpan_SPI_IdleBuffer, G_GainSpan_SPI_NumSent);
+        G_GainSpan_SPI_NumSent = 0;
+        return;
+    }
 
     /* At this point, the characters in the transfer buffer */
     /* are characters that were sent and then replaced by the */
     /* matching received characters.  We need to process these */
     /* return characters and put the response in the receive */
     /* buffer. */
-    /* Process all the bytes sent last */
+    /* Process all the bytes sent last, a contiguous piece at a time */
     while (G_GainSpan_SPI_NumSent) {
-        /* A character has come in, process it */
-        /* The characters that are going out can be used */
-        c = G_GainSpan_SPI_TXBuffer[G_GainSpan_SPI_TXOut++];
-        if (G_GainSpan_SPI_TXOut == GAINSPAN_SPI_TX_BUFFER_SIZE)
-            G_GainSpan_SPI_TXOut = 0;
-        storeChar = true;
+        count = GAINSPAN_SPI_TX_BUFFER_SIZE - G_GainSpan_SPI_TXOut;
+        if (count > G_GainSpan_SPI_NumSent)
+            count = G_GainSpan_SPI_NumSent;
+        IGainSpan_SPI_Decode(G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXOut,
+                count);
+        G_GainSpan_SPI_NumSent -= count;
+        G_GainSpan_SPI_TXOut = (G_GainSpan_SPI_TXOut + count)
+                & GAINSPAN_SPI_TX_MASK;
+    }
+}
 
-        /* Was the last character an escape code? */
-        if (G_GainSpan_SPI_EscapeCode) {
-            /* Use this character xor 0x20 and now no longer in escape mode */
-            c ^= 0x20;
-            G_GainSpan_SPI_EscapeCode = false;
-        } else {
-            if (c == GAINSPAN_SPI_CHAR_ESC) {
-                /* Don't use this character, go into escape mode */
-                G_GainSpan_SPI_EscapeCode = true;
-                storeChar = false;
-            } else if (c == GAINSPAN_SPI_CHAR_IDLE) {
-                storeChar = false;
-            }
-        }
-        if (storeChar) {
-            /* The character needs to be stored in the receive buffer */
-            /* Is there room? */
-            next = G_GainSpan_SPI_RXIn + 1;
-            if (next >= GAINSPAN_SPI_RX_BUFFER_SIZE)
-                next = 0;
-            if (next != G_GainSpan_SPI_RXOut) {
-                /* Yes, room.  Store the character in the receive FIFO buffer */
-                G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXIn] = c;
-                G_GainSpan_SPI_RXIn = next;
-            }
-        }
-        G_GainSpan_SPI_NumSent--;
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_StartIdleBurst
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Clock out a burst of IDLE characters to read in up to that many
+ *      bytes from the module.  The burst is no longer than the free space
+ *      of the receive FIFO, so what comes back has room.  Nothing is
+ *      clocked in while the receive FIFO is full.
+ * Inputs:
+ *      uint16_t aMaxBurst -- Most IDLE characters to send, up to
+ *          GAINSPAN_SPI_IDLE_BURST_MAX
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_StartIdleBurst(uint16_t aMaxBurst)
+{
+    uint16_t burst = IGainSpan_SPI_ReceiveSpace();
+
+    if (burst > aMaxBurst)
+        burst = aMaxBurst;
+    if (!burst)
+        return;
+
+    memset(G_GainSpan_SPI_IdleBuffer, GAINSPAN_SPI_CHAR_IDLE, burst);
+    G_GainSpan_SPI_NumSent = burst;
+    G_GainSpan_SPI_IsIdleTransfer = true;
+    G_GainSpan_SPI_IsTransferActive = true;
+    if (!SPI_CSI10_Transfer(SPI_WIFI_CHANNEL, burst, G_GainSpan_SPI_IdleBuffer,
+            G_GainSpan_SPI_IdleBuffer, IGainSpan_SPI_TransferComplete)) {
+        /* Bus in use, IGainSpan_SPI_BusFree tries again */
+        G_GainSpan_SPI_IsTransferActive = false;
+        G_GainSpan_SPI_NumSent = 0;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_IsStallOver
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Called while data to send is held back.  Counts the stall and
+ *      determines if it has lasted GAINSPAN_SPI_STALL_TIMEOUT, in which
+ *      case the XON is taken as lost (or the receive FIFO as not being
+ *      read) and the data is to be sent anyway.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true to send anyway, false to keep waiting
+ *---------------------------------------------------------------------------*/
+static bool IGainSpan_SPI_IsStallOver(void)
+{
+    if (!G_GainSpan_SPI_IsStalled) {
+        G_GainSpan_SPI_IsStalled = true;
+        G_GainSpan_SPI_StallStart = MSTimerGet();
+        G_GainSpan_SPI_Stats.iStalls++;
+    }
+    if (MSTimerDelta(G_GainSpan_SPI_StallStart) < GAINSPAN_SPI_STALL_TIMEOUT)
+        return false;
+
+    G_GainSpan_SPI_Stats.iStallTimeouts++;
+    G_GainSpan_SPI_IsStalled = false;
+    G_GainSpan_SPI_XOff = false;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_StartTransmit
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Send the next contiguous bytes of the transmit FIFO, unless held
+ *      back.  Data is held back while the module has sent XOFF, and while
+ *      the module has data for us (which comes back in place of what is
+ *      sent) but the receive FIFO is full.  If the module has data, no
+ *      more bytes are sent than the receive FIFO can take.
+ * Inputs:
+ *      bool aDataReady -- true if the module has data for us
+ * Outputs:
+ *      bool -- true if a transfer was started, else false
+ *---------------------------------------------------------------------------*/
+static bool IGainSpan_SPI_StartTransmit(bool aDataReady)
+{
+    uint16_t numBytes;
+    uint16_t space = IGainSpan_SPI_ReceiveSpace();
+
+    if ((G_GainSpan_SPI_XOff) || ((aDataReady) && (!space))) {
+        if (!IGainSpan_SPI_IsStallOver())
+            return false;
+    } else {
+        G_GainSpan_SPI_IsStalled = false;
+    }
+
+    /* How many contiguous bytes can we send */
+    if (G_GainSpan_SPI_TXIn > G_GainSpan_SPI_TXOut) {
+        numBytes = G_GainSpan_SPI_TXIn - G_GainSpan_SPI_TXOut;
+    } else {
+        numBytes = GAINSPAN_SPI_TX_BUFFER_SIZE - G_GainSpan_SPI_TXOut;
+    }
+    if ((aDataReady) && (space) && (numBytes > space))
+        numBytes = space;
+
+    /* Remember how many bytes were sent in this transfer so it */
+    /* the returned bytes can be processed later */
+    G_GainSpan_SPI_NumSent = numBytes;
+    G_GainSpan_SPI_IsIdleTransfer = false;
+    G_GainSpan_SPI_IsTransferActive = true;
+
+    /* Tell the SPI to send out this group of characters */
+    if (!SPI_CSI10_Transfer(SPI_WIFI_CHANNEL, numBytes,
+            G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXOut,
+            G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXOut,
+            IGainSpan_SPI_TransferComplete)) {
+        /* Bus in use, IGainSpan_SPI_BusFree tries again */
+        G_GainSpan_SPI_IsTransferActive = false;
+        G_GainSpan_SPI_NumSent = 0;
+        return false;
     }
+
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
@@ -185,18 +491,113 @@ bool GainSpan_SPI_IsDataReady(void)
         return false;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_Pump
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start the next transfer if the SPI bus is free and there is
+ *      something to do.  Data to send goes first (unless held back by
+ *      flow control), else if the module has data for us a burst of
+ *      IDLE characters brings it in.  Called at interrupt level, or with
+ *      interrupts disabled.
+ * Inputs:
+ *      bool aPollXOn -- true to clock out an IDLE character to look for
+ *          the XON if the module has sent XOFF.  Only done from
+ *          GainSpan_SPI_Update, to not spin in the interrupts.
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_Pump(bool aPollXOn)
+{
+    bool dataReady;
+
+    /* Is a transfer of ours still going?  (If another device has the */
+    /* bus, SPI_CSI10_Transfer turns us away and IGainSpan_SPI_BusFree */
+    /* runs this again when the bus is ours.) */
+    if (G_GainSpan_SPI_IsTransferActive)
+        return;
+
+    /* Is there more data to send (and can it go)? */
+    dataReady = GainSpan_SPI_IsDataReady();
+    if ((G_GainSpan_SPI_TXIn != G_GainSpan_SPI_TXOut)
+            && (IGainSpan_SPI_StartTransmit(dataReady))) {
+        /* Sending */
+    } else if (dataReady) {
+        /* Is the GainSpan module ready with data to return?  If so, send IDLE characters */
+        /* to start feeding out the data */
+        IGainSpan_SPI_StartIdleBurst(GAINSPAN_SPI_IDLE_BURST_MAX);
+    } else if ((aPollXOn) && (G_GainSpan_SPI_XOff)) {
+        /* Keep polling for the XON */
+        IGainSpan_SPI_StartIdleBurst(1);
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_TransferComplete
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Interrupt Service Routine callback that processes the bytes that
+ *      came back and chains the next transfer.  The chain stops when
+ *      there is nothing to send, the module has no more data, or the
+ *      receive FIFO is full.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_TransferComplete(void)
+{
+    GainSpan_SPI_ProcessIncoming();
+    G_GainSpan_SPI_IsTransferActive = false;
+    IGainSpan_SPI_Pump(false);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IGainSpan_SPI_BusFree
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      SPI bus free handler.  A transfer was turned away because another
+ *      device had the bus; start it now.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void IGainSpan_SPI_BusFree(void)
+{
+    IGainSpan_SPI_Pump(false);
+}
+
+/*---------------------------------------------------------------------------*
+ * Interrupt Routine:  IGainSpan_SPI_DataReadyISR
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The module raised data ready.  Start pulling in its data if the
+ *      bus is free (otherwise the end of the current transfer will).
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+#pragma vector = INTP8_vect
+__interrupt static void IGainSpan_SPI_DataReadyISR(void)
+{
+    IGainSpan_SPI_Pump(false);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_Update
  *---------------------------------------------------------------------------*
  * Description:
- *      Update the state of the GainSpan SPI driver.  It first determines
- *      if any data has just been received and if so, processes it.
- *      If SPI is not busy (and a transfer is no longer active), the
- *      outgoing FIFO is checked to see if bytes can be sent out over
- *      SPI.  If so, those bytes are scheduled to send out.
- *      If no bytes are to be sent, but the module has data to send us,
- *      we'll put an IDLE character in the FIFO and request for more
- *      to come in.
+ *      Update the state of the GainSpan SPI driver.  If SPI is not busy
+ *      (and a transfer is no longer active), the outgoing FIFO is checked
+ *      to see if bytes can be sent out over SPI.  If so, those bytes are
+ *      scheduled to send out; the rest follow from the interrupts.
+ *      If no bytes are to be sent (or they are held back by flow
+ *      control), but the module has data to send us, we'll clock out
+ *      a burst of IDLE characters to bring it in.  While the module
+ *      has sent XOFF, single IDLE characters are clocked out to look
+ *      for the XON.
  * Inputs:
  *      void
  * Outputs:
@@ -204,49 +605,11 @@ bool GainSpan_SPI_IsDataReady(void)
  *---------------------------------------------------------------------------*/
 void GainSpan_SPI_Update(void)
 {
-    uint16_t numBytes;
+    __istate_t state = __get_interrupt_state();
 
-    /* Process any incoming bytes that were just sent */
-    if (G_GainSpan_SPI_IsTransferComplete) {
-        G_GainSpan_SPI_IsTransferComplete = false;
-        GainSpan_SPI_ProcessIncoming();
-        G_GainSpan_SPI_IsTransferActive = false;
-    } else {
-        /* Is the SPI bus busy? We cannot start a transfer until it is free. */
-        if ((!SPI_CSI10_IsBusy()) && (!G_GainSpan_SPI_IsTransferActive)) {
-            /* The SPI bus is now free to start another transfer */
-            /* Try to send more data */
-            /* Is there more data to send? */
-            if (G_GainSpan_SPI_TXIn != G_GainSpan_SPI_TXOut) {
-                /* There is data to send, how many contiguous bytes can we send */
-                if (G_GainSpan_SPI_TXIn > G_GainSpan_SPI_TXOut) {
-                    numBytes = G_GainSpan_SPI_TXIn - G_GainSpan_SPI_TXOut;
-                } else {
-                    numBytes = GAINSPAN_SPI_TX_BUFFER_SIZE
-                            - G_GainSpan_SPI_TXOut;
-                }
-
-                /* Remember how many bytes were sent in this transfer so it */
-                /* the returned bytes can be processed later */
-                G_GainSpan_SPI_NumSent = numBytes;
-                G_GainSpan_SPI_IsTransferActive = true;
-
-                /* Tell the SPI to send out this group of characters */
-                SPI_CSI10_Transfer(SPI_WIFI_CHANNEL, numBytes,
-                        G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXOut,
-                        G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXOut,
-                        IGainSpan_SPI_TransferComplete);
-                //MSTimerDelay(1);
-            } else {
-                /* Nothing is being sent currently. */
-                /* Is the GainSpan module ready with data to return?  If so, send an IDLE character */
-                /* to start feeding out the data */
-                if (GainSpan_SPI_IsDataReady()) {
-                    GainSpan_SPI_SendByteLowLevel(GAINSPAN_SPI_CHAR_IDLE);
-                }
-            }
-        }
-    }
+    DI();
+    IGainSpan_SPI_Pump(true);
+    __set_interrupt_state(state);
 }
 
 /*---------------------------------------------------------------------------*
@@ -265,6 +628,22 @@ bool GainSpan_SPI_IsTransmitEmpty(void)
     return (G_GainSpan_SPI_TXOut == G_GainSpan_SPI_TXIn);
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_IsFlowOff
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine if the module has sent XOFF (and no XON since), so data
+ *      to send is held back.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if held back by XOFF, else false.
+ *---------------------------------------------------------------------------*/
+bool GainSpan_SPI_IsFlowOff(void)
+{
+    return G_GainSpan_SPI_XOff;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_ReceiveByte
  *---------------------------------------------------------------------------*
@@ -285,15 +664,56 @@ bool GainSpan_SPI_ReceiveByte(uint8_t *aByte)
     /* Check to see if any bytes have been placed in the FIFO and */
     /* are waiting to be pulled out. */
     if (G_GainSpan_SPI_RXIn != G_GainSpan_SPI_RXOut) {
-        *aByte = G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXOut++];
-        if (G_GainSpan_SPI_RXOut >= GAINSPAN_SPI_RX_BUFFER_SIZE)
-            G_GainSpan_SPI_RXOut = 0;
+        *aByte = G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXOut];
+        G_GainSpan_SPI_RXOut = (G_GainSpan_SPI_RXOut + 1)
+                & GAINSPAN_SPI_RX_MASK;
         found = true;
     }
 
     return found;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_ReceiveData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the bytes waiting in the receive FIFO, in at most two copies
+ *      (up to the end of the buffer and then from the start).  Does not
+ *      block.
+ * Inputs:
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t GainSpan_SPI_ReceiveData(uint8_t *aData, uint32_t aMaxLen)
+{
+    uint32_t count = 0;
+    uint16_t in;
+    uint16_t run;
+
+    /* When looking for data, update the state */
+    GainSpan_SPI_Update();
+
+    in = G_GainSpan_SPI_RXIn;
+    while ((count < aMaxLen) && (G_GainSpan_SPI_RXOut != in)) {
+        /* Contiguous bytes from the out position */
+        if (in > G_GainSpan_SPI_RXOut)
+            run = in - G_GainSpan_SPI_RXOut;
+        else
+            run = GAINSPAN_SPI_RX_BUFFER_SIZE - G_GainSpan_SPI_RXOut;
+        if (run > aMaxLen - count)
+            run = aMaxLen - count;
+        memcpy(aData + count, G_GainSpan_SPI_RXBuffer + G_GainSpan_SPI_RXOut,
+                run);
+        G_GainSpan_SPI_RXOut = (G_GainSpan_SPI_RXOut + run)
+                & GAINSPAN_SPI_RX_MASK;
+        count += run;
+    }
+
+    return count;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_SendByteLowLevel
  *---------------------------------------------------------------------------*
@@ -308,26 +728,15 @@ bool GainSpan_SPI_ReceiveByte(uint8_t *aByte)
  *---------------------------------------------------------------------------*/
 bool GainSpan_SPI_SendByteLowLevel(uint8_t aByte)
 {
-    uint16_t next;
-    bool placed = false;
-
-    /* Calculate where the next in position is in the FIFO */
-    next = G_GainSpan_SPI_TXIn + 1;
-    if (next >= GAINSPAN_SPI_TX_BUFFER_SIZE)
-        next = 0;
-
     /* Is there room in the transmit FIFO? */
-    if (next != G_GainSpan_SPI_TXOut) {
-        /* There is room, place a byte in the FIFO */
-        G_GainSpan_SPI_TXBuffer[G_GainSpan_SPI_TXIn] = aByte;
-        G_GainSpan_SPI_TXIn = next;
-        placed = true;
-    } else {
-        /* There is no room in the FIFO, return the failed case */
-        placed = false;
-    }
+    if (!IGainSpan_SPI_TransmitSpace())
+        return false;
 
-    return placed;
+    /* There is room, place a byte in the FIFO */
+    G_GainSpan_SPI_TXBuffer[G_GainSpan_SPI_TXIn] = aByte;
+    G_GainSpan_SPI_TXIn = (G_GainSpan_SPI_TXIn + 1) & GAINSPAN_SPI_TX_MASK;
+
+    return true;
 }
 
 /*---------------------------------------------------------------------------*
@@ -346,39 +755,7 @@ bool GainSpan_SPI_SendByteLowLevel(uint8_t aByte)
  *---------------------------------------------------------------------------*/
 bool GainSpan_SPI_SendByte(uint8_t aByte)
 {
-    uint16_t next;
-    bool placed = false;
-
-    /* If one of the special characters, stuff an extra byte into it */
-    switch (aByte) {
-        case GAINSPAN_SPI_CHAR_IDLE:
-        case GAINSPAN_SPI_CHAR_ESC:
-        case GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON:
-        case GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF:
-        case GAINSPAN_SPI_CHAR_INACTIVE_LINK:
-        case GAINSPAN_SPI_CHAR_INACTIVE_LINK2:
-        case GAINSPAN_SPI_CHAR_LINK_READY:
-            /* Is there room for two characters? */
-            next = G_GainSpan_SPI_TXIn + 1;
-            if (next >= GAINSPAN_SPI_TX_BUFFER_SIZE)
-                next = 0;
-            if (next != G_GainSpan_SPI_TXOut) {
-                next++;
-                if (next >= GAINSPAN_SPI_TX_BUFFER_SIZE)
-                    next = 0;
-
-                /* There is room for two bytes, now stuff the characters in */
-                GainSpan_SPI_SendByteLowLevel(GAINSPAN_SPI_CHAR_ESC);
-                GainSpan_SPI_SendByteLowLevel(aByte ^ 0x20);
-            }
-            break;
-        default:
-            /*  Not a special character, go ahead and store it */
-            placed = GainSpan_SPI_SendByteLowLevel(aByte);
-            break;
-    }
-
-    return placed;
+    return (GainSpan_SPI_SendData(&aByte, 1) == 1);
 }
 
 /*---------------------------------------------------------------------------*
@@ -387,6 +764,11 @@ bool GainSpan_SPI_SendByte(uint8_t aByte)
  * Description:
  *      Send an array of data bytes out the transmit FIFO.  This routine
  *      does not block and returns the number of bytes sent.
+ *      The data is escaped in one pass: runs of plain bytes are copied
+ *      into the FIFO with memcpy (in two pieces if they cross the end of
+ *      the buffer) and special characters go in as ESC plus the byte
+ *      xor 0x20.  The FIFO in position is only moved after the bytes
+ *      are in place, as the transfer interrupts read it.
  * Inputs:
  *      const uint8_t *aData -- data to send
  *      uint32_t aLen -- Number of bytes to send.
@@ -395,16 +777,48 @@ bool GainSpan_SPI_SendByte(uint8_t aByte)
  *---------------------------------------------------------------------------*/
 uint32_t GainSpan_SPI_SendData(const uint8_t *aData, uint32_t aLen)
 {
-    uint32_t i;
+    uint32_t done = 0;
+    uint16_t space = IGainSpan_SPI_TransmitSpace();
+    uint16_t in = G_GainSpan_SPI_TXIn;
+    uint16_t count;
+    uint16_t run;
+
+    while ((done < aLen) && (space)) {
+        if (G_GainSpan_SPI_IsSpecial[aData[done]]) {
+            /* Need room for the escape and the byte */
+            if (space < 2)
+                break;
+            G_GainSpan_SPI_TXBuffer[in] = GAINSPAN_SPI_CHAR_ESC;
+            in = (in + 1) & GAINSPAN_SPI_TX_MASK;
+            G_GainSpan_SPI_TXBuffer[in] = aData[done] ^ 0x20;
+            in = (in + 1) & GAINSPAN_SPI_TX_MASK;
+            space -= 2;
+            done++;
+            continue;
+        }
 
-    /* Send each byte one at a time unless out of space */
-    for (i = 0; i < aLen; ++i) {
-        if (!GainSpan_SPI_SendByte(aData[i]))
-            break;
+        /* Find the run of bytes that go as is */
+        count = 1;
+        while ((count < space) && (done + count < aLen)
+                && (!G_GainSpan_SPI_IsSpecial[aData[done + count]]))
+            count++;
+        space -= count;
+
+        /* Copy up to the end of the buffer and then from the start */
+        while (count) {
+            run = GAINSPAN_SPI_TX_BUFFER_SIZE - in;
+            if (run > count)
+                run = count;
+            memcpy(G_GainSpan_SPI_TXBuffer + in, aData + done, run);
+            in = (in + run) & GAINSPAN_SPI_TX_MASK;
+            done += run;
+            count -= run;
+        }
     }
+    G_GainSpan_SPI_TXIn = in;
 
     /* Return the number of bytes that did get into the transmit FIFO */
-    return i;
+    return done;
 }
 
 /*---------------------------------------------------------------------------*
@@ -421,18 +835,50 @@ uint32_t GainSpan_SPI_SendData(const uint8_t *aData, uint32_t aLen)
  *---------------------------------------------------------------------------*/
 void GainSpan_SPI_SendDataBlock(const uint8_t *aData, uint32_t aLen)
 {
-    /* Send each byte one at a time unless out of space */
-    uint32_t i;
-
-    for (i = 0; i < aLen; ++i) {
-        while (1) {
-            if (GainSpan_SPI_SendByte(aData[i]))
-                break;
-            GainSpan_SPI_Update();
-        }
+    uint32_t sent;
+
+    while (1) {
+        /* Queue as much as fits, then start it going */
+        sent = GainSpan_SPI_SendData(aData, aLen);
+        aData += sent;
+        aLen -= sent;
+        GainSpan_SPI_Update();
+        if (!aLen)
+            break;
     }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_GetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the transfer counters.  iBytesReceived / iTransfers gives the
+ *      useful bytes per transfer.
+ * Inputs:
+ *      GAINSPAN_SPI_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void GainSpan_SPI_GetStats(GAINSPAN_SPI_STATS_T *aStats)
+{
+    *aStats = G_GainSpan_SPI_Stats;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_ClearStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Reset the transfer counters.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void GainSpan_SPI_ClearStats(void)
+{
+    memset(&G_GainSpan_SPI_Stats, 0, sizeof(G_GainSpan_SPI_Stats));
+}
+
 /*-------------------------------------------------------------------------*
  * File:  GAINSPAN_SPI.h
  *-------------------------------------------------------------------------*/
@@ -28,18 +28,36 @@
 #define GAINSPAN_SPI_CHAR_INACTIVE_LINK2    0xFF
 #define GAINSPAN_SPI_CHAR_LINK_READY        0xF3
 
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Transfer counters, see GainSpan_SPI_GetStats */
+typedef struct {
+    uint32_t iTransfers;        /* SPI transfers completed */
+    uint32_t iBytesClocked;     /* Bytes exchanged in those transfers */
+    uint32_t iBytesReceived;    /* Data bytes put in the receive FIFO */
+    uint32_t iBytesDropped;     /* Data bytes lost, receive FIFO full */
+    uint32_t iXOffs;            /* XOFF received */
+    uint32_t iStalls;           /* Times data to send was held back */
+    uint32_t iStallTimeouts;    /* Held back too long and sent anyway */
+} GAINSPAN_SPI_STATS_T;
+
 /*-------------------------------------------------------------------------*
  * Prototypes:
  *-------------------------------------------------------------------------*/
 void GainSpan_SPI_Start(void);
 void GainSpan_SPI_Stop(void);
 bool GainSpan_SPI_ReceiveByte(uint8_t *aByte);
+uint32_t GainSpan_SPI_ReceiveData(uint8_t *aData, uint32_t aMaxLen);
 bool GainSpan_SPI_SendByte(uint8_t aByte);
 uint32_t GainSpan_SPI_SendData(const uint8_t *aData, uint32_t aLen);
 void GainSpan_SPI_SendDataBlock(const uint8_t *aData, uint32_t aLen);
 bool GainSpan_SPI_IsTransmitEmpty(void);
+bool GainSpan_SPI_IsFlowOff(void);
 void GainSpan_SPI_Update(void);
 bool GainSpan_SPI_SendByteLowLevel(uint8_t aByte);
+void GainSpan_SPI_GetStats(GAINSPAN_SPI_STATS_T *aStats);
+void GainSpan_SPI_ClearStats(void);
 
 #endif // _GainSpan_SPI_H
 /*-------------------------------------------------------------------------*
@@ -15,7 +15,7 @@
 /******************************************************************************
 Includes Glyph Include
 ******************************************************************************/
-#include "..\glyph_api.h"
+#include "../glyph_api.h"
 
 /******************************************************************************
 * Outline : Function Sets
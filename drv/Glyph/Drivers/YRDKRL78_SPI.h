@@ -27,7 +27,7 @@
 /******************************************************************************
 Includes Glyph Include
 ******************************************************************************/
-#include "..\glyph_api.h"
+#include "../glyph_api.h"
  
 /******************************************************************************
 Prototypes for the Glyph Communications API
@@ -35,6 +35,8 @@ Prototypes for the Glyph Communications API
 T_glyphError LCD_SPI_Open(T_glyphHandle aHandle);
 void LCD_SPI_CommandSend(int8_t aCommand) ;
 void LCD_SPI_DataSend(int8_t aData) ;
+void LCD_SPI_Flush(void) ;
+void LCD_SPI_DataSendBlock(const uint8_t *aData, uint16_t aLength) ;
 
 #endif /* __GLYPH__YRDK_RL78_SPI_0_HEADER_FILE */
  
@@ -16,281 +16,60 @@
  *    *===============================================================*
  *
  *-------------------------------------------------------------------------*/
-#include "glyph_cfg.h"
+#include "glyph_api.h"
 
-const uint8_t Bitmap_LoadingBar_Left[] = {
+static const uint8_t LCD_Bitmap_LoadingBar_Left[] = {
     0x04, 0x08, // width=4, height=8
     0x18, 0x7E, 0xFF, 0x81
 };
 
-const uint8_t Bitmap_LoadingBar_Right[] = {
+static const uint8_t LCD_Bitmap_LoadingBar_Right[] = {
     0x04, 0x08, // width=4, height=8
     0x81, 0xFF, 0x7E, 0x18
 };
 
-const uint8_t Bitmap_LoadingBar_Empty[] = {
+static const uint8_t LCD_Bitmap_LoadingBar_Empty[] = {
     0x01, 0x08, // width=1, height=8
     0x81
 };
 
-const uint8_t Bitmap_LoadingBar_Fill[] = {
+static const uint8_t LCD_Bitmap_LoadingBar_Fill[] = {
     0x01, 0x08, // width=1, height=8
     0xBD
 };
 
-const unsigned char *Bitmaps_table[256] = {
-	Bitmap_LoadingBar_Left,
-    Bitmap_LoadingBar_Right,
-    Bitmap_LoadingBar_Empty,
-    Bitmap_LoadingBar_Fill,
-    0,
-	0,
-	0,
-	0,
-	0,
-	0,
-    0,
-    0,
-	0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
+/* Sparse index of the bitmaps by character code, sorted by code.  Replaces
+   the 256 entry Bitmaps_table that was almost all 0.  The names differ from
+   the bitmaps and Bitmaps_table of the bitmap_font module of RL78GlyphLib,
+   so they do not clash when the library pulls that module in. */
+static const T_glyphBitmapIndex LCD_Bitmaps_index[] = {
+    { 0, LCD_Bitmap_LoadingBar_Left },
+    { 1, LCD_Bitmap_LoadingBar_Right },
+    { 2, LCD_Bitmap_LoadingBar_Empty },
+    { 3, LCD_Bitmap_LoadingBar_Fill },
 };
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BitmapFind
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Look up the bitmap of a character code in LCD_Bitmaps_index.
+ * Inputs:
+ *      uint8_t aCode -- Character code
+ * Outputs:
+ *      const uint8_t * -- Bitmap (width, height, column bytes), or 0 if
+ *          there is none for this code.
+ *---------------------------------------------------------------------------*/
+const uint8_t *BitmapFind(uint8_t aCode)
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(LCD_Bitmaps_index) / sizeof(LCD_Bitmaps_index[0]);
+            i++) {
+        if (LCD_Bitmaps_index[i].iCode == aCode)
+            return LCD_Bitmaps_index[i].iBitmap;
+        if (LCD_Bitmaps_index[i].iCode > aCode)
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*-------------------------------------------------------------------------*
+ * File:  font_8x8_pages.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      The Glyph library 8x8 subset font (0x20 to 0x7F) laid out for the
+ *      ST7579 display pages: 8 column bytes per character, bit 0 the top
+ *      pixel.  Text on page boundaries is drawn by copying these bytes
+ *      straight into the page, with no per pixel work.
+ *-------------------------------------------------------------------------*/
+#include "glyph_api.h"
+
+const uint8_t Font8x8_pages[FONT8X8_PAGES_LAST - FONT8X8_PAGES_FIRST + 1][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, /* 0x20 ' ' */
+    { 0x00, 0x00, 0x06, 0x5F, 0x5F, 0x06, 0x00, 0x00 }, /* 0x21 '!' */
+    { 0x00, 0x07, 0x07, 0x00, 0x07, 0x07, 0x00, 0x00 }, /* 0x22 '"' */
+    { 0x14, 0x7F, 0x7F, 0x14, 0x7F, 0x7F, 0x14, 0x00 }, /* 0x23 '#' */
+    { 0x24, 0x2E, 0x2A, 0x6B, 0x6B, 0x3A, 0x12, 0x00 }, /* 0x24 '$' */
+    { 0x42, 0x62, 0x30, 0x18, 0x0C, 0x46, 0x42, 0x00 }, /* 0x25 '%' */
+    { 0x30, 0x7A, 0x4F, 0x4D, 0x37, 0x7A, 0x48, 0x00 }, /* 0x26 '&' */
+    { 0x00, 0x00, 0x04, 0x07, 0x03, 0x00, 0x00, 0x00 }, /* 0x27 quote */
+    { 0x00, 0x1C, 0x3E, 0x63, 0x41, 0x00, 0x00, 0x00 }, /* 0x28 '(' */
+    { 0x00, 0x41, 0x63, 0x3E, 0x1C, 0x00, 0x00, 0x00 }, /* 0x29 ')' */
+    { 0x2A, 0x3E, 0x3E, 0x1C, 0x3E, 0x3E, 0x2A, 0x00 }, /* 0x2A '*' */
+    { 0x00, 0x08, 0x08, 0x3E, 0x3E, 0x08, 0x08, 0x00 }, /* 0x2B '+' */
+    { 0x00, 0x00, 0x40, 0x70, 0x30, 0x00, 0x00, 0x00 }, /* 0x2C ',' */
+    { 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00 }, /* 0x2D '-' */
+    { 0x00, 0x00, 0x60, 0x60, 0x60, 0x00, 0x00, 0x00 }, /* 0x2E '.' */
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, /* 0x2F '/' */
+    { 0x3E, 0x7F, 0x71, 0x59, 0x4D, 0x7F, 0x3E, 0x00 }, /* 0x30 '0' */
+    { 0x00, 0x42, 0x42, 0x7F, 0x7F, 0x40, 0x40, 0x00 }, /* 0x31 '1' */
+    { 0x42, 0x63, 0x71, 0x59, 0x4D, 0x67, 0x62, 0x00 }, /* 0x32 '2' */
+    { 0x22, 0x63, 0x49, 0x49, 0x49, 0x7F, 0x36, 0x00 }, /* 0x33 '3' */
+    { 0x10, 0x18, 0x1C, 0x16, 0x7F, 0x7F, 0x10, 0x00 }, /* 0x34 '4' */
+    { 0x27, 0x67, 0x45, 0x45, 0x45, 0x7D, 0x39, 0x00 }, /* 0x35 '5' */
+    { 0x3E, 0x7F, 0x49, 0x49, 0x49, 0x7B, 0x32, 0x00 }, /* 0x36 '6' */
+    { 0x03, 0x03, 0x01, 0x71, 0x79, 0x0F, 0x07, 0x00 }, /* 0x37 '7' */
+    { 0x36, 0x7F, 0x49, 0x49, 0x49, 0x7F, 0x36, 0x00 }, /* 0x38 '8' */
+    { 0x26, 0x6F, 0x49, 0x49, 0x49, 0x7F, 0x3E, 0x00 }, /* 0x39 '9' */
+    { 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x00, 0x00 }, /* 0x3A ':' */
+    { 0x00, 0x00, 0x80, 0xE6, 0x66, 0x00, 0x00, 0x00 }, /* 0x3B ';' */
+    { 0x00, 0x08, 0x1C, 0x36, 0x63, 0x41, 0x00, 0x00 }, /* 0x3C '<' */
+    { 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x00 }, /* 0x3D '=' */
+    { 0x00, 0x41, 0x63, 0x36, 0x1C, 0x08, 0x00, 0x00 }, /* 0x3E '>' */
+    { 0x02, 0x03, 0x01, 0x51, 0x59, 0x0F, 0x06, 0x00 }, /* 0x3F '?' */
+    { 0x3E, 0x7F, 0x41, 0x59, 0x59, 0x5F, 0x4E, 0x00 }, /* 0x40 '@' */
+    { 0x7C, 0x7E, 0x13, 0x11, 0x13, 0x7E, 0x7C, 0x00 }, /* 0x41 'A' */
+    { 0x41, 0x7F, 0x7F, 0x49, 0x49, 0x7F, 0x36, 0x00 }, /* 0x42 'B' */
+    { 0x1C, 0x3E, 0x63, 0x41, 0x41, 0x63, 0x22, 0x00 }, /* 0x43 'C' */
+    { 0x41, 0x7F, 0x7F, 0x41, 0x63, 0x3E, 0x1C, 0x00 }, /* 0x44 'D' */
+    { 0x7F, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x63, 0x00 }, /* 0x45 'E' */
+    { 0x41, 0x7F, 0x7F, 0x49, 0x09, 0x09, 0x03, 0x00 }, /* 0x46 'F' */
+    { 0x3E, 0x7F, 0x41, 0x51, 0x51, 0x73, 0x32, 0x00 }, /* 0x47 'G' */
+    { 0x7F, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x7F, 0x00 }, /* 0x48 'H' */
+    { 0x00, 0x00, 0x41, 0x7F, 0x7F, 0x41, 0x00, 0x00 }, /* 0x49 'I' */
+    { 0x30, 0x70, 0x41, 0x7F, 0x3F, 0x01, 0x00, 0x00 }, /* 0x4A 'J' */
+    { 0x7F, 0x7F, 0x08, 0x1C, 0x36, 0x63, 0x41, 0x00 }, /* 0x4B 'K' */
+    { 0x41, 0x7F, 0x7F, 0x41, 0x40, 0x40, 0x60, 0x00 }, /* 0x4C 'L' */
+    { 0x7F, 0x7F, 0x06, 0x1C, 0x06, 0x7F, 0x7F, 0x00 }, /* 0x4D 'M' */
+    { 0x7F, 0x7F, 0x0E, 0x18, 0x30, 0x7F, 0x7F, 0x00 }, /* 0x4E 'N' */
+    { 0x3E, 0x7F, 0x41, 0x41, 0x41, 0x7F, 0x3E, 0x00 }, /* 0x4F 'O' */
+    { 0x41, 0x7F, 0x7F, 0x49, 0x09, 0x0F, 0x06, 0x00 }, /* 0x50 'P' */
+    { 0x3E, 0x7F, 0x41, 0x61, 0x41, 0xFF, 0xBE, 0x00 }, /* 0x51 'Q' */
+    { 0x7F, 0x7F, 0x09, 0x19, 0x39, 0x6F, 0x46, 0x00 }, /* 0x52 'R' */
+    { 0x26, 0x6F, 0x49, 0x49, 0x49, 0x7B, 0x32, 0x00 }, /* 0x53 'S' */
+    { 0x00, 0x03, 0x41, 0x7F, 0x7F, 0x41, 0x03, 0x00 }, /* 0x54 'T' */
+    { 0x3F, 0x7F, 0x40, 0x40, 0x40, 0x7F, 0x3F, 0x00 }, /* 0x55 'U' */
+    { 0x0F, 0x1F, 0x30, 0x60, 0x30, 0x1F, 0x0F, 0x00 }, /* 0x56 'V' */
+    { 0x7F, 0x7F, 0x30, 0x1C, 0x30, 0x7F, 0x7F, 0x00 }, /* 0x57 'W' */
+    { 0x41, 0x63, 0x3E, 0x1C, 0x3E, 0x63, 0x41, 0x00 }, /* 0x58 'X' */
+    { 0x00, 0x07, 0x4F, 0x78, 0x78, 0x4F, 0x07, 0x00 }, /* 0x59 'Y' */
+    { 0x43, 0x61, 0x71, 0x59, 0x4D, 0x47, 0x63, 0x00 }, /* 0x5A 'Z' */
+    { 0x00, 0x7F, 0x7F, 0x41, 0x41, 0x41, 0x00, 0x00 }, /* 0x5B '[' */
+    { 0x01, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x00 }, /* 0x5C backslash */
+    { 0x00, 0x41, 0x41, 0x41, 0x7F, 0x7F, 0x00, 0x00 }, /* 0x5D ']' */
+    { 0x08, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x08, 0x00 }, /* 0x5E '^' */
+    { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 }, /* 0x5F '_' */
+    { 0x00, 0x00, 0x03, 0x07, 0x04, 0x00, 0x00, 0x00 }, /* 0x60 '`' */
+    { 0x20, 0x74, 0x54, 0x54, 0x7C, 0x78, 0x40, 0x00 }, /* 0x61 'a' */
+    { 0x41, 0x7F, 0x7F, 0x44, 0x44, 0x7C, 0x38, 0x00 }, /* 0x62 'b' */
+    { 0x38, 0x7C, 0x44, 0x44, 0x44, 0x6C, 0x28, 0x00 }, /* 0x63 'c' */
+    { 0x38, 0x7C, 0x44, 0x45, 0x7F, 0x7F, 0x40, 0x00 }, /* 0x64 'd' */
+    { 0x38, 0x7C, 0x54, 0x54, 0x54, 0x5C, 0x18, 0x00 }, /* 0x65 'e' */
+    { 0x08, 0x48, 0x7E, 0x7F, 0x49, 0x0B, 0x02, 0x00 }, /* 0x66 'f' */
+    { 0x18, 0xBC, 0xA4, 0xA4, 0xA8, 0xFC, 0x7C, 0x00 }, /* 0x67 'g' */
+    { 0x41, 0x7F, 0x7F, 0x04, 0x04, 0x7C, 0x78, 0x00 }, /* 0x68 'h' */
+    { 0x00, 0x00, 0x44, 0x7D, 0x7D, 0x40, 0x00, 0x00 }, /* 0x69 'i' */
+    { 0x40, 0xC0, 0x80, 0x84, 0xFD, 0x7D, 0x00, 0x00 }, /* 0x6A 'j' */
+    { 0x41, 0x7F, 0x7F, 0x10, 0x38, 0x6C, 0x44, 0x00 }, /* 0x6B 'k' */
+    { 0x00, 0x00, 0x00, 0x7F, 0x7F, 0x40, 0x00, 0x00 }, /* 0x6C 'l' */
+    { 0x78, 0x7C, 0x0C, 0x38, 0x0C, 0x7C, 0x78, 0x00 }, /* 0x6D 'm' */
+    { 0x04, 0x7C, 0x78, 0x04, 0x04, 0x7C, 0x78, 0x00 }, /* 0x6E 'n' */
+    { 0x38, 0x7C, 0x44, 0x44, 0x44, 0x7C, 0x38, 0x00 }, /* 0x6F 'o' */
+    { 0x84, 0xFC, 0xF8, 0xA4, 0x24, 0x3C, 0x18, 0x00 }, /* 0x70 'p' */
+    { 0x18, 0x3C, 0x24, 0xA4, 0xF8, 0xFC, 0x84, 0x00 }, /* 0x71 'q' */
+    { 0x44, 0x7C, 0x78, 0x44, 0x04, 0x0C, 0x08, 0x00 }, /* 0x72 'r' */
+    { 0x08, 0x5C, 0x54, 0x54, 0x54, 0x74, 0x20, 0x00 }, /* 0x73 's' */
+    { 0x04, 0x04, 0x3F, 0x7F, 0x44, 0x64, 0x20, 0x00 }, /* 0x74 't' */
+    { 0x3C, 0x7C, 0x40, 0x40, 0x3C, 0x7C, 0x40, 0x00 }, /* 0x75 'u' */
+    { 0x0C, 0x1C, 0x30, 0x60, 0x30, 0x1C, 0x0C, 0x00 }, /* 0x76 'v' */
+    { 0x3C, 0x7C, 0x60, 0x30, 0x60, 0x7C, 0x3C, 0x00 }, /* 0x77 'w' */
+    { 0x44, 0x6C, 0x38, 0x10, 0x38, 0x6C, 0x44, 0x00 }, /* 0x78 'x' */
+    { 0x1C, 0xBC, 0xA0, 0xA0, 0x90, 0xFC, 0x7C, 0x00 }, /* 0x79 'y' */
+    { 0x4C, 0x64, 0x74, 0x5C, 0x4C, 0x64, 0x00, 0x00 }, /* 0x7A 'z' */
+    { 0x00, 0x08, 0x08, 0x3E, 0x77, 0x41, 0x41, 0x00 }, /* 0x7B '{' */
+    { 0x00, 0x00, 0x00, 0x77, 0x77, 0x00, 0x00, 0x00 }, /* 0x7C '|' */
+    { 0x00, 0x41, 0x41, 0x77, 0x3E, 0x08, 0x08, 0x00 }, /* 0x7D '}' */
+    { 0x02, 0x03, 0x01, 0x03, 0x02, 0x03, 0x01, 0x00 }, /* 0x7E '~' */
+    { 0x40, 0x70, 0x7C, 0x4E, 0x7C, 0x70, 0x40, 0x00 }, /* 0x7F DEL */
+};
+
+/*-------------------------------------------------------------------------*
+ * End of File:  font_8x8_pages.c
+ *-------------------------------------------------------------------------*/
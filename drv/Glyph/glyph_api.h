@@ -65,7 +65,6 @@ Imported global variables and functions (from other files)
 
 /* Global Fonts to all users of API at all times                             */
 extern const uint8_t * FontHelvr10_table[256];
-extern const uint8_t * Bitmaps_table[256];
 extern const uint8_t * Font8x16_table[256];
 extern const uint8_t * Font8x8_table[256];
 extern const uint8_t * Font8x8_subset_table[256];
@@ -74,11 +73,26 @@ extern const uint8_t * Fontx5x7_table[256];
 extern const uint8_t * Fontx6x13_table[256];
 extern const uint8_t * Logos_table[256];
 
+/* 8x8 subset font as LCD page column bytes, see font_8x8_pages.c           */
+#define FONT8X8_PAGES_FIRST     0x20
+#define FONT8X8_PAGES_LAST      0x7F
+extern const uint8_t Font8x8_pages[FONT8X8_PAGES_LAST - FONT8X8_PAGES_FIRST + 1][8];
+
 /******************************************************************************
 Typedef definitions
 ******************************************************************************/
 typedef void *T_glyphHandle;
 
+/******************************************************************************
+* Outline : T_glyphBitmapIndex  Structure
+* Description :  One entry of the sparse bitmap index (see bitmap_font.c).
+* Calling Functions : BitmapFind
+******************************************************************************/
+typedef struct {
+    uint8_t iCode ;
+    const uint8_t * iBitmap ;
+} T_glyphBitmapIndex ;
+
 /******************************************************************************
 * Outline : T_glyphError  Enum
 * Description :  The Glyph API Error Identifiers Enumeration.
@@ -276,5 +290,10 @@ T_glyphError GlyphEraseBlock(T_glyphHandle aHandle, uint32_t aX1, uint32_t aY1,
 T_glyphError GlyphSetContrast(T_glyphHandle aHandle, int32_t nContrast) ;
 T_glyphError GlyphSetContrastBoost(T_glyphHandle aHandle, uint8_t cContrastBoost) ;
 
+/******************************************************************************
+Prototypes for the bitmap index
+******************************************************************************/
+const uint8_t * BitmapFind(uint8_t aCode) ;
+
 #endif /* GLYPH_LIB_GLYPH_API_HEADER_FILE */
 
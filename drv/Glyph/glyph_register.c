@@ -45,6 +45,20 @@ Includes <system include> 
 #include <system/mstimer.h>
 #include <drv/SPI_CSI10.h>
 
+/******************************************************************************
+* LCD data is sent in multi-byte SPI transactions: one batch fills while the
+* other goes out
+******************************************************************************/
+#define LCD_SPI_BATCH_SIZE      32
+
+static uint8_t G_LCD_SPI_Batch[2][LCD_SPI_BATCH_SIZE];
+static SPI_CSI10_Request G_LCD_SPI_Request[2];
+static uint8_t G_LCD_SPI_Fill;
+static uint8_t G_LCD_SPI_Count;
+static uint8_t G_LCD_SPI_Command;
+static SPI_CSI10_Request G_LCD_SPI_CommandRequest;
+static SPI_CSI10_Request G_LCD_SPI_BlockRequest;
+
 
 /******************************************************************************
 * Routines that override glyph library SPI routines
@@ -74,34 +88,106 @@ T_glyphError LCD_SPI_Open(T_glyphHandle aHandle)
     return GLYPH_ERROR_NONE;
 }
 /******************************************************************************
+* Function Name: ILCD_SPI_Wait
+* Description : Wait for a queued SPI transaction to be sent (returns right
+*   away for one never queued).
+******************************************************************************/
+static void ILCD_SPI_Wait(SPI_CSI10_Request *aRequest)
+{
+    while ((aRequest->iNumBytes) && (!aRequest->iIsDone))
+        {}
+}
+/******************************************************************************
+* Function Name: LCD_SPI_Flush
+* Description : Queue the LCD data bytes batched up by LCD_SPI_DataSend on
+*   the SPI bus.  Call at the end of a display update so the last bytes go
+*   out.
+******************************************************************************/
+void LCD_SPI_Flush(void)
+{
+    SPI_CSI10_Request *r;
+
+    if (!G_LCD_SPI_Count)
+        return;
+
+    r = &G_LCD_SPI_Request[G_LCD_SPI_Fill];
+    r->iChannel = SPI_CSI10_LCD_CHANNEL;
+    r->iNumBytes = G_LCD_SPI_Count;
+    r->iSendData = G_LCD_SPI_Batch[G_LCD_SPI_Fill];
+    r->iReceiveData = 0;
+    r->iCallback = 0;
+    SPI_CSI10_Queue(r);
+
+    /* Fill the other batch while this one goes out */
+    G_LCD_SPI_Fill ^= 1;
+    G_LCD_SPI_Count = 0;
+}
+/******************************************************************************
 * Function Name: LCD_SPI_Open
 * Description : Overwrites the default LCD_SPI_CommandSend in the RL78 Glyph 
 *   Library. This routine sends a command byte to the LCD along with toggling 
-*   the LCD Chip Select and LCD Register Select Pins
+*   the LCD Chip Select and LCD Register Select Pins.  The data bytes before
+*   it are sent first, as RS has to change.
 ******************************************************************************/
 void LCD_SPI_CommandSend(int8_t aCommand)
 {
-    uint8_t dummyRX;  // No Receive Data
-    
+    LCD_SPI_Flush();
+    ILCD_SPI_Wait(&G_LCD_SPI_Request[0]);
+    ILCD_SPI_Wait(&G_LCD_SPI_Request[1]);
+
     P1 &= ~(1<<5);  // Assert P15 (LCD RS)
     
-    SPI_CSI10_Transfer(SPI_CSI10_LCD_CHANNEL, 1, (uint8_t *)&aCommand, &dummyRX, 0);
-    while(SPI_CSI10_IsBusy()); // Wait for transmission end
+    G_LCD_SPI_Command = (uint8_t)aCommand;
+    G_LCD_SPI_CommandRequest.iChannel = SPI_CSI10_LCD_CHANNEL;
+    G_LCD_SPI_CommandRequest.iNumBytes = 1;
+    G_LCD_SPI_CommandRequest.iSendData = &G_LCD_SPI_Command;
+    G_LCD_SPI_CommandRequest.iReceiveData = 0;
+    G_LCD_SPI_CommandRequest.iCallback = 0;
+    SPI_CSI10_Queue(&G_LCD_SPI_CommandRequest);
+    ILCD_SPI_Wait(&G_LCD_SPI_CommandRequest); // Wait for transmission end
     
     P1 |= (1<<5);   // Deassert P15 (LCD RS)
 }
 /******************************************************************************
 * Function Name: LCD_SPI_Open
 * Description : Overwrites the default LCD_SPI_DataSend in the RL78 Glyph 
-* Library. This routine sends a data byte to the LCD along with toggling the LCD
-*   Chip Select Pin.
+* Library. This routine adds a data byte to the batch being filled, which is
+*   queued on the SPI bus when full (or by LCD_SPI_Flush).  The WiFi link
+*   gets the bus ahead of the queued batches.
 ******************************************************************************/
 void LCD_SPI_DataSend(int8_t aData)
 {
-    uint8_t dummyRX;  // No Recieve Data
-    
-    SPI_CSI10_Transfer(SPI_CSI10_LCD_CHANNEL, 1, (uint8_t *)&aData, &dummyRX, 0);
-    while(SPI_CSI10_IsBusy()); // Wait for transmission end
+    /* Starting a batch, the last one sent from it must be gone */
+    if (!G_LCD_SPI_Count)
+        ILCD_SPI_Wait(&G_LCD_SPI_Request[G_LCD_SPI_Fill]);
+
+    G_LCD_SPI_Batch[G_LCD_SPI_Fill][G_LCD_SPI_Count++] = (uint8_t)aData;
+    if (G_LCD_SPI_Count == LCD_SPI_BATCH_SIZE)
+        LCD_SPI_Flush();
+}
+
+/******************************************************************************
+* Function Name: LCD_SPI_DataSendBlock
+* Description : Send a run of LCD data bytes as one SPI transaction, straight
+*   from the caller's buffer, after any bytes batched before them.  Returns
+*   once the bytes are sent so the buffer can be reused.
+******************************************************************************/
+void LCD_SPI_DataSendBlock(const uint8_t *aData, uint16_t aLength)
+{
+    SPI_CSI10_Request *r = &G_LCD_SPI_BlockRequest;
+
+    if (!aLength)
+        return;
+
+    LCD_SPI_Flush();
+
+    r->iChannel = SPI_CSI10_LCD_CHANNEL;
+    r->iNumBytes = aLength;
+    r->iSendData = aData;
+    r->iReceiveData = 0;
+    r->iCallback = 0;
+    SPI_CSI10_Queue(r);
+    ILCD_SPI_Wait(r);
 }
 
 /******************************************************************************
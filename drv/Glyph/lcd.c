@@ -60,16 +60,45 @@
 /* Graphics library support */
 #include "Glyph_API.h"
 #include "Glyph_cfg.h"
+/* Sends the batched LCD bytes */
+#include "Drivers/YRDKRL78_SPI.h"
+/* Page and column addressing of the display */
+#include "Drivers/ST7579_LCD.h"
 
+/******************************************************************************
+Macro definitions
+******************************************************************************/
+/* Text layout: 8 lines, one 8 pixel LCD page each, of 12 8x8 characters */
+#define LCD_NUM_LINES           8
+#define LCD_CHARS_PER_LINE      12
+#define LCD_CHAR_WIDTH          8
+#define LCD_WIDTH               (LCD_CHARS_PER_LINE * LCD_CHAR_WIDTH)
+
+/* ST7579 column of the left edge of the text */
+#ifndef LCD_COLUMN_OFFSET
+#define LCD_COLUMN_OFFSET       0
+#endif
 
 /******************************************************************************
 Private global variables and functions
 ******************************************************************************/
 T_glyphHandle G_lcd ;
 
+/* Shadow of the display kept as text cells (96 bytes instead of a 768 byte
+   framebuffer).  Only cells that change are drawn and sent. */
+static uint8_t G_lcdText[LCD_NUM_LINES][LCD_CHARS_PER_LINE] ;
+/* Changed cells of each line not sent yet, first > last when none */
+static uint8_t G_lcdDirtyFirst[LCD_NUM_LINES] ;
+static uint8_t G_lcdDirtyLast[LCD_NUM_LINES] ;
+/* Pixels of the changed part of one line, sent as one SPI burst */
+static uint8_t G_lcdPage[LCD_WIDTH] ;
+
 /******************************************************************************
 * Local Function Prototypes
 ******************************************************************************/
+static void LCDResetShadow(void);
+static void LCDRenderCell(uint8_t * dest, uint8_t c);
+static void LCDFlush(void);
 
 /******************************************************************************
 * Function name : InitialiseLCD
@@ -85,6 +114,8 @@ void InitialiseLCD(void)
         GlyphNormalScreen(G_lcd) ;
         GlyphSetFont(G_lcd, GLYPH_FONT_8_BY_8_SUBSET) ;
         GlyphClearScreen(G_lcd) ;
+        LCD_SPI_Flush() ;
+        LCDResetShadow() ;
     }
 }
 /******************************************************************************
@@ -100,6 +131,8 @@ void InitialiseLCD(void)
 void ClearLCD(void)
 {
     GlyphClearScreen(G_lcd) ;
+    LCD_SPI_Flush() ;
+    LCDResetShadow() ;
 }
 /******************************************************************************
 * End of function ClearLCD
@@ -113,23 +146,130 @@ void ClearLCD(void)
 *                 position.
 *                 For example, to start at the 4th position on line 1:
 *                     DisplayLCD(LCD_LINE1 + 4, "Hello")
+*                 The rest of the line after the string is cleared.  Only
+*                 the characters that differ from what is already shown are
+*                 sent to the display.
 * Arguments     : uint8_t position - line number of display
 *                 const unit8_t * string - pointer to null terminated string
 * Return Value  : none
 ******************************************************************************/
 void DisplayLCD(uint8_t position, const uint8_t * string)
 {
-    uint8_t y = position - (position % 8);
-    uint8_t xOffset = (position % 8)<<3 ;
+    uint8_t line = position / 8;
+    uint8_t i;
+    uint8_t c;
+    uint8_t * p_text;
 
-    /* Draw text lines, 8 pixels high, 96 pixels wide */
-    /* Clear the rectangle of this line */
-    GlyphEraseBlock(G_lcd, xOffset, y, (95 - xOffset), y+7);
-    GlyphSetXY(G_lcd, xOffset, y);
-    GlyphString(G_lcd, (uint8_t *)string, strlen((void *)string));
+    if (line >= LCD_NUM_LINES)
+        return;
+    p_text = G_lcdText[line];
 
+    /* Text from the start position, then spaces to the end of the line */
+    for (i = position % 8; i < LCD_CHARS_PER_LINE; i++)
+    {
+        c = (*string) ? *string++ : ' ';
+        if (p_text[i] != c)
+        {
+            p_text[i] = c;
+            if (G_lcdDirtyFirst[line] > i)
+                G_lcdDirtyFirst[line] = i;
+            if (G_lcdDirtyLast[line] < i)
+                G_lcdDirtyLast[line] = i;
+        }
+    }
+
+    LCDFlush();
 }
 /******************************************************************************
 * End of function DisplayString
 ******************************************************************************/
 
+/******************************************************************************
+* Function name : LCDResetShadow
+* Description   : Set the text shadow to match a cleared display.
+* Arguments     : none
+* Return Value  : none
+******************************************************************************/
+static void LCDResetShadow(void)
+{
+    memset(G_lcdText, ' ', sizeof(G_lcdText));
+    memset(G_lcdDirtyFirst, LCD_CHARS_PER_LINE, sizeof(G_lcdDirtyFirst));
+    memset(G_lcdDirtyLast, 0, sizeof(G_lcdDirtyLast));
+}
+/******************************************************************************
+* End of function LCDResetShadow
+******************************************************************************/
+
+/******************************************************************************
+* Function name : LCDRenderCell
+* Description   : Draw one character into 8 column bytes of a page (bit 0 is
+*                 the top pixel).  Characters of the 8x8 font are copied
+*                 straight from its page layout table; other codes use the
+*                 bitmap index, and are left blank if not found there.
+* Arguments     : uint8_t * dest - first column byte of the cell
+*                 uint8_t c - character to draw
+* Return Value  : none
+******************************************************************************/
+static void LCDRenderCell(uint8_t * dest, uint8_t c)
+{
+    const uint8_t * p_glyph;
+    uint8_t width = 0;
+
+    if ((c >= FONT8X8_PAGES_FIRST) && (c <= FONT8X8_PAGES_LAST))
+    {
+        memcpy(dest, Font8x8_pages[c - FONT8X8_PAGES_FIRST], LCD_CHAR_WIDTH);
+        return;
+    }
+
+    /* Bitmaps are width, height, then one byte per column */
+    p_glyph = BitmapFind(c);
+    if ((p_glyph) && (p_glyph[1] <= 8))
+    {
+        width = p_glyph[0];
+        if (width > LCD_CHAR_WIDTH)
+            width = LCD_CHAR_WIDTH;
+        memcpy(dest, p_glyph + 2, width);
+    }
+    memset(dest + width, 0, LCD_CHAR_WIDTH - width);
+}
+/******************************************************************************
+* End of function LCDRenderCell
+******************************************************************************/
+
+/******************************************************************************
+* Function name : LCDFlush
+* Description   : Send the changed cells of each line to the display, one
+*                 SPI burst per line from the first to the last changed cell.
+* Arguments     : none
+* Return Value  : none
+******************************************************************************/
+static void LCDFlush(void)
+{
+    uint8_t line;
+    uint8_t first;
+    uint8_t last;
+    uint8_t i;
+
+    for (line = 0; line < LCD_NUM_LINES; line++)
+    {
+        first = G_lcdDirtyFirst[line];
+        last = G_lcdDirtyLast[line];
+        if (first > last)
+            continue;
+
+        for (i = first; i <= last; i++)
+            LCDRenderCell(G_lcdPage + (i - first) * LCD_CHAR_WIDTH,
+                G_lcdText[line][i]);
+
+        ST7579_SetPage(G_lcd, line);
+        ST7579_SetChar(G_lcd, LCD_COLUMN_OFFSET + first * LCD_CHAR_WIDTH);
+        LCD_SPI_DataSendBlock(G_lcdPage,
+            (last - first + 1) * LCD_CHAR_WIDTH);
+
+        G_lcdDirtyFirst[line] = LCD_CHARS_PER_LINE;
+        G_lcdDirtyLast[line] = 0;
+    }
+}
+/******************************************************************************
+* End of function LCDFlush
+******************************************************************************/
@@ -66,16 +66,32 @@
 /*-------------------------------------------------------------------------*
  * Globals:
  *-------------------------------------------------------------------------*/
-static bool G_SPI_CSI10_IsBusy;
+static volatile bool G_SPI_CSI10_IsBusy;
 static const uint8_t *G_SPI_CSI10_SendBuffer;
 static uint8_t *G_SPI_CSI10_ReceiveBuffer;
-static uint32_t G_SPI_CSI10_SendIndex;
 static uint32_t G_SPI_CSI10_SendLength;
-static uint32_t G_SPI_CSI10_ReceiveIndex;
 static uint8_t G_SPI_CSI10_Channel;
+static bool G_SPI_CSI10_IsCSPerByte;
 static void (*G_SPI_CSI10_Callback)(void);
 static uint8_t G_SPI_CSI10_OverrunErrorCount;
 
+/* Queued transactions per channel, and the one being transferred (0 if */
+/* the transfer came from SPI_CSI10_Transfer) */
+static SPI_CSI10_Request *G_SPI_CSI10_QueueHead[SPI_CSI10_NUM_CHANNELS];
+static SPI_CSI10_Request *G_SPI_CSI10_QueueTail[SPI_CSI10_NUM_CHANNELS];
+static SPI_CSI10_Request *G_SPI_CSI10_Current;
+
+/* Order the channels get the bus in (lowest first), and the clock */
+/* divider of each channel, applied when its transfer starts */
+static uint8_t G_SPI_CSI10_Priority[SPI_CSI10_NUM_CHANNELS];
+static uint8_t G_SPI_CSI10_Divider[SPI_CSI10_NUM_CHANNELS];
+static uint8_t G_SPI_CSI10_ActiveDivider;
+
+/* Channels turned away by SPI_CSI10_Transfer (one bit per channel) and */
+/* the routines to call for them when the bus is free again */
+static volatile uint8_t G_SPI_CSI10_Waiting;
+static void (*G_SPI_CSI10_BusFreeHandler[SPI_CSI10_NUM_CHANNELS])(void);
+
 /* CPI Chip Select Polarity Array - indexed by channel #
    Set in SPI_CSI10_SetupChannel(..) */
 bool G_SPI_CSI10_CSActiveHigh[SPI_CSI10_NUM_CHANNELS];
@@ -181,6 +197,86 @@ void SPI_CSI10_SetBitRate(uint32_t bitsPerSecond)
     }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  ISPI_CSI10_Divider
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Work out the CSI10 clock divider for a bit rate.  The SAU0 clock
+ *      select is left as it is (the other SAU0 channels use it too).
+ * Inputs:
+ *      uint32_t bitsPerSecond -- bits per second clock rate (Hz)
+ * Outputs:
+ *      uint8_t -- Divider for SDR02 bits 15:9
+ *---------------------------------------------------------------------------*/
+static uint8_t ISPI_CSI10_Divider(uint32_t bitsPerSecond)
+{
+    uint32_t baud_devisor;
+
+    /* CSI10 runs off CK01, SPS0 bits 7:4 */
+    baud_devisor = ((RL78_MAIN_SYSTEM_CLOCK >> ((SPS0 >> 4) & 0xF))
+            / bitsPerSecond / 2);
+    if (baud_devisor)
+        baud_devisor--;
+    if (baud_devisor > 127)
+        baud_devisor = 127;
+
+    return (uint8_t)baud_devisor;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_ChannelSetBitRate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the bit rate of one channel.  It is put in place each time a
+ *      transfer on the channel starts, so channels can run at different
+ *      rates.  Channels use the SPI_CSI10_Init rate until set.
+ * Inputs:
+ *      uint8_t channel -- Channel for the RDK peripheral
+ *      uint32_t bitsPerSecond -- bits per second clock rate (Hz)
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void SPI_CSI10_ChannelSetBitRate(uint8_t channel, uint32_t bitsPerSecond)
+{
+    G_SPI_CSI10_Divider[channel] = ISPI_CSI10_Divider(bitsPerSecond);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_ChannelSetPriority
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set which channel gets the bus first when several are waiting.
+ *      Lower values go first; equal values go by channel number.
+ * Inputs:
+ *      uint8_t channel -- Channel for the RDK peripheral
+ *      uint8_t priority -- SPI_CSI10_PRIORITY_HIGH (0) to
+ *          SPI_CSI10_PRIORITY_LOW (255)
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void SPI_CSI10_ChannelSetPriority(uint8_t channel, uint8_t priority)
+{
+    G_SPI_CSI10_Priority[channel] = priority;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_ChannelSetBusFreeHandler
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set a routine to call (at interrupt level) when the bus is free
+ *      again after SPI_CSI10_Transfer turned the channel away, so it can
+ *      start its transfer then.
+ * Inputs:
+ *      uint8_t channel -- Channel for the RDK peripheral
+ *      void (*handler)(void) -- Routine to call, or 0 for none
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void SPI_CSI10_ChannelSetBusFreeHandler(uint8_t channel, void (*handler)(void))
+{
+    G_SPI_CSI10_BusFreeHandler[channel] = handler;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  SPI_CSI10_Init
  *---------------------------------------------------------------------------*
@@ -194,6 +290,8 @@ void SPI_CSI10_SetBitRate(uint32_t bitsPerSecond)
  *---------------------------------------------------------------------------*/
 void SPI_CSI10_Init(uint32_t bitsPerSecond)
 {
+    uint8_t i;
+
     G_SPI_CSI10_IsBusy = false;
 
     SAU0EN = 1U;    /* supply SAU0 clock */
@@ -218,6 +316,14 @@ void SPI_CSI10_Init(uint32_t bitsPerSecond)
 	SOE0 |= _SAU_CH2_OUTPUT_ENABLE;	 /* enable CSI10 output */
     
     SPI_CSI10_SetBitRate(bitsPerSecond);
+    G_SPI_CSI10_ActiveDivider = (uint8_t)(SDR02 >> 9);
+    for (i = 0; i < SPI_CSI10_NUM_CHANNELS; i++) {
+        G_SPI_CSI10_Divider[i] = G_SPI_CSI10_ActiveDivider;
+        G_SPI_CSI10_Priority[i] = SPI_CSI10_PRIORITY_NORMAL;
+        G_SPI_CSI10_QueueHead[i] = G_SPI_CSI10_QueueTail[i] = 0;
+    }
+    G_SPI_CSI10_Current = 0;
+    G_SPI_CSI10_Waiting = 0;
     
     /* Set SI10 pin */
 	PMC0 &= 0xF7U;
@@ -308,54 +414,178 @@ void SPI_CSI10_ChannelSetup(uint8_t channel, bool csActiveHigh, bool csActivePer
 }
 
 /*---------------------------------------------------------------------------*
- * Routine:  SPI_CSI10_Transfer
+ * Routine:  ISPI_CSI10_Start
  *---------------------------------------------------------------------------*
  * Description:
- *      Attempt to transfer an array of bytes over the SPI channel given.
- *      When complete, the given callback routine is called.
+ *      Start a transfer on a bus already claimed.  The channel's clock
+ *      divider is put in place if another channel used a different one.
+ *      Called with interrupts disabled.
  * Inputs:
  *      uint8_t channel -- Channel for the RDK peripheral
  *      uint32_t numBytes -- Number of bytes to transfer
  *      const uint8_t *send_buffer -- Pointer to bytes to send
- *      uint8_t *receive_buffer -- Pointer to buffer to receive SPI bytes.
- *          Can be the same location as the send_buffer.
- *      void (*callback)(void) -- Callback function to call when complete.
+ *      uint8_t *receive_buffer -- Pointer to buffer to receive SPI bytes,
+ *          or 0 to throw them away.
  * Outputs:
- *      bool -- true if successfully started, else false (busy).
+ *      void
  *---------------------------------------------------------------------------*/
-bool SPI_CSI10_Transfer(
+static void ISPI_CSI10_Start(
         uint8_t channel,
         uint32_t numBytes,
         const uint8_t *send_buffer,
-        uint8_t *receive_buffer,
-        void(*callback)(void))
+        uint8_t *receive_buffer)
 {
-    if (G_SPI_CSI10_IsBusy)
-        return false;
-    
-    G_SPI_CSI10_IsBusy = true;
+    if (G_SPI_CSI10_Divider[channel] != G_SPI_CSI10_ActiveDivider) {
+        /* The divider can only change with the channel stopped */
+        ST0 |= _SAU_CH2_STOP_TRG_ON;
+        SDR02 = (uint16_t)G_SPI_CSI10_Divider[channel] << 9;
+        SS0 |= _SAU_CH2_START_TRG_ON;
+        G_SPI_CSI10_ActiveDivider = G_SPI_CSI10_Divider[channel];
+    }
 
     G_SPI_CSI10_SendBuffer = send_buffer;
     G_SPI_CSI10_ReceiveBuffer = receive_buffer;
-    G_SPI_CSI10_Callback = callback;
-    G_SPI_CSI10_SendIndex = 0;
-    G_SPI_CSI10_ReceiveIndex = 0;
     G_SPI_CSI10_SendLength = numBytes;
     G_SPI_CSI10_Channel = channel;
+    G_SPI_CSI10_IsCSPerByte = G_SPI_CSI10_CSActivePerByte[channel];
     
     SPI_CSI10_DisableInterrupts();
     
     SPI_CSI10_CS_Assert(G_SPI_CSI10_Channel);
     
     /* started by writing data to SDR[7:0] */
-    SIO10 = G_SPI_CSI10_SendBuffer[G_SPI_CSI10_SendIndex++];
+    SIO10 = *G_SPI_CSI10_SendBuffer++;
     G_SPI_CSI10_SendLength--;
     
     SPI_CSI10_EnableInterrupts();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ISPI_CSI10_Schedule
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Hand the free bus to the highest priority channel that wants it.
+ *      A channel turned away by SPI_CSI10_Transfer has its bus free
+ *      handler called; otherwise the first queued transaction of the
+ *      channel is started.  Called with interrupts disabled.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ISPI_CSI10_Schedule(void)
+{
+    uint8_t channel;
+    uint8_t best;
+    SPI_CSI10_Request *r;
+
+    while (!G_SPI_CSI10_IsBusy) {
+        /* Find the channel to serve next */
+        best = SPI_CSI10_NUM_CHANNELS;
+        for (channel = 0; channel < SPI_CSI10_NUM_CHANNELS; channel++) {
+            if ((!(G_SPI_CSI10_Waiting & (1 << channel)))
+                    && (!G_SPI_CSI10_QueueHead[channel]))
+                continue;
+            if ((best == SPI_CSI10_NUM_CHANNELS)
+                    || (G_SPI_CSI10_Priority[channel]
+                            < G_SPI_CSI10_Priority[best]))
+                best = channel;
+        }
+        if (best == SPI_CSI10_NUM_CHANNELS)
+            return;
+
+        if (G_SPI_CSI10_Waiting & (1 << best)) {
+            /* Let it start its own transfer (it may have nothing to do) */
+            G_SPI_CSI10_Waiting &= ~(1 << best);
+            if (G_SPI_CSI10_BusFreeHandler[best])
+                G_SPI_CSI10_BusFreeHandler[best]();
+        } else {
+            r = G_SPI_CSI10_QueueHead[best];
+            G_SPI_CSI10_IsBusy = true;
+            G_SPI_CSI10_Current = r;
+            G_SPI_CSI10_Callback = 0;
+            ISPI_CSI10_Start(best, r->iNumBytes, r->iSendData,
+                    r->iReceiveData);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_Transfer
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Attempt to transfer an array of bytes over the SPI channel given.
+ *      When complete, the given callback routine is called.  If the bus
+ *      is in use, the channel is noted so its bus free handler is called
+ *      when its turn comes.
+ * Inputs:
+ *      uint8_t channel -- Channel for the RDK peripheral
+ *      uint32_t numBytes -- Number of bytes to transfer
+ *      const uint8_t *send_buffer -- Pointer to bytes to send
+ *      uint8_t *receive_buffer -- Pointer to buffer to receive SPI bytes.
+ *          Can be the same location as the send_buffer, or 0.
+ *      void (*callback)(void) -- Callback function to call when complete.
+ * Outputs:
+ *      bool -- true if successfully started, else false (busy).
+ *---------------------------------------------------------------------------*/
+bool SPI_CSI10_Transfer(
+        uint8_t channel,
+        uint32_t numBytes,
+        const uint8_t *send_buffer,
+        uint8_t *receive_buffer,
+        void(*callback)(void))
+{
+    __istate_t state = __get_interrupt_state();
+
+    /* Claim the bus with interrupts off, transfers are also started */
+    /* from interrupt routines */
+    DI();
+    if (G_SPI_CSI10_IsBusy) {
+        G_SPI_CSI10_Waiting |= (1 << channel);
+        __set_interrupt_state(state);
+        return false;
+    }
+    G_SPI_CSI10_IsBusy = true;
+    G_SPI_CSI10_Current = 0;
+    G_SPI_CSI10_Callback = callback;
+    ISPI_CSI10_Start(channel, numBytes, send_buffer, receive_buffer);
+    __set_interrupt_state(state);
     
     return true;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_Queue
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Add a transaction to the end of its channel's queue.  It is sent
+ *      when the bus is free and no higher priority channel wants it.
+ *      iIsDone is set (and iCallback called at interrupt level) when the
+ *      transaction is complete.  The request must stay in place until
+ *      then.
+ * Inputs:
+ *      SPI_CSI10_Request *aRequest -- Transaction to send
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void SPI_CSI10_Queue(SPI_CSI10_Request *aRequest)
+{
+    __istate_t state = __get_interrupt_state();
+    uint8_t channel = aRequest->iChannel;
+
+    aRequest->iNext = 0;
+    aRequest->iIsDone = false;
+
+    DI();
+    if (G_SPI_CSI10_QueueTail[channel])
+        G_SPI_CSI10_QueueTail[channel]->iNext = aRequest;
+    else
+        G_SPI_CSI10_QueueHead[channel] = aRequest;
+    G_SPI_CSI10_QueueTail[channel] = aRequest;
+    ISPI_CSI10_Schedule();
+    __set_interrupt_state(state);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  SPI_CSI10_IsBusy
  *---------------------------------------------------------------------------*
@@ -376,12 +606,34 @@ bool SPI_CSI10_IsBusy(void)
     return G_SPI_CSI10_IsBusy;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  SPI_CSI10_GetOverrunErrorCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of receive overrun errors seen (a byte came in
+ *      before the last one was read).  Rolls over at 255.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint8_t -- Number of overrun errors
+ *---------------------------------------------------------------------------*/
+uint8_t SPI_CSI10_GetOverrunErrorCount(void)
+{
+    return G_SPI_CSI10_OverrunErrorCount;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  SPI_CSI10_ISRHandler
  *---------------------------------------------------------------------------*
  * Description:
  *      Interrupt service routine for completed receptions (occurs after
- *      transmits).  Bytes are put in the receive buffer as they come in.
+ *      transmits).  Bytes are put in the receive buffer as they come in
+ *      and the next byte is sent right away.  At the end of a transfer
+ *      the bus goes to the next channel waiting for it.  The chip select is only
+ *      toggled between bytes on channels set up active per byte;
+ *      otherwise it stays asserted for the whole transfer.
+ *      An overrun error is counted but the transfer carries on, so it
+ *      always completes.
  * Inputs:
  *      void
  * Outputs:
@@ -391,38 +643,56 @@ bool SPI_CSI10_IsBusy(void)
 __interrupt static void SPI_CSI10_ISRHandler(void)
 {
     uint8_t err_type;
+    uint8_t c;
+    SPI_CSI10_Request *r;
 
     err_type = (uint8_t)(SSR02 & _SAU_OVERRUN_ERROR);
-    SIR02 = (uint16_t)err_type;
-
-    SPI_CSI10_CS_Clear(G_SPI_CSI10_Channel);
-    
-    if (1U == err_type) {
+    if (err_type) {
         /* overrun error occurs */
+        SIR02 = (uint16_t)err_type;
         G_SPI_CSI10_OverrunErrorCount++;
     }
-    else {
-      
-        /* Receive a character */
-        G_SPI_CSI10_ReceiveBuffer[G_SPI_CSI10_ReceiveIndex++] = SIO10;
-    
-        /* Is there more data to send? */
-        if (G_SPI_CSI10_SendLength > 0) {
-           
-            /* Send the next character */
+
+    /* Receive a character */
+    c = SIO10;
+    if (G_SPI_CSI10_ReceiveBuffer)
+        *G_SPI_CSI10_ReceiveBuffer++ = c;
+
+    /* Is there more data to send? */
+    if (G_SPI_CSI10_SendLength) {
+        G_SPI_CSI10_SendLength--;
+        if (G_SPI_CSI10_IsCSPerByte) {
+            SPI_CSI10_CS_Clear(G_SPI_CSI10_Channel);
             SPI_CSI10_CS_Assert(G_SPI_CSI10_Channel);
-            SIO10 = G_SPI_CSI10_SendBuffer[G_SPI_CSI10_SendIndex++];
-            G_SPI_CSI10_SendLength--;
         }
-        else {
-            /* Data transfer complete */
-            SPI_CSI10_CS_Clear(G_SPI_CSI10_Channel);
-            
-            if (G_SPI_CSI10_Callback)
-                G_SPI_CSI10_Callback();
-            
-            G_SPI_CSI10_IsBusy = false;
+
+        /* Send the next character */
+        SIO10 = *G_SPI_CSI10_SendBuffer++;
+    }
+    else {
+        /* Data transfer complete */
+        SPI_CSI10_CS_Clear(G_SPI_CSI10_Channel);
+        
+        /* Free the bus first so the callback can start the next */
+        /* transfer */
+        G_SPI_CSI10_IsBusy = false;
+        
+        r = G_SPI_CSI10_Current;
+        if (r) {
+            /* Queued transaction done, take it off its queue */
+            G_SPI_CSI10_Current = 0;
+            G_SPI_CSI10_QueueHead[G_SPI_CSI10_Channel] = r->iNext;
+            if (!r->iNext)
+                G_SPI_CSI10_QueueTail[G_SPI_CSI10_Channel] = 0;
+            r->iIsDone = true;
+            if (r->iCallback)
+                r->iCallback(r);
+        } else if (G_SPI_CSI10_Callback) {
+            G_SPI_CSI10_Callback();
         }
+        
+        /* Bus still free?  Give it to whoever is waiting */
+        ISPI_CSI10_Schedule();
     }
 }
 
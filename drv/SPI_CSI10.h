@@ -24,6 +24,25 @@
 #define SPI_CSI10_PMOD1_CHANNEL         3
 #define SPI_CSI10_PMOD2_CHANNEL         4
 
+/* Channel priorities (lower goes first) */
+#define SPI_CSI10_PRIORITY_HIGH         0
+#define SPI_CSI10_PRIORITY_NORMAL       128
+#define SPI_CSI10_PRIORITY_LOW          255
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Transaction for SPI_CSI10_Queue */
+typedef struct SPI_CSI10_Request_ {
+    struct SPI_CSI10_Request_ *iNext;   /* Used by the queue */
+    uint8_t iChannel;
+    uint32_t iNumBytes;
+    const uint8_t *iSendData;
+    uint8_t *iReceiveData;              /* 0 to throw away */
+    void (*iCallback)(struct SPI_CSI10_Request_ *aRequest);
+    volatile bool iIsDone;
+} SPI_CSI10_Request;
+
 /*-------------------------------------------------------------------------*
  * Prototypes:
  *-------------------------------------------------------------------------*/
@@ -32,13 +51,18 @@ void SPI_CSI10_ChannelSetup(
         uint8_t channel,
         bool csActiveHigh,
         bool csActivePerByte);
+void SPI_CSI10_ChannelSetBitRate(uint8_t channel, uint32_t bitsPerSecond);
+void SPI_CSI10_ChannelSetPriority(uint8_t channel, uint8_t priority);
+void SPI_CSI10_ChannelSetBusFreeHandler(uint8_t channel, void (*handler)(void));
 bool SPI_CSI10_Transfer(
         uint8_t channel,
         uint32_t numBytes,
         const uint8_t *send_buffer,
         uint8_t *receive_buffer,
         void(*callback)(void));
+void SPI_CSI10_Queue(SPI_CSI10_Request *aRequest);
 bool SPI_CSI10_IsBusy(void);
+uint8_t SPI_CSI10_GetOverrunErrorCount(void);
 void SPI_CSI10_DisableInterrupts(void);
 void SPI_CSI10_EnableInterrupts(void);
 
@@ -0,0 +1,489 @@
+/*-------------------------------------------------------------------------*
+ * File:  Transport.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Run time selectable byte link to the GainSpan module.  Each
+ *     transport is a table of routines (TRANSPORT_T); the Transport_*
+ *     routines call the ones of the selected transport and count the
+ *     bytes going through.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <HostApp.h>
+#include <drv/GainSpan_SPI.h>
+#include <drv/SPI_CSI10.h>
+#include <drv/UART2.h>
+#include "Transport.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef TRANSPORT_LOOPBACK_SIZE
+#define TRANSPORT_LOOPBACK_SIZE     128
+#endif
+
+#if (TRANSPORT_LOOPBACK_SIZE & (TRANSPORT_LOOPBACK_SIZE - 1))
+#error "TRANSPORT_LOOPBACK_SIZE must be a power of two"
+#endif
+#define TRANSPORT_LOOPBACK_MASK     (TRANSPORT_LOOPBACK_SIZE - 1)
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static bool ITransport_SPIFlush(void);
+static void ITransport_SPIGetStats(TRANSPORT_STATS_T *aStats);
+static void ITransport_UART2Start(void);
+static void ITransport_UART2Poll(void);
+static void ITransport_UART2GetStats(TRANSPORT_STATS_T *aStats);
+static void ITransport_LoopbackStart(void);
+static void ITransport_LoopbackStop(void);
+static uint32_t ITransport_LoopbackWrite(const uint8_t *aData, uint32_t aLen);
+static uint32_t ITransport_LoopbackRead(uint8_t *aData, uint32_t aMaxLen);
+static void ITransport_LoopbackPoll(void);
+static bool ITransport_LoopbackFlush(void);
+static void ITransport_LoopbackGetStats(TRANSPORT_STATS_T *aStats);
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* In the order of TRANSPORT_ID_E */
+static const TRANSPORT_T G_Transport_List[TRANSPORT_NUM] = {
+    {
+        "SPI",
+        GainSpan_SPI_Start,
+        GainSpan_SPI_Stop,
+        GainSpan_SPI_SendData,
+        GainSpan_SPI_ReceiveData,
+        GainSpan_SPI_Update,
+        ITransport_SPIFlush,
+        ITransport_SPIGetStats
+    },
+    {
+        "UART2",
+        ITransport_UART2Start,
+        UART2_Stop,
+        UART2_SendData,
+        UART2_ReceiveData,
+        ITransport_UART2Poll,
+        UART2_IsTransmitEmpty,
+        ITransport_UART2GetStats
+    },
+    {
+        "Loopback",
+        ITransport_LoopbackStart,
+        ITransport_LoopbackStop,
+        ITransport_LoopbackWrite,
+        ITransport_LoopbackRead,
+        ITransport_LoopbackPoll,
+        ITransport_LoopbackFlush,
+        ITransport_LoopbackGetStats
+    },
+#ifndef __IAR_SYSTEMS_ICC__
+    {
+        "PTY",
+        Host_Pty_Start,
+        Host_Pty_Stop,
+        Host_Pty_Write,
+        Host_Pty_Read,
+        Host_Pty_Poll,
+        Host_Pty_Flush,
+        Host_Pty_GetStats
+    },
+#endif
+};
+
+/* SPI is the transport until Transport_Select is called (main starts */
+/* its driver with GainSpan_SPI_Start) */
+static TRANSPORT_ID_E G_Transport_Selected = TRANSPORT_SPI;
+static const TRANSPORT_T *G_Transport = &G_Transport_List[TRANSPORT_SPI];
+
+static TRANSPORT_STATS_T G_Transport_Stats;
+/* Transport counters at the last Transport_ClearStats */
+static TRANSPORT_STATS_T G_Transport_StatsBase;
+
+/* Bytes written to the loopback transport, waiting to be read back */
+static uint8_t G_Transport_LoopBuffer[TRANSPORT_LOOPBACK_SIZE];
+static uint16_t G_Transport_LoopIn;
+static uint16_t G_Transport_LoopOut;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_Select
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Stop the current transport and start the given one.  Counters are
+ *      cleared.  Bytes not yet sent or read on the old transport are lost.
+ * Inputs:
+ *      TRANSPORT_ID_E aID -- Transport to use from now on
+ * Outputs:
+ *      bool -- true if selected, false if aID is not a transport
+ *---------------------------------------------------------------------------*/
+bool Transport_Select(TRANSPORT_ID_E aID)
+{
+    if (aID >= TRANSPORT_NUM)
+        return false;
+
+    G_Transport->iStop();
+    G_Transport_Selected = aID;
+    G_Transport = &G_Transport_List[aID];
+    G_Transport->iStart();
+    Transport_ClearStats();
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_GetSelected
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine which transport is in use.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      TRANSPORT_ID_E -- Selected transport
+ *---------------------------------------------------------------------------*/
+TRANSPORT_ID_E Transport_GetSelected(void)
+{
+    return G_Transport_Selected;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_GetName
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the name of the selected transport (e.g. for the LCD).
+ * Inputs:
+ *      void
+ * Outputs:
+ *      const char * -- Name
+ *---------------------------------------------------------------------------*/
+const char *Transport_GetName(void)
+{
+    return G_Transport->iName;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_Write
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue as many bytes to send as the selected transport can take.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to send
+ *      uint32_t aLen -- Number of bytes to send
+ * Outputs:
+ *      uint32_t -- Number of bytes taken
+ *---------------------------------------------------------------------------*/
+uint32_t Transport_Write(const uint8_t *aData, uint32_t aLen)
+{
+    uint32_t count = G_Transport->iWrite(aData, aLen);
+
+    G_Transport_Stats.iBytesWritten += count;
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_Read
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the bytes that have already arrived on the selected transport.
+ *      Never waits.
+ * Inputs:
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t Transport_Read(uint8_t *aData, uint32_t aMaxLen)
+{
+    uint32_t count = G_Transport->iRead(aData, aMaxLen);
+
+    G_Transport_Stats.iBytesRead += count;
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_Poll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Keep the transfers of the selected transport going.  Call while
+ *      waiting to send or receive.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Transport_Poll(void)
+{
+    G_Transport->iPoll();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_Flush
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Push out the queued bytes.  Never waits; call until it returns
+ *      true.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if all written bytes have gone and the link is ready
+ *          for more, else false.
+ *---------------------------------------------------------------------------*/
+bool Transport_Flush(void)
+{
+    return G_Transport->iFlush();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_GetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the counters of the selected transport since it was selected
+ *      or Transport_ClearStats was last called.
+ * Inputs:
+ *      TRANSPORT_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Transport_GetStats(TRANSPORT_STATS_T *aStats)
+{
+    G_Transport->iGetStats(aStats);
+    aStats->iBytesDropped -= G_Transport_StatsBase.iBytesDropped;
+    aStats->iErrors -= G_Transport_StatsBase.iErrors;
+    aStats->iBytesWritten = G_Transport_Stats.iBytesWritten;
+    aStats->iBytesRead = G_Transport_Stats.iBytesRead;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Transport_ClearStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Reset the counters of the selected transport.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Transport_ClearStats(void)
+{
+    memset(&G_Transport_Stats, 0, sizeof(G_Transport_Stats));
+    G_Transport->iGetStats(&G_Transport_StatsBase);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_SPIFlush
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Keep the SPI transfer going and check that the transmit FIFO is
+ *      empty and the module is not holding us off with XOFF.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if flushed, else false
+ *---------------------------------------------------------------------------*/
+static bool ITransport_SPIFlush(void)
+{
+    GainSpan_SPI_Update();
+    return ((GainSpan_SPI_IsTransmitEmpty()) && (!GainSpan_SPI_IsFlowOff()));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_SPIGetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Fill in the error counters of the SPI transport.
+ * Inputs:
+ *      TRANSPORT_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_SPIGetStats(TRANSPORT_STATS_T *aStats)
+{
+    GAINSPAN_SPI_STATS_T stats;
+
+    GainSpan_SPI_GetStats(&stats);
+    aStats->iBytesDropped = stats.iBytesDropped;
+    aStats->iErrors = SPI_CSI10_GetOverrunErrorCount();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_UART2Start
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start UART2 at the module's baud rate.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_UART2Start(void)
+{
+    UART2_Start(UART2_BAUD_RATE);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_UART2Poll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Nothing to do, UART2 sends and receives from its interrupts.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_UART2Poll(void)
+{
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_UART2GetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Fill in the error counters of the UART2 transport.
+ * Inputs:
+ *      TRANSPORT_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_UART2GetStats(TRANSPORT_STATS_T *aStats)
+{
+    aStats->iBytesDropped = UART2_GetOverflowCount();
+    aStats->iErrors = UART2_GetErrorCount();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackStart
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Empty the loopback buffer.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_LoopbackStart(void)
+{
+    G_Transport_LoopIn = G_Transport_LoopOut = 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackStop
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Nothing to stop for the loopback transport.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_LoopbackStop(void)
+{
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackWrite
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put as many bytes as fit in the loopback buffer, to be read back.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to send
+ *      uint32_t aLen -- Number of bytes to send
+ * Outputs:
+ *      uint32_t -- Number of bytes taken
+ *---------------------------------------------------------------------------*/
+static uint32_t ITransport_LoopbackWrite(const uint8_t *aData, uint32_t aLen)
+{
+    uint32_t count = 0;
+    uint32_t space;
+
+    /* One slot always stays empty to tell full from empty */
+    space = (G_Transport_LoopOut - G_Transport_LoopIn - 1)
+            & TRANSPORT_LOOPBACK_MASK;
+    if (aLen > space)
+        aLen = space;
+
+    while (count < aLen) {
+        G_Transport_LoopBuffer[G_Transport_LoopIn] = aData[count++];
+        G_Transport_LoopIn = (G_Transport_LoopIn + 1) & TRANSPORT_LOOPBACK_MASK;
+    }
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackRead
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take bytes written to the loopback transport back out.
+ * Inputs:
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+static uint32_t ITransport_LoopbackRead(uint8_t *aData, uint32_t aMaxLen)
+{
+    uint32_t count = 0;
+
+    while ((count < aMaxLen) && (G_Transport_LoopOut != G_Transport_LoopIn)) {
+        aData[count++] = G_Transport_LoopBuffer[G_Transport_LoopOut];
+        G_Transport_LoopOut = (G_Transport_LoopOut + 1) & TRANSPORT_LOOPBACK_MASK;
+    }
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackPoll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Nothing to do, written bytes are readable right away.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_LoopbackPoll(void)
+{
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackFlush
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Written bytes are delivered at once, so always flushed.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- Always true
+ *---------------------------------------------------------------------------*/
+static bool ITransport_LoopbackFlush(void)
+{
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITransport_LoopbackGetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The loopback transport never loses bytes or has errors.
+ * Inputs:
+ *      TRANSPORT_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ITransport_LoopbackGetStats(TRANSPORT_STATS_T *aStats)
+{
+    aStats->iBytesDropped = 0;
+    aStats->iErrors = 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  Transport.c
+ *-------------------------------------------------------------------------*/
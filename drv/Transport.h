@@ -0,0 +1,86 @@
+/*-------------------------------------------------------------------------*
+ * File:  Transport.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Byte link to the GainSpan module, selectable at run time.  The
+ *     App_Write/App_Read callbacks of the AT command library go through
+ *     the selected transport: the GainSpan SPI driver, UART2, or a
+ *     loopback that hands written bytes back as received bytes (to run
+ *     and time the stack with no module attached).  The PC build (see
+ *     host/) adds a pseudo terminal to a simulated module.
+ *-------------------------------------------------------------------------*/
+#ifndef _TRANSPORT_H
+#define _TRANSPORT_H
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef enum {
+    TRANSPORT_SPI,
+    TRANSPORT_UART2,
+    TRANSPORT_LOOPBACK,
+#ifndef __IAR_SYSTEMS_ICC__
+    TRANSPORT_PTY,
+#endif
+    TRANSPORT_NUM
+} TRANSPORT_ID_E;
+
+/* Counters of the selected transport, see Transport_GetStats */
+typedef struct {
+    uint32_t iBytesWritten;     /* Bytes taken by Transport_Write */
+    uint32_t iBytesRead;        /* Bytes returned by Transport_Read */
+    uint32_t iBytesDropped;     /* Bytes received but lost, buffer full */
+    uint32_t iErrors;           /* Link errors (framing, overrun, ...) */
+} TRANSPORT_STATS_T;
+
+/* Routines of one transport */
+typedef struct {
+    const char *iName;
+    void (*iStart)(void);
+    void (*iStop)(void);
+    /* Queue as many bytes as fit, return the number taken */
+    uint32_t (*iWrite)(const uint8_t *aData, uint32_t aLen);
+    /* Return the bytes that have arrived, never waits */
+    uint32_t (*iRead)(uint8_t *aData, uint32_t aMaxLen);
+    /* Keep transfers going (called while waiting) */
+    void (*iPoll)(void);
+    /* Push out queued bytes, true once all have gone */
+    bool (*iFlush)(void);
+    /* Fill in iBytesDropped and iErrors */
+    void (*iGetStats)(TRANSPORT_STATS_T *aStats);
+} TRANSPORT_T;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+bool Transport_Select(TRANSPORT_ID_E aID);
+TRANSPORT_ID_E Transport_GetSelected(void);
+const char *Transport_GetName(void);
+uint32_t Transport_Write(const uint8_t *aData, uint32_t aLen);
+uint32_t Transport_Read(uint8_t *aData, uint32_t aMaxLen);
+void Transport_Poll(void);
+bool Transport_Flush(void);
+void Transport_GetStats(TRANSPORT_STATS_T *aStats);
+void Transport_ClearStats(void);
+
+#ifndef __IAR_SYSTEMS_ICC__
+/* Routines of the pseudo terminal transport, in host/host_pty.c */
+void Host_Pty_Start(void);
+void Host_Pty_Stop(void);
+uint32_t Host_Pty_Write(const uint8_t *aData, uint32_t aLen);
+uint32_t Host_Pty_Read(uint8_t *aData, uint32_t aMaxLen);
+void Host_Pty_Poll(void);
+bool Host_Pty_Flush(void);
+void Host_Pty_GetStats(TRANSPORT_STATS_T *aStats);
+#endif
+
+#endif // _TRANSPORT_H
+/*-------------------------------------------------------------------------*
+ * End of File:  Transport.h
+ *-------------------------------------------------------------------------*/
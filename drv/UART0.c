@@ -45,6 +45,9 @@ static uint16_t G_UART0_TXIn = 0;
 static uint16_t G_UART0_TXOut = 0;
 static volatile bool G_UART0_TX_Empty;
 
+/* Routine giving more bytes to send once the transmit FIFO is empty */
+static bool (*G_UART0_TXSource)(uint8_t *aByte) = 0;
+
 static volatile T_SAUStatusError G_UART0_LastError = NONE;
 static uint16_t G_UART0_ErrorCount = 0;
 
@@ -341,6 +344,51 @@ bool UART0_IsTransmitEmpty(void)
     return G_UART0_TX_Empty;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  UART0_SetTransmitSource
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set a routine that the transmit interrupt asks for more bytes
+ *      when the transmit FIFO is empty (e.g. a log buffer being drained
+ *      in the background).  The routine is called at interrupt level.
+ * Inputs:
+ *      bool (*aSource)(uint8_t *aByte) -- Routine that stores the next
+ *          byte and returns true, or returns false if it has none.  0
+ *          for no source.
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void UART0_SetTransmitSource(bool (*aSource)(uint8_t *aByte))
+{
+    STMK0 = 1U;
+    G_UART0_TXSource = aSource;
+    STMK0 = 0U;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  UART0_TransmitKick
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start sending from the transmit source if the UART is idle.  Call
+ *      after giving the source new bytes.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void UART0_TransmitKick(void)
+{
+    uint8_t c;
+
+    /* Disable transmit interrupts while touching the transmit state */
+    STMK0 = 1U;
+    if ((G_UART0_TX_Empty) && (G_UART0_TXSource) && (G_UART0_TXSource(&c))) {
+        G_UART0_TX_Empty = false;
+        TXD0 = c;
+    }
+    STMK0 = 0U;
+}
+
 /*---------------------------------------------------------------------------*
  * Interrupt Routine:  UART0_TX_ISRHandler
  *---------------------------------------------------------------------------*
@@ -355,11 +403,16 @@ bool UART0_IsTransmitEmpty(void)
 #pragma vector = INTST0_vect
 __interrupt void UART0_TX_ISRHandler(void)
 {
+    uint8_t c;
+
     /* Clear the interrupt as the interrupt has been processed */
     STIF0 = 0U;	/* clear INTST0 interrupt flag */
 
-    /* Is more data waiting to be sent? */
-    if (G_UART0_TXIn != G_UART0_TXOut) {
+    /* The transmit source goes first so its bytes stay together; */
+    /* FIFO bytes go out once it runs dry. */
+    if ((G_UART0_TXSource) && (G_UART0_TXSource(&c))) {
+        TXD0 = c;
+    } else if (G_UART0_TXIn != G_UART0_TXOut) {
         /* Send another byte and update the FIFO position */
         TXD0 = G_UART0_TXBuffer[G_UART0_TXOut++];
         if (G_UART0_TXOut >= UART0_TX_BUFFER_SIZE)
@@ -23,6 +23,8 @@ bool UART0_SendByte(uint8_t aByte);
 uint32_t UART0_SendData(const uint8_t *aData, uint32_t aLen);
 void UART0_SendDataBlock(const uint8_t *aData, uint32_t aLen);
 bool UART0_IsTransmitEmpty(void);
+void UART0_SetTransmitSource(bool (*aSource)(uint8_t *aByte));
+void UART0_TransmitKick(void);
 
 #endif // _UART0_H
 /*-------------------------------------------------------------------------*
@@ -4,6 +4,7 @@
  * Description:
  *     FIFO driven UART2 driver for RL78.
  *-------------------------------------------------------------------------*/
+#include <string.h>
 #include <system/platform.h>
 #include "SAU.h"
 #include "UART2.h"
@@ -11,8 +12,10 @@
 /*-------------------------------------------------------------------------*
  * Constants:
  *-------------------------------------------------------------------------*/
+/* Sized for the module at high baud rates: 256 bytes hold about 5 ms of */
+/* data at 460800 baud before bytes are lost */
 #ifndef UART2_RX_BUFFER_SIZE
-#define UART2_RX_BUFFER_SIZE        128
+#define UART2_RX_BUFFER_SIZE        256
 #endif
 
 #ifndef UART2_TX_BUFFER_SIZE
@@ -36,8 +39,9 @@
  *-------------------------------------------------------------------------*/
 /* Transmit FIFO buffer */
 static uint8_t G_UART2_RXBuffer[UART2_RX_BUFFER_SIZE];
-static uint16_t G_UART2_RXIn = 0;
+static volatile uint16_t G_UART2_RXIn = 0;
 static uint16_t G_UART2_RXOut = 0;
+static volatile uint32_t G_UART2_RXOverflow = 0;
 
 /* Transmit FIFO buffer */
 static uint8_t G_UART2_TXBuffer[UART2_TX_BUFFER_SIZE];
@@ -49,16 +53,17 @@ static volatile T_SAUStatusError G_UART2_LastError = NONE;
 static volatile uint16_t G_UART2_ErrorCount = 0;
 
 /*---------------------------------------------------------------------------*
- * Routine:  I2C_SetSpeed
+ * Routine:  IUART2_SetDivider
  *---------------------------------------------------------------------------*
  * Description:
- *      Set the I2C speed in kHz.
+ *      Set the clock dividers for the baud rate.  The channels must be
+ *      stopped.
  * Inputs:
- *      uint16_t aSpeed -- kHz speed of I2C bus.
+ *      uint32_t baud -- baud rate (e.g. 115200 baud), or bits per second
  * Outputs:
  *      void
  *---------------------------------------------------------------------------*/
-void UART2_SetBaudRate(uint32_t baud)
+static void IUART2_SetDivider(uint32_t baud)
 {
     uint16_t fCLK_devisor;
     uint32_t baud_devisor;
@@ -86,6 +91,26 @@ void UART2_SetBaudRate(uint32_t baud)
     }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_SetBaudRate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Change the baud rate of the running UART.  Bytes still in the
+ *      transmitter go out at the new rate, so wait for
+ *      UART2_IsTransmitEmpty first.
+ * Inputs:
+ *      uint32_t baud -- baud rate (e.g. 115200 baud), or bits per second
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void UART2_SetBaudRate(uint32_t baud)
+{
+    /* The dividers may only change while the channels are stopped */
+    ST1 |= _SAU_CH1_STOP_TRG_ON | _SAU_CH0_STOP_TRG_ON;
+    IUART2_SetDivider(baud);
+    SS1 |= _SAU_CH1_START_TRG_ON | _SAU_CH0_START_TRG_ON;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  UART2_Start
  *---------------------------------------------------------------------------*
@@ -103,6 +128,8 @@ void UART2_Start(uint32_t baud)
     G_UART2_RXIn = G_UART2_RXOut = 0;
     G_UART2_TXIn = G_UART2_TXOut = 0;
     G_UART2_TX_Empty = true;  
+    G_UART2_RXOverflow = 0;
+    G_UART2_ErrorCount = 0;
   
     /* supply SAU0 clock */
     SAU1EN = 1U;
@@ -148,7 +175,7 @@ void UART2_Start(uint32_t baud)
     SOL1 |= _SAU_CHANNEL0_NORMAL;   /* output level normal */
     SOE1 |= _SAU_CH0_OUTPUT_ENABLE;   /* enable UART2 output */
     
-    UART2_SetBaudRate(baud);
+    IUART2_SetDivider(baud);
     
     PM1 |= 0x10U;   /* Set RxD2 pin */
     
@@ -226,6 +253,47 @@ bool UART2_ReceiveByte(uint8_t *aByte)
     return found;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_ReceiveData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take as many waiting bytes out of the receive FIFO as fit, copied
+ *      in at most two runs.
+ * Inputs:
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t UART2_ReceiveData(uint8_t *aData, uint32_t aMaxLen)
+{
+    uint32_t count = 0;
+    uint32_t run;
+    uint16_t in;
+
+    /* Disable interrupts while a check is made */
+    SRMK2 = 1U;
+    in = G_UART2_RXIn;
+    SRMK2 = 0U;
+
+    while ((count < aMaxLen) && (G_UART2_RXOut != in)) {
+        /* Contiguous bytes from the out position */
+        if (in > G_UART2_RXOut)
+            run = in - G_UART2_RXOut;
+        else
+            run = UART2_RX_BUFFER_SIZE - G_UART2_RXOut;
+        if (run > (aMaxLen - count))
+            run = aMaxLen - count;
+        memcpy(aData + count, G_UART2_RXBuffer + G_UART2_RXOut, run);
+        G_UART2_RXOut += run;
+        if (G_UART2_RXOut >= UART2_RX_BUFFER_SIZE)
+            G_UART2_RXOut = 0;
+        count += run;
+    }
+
+    return count;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  UART2_SendByte
  *---------------------------------------------------------------------------*
@@ -341,6 +409,43 @@ bool UART2_IsTransmitEmpty(void)
     return G_UART2_TX_Empty;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_GetOverflowCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of received bytes lost because the receive FIFO
+ *      was full.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Bytes lost since UART2_Start
+ *---------------------------------------------------------------------------*/
+uint32_t UART2_GetOverflowCount(void)
+{
+    uint32_t count;
+
+    SRMK2 = 1U;
+    count = G_UART2_RXOverflow;
+    SRMK2 = 0U;
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_GetErrorCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of receive errors (framing, parity, overrun).
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint16_t -- Errors since UART2_Start
+ *---------------------------------------------------------------------------*/
+uint16_t UART2_GetErrorCount(void)
+{
+    return G_UART2_ErrorCount;
+}
+
 /*---------------------------------------------------------------------------*
  * Interrupt Routine:  UART2_TX_ISRHandler
  *---------------------------------------------------------------------------*
@@ -403,10 +508,11 @@ __interrupt void UART2_RX_ISRHandler(void)
         G_UART2_RXIn = next;
     } else {
         /* The buffer is overrunning and we are losing bytes now. */
+        G_UART2_RXOverflow++;
     }
     
     /* Done with the receive interrupt */
-    SRIF0 = 0U;	/* clear INTSR0 interrupt flag */
+    SRIF2 = 0U;	/* clear INTSR2 interrupt flag */
 }
 
 /*---------------------------------------------------------------------------*
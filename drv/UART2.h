@@ -18,11 +18,15 @@
  *-------------------------------------------------------------------------*/
 void UART2_Start(uint32_t baud);
 void UART2_Stop(void);
+void UART2_SetBaudRate(uint32_t baud);
 bool UART2_ReceiveByte(uint8_t *aByte);
+uint32_t UART2_ReceiveData(uint8_t *aData, uint32_t aMaxLen);
 bool UART2_SendByte(uint8_t aByte);
 uint32_t UART2_SendData(const uint8_t *aData, uint32_t aLen);
 void UART2_SendDataBlock(const uint8_t *aData, uint32_t aLen);
 bool UART2_IsTransmitEmpty(void);
+uint32_t UART2_GetOverflowCount(void);
+uint16_t UART2_GetErrorCount(void);
 
 #endif // _UART2_H
 /*-------------------------------------------------------------------------*
@@ -0,0 +1,169 @@
+/*-------------------------------------------------------------------------*
+ * File:  bench_eof.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Cost of classifying response lines: AtLib_checkEOFMessage against
+ *      the chain of strstr() calls it replaced (copied below without its
+ *      flag side effects).  The old routine is timed with the C library
+ *      strstr() of the PC and with a byte-wise strstr() like the one of
+ *      the RL78 library, which is what the board runs.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <CmdLib/AtCmdLib.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MIN_SECONDS           0.2
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef char *(*BenchFind)(const char *pText, const char *pToken);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchByteFind
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      strstr() a character at a time, as the RL78 C library does it.
+ *---------------------------------------------------------------------------*/
+static char *IBenchByteFind(const char *pText, const char *pToken)
+{
+    const char *p;
+    const char *q;
+
+    for (; *pText; pText++) {
+        for (p = pText, q = pToken; (*q) && (*p == *q); p++, q++)
+            ;
+        if (!*q)
+            return (char *)pText;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldCheckEOF
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_checkEOFMessage before the token table, using find for
+ *      strstr().
+ *---------------------------------------------------------------------------*/
+static HOST_APP_MSG_ID_E IBenchOldCheckEOF(
+        const uint8_t *pBuffer,
+        BenchFind find)
+{
+    const char *p = (const char *)pBuffer;
+
+    if (find(p, "OK") != NULL) {
+        return HOST_APP_MSG_ID_OK;
+    } else if (find(p, "ERROR") != NULL) {
+        return HOST_APP_MSG_ID_ERROR;
+    } else if (find(p, "INVALID INPUT") != NULL) {
+        return HOST_APP_MSG_ID_INVALID_INPUT;
+    } else if (find(p, "DISASSOCIATED") != NULL) {
+        return HOST_APP_MSG_ID_DISASSOCIATION_EVENT;
+    } else if (find(p, "ERROR: IP CONFIG FAIL") != NULL) {
+        return HOST_APP_MSG_ID_ERROR_IP_CONFIG_FAIL;
+    } else if (find(p, "ERROR: SOCKET FAILURE") != NULL) {
+        return HOST_APP_MSG_ID_ERROR_SOCKET_FAIL;
+    } else if (find(p, "APP Reset-APP SW Reset") != NULL) {
+        return HOST_APP_MSG_ID_APP_RESET;
+    } else if (find(p, "DISCONNECT") != NULL) {
+        return HOST_APP_MSG_ID_DISCONNECT;
+    } else if (find(p, "Disassociation Event") != NULL) {
+        return HOST_APP_MSG_ID_DISASSOCIATION_EVENT;
+    } else if (find(p, "Out of StandBy-Alarm") != NULL) {
+        return HOST_APP_MSG_ID_OUT_OF_STBY_ALARM;
+    } else if (find(p, "Out of StandBy-Timer") != NULL) {
+        return HOST_APP_MSG_ID_OUT_OF_STBY_TIMER;
+    } else if (find(p, "UnExpected Warm Boot") != NULL) {
+        return HOST_APP_MSG_ID_UNEXPECTED_WARM_BOOT;
+    } else if (find(p, "Out of Deep Sleep") != NULL) {
+        return HOST_APP_MSG_ID_OUT_OF_DEEP_SLEEP;
+    } else if (find(p, "Serial2WiFi APP") != NULL) {
+        return HOST_APP_MSG_ID_WELCOME_MSG;
+    }
+
+    return HOST_APP_MSG_ID_NONE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchLine
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Time one line through each classifier and print ns per line and
+ *      per byte.  method 0 is AtLib_checkEOFMessage, 1 and 2 the old
+ *      routine with the byte-wise and the C library strstr().
+ *---------------------------------------------------------------------------*/
+static void IBenchLine(const char *aName, const char *aLine)
+{
+    static const char *methods[] = { "table", "old/byte", "old/libc" };
+    volatile HOST_APP_MSG_ID_E msgId;
+    uint32_t length = strlen(aLine);
+    double start;
+    double elapsed;
+    double ns[3];
+    uint32_t count;
+    uint32_t i;
+    int m;
+
+    for (m = 0; m < 3; m++) {
+        count = 0;
+        start = Host_Seconds();
+        do {
+            for (i = 0; i < 1000; i++) {
+                if (m == 0)
+                    msgId = AtLib_checkEOFMessage((const uint8_t *)aLine);
+                else
+                    msgId = IBenchOldCheckEOF((const uint8_t *)aLine,
+                            (m == 1) ? IBenchByteFind : (BenchFind)strstr);
+            }
+            count += 1000;
+            elapsed = Host_Seconds() - start;
+        } while (elapsed < BENCH_MIN_SECONDS);
+        ns[m] = elapsed * 1e9 / count;
+    }
+    (void)msgId;
+
+    printf("%-16s %4u bytes", aName, (unsigned)length);
+    for (m = 0; m < 3; m++)
+        printf("  %s %7.1f ns (%5.2f ns/byte)", methods[m], ns[m],
+                ns[m] / length);
+    printf("  %5.1fx\n", ns[1] / ns[0]);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    static char longLine[320];
+
+    memset(longLine, 'h', 300);
+    strcpy(longLine + 300, "\r\n");
+
+    Host_Reset();
+    AtLib_Init();
+    IBenchLine("OK", "OK\r\n");
+    IBenchLine("ERROR", "ERROR\r\n");
+    IBenchLine("SOCKET FAILURE", "ERROR: SOCKET FAILURE 1\r\n");
+    IBenchLine("CONNECT", "CONNECT 0 1 10.0.0.2:80\r\n");
+    IBenchLine("NSTAT", "IP addr=192.168.1.100   SubNet=255.255.255.0  "
+            "Gateway=192.168.1.1\r\n");
+    IBenchLine("Serial2WiFi APP", "Serial2WiFi APP\r\n");
+    IBenchLine("300 bytes", longLine);
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  bench_eof.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,258 @@
+/*-------------------------------------------------------------------------*
+ * File:  bench_lcd.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Characters drawn per millisecond by DisplayLCD (drv/Glyph/lcd.c),
+ *      which copies the 8 column bytes of each changed character from
+ *      Font8x8_pages into the page and sends the line in one burst.  The
+ *      SPI and ST7579 calls are stubs that only count bytes, so only the
+ *      work on the CPU is timed.
+ *
+ *      RL78GlyphLib cannot be built on a PC, so the path it replaced is
+ *      timed as a model: a 256 entry pointer table of glyphs with a width
+ *      and height header, and a read-modify-write of the frame buffer for
+ *      every pixel, then the 8 bytes of the cell sent one at a time.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "Glyph_API.h"
+#include <drv/Glyph/lcd.h>
+#include <drv/Glyph/Drivers/YRDKRL78_SPI.h>
+#include <drv/Glyph/Drivers/ST7579_LCD.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MIN_SECONDS           0.2
+#define BENCH_LINES                 8
+#define BENCH_CHARS                 12
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef void (*BenchDraw)(uint32_t aPass);
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static uint32_t G_BenchSpiBytes;
+static uint8_t G_BenchGlyphs[256][2 + 8];
+static const uint8_t *G_BenchTable[256];
+static uint8_t G_BenchFrame[BENCH_LINES][BENCH_CHARS * 8];
+static const char *G_BenchText[2][BENCH_LINES] = {
+    {
+        "Connecting  ", "SSID Demo   ", "RSSI -53 dBm", "10.0.0.100  ",
+        "Temp 23.5 C ", "Light 512   ", "Exosite OK  ", "Ver 1.2.3   ",
+    },
+    {
+        "Associated  ", "Channel 6   ", "RSSI -61 dBm", "192.168.1.7 ",
+        "Temp 24.0 C ", "Light 498   ", "Exosite FAIL", "Update 42%  ",
+    },
+};
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Glyph*, ST7579_*, LCD_SPI_*
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      What lcd.c calls of the Glyph library and the LCD drivers.
+ *---------------------------------------------------------------------------*/
+T_glyphError GlyphOpen(T_glyphHandle *aHandle, int32_t aAddress)
+{
+    (void)aAddress;
+    *aHandle = G_BenchFrame;
+    return GLYPH_ERROR_NONE;
+}
+
+T_glyphError GlyphNormalScreen(T_glyphHandle aHandle)
+{
+    (void)aHandle;
+    return GLYPH_ERROR_NONE;
+}
+
+T_glyphError GlyphSetFont(T_glyphHandle aHandle, T_glyphFont aFont)
+{
+    (void)aHandle;
+    (void)aFont;
+    return GLYPH_ERROR_NONE;
+}
+
+T_glyphError GlyphClearScreen(T_glyphHandle aHandle)
+{
+    (void)aHandle;
+    memset(G_BenchFrame, 0, sizeof(G_BenchFrame));
+    return GLYPH_ERROR_NONE;
+}
+
+void ST7579_SetPage(T_glyphHandle aHandle, int8_t cValue0To9)
+{
+    (void)aHandle;
+    (void)cValue0To9;
+    G_BenchSpiBytes += 2;
+}
+
+void ST7579_SetChar(T_glyphHandle aHandle, int8_t cValue0To101)
+{
+    (void)aHandle;
+    (void)cValue0To101;
+    G_BenchSpiBytes += 2;
+}
+
+void ST7579_Send8bitsData(T_glyphHandle aHandle, int8_t cData)
+{
+    (void)aHandle;
+    (void)cData;
+    G_BenchSpiBytes++;
+}
+
+void LCD_SPI_Flush(void)
+{
+}
+
+void LCD_SPI_DataSendBlock(const uint8_t *aData, uint16_t aLength)
+{
+    (void)aData;
+    G_BenchSpiBytes += aLength;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchPixelChar
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Model of drawing one character the way the Glyph library does:
+ *      glyph from the pointer table, one frame buffer read-modify-write
+ *      per pixel, then the cell's bytes sent one by one.
+ *---------------------------------------------------------------------------*/
+static void IBenchPixelChar(uint8_t aLine, uint8_t aColumn, uint8_t aChar)
+{
+    const uint8_t *p_glyph = G_BenchTable[aChar];
+    uint8_t *p_cell = &G_BenchFrame[aLine][aColumn * 8];
+    uint8_t x;
+    uint8_t y;
+
+    if (!p_glyph)
+        return;
+    for (x = 0; x < p_glyph[0]; x++) {
+        for (y = 0; y < p_glyph[1]; y++) {
+            if (p_glyph[2 + x] & (1 << y))
+                p_cell[x] |= (uint8_t)(1 << y);
+            else
+                p_cell[x] &= (uint8_t)~(1 << y);
+        }
+    }
+    ST7579_SetPage(G_BenchFrame, aLine);
+    ST7579_SetChar(G_BenchFrame, aColumn * 8);
+    for (x = 0; x < p_glyph[0]; x++)
+        ST7579_Send8bitsData(G_BenchFrame, p_cell[x]);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchPixel*, IBenchDisplay*
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      One pass of a screen: the model of the library path or
+ *      DisplayLCD.  Full changes every line to the other text, Same
+ *      writes the text already shown, Counter changes one character
+ *      of one line.
+ *---------------------------------------------------------------------------*/
+static void IBenchPixelFull(uint32_t aPass)
+{
+    const char *p_text;
+    uint8_t line;
+    uint8_t i;
+
+    for (line = 0; line < BENCH_LINES; line++) {
+        p_text = G_BenchText[aPass & 1][line];
+        for (i = 0; i < BENCH_CHARS; i++)
+            IBenchPixelChar(line, i, (uint8_t)p_text[i]);
+    }
+}
+
+static void IBenchDisplayFull(uint32_t aPass)
+{
+    uint8_t line;
+
+    for (line = 0; line < BENCH_LINES; line++)
+        DisplayLCD(LCD_LINE1 + line * 8,
+                (const uint8_t *)G_BenchText[aPass & 1][line]);
+}
+
+static void IBenchDisplaySame(uint32_t aPass)
+{
+    uint8_t line;
+
+    (void)aPass;
+    for (line = 0; line < BENCH_LINES; line++)
+        DisplayLCD(LCD_LINE1 + line * 8,
+                (const uint8_t *)G_BenchText[0][line]);
+}
+
+static void IBenchDisplayCounter(uint32_t aPass)
+{
+    char text[BENCH_CHARS + 1];
+
+    sprintf(text, "Count %06u", (unsigned)(aPass % 1000000));
+    DisplayLCD(LCD_LINE8, (const uint8_t *)text);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Run aDraw for BENCH_MIN_SECONDS and print the characters written
+ *      per millisecond and the LCD bytes sent per pass.
+ *---------------------------------------------------------------------------*/
+static void IBenchRun(const char *aName, BenchDraw aDraw, uint32_t aChars)
+{
+    double start;
+    double elapsed;
+    uint32_t passes = 0;
+
+    InitialiseLCD();
+    aDraw(1);
+    G_BenchSpiBytes = 0;
+    start = Host_Seconds();
+    do {
+        aDraw(passes++);
+        elapsed = Host_Seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    printf("%-24s %10.0f chars/ms  %6.1f LCD bytes/pass\n", aName,
+            (double)passes * aChars / (elapsed * 1e3),
+            (double)G_BenchSpiBytes / passes);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    uint16_t c;
+
+    for (c = FONT8X8_PAGES_FIRST; c <= FONT8X8_PAGES_LAST; c++) {
+        G_BenchGlyphs[c][0] = 8;
+        G_BenchGlyphs[c][1] = 8;
+        memcpy(&G_BenchGlyphs[c][2], Font8x8_pages[c - FONT8X8_PAGES_FIRST], 8);
+        G_BenchTable[c] = G_BenchGlyphs[c];
+    }
+
+    IBenchRun("full screen, pixel model", IBenchPixelFull,
+            BENCH_LINES * BENCH_CHARS);
+    IBenchRun("full screen, DisplayLCD", IBenchDisplayFull,
+            BENCH_LINES * BENCH_CHARS);
+    IBenchRun("same text, DisplayLCD", IBenchDisplaySame,
+            BENCH_LINES * BENCH_CHARS);
+    IBenchRun("counter, DisplayLCD", IBenchDisplayCounter, BENCH_CHARS);
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  bench_lcd.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,293 @@
+/*-------------------------------------------------------------------------*
+ * File:  bench_parse.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Cost of parsing responses: the AtLib_Parse* routines built on the
+ *      response tokenizer against the strstr()/strtok()/atoi() versions
+ *      they replaced (copied below).  The old routines are timed with
+ *      the C library strstr() of the PC and with a byte-wise strstr()
+ *      like the one of the RL78 library.  Every pass receives the response
+ *      again through AtLib_ProcessRxChunk, so the tokenizer starts from
+ *      nothing each time; the time of receiving alone is printed and
+ *      taken off the parse times.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CmdLib/AtCmdLib.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MIN_SECONDS           0.2
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef void (*BenchParse)(void);
+typedef char *(*BenchFind)(const char *pText, const char *pToken);
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+extern uint8_t MRBuffer[];
+static char G_BenchText[64];
+static int16_t G_BenchRssi;
+static uint8_t G_BenchResult;
+static BenchFind G_BenchFind;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchByteFind
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      strstr() a character at a time, as the RL78 C library does it.
+ *---------------------------------------------------------------------------*/
+static char *IBenchByteFind(const char *pText, const char *pToken)
+{
+    const char *p;
+    const char *q;
+
+    for (; *pText; pText++) {
+        for (p = pText, q = pToken; (*q) && (*p == *q); p++, q++)
+            ;
+        if (!*q)
+            return (char *)pText;
+    }
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldParseWlanConnStat
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ParseWlanConnStat before the tokenizer, using G_BenchFind
+ *      for strstr().
+ *---------------------------------------------------------------------------*/
+static uint8_t IBenchOldParseWlanConnStat(void)
+{
+    return (G_BenchFind((const char *)MRBuffer, "BSSID=00:00:00:00:00:00"))
+            ? false : true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldParseGetMacResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ParseGetMacResponse before the tokenizer.
+ *---------------------------------------------------------------------------*/
+static uint8_t IBenchOldParseGetMacResponse(char *pMAC)
+{
+    char *pSubStr;
+    char currNodeMac[20] = "00:00:00:00:00:00";
+
+    pSubStr = G_BenchFind((const char *)MRBuffer, ":");
+    if (!pSubStr)
+        return false;
+    memcpy(currNodeMac, (pSubStr - 2), 17);
+    currNodeMac[17] = '\0';
+    for (pSubStr = currNodeMac; *pSubStr != '\0'; pSubStr++) {
+        if (*pSubStr != ':')
+            *pMAC++ = *pSubStr;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldParseNodeIpAddress
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ParseNodeIpAddress before the tokenizer (strtok() writes
+ *      into MRBuffer).
+ *---------------------------------------------------------------------------*/
+static uint8_t IBenchOldParseNodeIpAddress(int8_t *pIpAddr)
+{
+    char *pSubStr;
+
+    pSubStr = G_BenchFind((const char *)MRBuffer, "IP addr=");
+    if (!pSubStr)
+        return 0;
+    strcpy((char *)pIpAddr, strtok((pSubStr + 8), ": "));
+
+    return (pIpAddr[0] == '0') ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldParseRssiResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ParseRssiResponse before the tokenizer.
+ *---------------------------------------------------------------------------*/
+static uint8_t IBenchOldParseRssiResponse(int16_t *pRssi)
+{
+    char *pSubStr;
+
+    if ((pSubStr = G_BenchFind((const char *)MRBuffer, "-")) != NULL) {
+        *pRssi = atoi(pSubStr);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchOldParseDNSLookupResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ParseDNSLookupResponse before the tokenizer.  It copies the
+ *      rest of MRBuffer, so G_BenchText must hold the whole response.
+ *---------------------------------------------------------------------------*/
+static uint8_t IBenchOldParseDNSLookupResponse(char *ipAddr)
+{
+    char *pSubStr;
+
+    pSubStr = G_BenchFind((const char *)MRBuffer, "IP:");
+    if (!pSubStr)
+        return 0;
+    strcpy(ipAddr, (pSubStr + 3));
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchNone, IBenchOld*, IBenchNew*
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      What is timed after each response: nothing (receive only), the
+ *      old parsers or the new ones.  For AT+NSTAT=? the application
+ *      asks for the association, the MAC address and the IP address.
+ *---------------------------------------------------------------------------*/
+static void IBenchNone(void)
+{
+}
+
+static void IBenchOldNstat(void)
+{
+    G_BenchResult = IBenchOldParseWlanConnStat();
+    G_BenchResult += IBenchOldParseGetMacResponse(G_BenchText);
+    G_BenchResult += IBenchOldParseNodeIpAddress((int8_t *)G_BenchText);
+}
+
+static void IBenchNewNstat(void)
+{
+    G_BenchResult = AtLib_ParseWlanConnStat();
+    G_BenchResult += AtLib_ParseGetMacResponse(G_BenchText);
+    G_BenchResult += AtLib_ParseNodeIpAddress((int8_t *)G_BenchText);
+}
+
+static void IBenchOldRssi(void)
+{
+    G_BenchResult = IBenchOldParseRssiResponse(&G_BenchRssi);
+}
+
+static void IBenchNewRssi(void)
+{
+    G_BenchResult = AtLib_ParseRssiResponse(&G_BenchRssi);
+}
+
+static void IBenchOldDns(void)
+{
+    G_BenchResult = IBenchOldParseDNSLookupResponse(G_BenchText);
+}
+
+static void IBenchNewDns(void)
+{
+    G_BenchResult = AtLib_ParseDNSLookupResponse(G_BenchText);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchTime
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Receive aResponse and run aParse on it until BENCH_MIN_SECONDS
+ *      have passed.  Returns the ns of one response.
+ *---------------------------------------------------------------------------*/
+static double IBenchTime(const char *aResponse, BenchParse aParse)
+{
+    uint32_t length = strlen(aResponse);
+    double start;
+    double elapsed;
+    uint32_t count = 0;
+    uint32_t i;
+
+    start = Host_Seconds();
+    do {
+        for (i = 0; i < 1000; i++) {
+            AtLib_FlushRxBuffer();
+            AtLib_ProcessRxChunk((const uint8_t *)aResponse, length);
+            aParse();
+        }
+        count += 1000;
+        elapsed = Host_Seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    return elapsed * 1e9 / count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Time one response with each parser and print the results.
+ *---------------------------------------------------------------------------*/
+static void IBenchResponse(
+        const char *aName,
+        const char *aResponse,
+        BenchParse aOld,
+        BenchParse aNew)
+{
+    double receive;
+    double oldByte;
+    double oldLibc;
+    double new;
+
+    receive = IBenchTime(aResponse, IBenchNone);
+    G_BenchFind = IBenchByteFind;
+    oldByte = IBenchTime(aResponse, aOld) - receive;
+    G_BenchFind = (BenchFind)strstr;
+    oldLibc = IBenchTime(aResponse, aOld) - receive;
+    new = IBenchTime(aResponse, aNew) - receive;
+
+    printf("%-12s %4u bytes  receive %7.1f ns  old/byte %7.1f ns  "
+            "old/libc %7.1f ns  tokenizer %7.1f ns\n", aName,
+            (unsigned)strlen(aResponse), receive, oldByte, oldLibc, new);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    static const char nstat[] =
+            "\r\nMAC=00:1d:c9:10:2a:3b WSTATE=CONNECTED MODE=NONE\r\n"
+            "BSSID=00:24:a5:11:22:33   SSID=\"Renesas Demo\"   CHANNEL=6   "
+            "SECURITY=WPA2-PERSONAL\r\n"
+            "RSSI=-53\r\n"
+            "IP addr=192.168.1.100   SubNet=255.255.255.0  "
+            "Gateway=192.168.1.1\r\n"
+            "DNS1=192.168.1.1       DNS2=0.0.0.0\r\n"
+            "Rx Count=1523     Tx Count=988\r\n"
+            "OK\r\n";
+
+    Host_Reset();
+    AtLib_Init();
+    IBenchResponse("AT+NSTAT=?", nstat, IBenchOldNstat, IBenchNewNstat);
+    IBenchResponse("AT+WRSSI=?", "\r\n-53\r\nOK\r\n", IBenchOldRssi,
+            IBenchNewRssi);
+    IBenchResponse("AT+DNSLOOKUP", "\r\nIP:93.184.216.34\r\nOK\r\n",
+            IBenchOldDns, IBenchNewDns);
+    (void)G_BenchResult;
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  bench_parse.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,159 @@
+/*-------------------------------------------------------------------------*
+ * File:  bench_rx.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Throughput of the AtCmdLib receive path.  Replays captured S2W
+ *      byte streams (the bytes App_Read returned on the board) through
+ *      AtLib_ReceiveDataHandle, the routine the main loop calls, and
+ *      reports MB/s and the worst case bytes and time of one call.  The
+ *      same is done with the old per-character loop (App_Read of one
+ *      byte, then AtLib_ReceiveDataProcess) for comparison.
+ *
+ *      bench_rx [-a <bytes arriving per call>] <capture>...
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <CmdLib/AtCmdLib.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MIN_SECONDS           0.5
+#define BENCH_MAX_CAPTURE           (HOST_RX_QUEUE_SIZE)
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef HOST_APP_MSG_ID_E (*BenchHandle)(void);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchPerByte
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLib_ReceiveDataHandle as it was before the span parser: read
+ *      and process one character at a time.
+ *---------------------------------------------------------------------------*/
+static HOST_APP_MSG_ID_E IBenchPerByte(void)
+{
+    uint8_t rxData;
+
+    while (App_Read(&rxData, 1, 0))
+        AtLib_ReceiveDataProcess(rxData);
+
+    return HOST_APP_MSG_ID_NONE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchReplay
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Replay a capture until at least BENCH_MIN_SECONDS have passed and
+ *      print the results.
+ *---------------------------------------------------------------------------*/
+static void IBenchReplay(
+        const char *aName,
+        const char *aPath,
+        BenchHandle aHandle,
+        const uint8_t *aData,
+        uint32_t aSize,
+        uint32_t aArrive)
+{
+    double start;
+    double elapsed;
+    double callStart;
+    double call;
+    double worstCall = 0;
+    uint64_t total = 0;
+    uint32_t passes = 0;
+    uint32_t offset;
+    uint32_t len;
+    uint32_t calls = 0;
+    uint32_t pending;
+    uint32_t worstBytes = 0;
+
+    Host_Reset();
+    AtLib_Init();
+    start = Host_Seconds();
+    do {
+        for (offset = 0; offset < aSize; offset += len) {
+            len = aSize - offset;
+            if ((aArrive) && (len > aArrive))
+                len = aArrive;
+            Host_RxPush(aData + offset, len);
+            pending = Host_RxPending();
+            callStart = Host_Seconds();
+            aHandle();
+            call = Host_Seconds() - callStart;
+            if (call > worstCall)
+                worstCall = call;
+            if (pending - Host_RxPending() > worstBytes)
+                worstBytes = pending - Host_RxPending();
+            calls++;
+        }
+        /* Let the state machine finish what is left */
+        while (Host_RxPending())
+            aHandle();
+        total += aSize;
+        passes++;
+        elapsed = Host_Seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    printf("%-24s %-8s %8u bytes x %5u  %8.2f MB/s  %7.1f ns/call  "
+            "worst call %5u bytes %8.1f us\n", aName, aPath, aSize, passes,
+            total / elapsed / 1e6, elapsed * 1e9 / calls,
+            (unsigned)worstBytes, worstCall * 1e6);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    static uint8_t capture[BENCH_MAX_CAPTURE];
+    uint32_t arrive = 64;
+    const char *name;
+    FILE *fp;
+    size_t size;
+    int i = 1;
+
+    if ((argc > 2) && (strcmp(argv[1], "-a") == 0)) {
+        arrive = strtoul(argv[2], 0, 0);
+        i = 3;
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: %s [-a <bytes arriving per call>] "
+                "<capture>...\n", argv[0]);
+        return 2;
+    }
+    printf("%u bytes arrive per AtLib_ReceiveDataHandle call\n",
+            (unsigned)arrive);
+    for (; i < argc; i++) {
+        fp = fopen(argv[i], "rb");
+        if (!fp) {
+            perror(argv[i]);
+            return 2;
+        }
+        size = fread(capture, 1, sizeof(capture), fp);
+        fclose(fp);
+        name = strrchr(argv[i], '/');
+        name = (name) ? name + 1 : argv[i];
+        IBenchReplay(name, "span", AtLib_ReceiveDataHandle, capture, size,
+                arrive);
+        IBenchReplay(name, "per byte", IBenchPerByte, capture, size,
+                arrive);
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  bench_rx.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,226 @@
+/*-------------------------------------------------------------------------*
+ * File:  bench_spi.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Throughput of the decoding of the bytes the module returns over
+ *      SPI.  Replays SPI dumps (the MISO bytes, see
+ *      captures/make_captures.py) a transfer at a time through
+ *      IGainSpan_SPI_Decode, which GainSpan_SPI_ProcessIncoming calls,
+ *      and through the old per-byte loop, and reports MB/s of returned
+ *      bytes.  The receive FIFO is emptied after each transfer as the
+ *      application does.  The driver is built into this file (as in
+ *      test_gainspan_spi.c) to reach its static routines.
+ *
+ *      bench_spi [-t <bytes per transfer>] <dump>...
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <drv/GainSpan_SPI.c>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MIN_SECONDS           0.5
+#define BENCH_MAX_DUMP              (1024UL * 1024UL)
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef void (*BenchDecode)(const uint8_t *p, uint16_t count);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchPerByte
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      GainSpan_SPI_ProcessIncoming's loop as it was before the run
+ *      decoding: one byte at a time, with the FIFO checked for room for
+ *      each.  XON/XOFF are handled as IGainSpan_SPI_Decode does.
+ *---------------------------------------------------------------------------*/
+static void IBenchPerByte(const uint8_t *p, uint16_t count)
+{
+    bool storeChar;
+    uint16_t next;
+    uint8_t c;
+
+    while (count--) {
+        c = *p++;
+        storeChar = true;
+
+        /* Was the last character an escape code? */
+        if (G_GainSpan_SPI_EscapeCode) {
+            /* Use this character xor 0x20 and now no longer in escape mode */
+            c ^= 0x20;
+            G_GainSpan_SPI_EscapeCode = false;
+        } else {
+            if (c == GAINSPAN_SPI_CHAR_ESC) {
+                G_GainSpan_SPI_EscapeCode = true;
+                storeChar = false;
+            } else if (c == GAINSPAN_SPI_CHAR_IDLE) {
+                storeChar = false;
+            } else if (c == GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON) {
+                G_GainSpan_SPI_XOff = false;
+                storeChar = false;
+            } else if (c == GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF) {
+                G_GainSpan_SPI_XOff = true;
+                storeChar = false;
+            }
+        }
+        if (storeChar) {
+            /* The character needs to be stored in the receive buffer */
+            /* Is there room? */
+            next = G_GainSpan_SPI_RXIn + 1;
+            if (next >= GAINSPAN_SPI_RX_BUFFER_SIZE)
+                next = 0;
+            if (next != G_GainSpan_SPI_RXOut) {
+                /* Yes, room.  Store the character in the receive FIFO buffer */
+                G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXIn] = c;
+                G_GainSpan_SPI_RXIn = next;
+            }
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchDecodeAll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Decode a whole dump, aTransfer bytes at a time, and optionally
+ *      collect the data that came out.
+ * Outputs:
+ *      uint32_t -- Number of data bytes that came out
+ *---------------------------------------------------------------------------*/
+static uint32_t IBenchDecodeAll(
+        BenchDecode aDecode,
+        const uint8_t *aData,
+        uint32_t aSize,
+        uint16_t aTransfer,
+        uint8_t *aOut)
+{
+    uint32_t total = 0;
+    uint32_t offset;
+    uint16_t len;
+
+    G_GainSpan_SPI_RXIn = G_GainSpan_SPI_RXOut = 0;
+    G_GainSpan_SPI_EscapeCode = false;
+    G_GainSpan_SPI_XOff = false;
+    for (offset = 0; offset < aSize; offset += len) {
+        len = (aSize - offset > aTransfer) ? aTransfer : aSize - offset;
+        aDecode(aData + offset, len);
+        if (!aOut) {
+            total += (G_GainSpan_SPI_RXIn - G_GainSpan_SPI_RXOut)
+                    & GAINSPAN_SPI_RX_MASK;
+            G_GainSpan_SPI_RXOut = G_GainSpan_SPI_RXIn;
+            continue;
+        }
+        while (G_GainSpan_SPI_RXOut != G_GainSpan_SPI_RXIn) {
+            aOut[total++] = G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXOut];
+            G_GainSpan_SPI_RXOut = (G_GainSpan_SPI_RXOut + 1)
+                    & GAINSPAN_SPI_RX_MASK;
+        }
+    }
+
+    return total;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IBenchReplay
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Decode a dump until at least BENCH_MIN_SECONDS have passed and
+ *      print the results.
+ *---------------------------------------------------------------------------*/
+static void IBenchReplay(
+        const char *aName,
+        const char *aDecoder,
+        BenchDecode aDecode,
+        const uint8_t *aData,
+        uint32_t aSize,
+        uint16_t aTransfer)
+{
+    double start;
+    double elapsed;
+    uint64_t total = 0;
+    uint32_t passes = 0;
+    uint32_t out = 0;
+
+    start = Host_Seconds();
+    do {
+        out = IBenchDecodeAll(aDecode, aData, aSize, aTransfer, 0);
+        total += aSize;
+        passes++;
+        elapsed = Host_Seconds() - start;
+    } while (elapsed < BENCH_MIN_SECONDS);
+
+    printf("%-24s %-8s %8u bytes x %5u  %8.2f MB/s  %6.1f%% data\n", aName,
+            aDecoder, (unsigned)aSize, (unsigned)passes,
+            total / elapsed / 1e6, 100.0 * out / aSize);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    static uint8_t dump[BENCH_MAX_DUMP];
+    static uint8_t outRun[BENCH_MAX_DUMP];
+    static uint8_t outByte[BENCH_MAX_DUMP];
+    uint32_t lenRun;
+    uint32_t lenByte;
+    uint16_t transfer = GAINSPAN_SPI_IDLE_BURST_MAX;
+    const char *name;
+    FILE *fp;
+    size_t size;
+    int i = 1;
+
+    if ((argc > 2) && (strcmp(argv[1], "-t") == 0)) {
+        transfer = (uint16_t)strtoul(argv[2], 0, 0);
+        i = 3;
+    }
+    if ((i >= argc) || (!transfer)
+            || (transfer >= GAINSPAN_SPI_RX_BUFFER_SIZE)) {
+        fprintf(stderr, "usage: %s [-t <bytes per transfer, 1 to %u>] "
+                "<dump>...\n", argv[0], GAINSPAN_SPI_RX_BUFFER_SIZE - 1);
+        return 2;
+    }
+    printf("%u bytes per SPI transfer\n", (unsigned)transfer);
+    Host_Reset();
+    for (; i < argc; i++) {
+        fp = fopen(argv[i], "rb");
+        if (!fp) {
+            perror(argv[i]);
+            return 2;
+        }
+        size = fread(dump, 1, sizeof(dump), fp);
+        fclose(fp);
+        name = strrchr(argv[i], '/');
+        name = (name) ? name + 1 : argv[i];
+
+        /* Both must give the same data */
+        lenRun = IBenchDecodeAll(IGainSpan_SPI_Decode, dump, size, transfer,
+                outRun);
+        lenByte = IBenchDecodeAll(IBenchPerByte, dump, size, transfer,
+                outByte);
+        if ((lenRun != lenByte) || (memcmp(outRun, outByte, lenRun) != 0)) {
+            fprintf(stderr, "%s: decoders differ\n", name);
+            return 1;
+        }
+
+        IBenchReplay(name, "runs", IGainSpan_SPI_Decode, dump, size,
+                transfer);
+        IBenchReplay(name, "per byte", IBenchPerByte, dump, size, transfer);
+    }
+
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  bench_spi.c
+ *-------------------------------------------------------------------------*/
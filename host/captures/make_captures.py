@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Write the sample S2W byte streams used by bench_rx, the SPI dumps used by
+bench_spi and the fuzz corpus.
+
+The fuzz inputs (../corpus) start with the two bytes fuzz_atcmdlib.c reads
+(bytes per read, flags) followed by module bytes.
+
+The streams follow the traffic of the Exosite demo (command responses,
+<ESC>S, <ESC>Z, <ESC>H and <ESC>R data frames, notifications).  A capture
+taken from a real module (the bytes returned by App_Read) can be replayed
+the same way.
+
+The SPI dumps (.spi) are the bytes the module returns over SPI for a
+stream: escaped, in 64 byte IDLE bursts, with IDLE fill while the module
+has nothing to send and the odd XOFF/XON.  A dump taken with a logic
+analyzer (the MISO bytes) can be used the same way.
+"""
+import os
+import random
+
+ESC = b'\x1b'
+SPI_IDLE = 0xF5
+SPI_ESC = 0xFB
+SPI_XON = 0xFD
+SPI_XOFF = 0xFA
+SPI_SPECIAL = (0x00, 0xF3, 0xF5, 0xFA, 0xFB, 0xFD, 0xFF)
+SPI_BURST = 64
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+def ok(*lines):
+    return b''.join(b'\r\n' + l.encode() for l in lines) + b'\r\nOK\r\n'
+
+def http_response(body):
+    head = ('HTTP/1.1 200 OK\r\n'
+            'Date: Tue, 20 Mar 2012 10:00:00 GMT\r\n'
+            'Server: Apache\r\n'
+            'Content-Length: %d\r\n'
+            'Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n'
+            '\r\n' % len(body))
+    return head.encode() + body
+
+def frame_s(cid, data):
+    return ESC + b'S' + cid + data + ESC + b'E'
+
+def frame_len(kind, cid, data):
+    return ESC + kind + cid + b'%04d' % len(data) + data
+
+def nstat():
+    return ok('MAC=00:1d:c9:01:02:03',
+              'WSTATE=CONNECTED     MODE=INFRA',
+              'BSSID=00:24:01:aa:bb:cc   SSID="exosite-demo"   CHANNEL=6   SECURITY=WPA2-PERSONAL',
+              'RSSI=-52',
+              'IP addr=192.168.1.105   SubNet=255.255.255.0  Gateway=192.168.1.1',
+              'DNS1=192.168.1.1       DNS2=0.0.0.0',
+              'Rx Count=1234    Tx Count=987')
+
+def session(rng):
+    out = ok() + ok() + ok('00:1d:c9:01:02:03') + nstat() + ok()
+    out += ok('IP              SubNet         Gateway',
+              ' 192.168.1.105: 255.255.255.0: 192.168.1.1')
+    for i in range(300):
+        out += b'\r\nCONNECT 0\r\n' + ok()
+        body = b'led=%d&ping=%d' % (i & 1, i)
+        out += ok()
+        out += frame_s(b'0', http_response(body))
+        out += b'\r\nDISCONNECT 0\r\n'
+        if i % 50 == 49:
+            out += ok('RSSI=-%d' % rng.randint(40, 80))
+    return out
+
+def bulk(rng):
+    out = ok()
+    for i in range(200):
+        size = rng.choice((64, 300, 1400))
+        data = bytes(rng.randrange(256) for _ in range(size))
+        out += frame_len(b'Z', b'%x' % (i % 3), data)
+        if i % 4 == 0:
+            out += frame_len(b'H', b'1', http_response(b'x' * rng.randint(10, 900)))
+        if i % 10 == 0:
+            raw = b'y' * rng.randint(1, 200)
+            out += ESC + b'R:' + b'%d' % len(raw) + b':' + raw
+        if i % 16 == 0:
+            out += ok()
+    return out
+
+def responses(rng):
+    out = b''
+    for i in range(100):
+        lines = ['%2d  %02x:%02x:%02x:%02x:%02x:%02x  "net-%d"  %d  INFRA  -%d  WPA2'
+                 % (n, *[rng.randrange(256) for _ in range(6)], n,
+                    rng.randint(1, 13), rng.randint(40, 90))
+                 for n in range(rng.randint(1, 20))]
+        lines.append('No.Of AP Found:%d' % (len(lines)))
+        out += ok(*lines) + nstat() + ok('2.3.5') + ok('192.168.1.20')
+        out += b'\r\nERROR: INVALID INPUT\r\n'
+    return out
+
+def spi_dump(data, rng, idle):
+    """Bytes returned over SPI while the module sends data: pieces of it
+    with IDLE fill between them (idle = bursts of fill after a piece)."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        piece = data[pos:pos + rng.randint(1, 600)]
+        pos += len(piece)
+        for c in piece:
+            if c in SPI_SPECIAL:
+                out += bytes((SPI_ESC, c ^ 0x20))
+            else:
+                out.append(c)
+        if rng.random() < 0.02:
+            out += bytes((SPI_XOFF, SPI_IDLE, SPI_IDLE, SPI_XON))
+        gap = rng.randint(0, idle) * SPI_BURST + (-len(out) % SPI_BURST)
+        out += bytes((SPI_IDLE,)) * gap
+    return bytes(out)
+
+def corpus(rng):
+    seeds = {
+        'ok': ok(),
+        'nstat': nstat(),
+        'session': session(rng)[:1500],
+        'frame_s': frame_s(b'0', http_response(b'led=1')) + ok(),
+        'frame_s_esc': frame_s(b'1', b'a' + ESC + b'b' + ESC + ESC + b'c') + ok(),
+        'frame_z': frame_len(b'Z', b'2', b'z' * 100) + ok(),
+        'frame_h': frame_len(b'H', b'3', http_response(b'abc')) + ok(),
+        'frame_r': ESC + b'R:5:hello' + ok(),
+        'events': b'\r\nDISCONNECT 1\r\n\r\nDISASSOCIATED\r\n'
+                  b'\r\nAPP Reset-APP SW Reset\r\n\r\nSerial2WiFi APP\r\n' + ok(),
+        'long_line': b'\r\n' + b'L' * 600 + b'\r\n' + ok(),
+        'limit_line': b'\r\n' + b'L' * 509 + b'\r\n' + b'M' * 60 + b'\r\n' + ok(),
+        'errors': b'\r\nERROR: SOCKET FAILURE 1\r\n\r\nERROR: IP CONFIG FAIL\r\n',
+    }
+    for n, (name, data) in enumerate(sorted(seeds.items())):
+        for flags in (0, 1, 3):
+            chunk = (0, 1, 7, 64)[(n + flags) % 4]
+            path = os.path.join(HERE, '..', 'corpus', '%s_%d.bin' % (name, flags))
+            with open(path, 'wb') as f:
+                f.write(bytes((chunk, flags)) + data)
+
+def main():
+    rng = random.Random(1)
+    corpus(random.Random(2))
+    for name, data in (('exosite_session.s2w', session(rng)),
+                       ('bulk_frames.s2w', bulk(rng)),
+                       ('responses.s2w', responses(rng))):
+        with open(os.path.join(HERE, name), 'wb') as f:
+            f.write(data)
+    rng = random.Random(3)
+    for name, data, idle in (('exosite_session.spi', session(rng), 8),
+                             ('bulk_frames.spi', bulk(rng), 0)):
+        with open(os.path.join(HERE, name), 'wb') as f:
+            f.write(spi_dump(data, rng, idle))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,358 @@
+/*-------------------------------------------------------------------------*
+ * File:  fuzz_atcmdlib.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Fuzz target for the AtCmdLib receive path (AtLib_ReceiveDataSpan,
+ *      AtLib_ReceiveDataProcess, AtLib_checkEOFMessage) and the response
+ *      parsers.  The input is:
+ *
+ *          byte 0 -- Most bytes per App_ReadAvailable (0 = no limit)
+ *          byte 1 -- Flags, bit 0: a command waits for the response,
+ *                    bit 1: its lines are streamed to a callback
+ *          rest   -- Bytes sent by the module
+ *
+ *      Built with -fsanitize=fuzzer (clang) this is a libFuzzer target.
+ *      Otherwise main() runs the files given (as AFL expects), or with
+ *      "-r <count> [seed]" runs that many inputs mutated from the files.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <CmdLib/AtCmdLib.h>
+#include "host_stubs.h"
+#if defined(__SANITIZE_ADDRESS__) && !defined(HOST_LIBFUZZER)
+#include <sanitizer/common_interface_defs.h>
+#define FUZZ_SAVE_CRASH
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define FUZZ_FLAG_COMMAND           0x01
+#define FUZZ_FLAG_STREAM            0x02
+#define FUZZ_MAX_INPUT              (64UL * 1024UL)
+#define FUZZ_MAX_SEEDS              64
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static uint32_t G_FuzzLines;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzLine
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Line callback of a streamed command.  Touches every byte so the
+ *      sanitizers see a bad pointer or length.
+ *---------------------------------------------------------------------------*/
+static void IFuzzLine(
+        const char *pLine,
+        uint16_t length,
+        uint8_t isPartial,
+        void *pContext)
+{
+    volatile char sum = 0;
+    uint16_t i;
+
+    (void)isPartial;
+    (void)pContext;
+    for (i = 0; i < length; i++)
+        sum ^= pLine[i];
+    G_FuzzLines++;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzParse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Command callback: run the response parsers over what is in
+ *      MRBuffer.
+ *---------------------------------------------------------------------------*/
+static void IFuzzParse(uint8_t handle, HOST_APP_MSG_ID_E msgId, void *pContext)
+{
+    char text[64];
+    int8_t ip[64];
+    uint8_t bytes[6];
+    int32_t value;
+    int16_t rssi;
+    uint8_t cid;
+    uint16_t length;
+    uint8_t i;
+
+    (void)handle;
+    (void)msgId;
+    (void)pContext;
+    for (i = 0; i < AtLib_ResponseNumLines(); i++)
+        AtLib_ResponseLine(i, &length);
+    for (i = 0; i < AtLib_ResponseNumTokens(); i++)
+        AtLib_ResponseToken(i);
+    AtLib_ResponseGetInt("RSSI", &value);
+    AtLib_ResponseGetIP("IP addr", bytes);
+    AtLib_ResponseGetMAC("MAC", bytes);
+    AtLib_ResponseGetString("SSID", text, sizeof(text));
+    AtLib_ParseTcpClientCid();
+    AtLib_ParseUdpClientCid();
+    AtLib_ParseWlanConnStat();
+    AtLib_ParseGetMacResponse(text);
+    AtLib_ParseNodeIpAddress(ip);
+    AtLib_ParseRssiResponse(&rssi);
+    AtLib_ParseUdpServerStartResponse(&cid);
+    AtLib_ParseTcpServerStartResponse(&cid);
+    AtLib_ParseDNSLookupResponse(text);
+    AtLib_ParseWPSPUSHResponse();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  LLVMFuzzerTestOneInput
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Run one input through the library from a clean state.
+ * Inputs:
+ *      const uint8_t *data -- Input (see the top of the file)
+ *      size_t size -- Input length
+ * Outputs:
+ *      int -- 0
+ *---------------------------------------------------------------------------*/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint32_t idle;
+
+    if (size < 2)
+        return 0;
+
+    Host_Reset();
+    AtLib_Init();
+    Host_SetReadChunk(data[0]);
+    if (data[1] & FUZZ_FLAG_COMMAND) {
+        AtLib_CommandQueueStream("AT+NSTAT=?\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+                (data[1] & FUZZ_FLAG_STREAM) ? IFuzzLine : 0, IFuzzParse, 0);
+    }
+    Host_RxPush(data + 2, size - 2);
+
+    /* Run until everything is read and the command is done */
+    for (idle = 0; idle < 3; ) {
+        AtLib_Poll();
+        if ((Host_RxPending()) || (AtLib_IsCommandBusy()))
+            idle = 0;
+        else
+            idle++;
+        if (!Host_RxPending())
+            Host_TimeAdvance(1000);
+    }
+
+    return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+/* Input being run, written to fuzz-crash.bin if a sanitizer stops us */
+static const uint8_t *G_FuzzInput;
+static size_t G_FuzzInputSize;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzSaveCrash
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Sanitizer death callback: keep the input that failed.
+ *---------------------------------------------------------------------------*/
+static void IFuzzSaveCrash(void)
+{
+    FILE *fp = fopen("fuzz-crash.bin", "wb");
+
+    if (fp) {
+        fwrite(G_FuzzInput, 1, G_FuzzInputSize, fp);
+        fclose(fp);
+        fprintf(stderr, "Input saved in fuzz-crash.bin\n");
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzAbort
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      SIGABRT handler: UndefinedBehaviorSanitizer aborts without calling
+ *      the death callback, so keep the input here too.
+ *---------------------------------------------------------------------------*/
+static void IFuzzAbort(int aSignal)
+{
+    IFuzzSaveCrash();
+    signal(aSignal, SIG_DFL);
+    raise(aSignal);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  __ubsan_default_options
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Make UndefinedBehaviorSanitizer abort (see IFuzzAbort) with a stack
+ *      trace.
+ *---------------------------------------------------------------------------*/
+const char *__ubsan_default_options(void)
+{
+    return "abort_on_error=1:print_stacktrace=1";
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Run one input, remembering it for IFuzzSaveCrash.
+ *---------------------------------------------------------------------------*/
+static void IFuzzRun(const uint8_t *p, size_t size)
+{
+    G_FuzzInput = p;
+    G_FuzzInputSize = size;
+    LLVMFuzzerTestOneInput(p, size);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzLoad
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Read a file into a new buffer.
+ *---------------------------------------------------------------------------*/
+static uint8_t *IFuzzLoad(const char *aName, size_t *pSize)
+{
+    FILE *fp = fopen(aName, "rb");
+    uint8_t *p;
+
+    if (!fp) {
+        perror(aName);
+        exit(2);
+    }
+    p = malloc(FUZZ_MAX_INPUT);
+    *pSize = fread(p, 1, FUZZ_MAX_INPUT, fp);
+    fclose(fp);
+
+    return p;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IFuzzMutate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Make a new input from a seed: flip, insert, delete and repeat
+ *      bytes, and put in long lines and the special characters of the
+ *      S2W protocol.
+ *---------------------------------------------------------------------------*/
+static size_t IFuzzMutate(uint8_t *p, size_t size, size_t maxSize)
+{
+    static const uint8_t special[] = { 0x1B, '\r', '\n', 'S', 'Z', 'H',
+            'R', ':', 'E', 'O', 'F', '0', '9' };
+    uint32_t count = 1 + (rand() % 8);
+    size_t at;
+    size_t len;
+
+    while (count--) {
+        at = (size) ? (size_t)rand() % size : 0;
+        switch (rand() % 6) {
+            case 0:
+                if (size)
+                    p[at] ^= (uint8_t)(1 << (rand() % 8));
+                break;
+            case 1:
+                if (size)
+                    p[at] = special[rand() % sizeof(special)];
+                break;
+            case 2:
+                /* Insert a run of one byte, up to a few times MRBuffer */
+                len = 1 + (rand() % 1200);
+                if (size + len > maxSize)
+                    break;
+                memmove(p + at + len, p + at, size - at);
+                memset(p + at, (rand() & 1) ? 'x' : rand(), len);
+                size += len;
+                break;
+            case 3:
+                /* Delete some bytes */
+                len = rand() % 16;
+                if (at + len > size)
+                    len = size - at;
+                memmove(p + at, p + at + len, size - at - len);
+                size -= len;
+                break;
+            case 4:
+                /* Repeat a piece */
+                len = 1 + (rand() % 64);
+                if ((at + len > size) || (size + len > maxSize))
+                    break;
+                memmove(p + at + len, p + at, size - at);
+                size += len;
+                break;
+            default:
+                if (size < maxSize) {
+                    memmove(p + at + 1, p + at, size - at);
+                    p[at] = special[rand() % sizeof(special)];
+                    size++;
+                }
+                break;
+        }
+    }
+
+    return size;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      fuzz_atcmdlib <file>...               -- run each file once
+ *      fuzz_atcmdlib -r <count> [seed] <file>... -- run mutated inputs
+ *---------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    uint8_t *seeds[FUZZ_MAX_SEEDS];
+    size_t sizes[FUZZ_MAX_SEEDS];
+    uint8_t *input;
+    size_t size;
+    unsigned long runs = 0;
+    unsigned long run;
+    int numSeeds = 0;
+    int first = 1;
+    int s;
+
+#ifdef FUZZ_SAVE_CRASH
+    __sanitizer_set_death_callback(IFuzzSaveCrash);
+#endif
+    signal(SIGABRT, IFuzzAbort);
+    if ((argc > 2) && (strcmp(argv[1], "-r") == 0)) {
+        runs = strtoul(argv[2], 0, 0);
+        first = 3;
+        if ((argc > 3) && (argv[3][0] >= '0') && (argv[3][0] <= '9'))
+            srand((unsigned)strtoul(argv[first++], 0, 0));
+    }
+    for (s = first; (s < argc) && (numSeeds < FUZZ_MAX_SEEDS); s++) {
+        seeds[numSeeds] = IFuzzLoad(argv[s], &sizes[numSeeds]);
+        IFuzzRun(seeds[numSeeds], sizes[numSeeds]);
+        numSeeds++;
+    }
+    printf("%d inputs run\n", numSeeds);
+
+    if ((runs) && (numSeeds)) {
+        input = malloc(FUZZ_MAX_INPUT);
+        for (run = 0; run < runs; run++) {
+            s = rand() % numSeeds;
+            memcpy(input, seeds[s], sizes[s]);
+            size = IFuzzMutate(input, sizes[s], FUZZ_MAX_INPUT);
+            IFuzzRun(input, size);
+        }
+        free(input);
+        printf("%lu mutated inputs run, %lu lines streamed\n", runs,
+                (unsigned long)G_FuzzLines);
+    }
+    for (s = 0; s < numSeeds; s++)
+        free(seeds[s]);
+
+    return 0;
+}
+#endif // HOST_LIBFUZZER
+
+/*-------------------------------------------------------------------------*
+ * End of File:  fuzz_atcmdlib.c
+ *-------------------------------------------------------------------------*/
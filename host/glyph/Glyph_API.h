@@ -0,0 +1,8 @@
+/*-------------------------------------------------------------------------*
+ * File:  Glyph_API.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      lcd.c includes glyph_api.h by this name, which only a case
+ *      insensitive file system finds.
+ *-------------------------------------------------------------------------*/
+#include "../../drv/Glyph/glyph_api.h"
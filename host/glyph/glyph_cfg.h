@@ -0,0 +1,8 @@
+/*-------------------------------------------------------------------------*
+ * File:  glyph_cfg.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      glyph_api.h includes Glyph_cfg.h by this name, which only a case
+ *      insensitive file system finds.
+ *-------------------------------------------------------------------------*/
+#include "../../drv/Glyph/Glyph_cfg.h"
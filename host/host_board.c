@@ -0,0 +1,115 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_board.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Host (PC) versions of the board drivers linked into the full stack
+ *      (Apps/App_Common.c and drv/Transport.c) that have nothing behind
+ *      them on a PC: UART2 with no module on it and an EEPROM held in
+ *      memory.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <drv/UART2.h>
+#include <sensors/eeprom.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define HOST_EEPROM_SIZE            256
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Blank (all 0xFF) until written */
+static uint8_t G_HostEEPROM[HOST_EEPROM_SIZE];
+static bool G_HostEEPROMInit;
+
+/* Last rate given to UART2_Start or UART2_SetBaudRate */
+static uint32_t G_HostUART2Baud;
+
+/*-------------------------------------------------------------------------*
+ * UART2 driver (see drv/UART2.c): nothing connected, bytes sent are lost
+ * and none arrive.  Host_UART2_BaudRate gives the rate it was set to.
+ *-------------------------------------------------------------------------*/
+void UART2_Start(uint32_t baud)
+{
+    G_HostUART2Baud = baud;
+}
+
+void UART2_SetBaudRate(uint32_t baud)
+{
+    G_HostUART2Baud = baud;
+}
+
+uint32_t Host_UART2_BaudRate(void)
+{
+    return G_HostUART2Baud;
+}
+
+void UART2_Stop(void)
+{
+}
+
+uint32_t UART2_ReceiveData(uint8_t *aData, uint32_t aMaxLen)
+{
+    (void)aData;
+    (void)aMaxLen;
+    return 0;
+}
+
+uint32_t UART2_SendData(const uint8_t *aData, uint32_t aLen)
+{
+    (void)aData;
+    return aLen;
+}
+
+bool UART2_IsTransmitEmpty(void)
+{
+    return true;
+}
+
+uint32_t UART2_GetOverflowCount(void)
+{
+    return 0;
+}
+
+uint16_t UART2_GetErrorCount(void)
+{
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * EEPROM (see sensors/eeprom.c)
+ *-------------------------------------------------------------------------*/
+static void IHost_EEPROMInit(void)
+{
+    if (!G_HostEEPROMInit) {
+        memset(G_HostEEPROM, 0xFF, sizeof(G_HostEEPROM));
+        G_HostEEPROMInit = true;
+    }
+}
+
+void EEPROM_Write(uint16_t addr, char *pdata)
+{
+    IHost_EEPROMInit();
+    while ((*pdata != '\0') && (addr < HOST_EEPROM_SIZE))
+        G_HostEEPROM[addr++] = (uint8_t)*pdata++;
+}
+
+int16_t EEPROM_Seq_Read(uint16_t addr, uint8_t *pdata, uint16_t r_lenth)
+{
+    IHost_EEPROMInit();
+    while (r_lenth--)
+        *pdata++ = (addr < HOST_EEPROM_SIZE) ? G_HostEEPROM[addr++] : 0xFF;
+    return 1;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  host_board.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,584 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_pty.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Pseudo terminal transport of the PC build (TRANSPORT_PTY, see
+ *      drv/Transport.h).  Host_Pty_Start forks a simulated GainSpan
+ *      module on the slave side of a pseudo terminal, so the whole stack
+ *      (the Apps, App_Read/App_Write, drv/Transport.c and CmdLib) runs
+ *      on Linux against it, through a real file descriptor.
+ *
+ *      The module answers a few commands (AT, ATE, ATB, AT+NMAC=?,
+ *      AT+NSTAT=?, AT+WRSSI=?, AT+NCTCP, AT+NCLOSE, AT+NCLOSEALL,
+ *      AT+BDATA) with OK and their response lines, and anything else
+ *      with ERROR: INVALID INPUT.  The far end of each connection is an
+ *      echo server: <ESC>S and <ESC>Z data frames come back on the same
+ *      connection as they were sent.
+ *
+ *      Host_Pty_Poll drains the pseudo terminal into a receive FIFO, as
+ *      the UART receive interrupt does, so the module never blocks while
+ *      we write.  As with the App_* routines of host_stubs.c, time moves
+ *      1 ms for each read that finds nothing (after waiting up to 1 ms
+ *      for the module).
+ *-------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <drv/Transport.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_PTY_RX_BUFFER_SIZE
+#define HOST_PTY_RX_BUFFER_SIZE     4096
+#endif
+
+#if (HOST_PTY_RX_BUFFER_SIZE & (HOST_PTY_RX_BUFFER_SIZE - 1))
+#error "HOST_PTY_RX_BUFFER_SIZE must be a power of two"
+#endif
+#define HOST_PTY_RX_MASK            (HOST_PTY_RX_BUFFER_SIZE - 1)
+
+#define HOST_PTY_ESC                0x1B
+#define HOST_PTY_LINE_SIZE          256
+#define HOST_PTY_FRAME_SIZE         2048
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Where the module is in what we send it */
+typedef enum {
+    HOST_PTY_STATE_LINE,        /* Command text */
+    HOST_PTY_STATE_ESC,         /* After <ESC> */
+    HOST_PTY_STATE_S_CID,       /* After <ESC>S */
+    HOST_PTY_STATE_S_DATA,      /* <ESC>S data, up to <ESC>E */
+    HOST_PTY_STATE_S_DATA_ESC,  /* <ESC> in <ESC>S data */
+    HOST_PTY_STATE_Z_CID,       /* After <ESC>Z */
+    HOST_PTY_STATE_Z_LEN,       /* 4 digit length of <ESC>Z */
+    HOST_PTY_STATE_Z_DATA       /* <ESC>Z data */
+} HOST_PTY_STATE_E;
+
+/* Simulated module (the forked process) */
+typedef struct {
+    int iFD;
+    bool iEcho;
+    HOST_PTY_STATE_E iState;
+    char iLine[HOST_PTY_LINE_SIZE];
+    uint16_t iLineLen;
+    uint8_t iFrame[HOST_PTY_FRAME_SIZE];
+    uint16_t iFrameLen;
+    uint16_t iFrameWant;
+    uint8_t iDigits;
+    uint16_t iConnected;        /* Bit per open CID 0 to f */
+} HOST_PTY_MODULE_T;
+
+/* Response lines of the fixed answers */
+typedef struct {
+    const char *iCommand;
+    const char *iLines;
+} HOST_PTY_ANSWER_T;
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static const HOST_PTY_ANSWER_T G_HostPtyAnswers[] = {
+    { "AT", "" },
+    { "AT+NMAC=?", "\r\n00:1d:c9:01:02:03" },
+    { "AT+NSTAT=?",
+        "\r\nMAC=00:1d:c9:01:02:03"
+        "\r\nWSTATE=CONNECTED     MODE=INFRA"
+        "\r\nBSSID=00:24:01:aa:bb:cc   SSID=\"exosite-demo\"   CHANNEL=6   "
+            "SECURITY=WPA2-PERSONAL"
+        "\r\nRSSI=-52"
+        "\r\nIP addr=192.168.1.105   SubNet=255.255.255.0  "
+            "Gateway=192.168.1.1"
+        "\r\nDNS1=192.168.1.1       DNS2=0.0.0.0"
+        "\r\nRx Count=1234    Tx Count=987" },
+    { "AT+WRSSI=?", "\r\n-52" },
+    { "AT+BDATA=0", "" },
+    { "AT+BDATA=1", "" },
+};
+
+/* Our side of the pseudo terminal */
+static int G_HostPtyFD = -1;
+static pid_t G_HostPtyModule = -1;
+static uint32_t G_HostPtyErrors;
+static uint32_t G_HostPtyDropped;
+
+/* Bytes from the module, not read yet */
+static uint8_t G_HostPtyRx[HOST_PTY_RX_BUFFER_SIZE];
+static uint16_t G_HostPtyRxIn;
+static uint16_t G_HostPtyRxOut;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_Pty_ModuleSend
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Module side: send all the bytes, waiting as needed.
+ *---------------------------------------------------------------------------*/
+static void IHost_Pty_ModuleSend(
+        HOST_PTY_MODULE_T *aModule,
+        const void *aData,
+        uint32_t aLen)
+{
+    const uint8_t *p = aData;
+    ssize_t count;
+
+    while (aLen) {
+        count = write(aModule->iFD, p, aLen);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            _exit(0);
+        }
+        p += count;
+        aLen -= (uint32_t)count;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_Pty_ModuleCommand
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Module side: answer a command line.
+ *---------------------------------------------------------------------------*/
+static void IHost_Pty_ModuleCommand(HOST_PTY_MODULE_T *aModule)
+{
+    static const char ok[] = "\r\nOK\r\n";
+    static const char error[] = "\r\nERROR: INVALID INPUT\r\n";
+    const char *p_line = aModule->iLine;
+    char text[32];
+    uint8_t cid;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(G_HostPtyAnswers) / sizeof(G_HostPtyAnswers[0]);
+            i++) {
+        if (strcmp(p_line, G_HostPtyAnswers[i].iCommand) == 0) {
+            IHost_Pty_ModuleSend(aModule, G_HostPtyAnswers[i].iLines,
+                    strlen(G_HostPtyAnswers[i].iLines));
+            IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+            return;
+        }
+    }
+
+    if ((strcmp(p_line, "ATE0") == 0) || (strcmp(p_line, "ATE1") == 0)) {
+        aModule->iEcho = (p_line[3] == '1');
+        IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+    } else if (strncmp(p_line, "ATB=", 4) == 0) {
+        /* A pseudo terminal has no rate, only the standard ones are */
+        /* taken */
+        switch (strtoul(p_line + 4, 0, 10)) {
+            case 9600:
+            case 19200:
+            case 38400:
+            case 57600:
+            case 115200:
+            case 230400:
+            case 460800:
+            case 921600:
+                IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+                break;
+            default:
+                IHost_Pty_ModuleSend(aModule, error, sizeof(error) - 1);
+                break;
+        }
+    } else if (strncmp(p_line, "AT+NCTCP=", 9) == 0) {
+        /* Lowest free CID */
+        for (cid = 0; (cid < 16) && (aModule->iConnected & (1 << cid));
+                cid++)
+            ;
+        if (cid == 16) {
+            IHost_Pty_ModuleSend(aModule, "\r\nERROR\r\n", 9);
+            return;
+        }
+        aModule->iConnected |= (uint16_t)(1 << cid);
+        snprintf(text, sizeof(text), "\r\nCONNECT %x", cid);
+        IHost_Pty_ModuleSend(aModule, text, strlen(text));
+        IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+    } else if (strcmp(p_line, "AT+NCLOSEALL") == 0) {
+        aModule->iConnected = 0;
+        IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+    } else if (strncmp(p_line, "AT+NCLOSE=", 10) == 0) {
+        aModule->iConnected &= (uint16_t)~(1 << (strtoul(p_line + 10, 0, 16)
+                & 15));
+        IHost_Pty_ModuleSend(aModule, ok, sizeof(ok) - 1);
+    } else {
+        IHost_Pty_ModuleSend(aModule, error, sizeof(error) - 1);
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_Pty_ModuleFrame
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Module side: the echo server at the far end of the connection
+ *      sends the data of a frame back, in the same kind of frame.
+ *---------------------------------------------------------------------------*/
+static void IHost_Pty_ModuleFrame(HOST_PTY_MODULE_T *aModule, char aKind)
+{
+    char head[12];
+
+    if (aKind == 'S') {
+        head[0] = HOST_PTY_ESC;
+        head[1] = 'S';
+        head[2] = aModule->iLine[0];
+        IHost_Pty_ModuleSend(aModule, head, 3);
+        IHost_Pty_ModuleSend(aModule, aModule->iFrame, aModule->iFrameLen);
+        head[1] = 'E';
+        IHost_Pty_ModuleSend(aModule, head, 2);
+    } else {
+        snprintf(head, sizeof(head), "%cZ%c%04u", HOST_PTY_ESC,
+                aModule->iLine[0], aModule->iFrameLen);
+        IHost_Pty_ModuleSend(aModule, head, 7);
+        IHost_Pty_ModuleSend(aModule, aModule->iFrame, aModule->iFrameLen);
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_Pty_ModuleByte
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Module side: handle one byte we sent.  The CID of a frame is kept
+ *      in iLine[0].
+ *---------------------------------------------------------------------------*/
+static void IHost_Pty_ModuleByte(HOST_PTY_MODULE_T *aModule, uint8_t c)
+{
+    switch (aModule->iState) {
+        case HOST_PTY_STATE_LINE:
+            if (c == HOST_PTY_ESC) {
+                aModule->iState = HOST_PTY_STATE_ESC;
+                break;
+            }
+            if (aModule->iEcho)
+                IHost_Pty_ModuleSend(aModule, &c, 1);
+            if ((c == '\r') || (c == '\n')) {
+                if (aModule->iLineLen) {
+                    aModule->iLine[aModule->iLineLen] = '\0';
+                    IHost_Pty_ModuleCommand(aModule);
+                }
+                aModule->iLineLen = 0;
+            } else if (aModule->iLineLen < HOST_PTY_LINE_SIZE - 1) {
+                aModule->iLine[aModule->iLineLen++] = (char)c;
+            }
+            break;
+        case HOST_PTY_STATE_ESC:
+            aModule->iLineLen = 0;
+            aModule->iFrameLen = 0;
+            if (c == 'S')
+                aModule->iState = HOST_PTY_STATE_S_CID;
+            else if (c == 'Z')
+                aModule->iState = HOST_PTY_STATE_Z_CID;
+            else
+                aModule->iState = HOST_PTY_STATE_LINE;
+            break;
+        case HOST_PTY_STATE_S_CID:
+            aModule->iLine[0] = (char)c;
+            aModule->iState = HOST_PTY_STATE_S_DATA;
+            break;
+        case HOST_PTY_STATE_S_DATA:
+            if (c == HOST_PTY_ESC)
+                aModule->iState = HOST_PTY_STATE_S_DATA_ESC;
+            else if (aModule->iFrameLen < HOST_PTY_FRAME_SIZE)
+                aModule->iFrame[aModule->iFrameLen++] = c;
+            break;
+        case HOST_PTY_STATE_S_DATA_ESC:
+            if (c == 'E') {
+                IHost_Pty_ModuleFrame(aModule, 'S');
+                aModule->iState = HOST_PTY_STATE_LINE;
+                break;
+            }
+            /* Not the end, the <ESC> was data */
+            if (aModule->iFrameLen < HOST_PTY_FRAME_SIZE - 1) {
+                aModule->iFrame[aModule->iFrameLen++] = HOST_PTY_ESC;
+                aModule->iFrame[aModule->iFrameLen++] = c;
+            }
+            aModule->iState = HOST_PTY_STATE_S_DATA;
+            break;
+        case HOST_PTY_STATE_Z_CID:
+            aModule->iLine[0] = (char)c;
+            aModule->iFrameWant = 0;
+            aModule->iDigits = 0;
+            aModule->iState = HOST_PTY_STATE_Z_LEN;
+            break;
+        case HOST_PTY_STATE_Z_LEN:
+            aModule->iFrameWant = (uint16_t)(aModule->iFrameWant * 10
+                    + (c - '0'));
+            if (++aModule->iDigits < 4)
+                break;
+            if (aModule->iFrameWant > HOST_PTY_FRAME_SIZE)
+                aModule->iFrameWant = HOST_PTY_FRAME_SIZE;
+            aModule->iState = (aModule->iFrameWant) ? HOST_PTY_STATE_Z_DATA
+                    : HOST_PTY_STATE_LINE;
+            break;
+        case HOST_PTY_STATE_Z_DATA:
+            aModule->iFrame[aModule->iFrameLen++] = c;
+            if (aModule->iFrameLen == aModule->iFrameWant) {
+                IHost_Pty_ModuleFrame(aModule, 'Z');
+                aModule->iState = HOST_PTY_STATE_LINE;
+            }
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_Pty_Module
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The simulated module, run in the forked process until our side of
+ *      the pseudo terminal is closed.
+ *---------------------------------------------------------------------------*/
+static void IHost_Pty_Module(int aFD)
+{
+    static HOST_PTY_MODULE_T module;
+    uint8_t buffer[512];
+    ssize_t count;
+    ssize_t i;
+
+    memset(&module, 0, sizeof(module));
+    module.iFD = aFD;
+    module.iEcho = true;
+    module.iState = HOST_PTY_STATE_LINE;
+
+    /* The module says hello after its reset */
+    IHost_Pty_ModuleSend(&module, "\r\nSerial2WiFi APP\r\n", 19);
+    while (1) {
+        count = read(aFD, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (count == 0)
+            break;
+        for (i = 0; i < count; i++)
+            IHost_Pty_ModuleByte(&module, buffer[i]);
+    }
+    _exit(0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Start
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Open a pseudo terminal in raw mode and start the simulated module
+ *      on its slave side.  Exits the program if that cannot be done.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_Pty_Start(void)
+{
+    struct termios settings;
+    int slave;
+
+    G_HostPtyRxIn = G_HostPtyRxOut = 0;
+    G_HostPtyErrors = G_HostPtyDropped = 0;
+
+    G_HostPtyFD = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((G_HostPtyFD < 0) || (grantpt(G_HostPtyFD) != 0)
+            || (unlockpt(G_HostPtyFD) != 0)) {
+        perror("host_pty: posix_openpt");
+        exit(2);
+    }
+    slave = open(ptsname(G_HostPtyFD), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror("host_pty: open slave");
+        exit(2);
+    }
+
+    /* Raw before the module starts, so no byte is ever translated */
+    /* or echoed by the terminal itself */
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+
+    fflush(stdout);
+    G_HostPtyModule = fork();
+    if (G_HostPtyModule < 0) {
+        perror("host_pty: fork");
+        exit(2);
+    }
+    if (G_HostPtyModule == 0) {
+        close(G_HostPtyFD);
+        IHost_Pty_Module(slave);
+    }
+    close(slave);
+    fcntl(G_HostPtyFD, F_SETFL, fcntl(G_HostPtyFD, F_GETFL) | O_NONBLOCK);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Stop
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Close the pseudo terminal and end the simulated module.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_Pty_Stop(void)
+{
+    if (G_HostPtyFD >= 0) {
+        close(G_HostPtyFD);
+        G_HostPtyFD = -1;
+    }
+    if (G_HostPtyModule > 0) {
+        kill(G_HostPtyModule, SIGTERM);
+        waitpid(G_HostPtyModule, 0, 0);
+        G_HostPtyModule = -1;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Write
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Send as many bytes as the pseudo terminal takes.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to send
+ *      uint32_t aLen -- Number of bytes to send
+ * Outputs:
+ *      uint32_t -- Number of bytes taken
+ *---------------------------------------------------------------------------*/
+uint32_t Host_Pty_Write(const uint8_t *aData, uint32_t aLen)
+{
+    ssize_t count;
+
+    if ((G_HostPtyFD < 0) || (!aLen))
+        return 0;
+    count = write(G_HostPtyFD, aData, aLen);
+    if (count < 0) {
+        if ((errno != EAGAIN) && (errno != EINTR))
+            G_HostPtyErrors++;
+        return 0;
+    }
+
+    return (uint32_t)count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Poll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Move what the module has sent into the receive FIFO.  Bytes that
+ *      do not fit are dropped and counted.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_Pty_Poll(void)
+{
+    uint8_t buffer[512];
+    ssize_t count;
+    ssize_t i;
+    uint16_t next;
+
+    if (G_HostPtyFD < 0)
+        return;
+    while (1) {
+        count = read(G_HostPtyFD, buffer, sizeof(buffer));
+        if (count <= 0) {
+            if ((count < 0) && (errno != EAGAIN) && (errno != EINTR))
+                G_HostPtyErrors++;
+            return;
+        }
+        for (i = 0; i < count; i++) {
+            next = (G_HostPtyRxIn + 1) & HOST_PTY_RX_MASK;
+            if (next == G_HostPtyRxOut) {
+                G_HostPtyDropped++;
+                continue;
+            }
+            G_HostPtyRx[G_HostPtyRxIn] = buffer[i];
+            G_HostPtyRxIn = next;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Read
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the bytes that have arrived from the module.  If there are
+ *      none, wait up to 1 ms for some and, if still none, let 1 ms of
+ *      time pass (Host_TimeAdvance).
+ * Inputs:
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint32_t aMaxLen -- Most bytes to store
+ * Outputs:
+ *      uint32_t -- Number of bytes stored
+ *---------------------------------------------------------------------------*/
+uint32_t Host_Pty_Read(uint8_t *aData, uint32_t aMaxLen)
+{
+    struct pollfd wait;
+    uint32_t count = 0;
+
+    Host_Pty_Poll();
+    if ((G_HostPtyRxIn == G_HostPtyRxOut) && (G_HostPtyFD >= 0)) {
+        wait.fd = G_HostPtyFD;
+        wait.events = POLLIN;
+        if (poll(&wait, 1, 1) > 0)
+            Host_Pty_Poll();
+    }
+    if (G_HostPtyRxIn == G_HostPtyRxOut) {
+        Host_TimeAdvance(1);
+        return 0;
+    }
+
+    while ((count < aMaxLen) && (G_HostPtyRxOut != G_HostPtyRxIn)) {
+        aData[count++] = G_HostPtyRx[G_HostPtyRxOut];
+        G_HostPtyRxOut = (G_HostPtyRxOut + 1) & HOST_PTY_RX_MASK;
+    }
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_Flush
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Bytes taken by Host_Pty_Write are with the module already.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- Always true
+ *---------------------------------------------------------------------------*/
+bool Host_Pty_Flush(void)
+{
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Pty_GetStats
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Fill in the error counters of the pseudo terminal transport.
+ * Inputs:
+ *      TRANSPORT_STATS_T *aStats -- Place to store the counters
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_Pty_GetStats(TRANSPORT_STATS_T *aStats)
+{
+    aStats->iBytesDropped = G_HostPtyDropped;
+    aStats->iErrors = G_HostPtyErrors;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  host_pty.c
+ *-------------------------------------------------------------------------*/
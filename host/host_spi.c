@@ -0,0 +1,394 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_spi.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Host (PC) versions of the device registers and of the CSI10 SPI
+ *      routines used by drv/GainSpan_SPI.c, with a simulated GainSpan
+ *      module on the bus.  See host_spi.h.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <system/platform.h>
+#include <drv/SPI_CSI10.h>
+#include <drv/GainSpan_SPI.h>
+#include "host_spi.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Data ready is P74 */
+#define HOST_SPI_DATA_READY         (1 << 4)
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Device registers used by the drivers (see system/platform.h) */
+volatile uint8_t P7;
+volatile uint8_t PMK8, PIF8, PPR08, PPR18, EGP1, EGN1;
+
+static void (*G_HostSPIBusFree[SPI_CSI10_NUM_CHANNELS])(void);
+static void (*G_HostSPIDataReady)(void);
+static bool G_HostSPIBusBusy;
+static uint32_t G_HostSPITransfers;
+
+/* Transfer started by SPI_CSI10_Transfer and not clocked yet */
+static bool G_HostSPIPending;
+static uint32_t G_HostSPINumBytes;
+static const uint8_t *G_HostSPISend;
+static uint8_t *G_HostSPIReceive;
+static void (*G_HostSPICallback)(void);
+
+/* Bytes the module has to send us (already escaped), and the data it */
+/* got from us (unescaped, IDLE fill removed) */
+static uint8_t G_HostSPIModuleOut[HOST_SPI_QUEUE_SIZE];
+static uint32_t G_HostSPIModuleOutIn;
+static uint32_t G_HostSPIModuleOutOut;
+static uint8_t G_HostSPIModuleIn[HOST_SPI_QUEUE_SIZE];
+static uint32_t G_HostSPIModuleInLen;
+static bool G_HostSPIModuleEscape;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_SPI_UpdateDataReady
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the data ready line from what the module has to send.  On a
+ *      rising edge, call the data ready handler if the interrupt is
+ *      enabled for it, else only flag it (PIF8).
+ *---------------------------------------------------------------------------*/
+static void IHost_SPI_UpdateDataReady(void)
+{
+    bool wasReady = (P7 & HOST_SPI_DATA_READY) ? true : false;
+
+    if (G_HostSPIModuleOutIn == G_HostSPIModuleOutOut) {
+        P7 &= (uint8_t)~HOST_SPI_DATA_READY;
+        return;
+    }
+    P7 |= HOST_SPI_DATA_READY;
+    if ((wasReady) || (!(EGP1 & 0x01)))
+        return;
+    if ((PMK8) || (!G_HostSPIDataReady)) {
+        PIF8 = 1;
+        return;
+    }
+    G_HostSPIDataReady();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_SPI_ModuleQueue
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Add a byte to what the module sends.  Bytes that do not fit are
+ *      dropped.
+ *---------------------------------------------------------------------------*/
+static void IHost_SPI_ModuleQueue(uint8_t aByte)
+{
+    if (G_HostSPIModuleOutIn < HOST_SPI_QUEUE_SIZE)
+        G_HostSPIModuleOut[G_HostSPIModuleOutIn++] = aByte;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  IHost_SPI_ModuleClock
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      One byte clocked between us and the module: the module takes
+ *      aSent and answers with its next byte, or IDLE if it has none.
+ *---------------------------------------------------------------------------*/
+static uint8_t IHost_SPI_ModuleClock(uint8_t aSent)
+{
+    uint8_t reply = GAINSPAN_SPI_CHAR_IDLE;
+
+    if (G_HostSPIModuleEscape) {
+        G_HostSPIModuleEscape = false;
+        if (G_HostSPIModuleInLen < HOST_SPI_QUEUE_SIZE)
+            G_HostSPIModuleIn[G_HostSPIModuleInLen++] = aSent ^ 0x20;
+    } else if (aSent == GAINSPAN_SPI_CHAR_ESC) {
+        G_HostSPIModuleEscape = true;
+    } else if (aSent != GAINSPAN_SPI_CHAR_IDLE) {
+        if (G_HostSPIModuleInLen < HOST_SPI_QUEUE_SIZE)
+            G_HostSPIModuleIn[G_HostSPIModuleInLen++] = aSent;
+    }
+
+    if (G_HostSPIModuleOutOut < G_HostSPIModuleOutIn)
+        reply = G_HostSPIModuleOut[G_HostSPIModuleOutOut++];
+
+    return reply;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_Reset
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Registers to their reset values (interrupt masked), no transfer,
+ *      bus free and the module with nothing to send.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SPI_Reset(void)
+{
+    P7 = 0;
+    PMK8 = 1;
+    PIF8 = 0;
+    PPR08 = PPR18 = 1;
+    EGP1 = EGN1 = 0;
+    memset(G_HostSPIBusFree, 0, sizeof(G_HostSPIBusFree));
+    G_HostSPIDataReady = 0;
+    G_HostSPIBusBusy = false;
+    G_HostSPITransfers = 0;
+    G_HostSPIPending = false;
+    G_HostSPIModuleOutIn = G_HostSPIModuleOutOut = 0;
+    G_HostSPIModuleInLen = 0;
+    G_HostSPIModuleEscape = false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_SetDataReadyHandler
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the routine run on a rising edge of data ready (the driver's
+ *      INTP8 interrupt routine).
+ * Inputs:
+ *      void (*aHandler)(void) -- Routine, or 0 for none
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SPI_SetDataReadyHandler(void (*aHandler)(void))
+{
+    G_HostSPIDataReady = aHandler;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_ModuleSend
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Have the module send data, escaped as the module does it, and
+ *      raise data ready.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to send
+ *      uint32_t aLen -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SPI_ModuleSend(const uint8_t *aData, uint32_t aLen)
+{
+    uint8_t c;
+
+    while (aLen--) {
+        c = *aData++;
+        switch (c) {
+            case GAINSPAN_SPI_CHAR_IDLE:
+            case GAINSPAN_SPI_CHAR_ESC:
+            case GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON:
+            case GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF:
+            case GAINSPAN_SPI_CHAR_INACTIVE_LINK:
+            case GAINSPAN_SPI_CHAR_INACTIVE_LINK2:
+            case GAINSPAN_SPI_CHAR_LINK_READY:
+                IHost_SPI_ModuleQueue(GAINSPAN_SPI_CHAR_ESC);
+                IHost_SPI_ModuleQueue(c ^ 0x20);
+                break;
+            default:
+                IHost_SPI_ModuleQueue(c);
+                break;
+        }
+    }
+    IHost_SPI_UpdateDataReady();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_ModuleSendRaw
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Have the module send one byte as is (e.g. XON or XOFF).  Without
+ *      data ready the byte only comes back in place of the IDLE fill of
+ *      a transfer we start.
+ * Inputs:
+ *      uint8_t aByte -- Byte to send
+ *      bool aDataReady -- true to raise data ready for it
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SPI_ModuleSendRaw(uint8_t aByte, bool aDataReady)
+{
+    IHost_SPI_ModuleQueue(aByte);
+    if (aDataReady)
+        IHost_SPI_UpdateDataReady();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_ModuleReceived
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the data the module has received so far (unescaped, without
+ *      the IDLE fill).
+ * Inputs:
+ *      const uint8_t **aData -- Place to store a pointer to the data
+ * Outputs:
+ *      uint32_t -- Number of bytes
+ *---------------------------------------------------------------------------*/
+uint32_t Host_SPI_ModuleReceived(const uint8_t **aData)
+{
+    *aData = G_HostSPIModuleIn;
+    return G_HostSPIModuleInLen;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_SetBusBusy
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Pretend another device has the bus (transfers are turned away)
+ *      or give it back, which calls the bus free handlers.
+ * Inputs:
+ *      bool aBusy -- true if another device has the bus
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SPI_SetBusBusy(bool aBusy)
+{
+    uint8_t channel;
+
+    G_HostSPIBusBusy = aBusy;
+    if (aBusy)
+        return;
+    for (channel = 0; channel < SPI_CSI10_NUM_CHANNELS; channel++) {
+        if ((G_HostSPIBusFree[channel]) && (!G_HostSPIPending))
+            G_HostSPIBusFree[channel]();
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_IsTransferPending
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine if a transfer was started and not completed yet.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if a transfer is waiting for Host_SPI_Complete
+ *---------------------------------------------------------------------------*/
+bool Host_SPI_IsTransferPending(void)
+{
+    return G_HostSPIPending;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_Complete
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Clock the pending transfer and call its callback, as the end of
+ *      transfer interrupt does.  Data ready follows what the module has
+ *      left to send.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      bool -- true if there was a transfer, else false
+ *---------------------------------------------------------------------------*/
+bool Host_SPI_Complete(void)
+{
+    uint32_t i;
+    uint8_t reply;
+
+    if (!G_HostSPIPending)
+        return false;
+
+    for (i = 0; i < G_HostSPINumBytes; i++) {
+        /* Read the byte sent first, the driver receives in place */
+        reply = IHost_SPI_ModuleClock(G_HostSPISend[i]);
+        if (G_HostSPIReceive)
+            G_HostSPIReceive[i] = reply;
+    }
+    G_HostSPIPending = false;
+    G_HostSPITransfers++;
+    if (G_HostSPIModuleOutOut == G_HostSPIModuleOutIn)
+        G_HostSPIModuleOutIn = G_HostSPIModuleOutOut = 0;
+    IHost_SPI_UpdateDataReady();
+    if (G_HostSPICallback)
+        G_HostSPICallback();
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_Run
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Complete transfers until no more are started (the driver chains
+ *      them from its callback).
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Number of transfers completed
+ *---------------------------------------------------------------------------*/
+uint32_t Host_SPI_Run(void)
+{
+    uint32_t count = 0;
+
+    while (Host_SPI_Complete())
+        count++;
+
+    return count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SPI_NumTransfers
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of transfers completed since Host_SPI_Reset.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Number of transfers
+ *---------------------------------------------------------------------------*/
+uint32_t Host_SPI_NumTransfers(void)
+{
+    return G_HostSPITransfers;
+}
+
+/*-------------------------------------------------------------------------*
+ * CSI10 SPI driver (see drv/SPI_CSI10.c)
+ *-------------------------------------------------------------------------*/
+void SPI_CSI10_ChannelSetBusFreeHandler(uint8_t channel, void (*handler)(void))
+{
+    if (channel < SPI_CSI10_NUM_CHANNELS)
+        G_HostSPIBusFree[channel] = handler;
+}
+
+bool SPI_CSI10_Transfer(
+        uint8_t channel,
+        uint32_t numBytes,
+        const uint8_t *send_buffer,
+        uint8_t *receive_buffer,
+        void(*callback)(void))
+{
+    (void)channel;
+    if ((G_HostSPIBusBusy) || (G_HostSPIPending))
+        return false;
+
+    G_HostSPIPending = true;
+    G_HostSPINumBytes = numBytes;
+    G_HostSPISend = send_buffer;
+    G_HostSPIReceive = receive_buffer;
+    G_HostSPICallback = callback;
+
+    return true;
+}
+
+void SPI_CSI10_ChannelSetBitRate(uint8_t channel, uint32_t bitsPerSecond)
+{
+    (void)channel;
+    (void)bitsPerSecond;
+}
+
+uint8_t SPI_CSI10_GetOverrunErrorCount(void)
+{
+    return 0;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  host_spi.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,49 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_spi.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Register level stand-in for the CSI10 SPI driver and the GainSpan
+ *      module on the other end of it, so drv/GainSpan_SPI.c runs on a PC.
+ *
+ *      SPI_CSI10_Transfer only records a transfer; Host_SPI_Complete
+ *      clocks it (each byte sent goes to the module, which answers with
+ *      its next byte or IDLE) and then calls the driver's callback, as
+ *      the end of transfer interrupt does.  The module's data ready line
+ *      is bit 4 of P7; its rising edge calls the handler given to
+ *      Host_SPI_SetDataReadyHandler if the driver has unmasked it (PMK8)
+ *      for the rising edge (EGP1).
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_SPI_H_
+#define HOST_SPI_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_SPI_QUEUE_SIZE
+#define HOST_SPI_QUEUE_SIZE         4096
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+void Host_SPI_Reset(void);
+void Host_SPI_SetDataReadyHandler(void (*aHandler)(void));
+void Host_SPI_ModuleSend(const uint8_t *aData, uint32_t aLen);
+void Host_SPI_ModuleSendRaw(uint8_t aByte, bool aDataReady);
+uint32_t Host_SPI_ModuleReceived(const uint8_t **aData);
+void Host_SPI_SetBusBusy(bool aBusy);
+bool Host_SPI_IsTransferPending(void);
+bool Host_SPI_Complete(void);
+uint32_t Host_SPI_Run(void);
+uint32_t Host_SPI_NumTransfers(void);
+
+#endif // HOST_SPI_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  host_spi.h
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,398 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_stubs.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Host (PC) versions of the routines CmdLib takes from the
+ *      application and the RL78 drivers.  See host_stubs.h.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <CmdLib/AtCmdLib.h>
+#include <system/mstimer.h>
+#include "host_stubs.h"
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Bytes sent by the simulated module, not read yet */
+static uint8_t G_HostRx[HOST_RX_QUEUE_SIZE];
+static uint32_t G_HostRxIn = 0;
+static uint32_t G_HostRxOut = 0;
+static uint32_t G_HostReadChunk = 0;
+
+/* Bytes written to the module (the last HOST_TX_LOG_SIZE - 1) */
+static char G_HostTx[HOST_TX_LOG_SIZE];
+static uint32_t G_HostTxLen = 0;
+
+static Host_WriteHook G_HostWriteHook = 0;
+static bool G_HostWriteReady = true;
+static Host_DataHook G_HostDataHook = 0;
+static uint32_t G_HostDataBytes = 0;
+static uint32_t G_HostTime = 0;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Reset
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Empty the simulated link, remove the hooks and set the time to 0.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_Reset(void)
+{
+    G_HostRxIn = G_HostRxOut = 0;
+    G_HostReadChunk = 0;
+    G_HostTxLen = 0;
+    G_HostTx[0] = '\0';
+    G_HostWriteHook = 0;
+    G_HostWriteReady = true;
+    G_HostDataHook = 0;
+    G_HostDataBytes = 0;
+    G_HostTime = 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_RxPush
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue bytes as if sent by the module.  Bytes that do not fit are
+ *      dropped.
+ * Inputs:
+ *      const uint8_t *aData -- Bytes to queue
+ *      uint32_t aLen -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_RxPush(const uint8_t *aData, uint32_t aLen)
+{
+    if (G_HostRxOut == G_HostRxIn) {
+        G_HostRxIn = G_HostRxOut = 0;
+    } else if (G_HostRxIn + aLen > HOST_RX_QUEUE_SIZE) {
+        /* Move the unread bytes to the start */
+        memmove(G_HostRx, G_HostRx + G_HostRxOut, G_HostRxIn - G_HostRxOut);
+        G_HostRxIn -= G_HostRxOut;
+        G_HostRxOut = 0;
+    }
+    if (aLen > HOST_RX_QUEUE_SIZE - G_HostRxIn)
+        aLen = HOST_RX_QUEUE_SIZE - G_HostRxIn;
+    memcpy(G_HostRx + G_HostRxIn, aData, aLen);
+    G_HostRxIn += aLen;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_RxPushString
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue text as if sent by the module.
+ * Inputs:
+ *      const char *aText -- Text to queue
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_RxPushString(const char *aText)
+{
+    Host_RxPush((const uint8_t *)aText, strlen(aText));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_RxPending
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of queued bytes the library has not read yet.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Bytes waiting
+ *---------------------------------------------------------------------------*/
+uint32_t Host_RxPending(void)
+{
+    return G_HostRxIn - G_HostRxOut;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SetReadChunk
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Limit the bytes App_ReadAvailable returns per call, as when only
+ *      part of a message has arrived.
+ * Inputs:
+ *      uint32_t aMaxLen -- Most bytes per call, 0 for no limit
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SetReadChunk(uint32_t aMaxLen)
+{
+    G_HostReadChunk = aMaxLen;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SetWriteHook
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the routine that sees every App_Write.
+ * Inputs:
+ *      Host_WriteHook aHook -- Routine, or 0 for none
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SetWriteHook(Host_WriteHook aHook)
+{
+    G_HostWriteHook = aHook;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SetWriteReady
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set if the module takes what is written (App_IsWriteReady).  It
+ *      does until this is called with false.
+ * Inputs:
+ *      bool aReady -- true if ready
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SetWriteReady(bool aReady)
+{
+    G_HostWriteReady = aReady;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_SetDataHook
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the routine that sees the data handed to the application
+ *      (App_ProcessIncomingData and App_ProcessIncomingSpan).
+ * Inputs:
+ *      Host_DataHook aHook -- Routine, or 0 for none
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_SetDataHook(Host_DataHook aHook)
+{
+    G_HostDataHook = aHook;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TxLength
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of bytes written to the module since Host_TxClear.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Bytes written (only the last ones are kept)
+ *---------------------------------------------------------------------------*/
+uint32_t Host_TxLength(void)
+{
+    return G_HostTxLen;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TxText
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the bytes written to the module as a string.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      const char * -- Bytes written, up to HOST_TX_LOG_SIZE - 1
+ *---------------------------------------------------------------------------*/
+const char *Host_TxText(void)
+{
+    return G_HostTx;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TxClear
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Forget the bytes written to the module.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_TxClear(void)
+{
+    G_HostTxLen = 0;
+    G_HostTx[0] = '\0';
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_DataBytes
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of data bytes handed to the application.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Bytes since Host_Reset
+ *---------------------------------------------------------------------------*/
+uint32_t Host_DataBytes(void)
+{
+    return G_HostDataBytes;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TimeAdvance
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Move the simulated millisecond timer forward.
+ * Inputs:
+ *      uint32_t aMS -- Milliseconds
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Host_TimeAdvance(uint32_t aMS)
+{
+    G_HostTime += aMS;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TimeNow
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the simulated millisecond timer.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint32_t -- Milliseconds since Host_Reset
+ *---------------------------------------------------------------------------*/
+uint32_t Host_TimeNow(void)
+{
+    return G_HostTime;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_Seconds
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the real (monotonic) time of the PC, for the benchmarks.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      double -- Seconds
+ *---------------------------------------------------------------------------*/
+double Host_Seconds(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + (t.tv_nsec * 1e-9);
+}
+
+/*-------------------------------------------------------------------------*
+ * Application routines used by CmdLib (see Apps/App_Common.c), unless the
+ * real ones are built in (HOST_APP_COMMON)
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_APP_COMMON
+void App_Write(const uint8_t *txData, uint32_t dataLength)
+{
+    uint32_t i;
+
+    for (i = 0; i < dataLength; i++) {
+        if (G_HostTxLen < HOST_TX_LOG_SIZE - 1)
+            G_HostTx[G_HostTxLen++] = (char)txData[i];
+    }
+    G_HostTx[G_HostTxLen] = '\0';
+    if (G_HostWriteHook)
+        G_HostWriteHook(txData, dataLength);
+}
+
+bool App_IsWriteReady(void)
+{
+    if (!G_HostWriteReady) {
+        /* Let time pass while the library waits */
+        G_HostTime++;
+    }
+    return G_HostWriteReady;
+}
+
+uint32_t App_ReadAvailable(uint8_t *rxData, uint32_t maxLength)
+{
+    uint32_t len = G_HostRxIn - G_HostRxOut;
+
+    if (!len) {
+        /* Nothing has arrived, let time pass */
+        G_HostTime++;
+        return 0;
+    }
+    if (len > maxLength)
+        len = maxLength;
+    if ((G_HostReadChunk) && (len > G_HostReadChunk))
+        len = G_HostReadChunk;
+    memcpy(rxData, G_HostRx + G_HostRxOut, len);
+    G_HostRxOut += len;
+
+    return len;
+}
+
+bool App_Read(uint8_t *rxData, uint32_t dataLength, uint8_t blockFlag)
+{
+    (void)blockFlag;
+
+    if ((G_HostRxIn - G_HostRxOut) < dataLength) {
+        G_HostTime++;
+        return false;
+    }
+    App_ReadAvailable(rxData, dataLength);
+    return true;
+}
+
+void App_ProcessIncomingData(uint8_t cid, uint8_t rxData)
+{
+    G_HostDataBytes++;
+    if (G_HostDataHook)
+        G_HostDataHook(cid, &rxData, 1);
+}
+
+void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint32_t dataLength)
+{
+    G_HostDataBytes += dataLength;
+    if (G_HostDataHook)
+        G_HostDataHook(cid, rxData, dataLength);
+}
+#endif
+
+void App_DelayMS(uint32_t cnt)
+{
+    G_HostTime += cnt;
+}
+
+/*-------------------------------------------------------------------------*
+ * Millisecond timer (see system/mstimer.c)
+ *-------------------------------------------------------------------------*/
+void MSTimerInit(void)
+{
+    G_HostTime = 0;
+}
+
+uint32_t MSTimerGet(void)
+{
+    return G_HostTime;
+}
+
+uint32_t MSTimerDelta(uint32_t start)
+{
+    return G_HostTime - start;
+}
+
+void MSTimerDelay(uint32_t ms)
+{
+    G_HostTime += ms;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  host_stubs.c
+ *-------------------------------------------------------------------------*/
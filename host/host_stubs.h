@@ -0,0 +1,72 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_stubs.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Stand-ins for the hardware dependent routines used by CmdLib
+ *      (App_Read, App_Write, the MSTimer routines, ...) so the library
+ *      builds and runs on a PC.  The module is simulated by a queue of
+ *      bytes it "sent" (Host_RxPush) and an optional routine that sees
+ *      everything the library writes to it (Host_SetWriteHook).
+ *
+ *      Time only moves when the library finds nothing to read (1 ms per
+ *      empty read), when it calls MSTimerDelay, or with Host_TimeAdvance,
+ *      so timeouts are reached quickly and repeatably.
+ *
+ *      Built with HOST_APP_COMMON, the App_* routines are left to
+ *      Apps/App_Common.c, which goes through drv/Transport.c (see
+ *      host_pty.c); only the time routines are used then.
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_STUBS_H_
+#define HOST_STUBS_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_RX_QUEUE_SIZE
+#define HOST_RX_QUEUE_SIZE          (1024UL * 1024UL)
+#endif
+
+#ifndef HOST_TX_LOG_SIZE
+#define HOST_TX_LOG_SIZE            4096
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Sees every App_Write, e.g. to answer commands like the module */
+typedef void (*Host_WriteHook)(const uint8_t *aData, uint32_t aLen);
+
+/* Sees the data the library hands to the application */
+typedef void (*Host_DataHook)(uint8_t aCid, const uint8_t *aData,
+        uint32_t aLen);
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+void Host_Reset(void);
+void Host_RxPush(const uint8_t *aData, uint32_t aLen);
+void Host_RxPushString(const char *aText);
+uint32_t Host_RxPending(void);
+void Host_SetReadChunk(uint32_t aMaxLen);
+void Host_SetWriteHook(Host_WriteHook aHook);
+void Host_SetWriteReady(bool aReady);
+void Host_SetDataHook(Host_DataHook aHook);
+uint32_t Host_TxLength(void);
+const char *Host_TxText(void);
+void Host_TxClear(void);
+uint32_t Host_DataBytes(void);
+void Host_TimeAdvance(uint32_t aMS);
+uint32_t Host_TimeNow(void);
+double Host_Seconds(void);
+uint32_t Host_UART2_BaudRate(void);
+
+#endif // HOST_STUBS_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  host_stubs.h
+ *-------------------------------------------------------------------------*/
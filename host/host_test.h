@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------*
+ * File:  host_test.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      The checks shared by the host tests.  A failed CHECK prints where
+ *      it is and the test goes on; main returns Host_TestResult().
+ *      Include it once, in the file with the tests.
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdio.h>
+
+/*-------------------------------------------------------------------------*
+ * Macros:
+ *-------------------------------------------------------------------------*/
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                    __func__, #cond); \
+            G_TestFailures++; \
+        } \
+    } while (0)
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static int G_TestFailures = 0;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Host_TestResult
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Print the result of the checks.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      int -- Exit status of the test: 0 if all checks passed, else 1
+ *---------------------------------------------------------------------------*/
+static inline int Host_TestResult(void)
+{
+    if (G_TestFailures) {
+        printf("%d checks failed\n", G_TestFailures);
+        return 1;
+    }
+    printf("All tests passed\n");
+    return 0;
+}
+
+#endif // HOST_TEST_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  host_test.h
+ *-------------------------------------------------------------------------*/
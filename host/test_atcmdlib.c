@@ -0,0 +1,551 @@
+/*-------------------------------------------------------------------------*
+ * File:  test_atcmdlib.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Tests of the AtCmdLib receive path and command engine, run on the
+ *      PC against the simulated module of host_stubs.c.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <CmdLib/AtCmdLib.h>
+#include <CmdLib/AtCidRx.h>
+#include "host_stubs.h"
+#include "host_test.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Bytes sent in one bulk data frame by TestBulkNotReady */
+#define ATLIB_TEST_BULK_SIZE        200
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Results of the command callback */
+static HOST_APP_MSG_ID_E G_TestMsgId;
+static uint8_t G_TestHandle;
+static uint32_t G_TestDone;
+
+/* Lines streamed to ITestLine */
+static char G_TestLines[2048];
+static uint32_t G_TestNumLines;
+
+/* Data handed to the application */
+static uint8_t G_TestData[2048];
+static uint32_t G_TestDataLen;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Command callback: keep the response type.
+ *---------------------------------------------------------------------------*/
+static void ITestDone(uint8_t handle, HOST_APP_MSG_ID_E msgId, void *pContext)
+{
+    (void)pContext;
+    G_TestHandle = handle;
+    G_TestMsgId = msgId;
+    G_TestDone++;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestLine
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Line callback: keep the lines, one per text line.
+ *---------------------------------------------------------------------------*/
+static void ITestLine(
+        const char *pLine,
+        uint16_t length,
+        uint8_t isPartial,
+        void *pContext)
+{
+    size_t used = strlen(G_TestLines);
+
+    (void)pContext;
+    if (used + length + 2 < sizeof(G_TestLines)) {
+        memcpy(G_TestLines + used, pLine, length);
+        G_TestLines[used + length] = (isPartial) ? '\0' : '\n';
+        G_TestLines[used + length + 1] = '\0';
+    }
+    if (!isPartial)
+        G_TestNumLines++;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Data hook: keep the data handed to the application.
+ *---------------------------------------------------------------------------*/
+static void ITestData(uint8_t aCid, const uint8_t *aData, uint32_t aLen)
+{
+    (void)aCid;
+    if (G_TestDataLen + aLen <= sizeof(G_TestData))
+        memcpy(G_TestData + G_TestDataLen, aData, aLen);
+    G_TestDataLen += aLen;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestAnswerOK
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write hook: the module answers OK to each command.
+ *---------------------------------------------------------------------------*/
+static void ITestAnswerOK(const uint8_t *aData, uint32_t aLen)
+{
+    if ((aLen >= 2) && (aData[aLen - 1] == '\n'))
+        Host_RxPushString("\r\nOK\r\n");
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestQueueAssoc
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Command callback: queue another command, as WIFI_init's callbacks
+ *      do.
+ *---------------------------------------------------------------------------*/
+static void ITestQueueAssoc(
+        uint8_t handle,
+        HOST_APP_MSG_ID_E msgId,
+        void *pContext)
+{
+    ITestDone(handle, msgId, pContext);
+    AtLibGs_AssocAsync((int8_t *)"net", 0, (int8_t *)"6", ITestDone, 0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestStall
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write hook: the module stops taking data after the first write.
+ *---------------------------------------------------------------------------*/
+static void ITestStall(const uint8_t *aData, uint32_t aLen)
+{
+    (void)aData;
+    (void)aLen;
+    Host_SetWriteReady(false);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestSetup
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start a test from a clean library and link.
+ *---------------------------------------------------------------------------*/
+static void ITestSetup(void)
+{
+    Host_Reset();
+    AtLib_Init();
+    Host_SetDataHook(ITestData);
+    G_TestMsgId = HOST_APP_MSG_ID_NONE;
+    G_TestHandle = 0;
+    G_TestDone = 0;
+    G_TestLines[0] = '\0';
+    G_TestNumLines = 0;
+    G_TestDataLen = 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestPoll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Run the command engine until the link is quiet.
+ *---------------------------------------------------------------------------*/
+static void ITestPoll(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < 16; i++)
+        AtLib_Poll();
+    while (Host_RxPending())
+        AtLib_Poll();
+}
+
+/*---------------------------------------------------------------------------*
+ * Tests
+ *---------------------------------------------------------------------------*/
+static void TestResponseCompletesCommand(void)
+{
+    uint8_t handle;
+
+    ITestSetup();
+    handle = AtLib_CommandQueue("AT\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+            ITestDone, 0);
+    CHECK(handle != 0);
+    AtLib_Poll();
+    CHECK(strcmp(Host_TxText(), "AT\r\n") == 0);
+    Host_RxPushString("\r\nOK\r\n");
+    ITestPoll();
+    CHECK(G_TestDone == 1);
+    CHECK(G_TestHandle == handle);
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+}
+
+static void TestDataFrames(void)
+{
+    static const uint8_t frames[] =
+            "\x1bS0hello\x1b" "E"
+            "\x1bZ10005world"
+            "\x1bS1a\x1b" "b\x1b" "E";
+
+    ITestSetup();
+    Host_SetReadChunk(3);
+    Host_RxPush(frames, sizeof(frames) - 1);
+    ITestPoll();
+    CHECK(G_TestDataLen == 13);
+    CHECK(memcmp(G_TestData, "helloworlda\x1b" "b", 13) == 0);
+}
+
+static void TestStreamedLines(void)
+{
+    ITestSetup();
+    AtLib_CommandQueueStream("AT+WS\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+            ITestLine, ITestDone, 0);
+    AtLib_Poll();
+    Host_SetReadChunk(5);
+    Host_RxPushString("\r\nnet-1\r\nnet-2\r\nNo.Of AP Found:2\r\nOK\r\n");
+    ITestPoll();
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+    CHECK(strcmp(G_TestLines, "net-1\nnet-2\nNo.Of AP Found:2\n") == 0);
+}
+
+static void TestResponseTimeout(void)
+{
+    ITestSetup();
+    AtLib_CommandQueue("AT\r\n", 100, ITestDone, 0);
+    ITestPoll();
+    Host_TimeAdvance(100);
+    AtLib_Poll();
+    CHECK(G_TestDone == 1);
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_RESPONSE_TIMEOUT);
+}
+
+static void TestLineAtBufferLimit(void)
+{
+    static char text[HOST_APP_RX_CMD_MAX_SIZE + 128];
+    uint32_t length;
+    uint32_t chunk;
+    uint8_t stream;
+
+    /* A line whose LF lands at the end of MRBuffer, then more lines */
+    for (length = HOST_APP_RX_CMD_MAX_SIZE - 8;
+            length <= HOST_APP_RX_CMD_MAX_SIZE + 2; length++) {
+        for (chunk = 1; chunk <= 64; chunk += 63) {
+            for (stream = 0; stream <= 1; stream++) {
+                ITestSetup();
+                if (stream)
+                    AtLib_CommandQueueStream("AT+WS\r\n",
+                            HOST_APP_TIMEOUT_ADAPTIVE, ITestLine, ITestDone, 0);
+                else
+                    AtLib_CommandQueue("AT+WS\r\n",
+                            HOST_APP_TIMEOUT_ADAPTIVE, ITestDone, 0);
+                AtLib_Poll();
+                Host_SetReadChunk(chunk);
+                memset(text, 'x', length - 2);
+                strcpy(text + length - 2, "\r\n");
+                Host_RxPushString(text);
+                memset(text, 'y', 60);
+                strcpy(text + 60, "\r\n");
+                Host_RxPushString(text);
+                Host_RxPushString("OK\r\n");
+                ITestPoll();
+                CHECK(G_TestDone == 1);
+                CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+            }
+        }
+    }
+}
+
+static void TestDisconnectDetachesRing(void)
+{
+    uint8_t data[8];
+
+    ITestSetup();
+    CHECK(AtCidRx_Open('1', 0));
+    CHECK(AtCidRx_Open('2', 0));
+    Host_RxPushString("\x1bS1abc\x1b" "E\r\nDISCONNECT 1\r\n");
+    ITestPoll();
+    CHECK(!AtCidRx_IsOpen('1'));
+    CHECK(AtCidRx_IsOpen('2'));
+
+    /* The CID is reused: its data no longer goes to the old ring */
+    Host_RxPushString("\x1bS1def\x1b" "E");
+    ITestPoll();
+    CHECK(G_TestDataLen == 3);
+    CHECK(memcmp(G_TestData, "def", 3) == 0);
+
+    /* The old owner still reads what arrived before the DISCONNECT */
+    CHECK(AtCidRx_Read('1', data, sizeof(data)) == 3);
+    CHECK(memcmp(data, "abc", 3) == 0);
+    CHECK(AtCidRx_Available('1') == 0);
+
+    /* A new owner starts with an empty ring */
+    Host_RxPushString("\x1bS2ghi\x1b" "E\r\nDISCONNECT 2\r\n");
+    ITestPoll();
+    CHECK(AtCidRx_Open('2', 0));
+    CHECK(AtCidRx_Available('2') == 0);
+
+    /* Dropping the association closes all the connections */
+    Host_RxPushString("\r\nDISASSOCIATED\r\n");
+    ITestPoll();
+    CHECK(!AtCidRx_IsOpen('2'));
+}
+
+static void TestTimeoutClasses(void)
+{
+    CHECK(AtLib_GetTimeoutClass("AT&W0\r\n") == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT&F\r\n") == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+WD\r\n") == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+NCLOSE=1\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+NCLOSEALL\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+STORENWCONN\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+NSET=1.2.3.4,255.0.0.0,1.2.3.1\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+WM=0\r\n") == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+VER=?\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FLASH);
+    CHECK(AtLib_GetTimeoutClass("AT+WRSSI=?\r\n")
+            == HOST_APP_TIMEOUT_CLASS_FAST);
+}
+
+static void TestDataDoesNotRestartTimeout(void)
+{
+    /* Data frames keep arriving but no response line */
+    ITestSetup();
+    AtLib_CommandQueue("AT+NSTAT=?\r\n", 100, ITestDone, 0);
+    AtLib_Poll();
+    Host_TimeAdvance(60);
+    Host_RxPushString("\x1bS1abc\x1b" "E");
+    ITestPoll();
+    Host_TimeAdvance(40);
+    AtLib_Poll();
+    CHECK(G_TestDone == 1);
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_RESPONSE_TIMEOUT);
+
+    /* A response line does restart it */
+    ITestSetup();
+    AtLib_CommandQueue("AT+NSTAT=?\r\n", 100, ITestDone, 0);
+    AtLib_Poll();
+    Host_TimeAdvance(60);
+    Host_RxPushString("\r\nMAC=00:1d:c9:00:00:01\r\n");
+    ITestPoll();
+    Host_TimeAdvance(40);
+    AtLib_Poll();
+    CHECK(G_TestDone == 0);
+}
+
+static void TestLateResponseDropped(void)
+{
+    HOST_APP_RX_STATS_T stats;
+    uint8_t handle;
+
+    ITestSetup();
+    AtLib_CommandQueue("AT&W0\r\n", 100, ITestDone, 0);
+    AtLib_Poll();
+    Host_TimeAdvance(100);
+    AtLib_Poll();
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_RESPONSE_TIMEOUT);
+    CHECK(strcmp(Host_TxText(), "AT&W0\r\nAT\r\n") == 0);
+    CHECK(AtLib_IsCommandBusy());
+
+    /* The next command waits while the late reply and the OK of "AT" */
+    /* come in */
+    Host_TxClear();
+    handle = AtLib_CommandQueue("AT+WRSSI=?\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+            ITestDone, 0);
+    Host_RxPushString("\r\nERROR\r\n\r\nOK\r\n");
+    ITestPoll();
+    CHECK(Host_TxLength() == 0);
+    CHECK(G_TestDone == 1);
+    Host_TimeAdvance(100);
+    ITestPoll();
+    CHECK(strcmp(Host_TxText(), "AT+WRSSI=?\r\n") == 0);
+    Host_RxPushString("\r\nRSSI=-40\r\nOK\r\n");
+    ITestPoll();
+    CHECK(G_TestDone == 2);
+    CHECK(G_TestHandle == handle);
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+    AtLib_GetRxStats(&stats);
+    CHECK(stats.iStaleResponses == 1);
+}
+
+static void TestResyncRetries(void)
+{
+    HOST_APP_RX_STATS_T stats;
+
+    ITestSetup();
+    AtLib_CommandQueue("AT+WD\r\n", 100, ITestDone, 0);
+    AtLib_Poll();
+    Host_TimeAdvance(100);
+    AtLib_Poll();
+
+    /* No answer to "AT" at all: give up after the retries */
+    Host_TxClear();
+    Host_TimeAdvance(AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_FAST));
+    AtLib_Poll();
+    Host_TimeAdvance(AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_FAST));
+    AtLib_Poll();
+    CHECK(strcmp(Host_TxText(), "AT\r\nAT\r\n") == 0);
+    Host_TimeAdvance(AtLib_GetTimeout(HOST_APP_TIMEOUT_CLASS_FAST));
+    AtLib_Poll();
+    CHECK(!AtLib_IsCommandBusy());
+
+    /* A reply now has no command to go to */
+    Host_RxPushString("\r\nOK\r\n");
+    ITestPoll();
+    AtLib_GetRxStats(&stats);
+    CHECK(stats.iStaleResponses == 1);
+    CHECK(G_TestDone == 1);
+}
+
+static void TestEventsDoNotComplete(void)
+{
+    static const char *events[] = {
+        "DISCONNECT 1", "DISASSOCIATED", "Disassociation Event",
+        "APP Reset-APP SW Reset", "UnExpected Warm Boot",
+        "Out of StandBy-Alarm", "Out of StandBy-Timer", "Out of Deep Sleep",
+        "Serial2WiFi APP" };
+    char text[64];
+    const char *pLine;
+    uint16_t length;
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        ITestSetup();
+        AtLib_CommandQueue("AT+NSTAT=?\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+                ITestDone, 0);
+        AtLib_Poll();
+        sprintf(text, "\r\n%s\r\n", events[i]);
+        Host_RxPushString(text);
+        Host_RxPushString("\r\nMAC=00:1d:c9:00:00:01\r\n");
+        Host_RxPushString(text);
+        Host_RxPushString("RSSI=-40\r\n");
+        ITestPoll();
+        CHECK(G_TestDone == 0);
+        Host_RxPushString("OK\r\n");
+        ITestPoll();
+        CHECK(G_TestDone == 1);
+        CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+
+        /* The event in the middle did not cut the response short */
+        pLine = AtLib_ResponseLine(0, &length);
+        CHECK((pLine) && (length == 21) && (memcmp(pLine, "MAC=", 4) == 0));
+        for (j = 1; j < AtLib_ResponseNumLines(); j++) {
+            pLine = AtLib_ResponseLine(j, &length);
+            if ((length == 8) && (memcmp(pLine, "RSSI=-40", 8) == 0))
+                break;
+        }
+        CHECK(j < AtLib_ResponseNumLines());
+    }
+}
+
+static void TestResponseGetInt(void)
+{
+    int32_t value;
+
+    ITestSetup();
+    AtLib_CommandQueue("AT+WRSSI=?\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+            ITestDone, 0);
+    AtLib_Poll();
+    Host_RxPushString("\r\nA=-2147483647 B=2147483648 C=99999999999\r\n"
+            "OK\r\n");
+    ITestPoll();
+    CHECK(G_TestMsgId == HOST_APP_MSG_ID_OK);
+    CHECK((AtLib_ResponseGetInt("A", &value)) && (value == -2147483647L));
+    CHECK(!AtLib_ResponseGetInt("B", &value));
+    CHECK(!AtLib_ResponseGetInt("C", &value));
+}
+
+static void TestCommandAfterQueued(void)
+{
+    ITestSetup();
+    Host_SetWriteHook(ITestAnswerOK);
+
+    /* The callback queues a command while AtLibGs_SetEcho waits */
+    AtLib_CommandQueue("AT+NSTAT=?\r\n", HOST_APP_TIMEOUT_ADAPTIVE,
+            ITestQueueAssoc, 0);
+    CHECK(AtLibGs_SetEcho(0) == HOST_APP_MSG_ID_OK);
+    CHECK(G_TestDone == 2);
+    CHECK(strcmp(Host_TxText(), "AT+NSTAT=?\r\nAT+WA=net,,6\r\nATE0\r\n")
+            == 0);
+}
+
+static void TestBulkNotReady(void)
+{
+    static const uint8_t data[ATLIB_TEST_BULK_SIZE] = { 0x1B };
+
+    /* Not ready for the header: nothing is sent */
+    ITestSetup();
+    Host_SetWriteReady(false);
+    CHECK(!AtLib_BulkDataTransfer('1', data, sizeof(data)));
+    CHECK(Host_TxLength() == 0);
+
+    /* The header is not taken: the data does not follow it */
+    ITestSetup();
+    Host_SetWriteHook(ITestStall);
+    CHECK(!AtLib_BulkDataTransfer('1', data, sizeof(data)));
+    CHECK(Host_TxLength() == 7);
+    CHECK(memcmp(Host_TxText(), "\x1bZ10200", 7) == 0);
+
+    ITestSetup();
+    CHECK(AtLib_BulkDataTransfer('1', data, sizeof(data)));
+    CHECK(Host_TxLength() == 7 + sizeof(data));
+}
+
+static void TestSendUdpData(void)
+{
+    int8_t digits[5];
+
+    ITestSetup();
+    AtLib_SendUdpData('1', (const uint8_t *)"hi", 2, HOST_APP_CON_UDP_SERVER,
+            (const uint8_t *)"10.0.0.2", 8080);
+    AtLib_SendUdpData('2', (const uint8_t *)"yo", 2, HOST_APP_CON_UDP_CLIENT,
+            0, 0);
+    CHECK(Host_TxLength() == 28);
+    CHECK(memcmp(Host_TxText(), "\x1bU110.0.0.2:8080:hi\x1b" "E"
+            "\x1bS2yo\x1b" "E", 28) == 0);
+
+    AtLib_ConvertNumberTo4DigitASCII(1460, digits);
+    CHECK(strcmp((char *)digits, "1460") == 0);
+    AtLib_ConvertNumberTo4DigitASCII(7, digits);
+    CHECK(strcmp((char *)digits, "0007") == 0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    TestResponseCompletesCommand();
+    TestDataFrames();
+    TestStreamedLines();
+    TestResponseTimeout();
+    TestLineAtBufferLimit();
+    TestDisconnectDetachesRing();
+    TestTimeoutClasses();
+    TestDataDoesNotRestartTimeout();
+    TestLateResponseDropped();
+    TestResyncRetries();
+    TestEventsDoNotComplete();
+    TestResponseGetInt();
+    TestCommandAfterQueued();
+    TestBulkNotReady();
+    TestSendUdpData();
+
+    return Host_TestResult();
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  test_atcmdlib.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,232 @@
+/*-------------------------------------------------------------------------*
+ * File:  test_gainspan_spi.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Tests of the GainSpan SPI driver, run on the PC against the
+ *      register level SPI bus and module of host_spi.c.  The driver is
+ *      built into this file so the tests can raise its data ready
+ *      interrupt routine like the hardware does.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <drv/GainSpan_SPI.c>
+#include "host_spi.h"
+#include "host_stubs.h"
+#include "host_test.h"
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Every byte value, the special characters included */
+static uint8_t G_TestBytes[600];
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestSetup
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Fresh bus, module and time, then start the driver the way main
+ *      does.
+ *---------------------------------------------------------------------------*/
+static void ITestSetup(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(G_TestBytes); i++)
+        G_TestBytes[i] = (uint8_t)(i * 7);
+    Host_Reset();
+    Host_SPI_Reset();
+    Host_SPI_SetDataReadyHandler(IGainSpan_SPI_DataReadyISR);
+    GainSpan_SPI_Start();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestModuleGot
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine if the module received exactly the given bytes.
+ *---------------------------------------------------------------------------*/
+static bool ITestModuleGot(const void *aData, uint32_t aLen)
+{
+    const uint8_t *p;
+
+    return (Host_SPI_ModuleReceived(&p) == aLen)
+            && (memcmp(p, aData, aLen) == 0);
+}
+
+static void TestStartStop(void)
+{
+    ITestSetup();
+    CHECK(PMK8 == 0);
+    CHECK((EGP1 & 0x01) && (!(EGN1 & 0x01)));
+    CHECK(PPR08 == GAINSPAN_SPI_DATA_READY_INT_PRIORITY);
+
+    GainSpan_SPI_Stop();
+    CHECK(PMK8 == 1);
+
+    /* Stopped: data ready only sets the flag, nothing is clocked */
+    Host_SPI_ModuleSend((const uint8_t *)"OK", 2);
+    CHECK(PIF8 == 1);
+    CHECK(!Host_SPI_IsTransferPending());
+}
+
+static void TestReceiveFromInterrupts(void)
+{
+    GAINSPAN_SPI_STATS_T stats;
+    uint8_t data[sizeof(G_TestBytes)];
+
+    ITestSetup();
+
+    /* The data ready edge starts a burst and each end of transfer */
+    /* chains the next, with no call to GainSpan_SPI_Update */
+    Host_SPI_ModuleSend(G_TestBytes, 200);
+    CHECK(Host_SPI_IsTransferPending());
+    CHECK(Host_SPI_Run() >= 4);
+    GainSpan_SPI_GetStats(&stats);
+    CHECK(stats.iBytesReceived == 200);
+    CHECK(stats.iBytesDropped == 0);
+    CHECK(!(P7 & (1 << 4)));
+
+    CHECK(GainSpan_SPI_ReceiveData(data, sizeof(data)) == 200);
+    CHECK(memcmp(data, G_TestBytes, 200) == 0);
+}
+
+static void TestReceiveFifoFull(void)
+{
+    GAINSPAN_SPI_STATS_T stats;
+    uint8_t data[sizeof(G_TestBytes)];
+    uint32_t count = 0;
+    uint32_t len;
+
+    ITestSetup();
+
+    /* More than the receive FIFO holds: the chain stops when it is */
+    /* full and GainSpan_SPI_ReceiveData starts it again */
+    Host_SPI_ModuleSend(G_TestBytes, sizeof(G_TestBytes));
+    Host_SPI_Run();
+    CHECK(P7 & (1 << 4));
+    GainSpan_SPI_GetStats(&stats);
+    CHECK(stats.iBytesReceived == GAINSPAN_SPI_RX_BUFFER_SIZE - 1);
+    while (count < sizeof(data)) {
+        len = GainSpan_SPI_ReceiveData(data + count, 100);
+        if (!len)
+            break;
+        count += len;
+        Host_SPI_Run();
+    }
+    CHECK(count == sizeof(G_TestBytes));
+    CHECK(memcmp(data, G_TestBytes, sizeof(G_TestBytes)) == 0);
+    GainSpan_SPI_GetStats(&stats);
+    CHECK(stats.iBytesDropped == 0);
+}
+
+static void TestTransmit(void)
+{
+    uint8_t data[16];
+
+    ITestSetup();
+
+    /* Data coming in while sending is kept */
+    GainSpan_SPI_SendData((const uint8_t *)"AT\r\n", 4);
+    GainSpan_SPI_Update();
+    Host_SPI_ModuleSend((const uint8_t *)"OK\r\n", 4);
+    Host_SPI_Run();
+    CHECK(ITestModuleGot("AT\r\n", 4));
+    CHECK(GainSpan_SPI_ReceiveData(data, sizeof(data)) == 4);
+    CHECK(memcmp(data, "OK\r\n", 4) == 0);
+}
+
+static void TestTransmitEscaped(void)
+{
+    ITestSetup();
+
+    /* Special characters go out escaped, the module gets them back */
+    GainSpan_SPI_SendDataBlock(G_TestBytes, 100);
+    Host_SPI_Run();
+    CHECK(ITestModuleGot(G_TestBytes, 100));
+    CHECK(GainSpan_SPI_IsTransmitEmpty());
+}
+
+static void TestFlowControl(void)
+{
+    GAINSPAN_SPI_STATS_T stats;
+
+    ITestSetup();
+
+    /* XOFF holds back what is written; Update polls for the XON */
+    Host_SPI_ModuleSendRaw(GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF, true);
+    Host_SPI_Run();
+    CHECK(GainSpan_SPI_IsFlowOff());
+    GainSpan_SPI_SendData((const uint8_t *)"AT\r\n", 4);
+    GainSpan_SPI_Update();
+    Host_SPI_Run();
+    CHECK(ITestModuleGot("", 0));
+    CHECK(!GainSpan_SPI_IsTransmitEmpty());
+
+    /* The XON (without data ready) is found by the polling and lets the */
+    /* data go straight from the end of transfer interrupt */
+    Host_SPI_ModuleSendRaw(GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON, false);
+    Host_SPI_Run();
+    CHECK(GainSpan_SPI_IsFlowOff());
+    GainSpan_SPI_Update();
+    Host_SPI_Run();
+    CHECK(!GainSpan_SPI_IsFlowOff());
+    CHECK(ITestModuleGot("AT\r\n", 4));
+
+    /* A lost XON: sent anyway after GAINSPAN_SPI_STALL_TIMEOUT */
+    Host_SPI_ModuleSendRaw(GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF, true);
+    Host_SPI_Run();
+    GainSpan_SPI_SendData((const uint8_t *)"AT\r\n", 4);
+    GainSpan_SPI_Update();
+    Host_SPI_Run();
+    Host_TimeAdvance(GAINSPAN_SPI_STALL_TIMEOUT);
+    GainSpan_SPI_Update();
+    Host_SPI_Run();
+    CHECK(ITestModuleGot("AT\r\nAT\r\n", 8));
+    GainSpan_SPI_GetStats(&stats);
+    CHECK(stats.iXOffs == 2);
+    CHECK(stats.iStallTimeouts == 1);
+}
+
+static void TestBusBusy(void)
+{
+    ITestSetup();
+
+    /* Turned away while another device has the bus, started by the */
+    /* bus free handler */
+    Host_SPI_SetBusBusy(true);
+    GainSpan_SPI_SendData((const uint8_t *)"AT\r\n", 4);
+    GainSpan_SPI_Update();
+    Host_SPI_ModuleSend((const uint8_t *)"OK", 2);
+    CHECK(!Host_SPI_IsTransferPending());
+    Host_SPI_SetBusBusy(false);
+    CHECK(Host_SPI_IsTransferPending());
+    Host_SPI_Run();
+    CHECK(ITestModuleGot("AT\r\n", 4));
+    CHECK(GainSpan_SPI_IsTransmitEmpty());
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    TestStartStop();
+    TestReceiveFromInterrupts();
+    TestReceiveFifoFull();
+    TestTransmit();
+    TestTransmitEscaped();
+    TestFlowControl();
+    TestBusBusy();
+
+    return Host_TestResult();
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  test_gainspan_spi.c
+ *-------------------------------------------------------------------------*/
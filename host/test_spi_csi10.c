@@ -0,0 +1,418 @@
+/*-------------------------------------------------------------------------*
+ * File:  test_spi_csi10.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Tests of the CSI10 SPI driver and its sharing of the bus between
+ *      channels, run on the PC.  The driver is built into this file (as
+ *      in test_gainspan_spi.c) so the tests can raise its interrupt
+ *      routine like the hardware does; its device registers are plain
+ *      variables.  Each byte clocked returns the inverse of the byte
+ *      sent.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <drv/SPI_CSI10.c>
+#include "host_test.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Bit rate given to SPI_CSI10_Init and the SDR02 divider it gives */
+#define TEST_INIT_RATE              1000000
+#define TEST_INIT_DIVIDER           5
+
+/* Bit rate of the fast channel and its divider */
+#define TEST_FAST_RATE              3000000
+#define TEST_FAST_DIVIDER           1
+
+/* Chip select of the WIFI channel, P73 */
+#define TEST_WIFI_CS                (1 << 3)
+
+/* Most bytes clocked by ITestRun */
+#define TEST_MAX_BYTES              256
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* Device registers used by SPI_CSI10.c (see system/platform.h) */
+volatile uint8_t P0, P1, P3, P7, PM0, PM1, PM3, PM7, PMC0;
+volatile uint8_t SAU0EN, CSIMK10, CSIIF10, CSIPR010, CSIPR110, SIO10;
+volatile uint16_t SPS0, SDR02, SIR02, SMR02, SCR02, SSR02;
+volatile uint16_t SO0, SOE0, SS0, ST0;
+
+/* Completions in order: '0' + channel for a queued transaction, 't' */
+/* for a SPI_CSI10_Transfer callback and 'w' for the WIFI channel's */
+/* bus free handler */
+static char G_TestOrder[32];
+
+/* Last queued transaction completed, and its iIsDone at the callback */
+static SPI_CSI10_Request *G_TestRequest;
+static bool G_TestRequestDone;
+
+/* Bytes sent on the bus with the channel they were sent on */
+static uint8_t G_TestSent[TEST_MAX_BYTES];
+static uint8_t G_TestSentChannel[TEST_MAX_BYTES];
+static uint32_t G_TestNumSent;
+
+/* Sent by the WIFI channel's bus free handler */
+static const uint8_t G_TestWifiData[] = { 0x57, 0x49 };
+static bool G_TestWifiStart;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestOrder
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Note a completion in G_TestOrder.
+ *---------------------------------------------------------------------------*/
+static void ITestOrder(char aWhat)
+{
+    size_t len = strlen(G_TestOrder);
+
+    if (len < sizeof(G_TestOrder) - 1) {
+        G_TestOrder[len] = aWhat;
+        G_TestOrder[len + 1] = '\0';
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestTransferDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      SPI_CSI10_Transfer callback.
+ *---------------------------------------------------------------------------*/
+static void ITestTransferDone(void)
+{
+    ITestOrder('t');
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestRequestDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queued transaction callback.
+ *---------------------------------------------------------------------------*/
+static void ITestRequestDone(SPI_CSI10_Request *aRequest)
+{
+    G_TestRequest = aRequest;
+    G_TestRequestDone = aRequest->iIsDone;
+    ITestOrder((char)('0' + aRequest->iChannel));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestWifiBusFree
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Bus free handler of the WIFI channel: start its transfer now, as
+ *      the GainSpan SPI driver does, if G_TestWifiStart.
+ *---------------------------------------------------------------------------*/
+static void ITestWifiBusFree(void)
+{
+    ITestOrder('w');
+    if (G_TestWifiStart)
+        CHECK(SPI_CSI10_Transfer(SPI_CSI10_WIFI_CHANNEL,
+                sizeof(G_TestWifiData), G_TestWifiData, 0,
+                ITestTransferDone));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestSetup
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start the driver on idle registers, every channel with an active
+ *      low chip select held for the whole transfer.
+ *---------------------------------------------------------------------------*/
+static void ITestSetup(void)
+{
+    uint8_t i;
+
+    P1 = P3 = P7 = 0;
+    ST0 = SS0 = 0;
+    SSR02 = 0;
+    SPI_CSI10_Init(TEST_INIT_RATE);
+    for (i = 0; i < SPI_CSI10_NUM_CHANNELS; i++) {
+        SPI_CSI10_ChannelSetup(i, false, false);
+        SPI_CSI10_ChannelSetBusFreeHandler(i, 0);
+    }
+    G_TestOrder[0] = '\0';
+    G_TestRequest = 0;
+    G_TestRequestDone = false;
+    G_TestNumSent = 0;
+    G_TestWifiStart = false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestByte
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Clock the byte written to SIO10 and raise the end of transfer
+ *      interrupt, as the hardware does.
+ *---------------------------------------------------------------------------*/
+static void ITestByte(void)
+{
+    uint8_t sent = SIO10;
+
+    if (G_TestNumSent < TEST_MAX_BYTES) {
+        G_TestSent[G_TestNumSent] = sent;
+        G_TestSentChannel[G_TestNumSent] = G_SPI_CSI10_Channel;
+        G_TestNumSent++;
+    }
+    SIO10 = (uint8_t)~sent;
+    SPI_CSI10_ISRHandler();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestComplete
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Clock the rest of the transfer on the bus.
+ *---------------------------------------------------------------------------*/
+static void ITestComplete(void)
+{
+    uint32_t n = G_SPI_CSI10_SendLength + 1;
+
+    while (n--)
+        ITestByte();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Clock until the bus is free and nobody wants it.
+ *---------------------------------------------------------------------------*/
+static void ITestRun(void)
+{
+    uint32_t n = 0;
+
+    while ((SPI_CSI10_IsBusy()) && (n++ < TEST_MAX_BYTES))
+        ITestByte();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestRequest
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Fill in a transaction of a single byte.
+ *---------------------------------------------------------------------------*/
+static void ITestRequest(
+        SPI_CSI10_Request *aRequest,
+        uint8_t aChannel,
+        const uint8_t *aData)
+{
+    memset(aRequest, 0, sizeof(*aRequest));
+    aRequest->iChannel = aChannel;
+    aRequest->iNumBytes = 1;
+    aRequest->iSendData = aData;
+    aRequest->iCallback = ITestRequestDone;
+}
+
+static void TestTransfer(void)
+{
+    static const uint8_t data[] = { 0x01, 0x80, 0xFF };
+    uint8_t received[sizeof(data)];
+
+    ITestSetup();
+    CHECK(SDR02 == (TEST_INIT_DIVIDER << 9));
+    CHECK(P7 & TEST_WIFI_CS);
+
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_WIFI_CHANNEL, sizeof(data), data,
+            received, ITestTransferDone));
+    CHECK(SPI_CSI10_IsBusy());
+    CHECK(!(P7 & TEST_WIFI_CS));
+    ITestComplete();
+    CHECK(!SPI_CSI10_IsBusy());
+    CHECK(P7 & TEST_WIFI_CS);
+    CHECK(strcmp(G_TestOrder, "t") == 0);
+    CHECK(G_TestNumSent == sizeof(data));
+    CHECK(memcmp(G_TestSent, data, sizeof(data)) == 0);
+    CHECK((received[0] == 0xFE) && (received[1] == 0x7F)
+            && (received[2] == 0x00));
+}
+
+static void TestWaitingChannel(void)
+{
+    static const uint8_t data[] = { 0x11, 0x22 };
+
+    ITestSetup();
+    SPI_CSI10_ChannelSetBusFreeHandler(SPI_CSI10_WIFI_CHANNEL,
+            ITestWifiBusFree);
+    G_TestWifiStart = true;
+
+    /* Turned away while another channel has the bus */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_SDCARD_CHANNEL, sizeof(data), data,
+            0, ITestTransferDone));
+    CHECK(!SPI_CSI10_Transfer(SPI_CSI10_WIFI_CHANNEL, sizeof(data), data,
+            0, ITestTransferDone));
+    CHECK(G_SPI_CSI10_Waiting == (1 << SPI_CSI10_WIFI_CHANNEL));
+    CHECK(G_TestOrder[0] == '\0');
+
+    /* Its handler is called when the bus is free and starts it */
+    ITestComplete();
+    CHECK(strcmp(G_TestOrder, "tw") == 0);
+    CHECK(G_SPI_CSI10_Waiting == 0);
+    CHECK(SPI_CSI10_IsBusy());
+    CHECK(G_SPI_CSI10_Channel == SPI_CSI10_WIFI_CHANNEL);
+    ITestRun();
+    CHECK(strcmp(G_TestOrder, "twt") == 0);
+    CHECK(G_TestNumSent == sizeof(data) + sizeof(G_TestWifiData));
+    CHECK(memcmp(G_TestSent + sizeof(data), G_TestWifiData,
+            sizeof(G_TestWifiData)) == 0);
+    CHECK(G_TestSentChannel[sizeof(data)] == SPI_CSI10_WIFI_CHANNEL);
+
+    /* A channel without a handler is just let go */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_SDCARD_CHANNEL, sizeof(data), data,
+            0, 0));
+    CHECK(!SPI_CSI10_Transfer(SPI_CSI10_LCD_CHANNEL, sizeof(data), data,
+            0, 0));
+    ITestRun();
+    CHECK(G_SPI_CSI10_Waiting == 0);
+    CHECK(!SPI_CSI10_IsBusy());
+}
+
+static void TestPriority(void)
+{
+    static const uint8_t data[] = { 0x33 };
+    SPI_CSI10_Request lcd;
+    SPI_CSI10_Request pmod1;
+    SPI_CSI10_Request pmod2;
+
+    ITestSetup();
+    SPI_CSI10_ChannelSetBusFreeHandler(SPI_CSI10_WIFI_CHANNEL,
+            ITestWifiBusFree);
+    SPI_CSI10_ChannelSetPriority(SPI_CSI10_PMOD1_CHANNEL,
+            SPI_CSI10_PRIORITY_HIGH);
+    SPI_CSI10_ChannelSetPriority(SPI_CSI10_WIFI_CHANNEL,
+            SPI_CSI10_PRIORITY_LOW);
+
+    /* All wait for the SD card's transfer, asked for lowest first */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_SDCARD_CHANNEL, sizeof(data), data,
+            0, ITestTransferDone));
+    CHECK(!SPI_CSI10_Transfer(SPI_CSI10_WIFI_CHANNEL, sizeof(data), data,
+            0, 0));
+    ITestRequest(&pmod2, SPI_CSI10_PMOD2_CHANNEL, data);
+    SPI_CSI10_Queue(&pmod2);
+    ITestRequest(&lcd, SPI_CSI10_LCD_CHANNEL, data);
+    SPI_CSI10_Queue(&lcd);
+    ITestRequest(&pmod1, SPI_CSI10_PMOD1_CHANNEL, data);
+    SPI_CSI10_Queue(&pmod1);
+    CHECK(G_TestOrder[0] == '\0');
+
+    /* Highest priority first, equal priorities by channel number */
+    ITestRun();
+    CHECK(strcmp(G_TestOrder, "t324w") == 0);
+    CHECK(G_TestNumSent == 4);
+    CHECK(G_TestSentChannel[1] == SPI_CSI10_PMOD1_CHANNEL);
+    CHECK(G_TestSentChannel[2] == SPI_CSI10_LCD_CHANNEL);
+    CHECK(G_TestSentChannel[3] == SPI_CSI10_PMOD2_CHANNEL);
+}
+
+static void TestDividerSwitch(void)
+{
+    static const uint8_t data[] = { 0x44 };
+
+    ITestSetup();
+    SPI_CSI10_ChannelSetBitRate(SPI_CSI10_LCD_CHANNEL, TEST_FAST_RATE);
+    CHECK(SDR02 == (TEST_INIT_DIVIDER << 9));
+
+    /* Put in place, with the channel stopped, when the LCD's turn comes */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_LCD_CHANNEL, sizeof(data), data, 0,
+            0));
+    CHECK(SDR02 == (TEST_FAST_DIVIDER << 9));
+    CHECK(ST0 & _SAU_CH2_STOP_TRG_ON);
+    CHECK(SS0 & _SAU_CH2_START_TRG_ON);
+    ITestRun();
+
+    /* Left as it is while the same channel goes on */
+    ST0 = SS0 = 0;
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_LCD_CHANNEL, sizeof(data), data, 0,
+            0));
+    CHECK(ST0 == 0);
+    CHECK(SDR02 == (TEST_FAST_DIVIDER << 9));
+    ITestRun();
+
+    /* And back for a channel at the SPI_CSI10_Init rate */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_WIFI_CHANNEL, sizeof(data), data, 0,
+            0));
+    CHECK(SDR02 == (TEST_INIT_DIVIDER << 9));
+    CHECK(ST0 & _SAU_CH2_STOP_TRG_ON);
+    ITestRun();
+}
+
+static void TestQueue(void)
+{
+    static const uint8_t data[] = { 0x55, 0x66, 0x77 };
+    SPI_CSI10_Request a;
+    SPI_CSI10_Request b;
+    uint8_t received[2];
+
+    ITestSetup();
+
+    /* A free bus starts the transaction at once */
+    ITestRequest(&a, SPI_CSI10_LCD_CHANNEL, data);
+    a.iNumBytes = 2;
+    a.iReceiveData = received;
+    SPI_CSI10_Queue(&a);
+    CHECK(SPI_CSI10_IsBusy());
+    CHECK(G_SPI_CSI10_Current == &a);
+    CHECK(!a.iIsDone);
+    ITestRun();
+    CHECK(a.iIsDone);
+    CHECK(G_TestRequest == &a);
+    CHECK(G_TestRequestDone);
+    CHECK((received[0] == 0xAA) && (received[1] == 0x99));
+    CHECK(G_SPI_CSI10_QueueHead[SPI_CSI10_LCD_CHANNEL] == 0);
+    CHECK(G_SPI_CSI10_QueueTail[SPI_CSI10_LCD_CHANNEL] == 0);
+
+    /* Behind a transfer: both wait in order */
+    CHECK(SPI_CSI10_Transfer(SPI_CSI10_SDCARD_CHANNEL, 1, data, 0, 0));
+    ITestRequest(&a, SPI_CSI10_LCD_CHANNEL, data + 1);
+    SPI_CSI10_Queue(&a);
+    ITestRequest(&b, SPI_CSI10_LCD_CHANNEL, data + 2);
+    SPI_CSI10_Queue(&b);
+    CHECK(G_SPI_CSI10_QueueHead[SPI_CSI10_LCD_CHANNEL] == &a);
+    CHECK(G_SPI_CSI10_QueueTail[SPI_CSI10_LCD_CHANNEL] == &b);
+    CHECK(a.iNext == &b);
+    CHECK((!a.iIsDone) && (!b.iIsDone));
+
+    ITestComplete();
+    CHECK(G_SPI_CSI10_Current == &a);
+    ITestComplete();
+    CHECK(a.iIsDone);
+    CHECK(!b.iIsDone);
+    CHECK(G_TestRequest == &a);
+    CHECK(G_SPI_CSI10_QueueHead[SPI_CSI10_LCD_CHANNEL] == &b);
+    CHECK(G_SPI_CSI10_QueueTail[SPI_CSI10_LCD_CHANNEL] == &b);
+    CHECK(G_SPI_CSI10_Current == &b);
+    ITestComplete();
+    CHECK(b.iIsDone);
+    CHECK(G_TestRequest == &b);
+    CHECK(G_SPI_CSI10_QueueHead[SPI_CSI10_LCD_CHANNEL] == 0);
+    CHECK(G_SPI_CSI10_QueueTail[SPI_CSI10_LCD_CHANNEL] == 0);
+    CHECK(!SPI_CSI10_IsBusy());
+    CHECK(strcmp(G_TestOrder, "222") == 0);
+    CHECK((G_TestSent[3] == 0x66) && (G_TestSent[4] == 0x77));
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    TestTransfer();
+    TestWaitingChannel();
+    TestPriority();
+    TestDividerSwitch();
+    TestQueue();
+
+    return Host_TestResult();
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  test_spi_csi10.c
+ *-------------------------------------------------------------------------*/
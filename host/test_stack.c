@@ -0,0 +1,173 @@
+/*-------------------------------------------------------------------------*
+ * File:  test_stack.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *      Tests of the whole stack on the PC: CmdLib, the App_* routines of
+ *      Apps/App_Common.c and drv/Transport.c, with the pseudo terminal
+ *      transport to the simulated module of host_pty.c.  The UART2 rate
+ *      changes of App_UARTSpeedUp only reach the host_board.c stubs.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <CmdLib/AtCmdLib.h>
+#include <Apps/Apps.h>
+#include <HostApp.h>
+#include <drv/Transport.h>
+#include <drv/UART2.h>
+#include <system/mstimer.h>
+#include "host_stubs.h"
+#include "host_test.h"
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Time (ms) to wait for echoed data */
+#define TEST_DATA_TIMEOUT           2000
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ITestReceive
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Run the receive path, as the main loop does, until aLen bytes of
+ *      data have reached the application or TEST_DATA_TIMEOUT passes.
+ *---------------------------------------------------------------------------*/
+static bool ITestReceive(uint32_t aLen)
+{
+    uint32_t start = MSTimerGet();
+
+    while (G_receivedCount < aLen) {
+        if (MSTimerDelta(start) >= TEST_DATA_TIMEOUT)
+            return false;
+        AtLib_ReceiveDataHandle();
+    }
+    return true;
+}
+
+static void TestCommands(void)
+{
+    char mac[13];
+    int16_t rssi;
+
+    /* The module's start up banner is thrown away */
+    AtLib_FlushIncomingMessage();
+
+    CHECK(AtLibGs_SetEcho(0) == HOST_APP_MSG_ID_OK);
+    CHECK(AtLibGs_Check() == HOST_APP_MSG_ID_OK);
+
+    memset(mac, 0, sizeof(mac));
+    CHECK(AtLibGs_GetMAC() == HOST_APP_MSG_ID_OK);
+    CHECK(AtLib_ParseGetMacResponse(mac));
+    CHECK(strcmp(mac, "001dc9010203") == 0);
+
+    CHECK(AtLibGs_GetRssi() == HOST_APP_MSG_ID_OK);
+    CHECK(AtLib_ParseRssiResponse(&rssi));
+    CHECK(rssi == -52);
+
+    /* Not a command the module knows */
+    CHECK(AtLibGs_SetEcho(2) == HOST_APP_MSG_ID_ERROR);
+    CHECK(AtLibGs_Check() == HOST_APP_MSG_ID_OK);
+}
+
+static void TestUARTSpeedUp(void)
+{
+    UART2_Start(UART2_BAUD_RATE);
+
+    /* Both ends move to the fast rate and still talk */
+    CHECK(App_UARTSpeedUp() == UART2_FAST_BAUD_RATE);
+    CHECK(Host_UART2_BaudRate() == UART2_FAST_BAUD_RATE);
+    CHECK(AtLibGs_Check() == HOST_APP_MSG_ID_OK);
+
+    /* A rate the module does not have */
+    CHECK(AtLibGs_SetBaudRate(12345) == HOST_APP_MSG_ID_ERROR);
+    CHECK(AtLibGs_Check() == HOST_APP_MSG_ID_OK);
+}
+
+static void TestTcpEcho(void)
+{
+    static const uint8_t text[] = "GET /api:v1/stack/alias?led HTTP/1.1\r\n";
+    uint8_t cid;
+
+    CHECK(AtLibGs_TcpClientStart((int8_t *)"10.0.0.1", (int8_t *)"80")
+            == HOST_APP_MSG_ID_OK);
+    cid = AtLib_GetTcpCid();
+    CHECK(cid == '0');
+
+    /* The echo server sends it back in an <ESC>S frame */
+    App_PrepareIncomingData(cid);
+    AtLib_SendTcpData(cid, text, sizeof(text) - 1);
+    CHECK(ITestReceive(sizeof(text) - 1));
+    CHECK(G_receivedCount == sizeof(text) - 1);
+    CHECK(memcmp(G_received, text, sizeof(text) - 1) == 0);
+
+    CHECK(AtLibGs_Close(cid) == HOST_APP_MSG_ID_OK);
+}
+
+static void TestBulkEcho(void)
+{
+    uint8_t data[APP_MAX_RECEIVED_DATA];
+    uint8_t cid;
+    uint32_t i;
+
+    /* Every byte value, <ESC> included */
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 7);
+
+    CHECK(AtLibGs_BData(1) == HOST_APP_MSG_ID_OK);
+    CHECK(AtLibGs_TcpClientStart((int8_t *)"10.0.0.1", (int8_t *)"80")
+            == HOST_APP_MSG_ID_OK);
+    cid = AtLib_GetTcpCid();
+
+    /* Sent and echoed back in <ESC>Z frames */
+    App_PrepareIncomingData(cid);
+    CHECK(AtLib_BulkDataTransfer(cid, data, sizeof(data)));
+    CHECK(ITestReceive(sizeof(data)));
+    CHECK(G_receivedCount == sizeof(data));
+    CHECK(memcmp(G_received, data, sizeof(data)) == 0);
+
+    CHECK(AtLibGs_CloseAll() == HOST_APP_MSG_ID_OK);
+    CHECK(AtLibGs_BData(0) == HOST_APP_MSG_ID_OK);
+}
+
+static void TestTransportStats(void)
+{
+    TRANSPORT_STATS_T stats;
+
+    CHECK(Transport_GetSelected() == TRANSPORT_PTY);
+    CHECK(strcmp(Transport_GetName(), "PTY") == 0);
+    Transport_GetStats(&stats);
+    CHECK(stats.iBytesWritten > APP_MAX_RECEIVED_DATA);
+    CHECK(stats.iBytesRead > APP_MAX_RECEIVED_DATA);
+    CHECK(stats.iBytesDropped == 0);
+    CHECK(stats.iErrors == 0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*/
+int main(void)
+{
+    Host_Reset();
+    AtLib_Init();
+    CHECK(Transport_Select(TRANSPORT_PTY));
+
+    TestCommands();
+    TestUARTSpeedUp();
+    TestTcpEcho();
+    TestBulkEcho();
+    TestTransportStats();
+
+    /* Ends the simulated module */
+    Transport_Select(TRANSPORT_LOOPBACK);
+
+    return Host_TestResult();
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  test_stack.c
+ *-------------------------------------------------------------------------*/
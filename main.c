@@ -16,8 +16,11 @@
 #include <sensors\Temperature_ADT7420.h>
 #include <sensors/eeprom.h>
 #include <system\console.h>
+#include <system\log.h>
 #include <drv\UART0.h>
 #include <drv\SPI_CSI10.h>
+#include <drv\GainSpan_SPI.h>
+#include <drv\Transport.h>
 #include <Apps/Apps.h>
 
 
@@ -62,14 +65,29 @@ int main(void)
 
     /* Setup LCD SPI channel for Chip Select P10, active low, active per byte  */
     SPI_CSI10_ChannelSetup(SPI_CSI10_LCD_CHANNEL, false, true);
+    /* The display waits for the WiFi link */
+    SPI_CSI10_ChannelSetPriority(SPI_CSI10_LCD_CHANNEL, SPI_CSI10_PRIORITY_LOW);
 
     /* Send LCD configuration */
     InitialiseLCD();
 
     UART0_Start(UART0_BAUD_RATE);
+    /* Debug log is sent on UART0 in the background */
+    Log_Init();
 
-    /* Setup WIFI SPI channel for Chip Select P7x, active low, active per byte  */
-    SPI_CSI10_ChannelSetup(SPI_WIFI_CHANNEL, false, true);
+    /* Setup WIFI SPI channel for Chip Select P7x, active low, held for */
+    /* the whole transfer */
+    SPI_CSI10_ChannelSetup(SPI_WIFI_CHANNEL, false, false);
+    SPI_CSI10_ChannelSetPriority(SPI_WIFI_CHANNEL, SPI_CSI10_PRIORITY_HIGH);
+
+    /* Link to the module (can be changed later with Transport_Select).  SPI */
+    /* is the transport at start up, so only its driver needs starting: the */
+    /* data ready interrupt and the bus free handler */
+#ifdef HOST_APP_INTERFACE_SPI
+    GainSpan_SPI_Start();
+#else
+    Transport_Select(TRANSPORT_UART2);
+#endif
 
     Temperature_ADT7420_Init();
     Potentiometer_Init();
@@ -13,7 +13,12 @@
 
 #define _F8_ "%d"
 #define _F16_ "%d"
+#ifdef __IAR_SYSTEMS_ICC__
 #define _F32_ "%ld"
+#else
+#include <inttypes.h>
+#define _F32_ "%" PRId32    /* long is not 32 bits on most hosts */
+#endif
 
 #define DI      __disable_interrupt
 #define EI      __enable_interrupt
@@ -0,0 +1,289 @@
+/*-------------------------------------------------------------------------*
+ * File:  log.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Deferred binary log.  Records are copied whole into a RAM ring with
+ *     interrupts disabled and sent out by the UART0 transmit interrupt,
+ *     so a LOG call never waits on the UART.  Record layout:
+ *
+ *         LOG_SYNC, ID, payload length, time stamp (4 bytes), payload
+ *
+ *     The time stamp is MSTimerGet() and the payload is either 32 bit
+ *     arguments or data bytes, all little endian.  LOG_MORE in the length
+ *     marks data that goes on in the next record.  When the ring is full
+ *     the record is dropped and counted; a LOG_ID_DROPPED record with the
+ *     count goes in as soon as there is room again.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <system/platform.h>
+#include <system/mstimer.h>
+#include <drv/UART0.h>
+#include "log.h"
+
+#if (LOG_LEVEL > LOG_LEVEL_NONE)
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Size of the ring, must be a power of 2 */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE     256
+#endif
+#define LOG_BUFFER_MASK     (LOG_BUFFER_SIZE - 1)
+
+/* Sync, ID, length and time stamp */
+#define LOG_HEADER_SIZE     7
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static uint8_t G_LogBuffer[LOG_BUFFER_SIZE];
+static volatile uint16_t G_LogIn = 0;
+static volatile uint16_t G_LogOut = 0;
+static volatile uint16_t G_LogCount = 0;
+static volatile uint16_t G_LogDropped = 0;
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ILogNextByte
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      UART0 transmit source: take the next byte out of the ring.  Called
+ *      by the UART0 transmit interrupt.
+ * Inputs:
+ *      uint8_t *aByte -- Place to store the byte
+ * Outputs:
+ *      bool -- true if a byte was stored, false if the ring is empty
+ *---------------------------------------------------------------------------*/
+static bool ILogNextByte(uint8_t *aByte)
+{
+    if (!G_LogCount)
+        return false;
+
+    *aByte = G_LogBuffer[G_LogOut];
+    G_LogOut = (G_LogOut + 1) & LOG_BUFFER_MASK;
+    G_LogCount--;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ILogPutHeader
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put the start of a record in the ring.  Interrupts must be
+ *      disabled and the room for the whole record checked.
+ * Inputs:
+ *      LOG_ID_E aID -- Message ID
+ *      uint8_t aLen -- Payload length that follows, plus LOG_MORE if the
+ *          data goes on in the next record
+ *      uint32_t aTime -- Time stamp
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ILogPutHeader(LOG_ID_E aID, uint8_t aLen, uint32_t aTime)
+{
+    uint16_t in = G_LogIn;
+
+    G_LogBuffer[in] = LOG_SYNC;
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = (uint8_t)aID;
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = aLen;
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = (uint8_t)aTime;
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = (uint8_t)(aTime >> 8);
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = (uint8_t)(aTime >> 16);
+    in = (in + 1) & LOG_BUFFER_MASK;
+    G_LogBuffer[in] = (uint8_t)(aTime >> 24);
+    G_LogIn = (in + 1) & LOG_BUFFER_MASK;
+    G_LogCount += LOG_HEADER_SIZE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ILogPutArg
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put a 32 bit argument in the ring.  Interrupts must be disabled.
+ * Inputs:
+ *      uint32_t aArg -- Argument
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void ILogPutArg(uint32_t aArg)
+{
+    uint8_t i;
+    uint16_t in = G_LogIn;
+
+    for (i = 0; i < 4; i++) {
+        G_LogBuffer[in] = (uint8_t)aArg;
+        in = (in + 1) & LOG_BUFFER_MASK;
+        aArg >>= 8;
+    }
+    G_LogIn = in;
+    G_LogCount += 4;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  ILogRoom
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Check the ring has room for a record, first putting in the record
+ *      of dropped records if one is owed.  Interrupts must be disabled.
+ * Inputs:
+ *      uint8_t aLen -- Payload length of the record
+ *      uint32_t aTime -- Time stamp
+ * Outputs:
+ *      bool -- true if the record fits, false if it was counted as dropped
+ *---------------------------------------------------------------------------*/
+static bool ILogRoom(uint8_t aLen, uint32_t aTime)
+{
+    uint16_t room = LOG_BUFFER_SIZE - G_LogCount;
+
+    if (G_LogDropped) {
+        if (room >= (2 * LOG_HEADER_SIZE) + 4 + aLen) {
+            ILogPutHeader(LOG_ID_DROPPED, 4, aTime);
+            ILogPutArg(G_LogDropped);
+            G_LogDropped = 0;
+            return true;
+        }
+    } else if (room >= LOG_HEADER_SIZE + aLen) {
+        return true;
+    }
+    if (G_LogDropped != 0xFFFF)
+        G_LogDropped++;
+    return false;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Log_Init
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Empty the log and have UART0 send it.  Call after UART0_Start.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Log_Init(void)
+{
+    __istate_t state = __get_interrupt_state();
+
+    DI();
+    G_LogIn = G_LogOut = G_LogCount = 0;
+    G_LogDropped = 0;
+    __set_interrupt_state(state);
+
+    UART0_SetTransmitSource(ILogNextByte);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Log_Write
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put a record with up to two 32 bit arguments in the log.  Use the
+ *      LOG, LOG1 and LOG2 macros rather than calling this directly.  Can
+ *      be called from an interrupt routine.
+ * Inputs:
+ *      LOG_ID_E aID -- Message ID from log_messages.h
+ *      uint8_t aNumArgs -- Number of arguments (0 to 2)
+ *      uint32_t aArg1 -- First argument
+ *      uint32_t aArg2 -- Second argument
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Log_Write(LOG_ID_E aID, uint8_t aNumArgs, uint32_t aArg1, uint32_t aArg2)
+{
+    uint32_t time = MSTimerGet();
+    __istate_t state = __get_interrupt_state();
+
+    DI();
+    if (ILogRoom(aNumArgs * 4, time)) {
+        ILogPutHeader(aID, aNumArgs * 4, time);
+        if (aNumArgs > 0)
+            ILogPutArg(aArg1);
+        if (aNumArgs > 1)
+            ILogPutArg(aArg2);
+    }
+    __set_interrupt_state(state);
+
+    UART0_TransmitKick();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Log_WriteData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put data bytes (shown with the message's %s) in the log, split
+ *      into records of up to LOG_DATA_MAX bytes.  Use the LOG_DATA macro
+ *      rather than calling this directly.
+ * Inputs:
+ *      LOG_ID_E aID -- Message ID from log_messages.h
+ *      const uint8_t *aData -- Bytes to log
+ *      uint16_t aLen -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void Log_WriteData(LOG_ID_E aID, const uint8_t *aData, uint16_t aLen)
+{
+    uint32_t time = MSTimerGet();
+    __istate_t state;
+    uint8_t len;
+    uint8_t more;
+    uint8_t i;
+    uint16_t in;
+
+    do {
+        if (aLen > LOG_DATA_MAX) {
+            len = LOG_DATA_MAX;
+            more = LOG_MORE;
+        } else {
+            len = (uint8_t)aLen;
+            more = 0;
+        }
+        state = __get_interrupt_state();
+        DI();
+        if (ILogRoom(len, time)) {
+            ILogPutHeader(aID, len | more, time);
+            in = G_LogIn;
+            for (i = 0; i < len; i++) {
+                G_LogBuffer[in] = aData[i];
+                in = (in + 1) & LOG_BUFFER_MASK;
+            }
+            G_LogIn = in;
+            G_LogCount += len;
+        }
+        __set_interrupt_state(state);
+        aData += len;
+        aLen -= len;
+    } while (aLen);
+
+    UART0_TransmitKick();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Log_GetDropCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get the number of records lost since the last LOG_ID_DROPPED
+ *      record.  Stops counting at 0xFFFF.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      uint16_t -- Records dropped and not yet reported
+ *---------------------------------------------------------------------------*/
+uint16_t Log_GetDropCount(void)
+{
+    return G_LogDropped;
+}
+
+#endif // LOG_LEVEL > LOG_LEVEL_NONE
+
+/*-------------------------------------------------------------------------*
+ * End of File:  log.c
+ *-------------------------------------------------------------------------*/
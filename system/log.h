@@ -0,0 +1,96 @@
+/*-------------------------------------------------------------------------*
+ * File:  log.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Deferred binary log.  A LOG call stores a short record (message ID,
+ *     millisecond time stamp and arguments, no formatting) in a RAM ring
+ *     and returns; the UART0 transmit interrupt sends the ring to the PC
+ *     in the background.  tools/log_decode.py turns the records back into
+ *     text using the formats in log_messages.h.
+ *
+ *     Calls above LOG_LEVEL compile to nothing.
+ *-------------------------------------------------------------------------*/
+#ifndef LOG_H_
+#define LOG_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <HostApp.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_INFO      2
+#define LOG_LEVEL_DEBUG     3
+
+/* Most detailed level built in, set in HostApp.h or the project */
+#ifndef LOG_LEVEL
+#ifdef HOST_APP_DEBUG_ENABLE
+#define LOG_LEVEL           LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL           LOG_LEVEL_NONE
+#endif
+#endif
+
+/* First byte of every record */
+#define LOG_SYNC            0xA5
+
+/* Most data bytes in one record, longer LOG_DATA calls are split */
+#ifndef LOG_DATA_MAX
+#define LOG_DATA_MAX        32
+#endif
+
+/* Set in the length byte of a record when the data goes on in the next */
+#define LOG_MORE            0x80
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+#define LOG_MESSAGE(id, format)     id,
+typedef enum {
+#include "log_messages.h"
+    LOG_ID_NUM
+} LOG_ID_E;
+#undef LOG_MESSAGE
+
+/*-------------------------------------------------------------------------*
+ * Macros:
+ *-------------------------------------------------------------------------*/
+#if (LOG_LEVEL > LOG_LEVEL_NONE)
+#define LOG(level, id) \
+    do { if ((level) <= LOG_LEVEL) Log_Write((id), 0, 0, 0); } while (0)
+#define LOG1(level, id, a) \
+    do { if ((level) <= LOG_LEVEL) Log_Write((id), 1, (uint32_t)(a), 0); } while (0)
+#define LOG2(level, id, a, b) \
+    do { if ((level) <= LOG_LEVEL) \
+        Log_Write((id), 2, (uint32_t)(a), (uint32_t)(b)); } while (0)
+#define LOG_DATA(level, id, p, len) \
+    do { if ((level) <= LOG_LEVEL) \
+        Log_WriteData((id), (const uint8_t *)(p), (len)); } while (0)
+#else
+#define LOG(level, id)                  do { } while (0)
+#define LOG1(level, id, a)              do { } while (0)
+#define LOG2(level, id, a, b)           do { } while (0)
+#define LOG_DATA(level, id, p, len)     do { } while (0)
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+#if (LOG_LEVEL > LOG_LEVEL_NONE)
+void Log_Init(void);
+void Log_Write(LOG_ID_E aID, uint8_t aNumArgs, uint32_t aArg1, uint32_t aArg2);
+void Log_WriteData(LOG_ID_E aID, const uint8_t *aData, uint16_t aLen);
+uint16_t Log_GetDropCount(void);
+#else
+#define Log_Init()
+#endif
+
+#endif // LOG_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  log.h
+ *-------------------------------------------------------------------------*/
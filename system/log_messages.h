@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------*
+ * File:  log_messages.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     List of the log messages, one LOG_MESSAGE(id, format) per line.
+ *     Only the IDs are built into the firmware; tools/log_decode.py reads
+ *     this file to turn the records back into text.  Arguments are 32 bit
+ *     numbers (%d, %u, %x, %c, %lu, ...) or, for LOG_DATA, the data bytes
+ *     as one %s.  Add new messages at the end so old logs still decode.
+ *-------------------------------------------------------------------------*/
+/* No include guard: included once per use with LOG_MESSAGE defined */
+LOG_MESSAGE(LOG_ID_DROPPED,             "** %lu log records dropped **\n")
+LOG_MESSAGE(LOG_ID_AT_COMMAND,          ">%s\n")
+LOG_MESSAGE(LOG_ID_AT_RECEIVE,          "%s")
+LOG_MESSAGE(LOG_ID_CHECKING_LINK,       "Checking link\n")
+LOG_MESSAGE(LOG_ID_ASSOCIATION_ERROR,   "\n Association error - retry now \n")
+LOG_MESSAGE(LOG_ID_TCP_CONNECT_ERROR,   "\n TCP Connection ERROR !\n")
+LOG_MESSAGE(LOG_ID_TCP_RESPONSE_ERROR,  "\nTCP connection response parsing error!\n")
+LOG_MESSAGE(LOG_ID_EXOSITE_RESPONSE,    "%s\n")
+LOG_MESSAGE(LOG_ID_TCP_SEND_ERROR,      "\n TCP send ERROR !\n")
+/*-------------------------------------------------------------------------*
+ * End of File:  log_messages.h
+ *-------------------------------------------------------------------------*/
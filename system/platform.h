@@ -13,9 +13,36 @@
  * Includes:
  *-------------------------------------------------------------------------*/
 #include "YRDKRL78G13.h"
+#ifdef __IAR_SYSTEMS_ICC__
 #include <ior5f101le.h>
 #include <ior5f101le_ext.h>
 #include "intrinsics.h"
+#else
+/* Host compiler (e.g. gcc on a PC) building the hardware independent */
+/* modules such as CmdLib: no device registers, intrinsics do nothing */
+typedef unsigned char __istate_t;
+#define __disable_interrupt()       ((void)0)
+#define __enable_interrupt()        ((void)0)
+#define __halt()                    ((void)0)
+#define __no_operation()            ((void)0)
+#define __stop()                    ((void)0)
+#define __get_interrupt_state()     ((__istate_t)0)
+#define __set_interrupt_state(s)    ((void)(s))
+/* Interrupt routines are only called by the hardware (or a test) */
+#define __interrupt                 __attribute__((unused))
+#define __root
+
+/* Device registers of the drivers built on the host, plain variables */
+/* set and checked by the simulation (see host/host_spi.c and, for the */
+/* CSI10 ones, host/test_spi_csi10.c) */
+#include <stdint.h>
+extern volatile uint8_t P7;
+extern volatile uint8_t PMK8, PIF8, PPR08, PPR18, EGP1, EGN1;
+extern volatile uint8_t P0, P1, P3, PM0, PM1, PM3, PM7, PMC0;
+extern volatile uint8_t SAU0EN, CSIMK10, CSIIF10, CSIPR010, CSIPR110, SIO10;
+extern volatile uint16_t SPS0, SDR02, SIR02, SMR02, SCR02, SSR02;
+extern volatile uint16_t SO0, SOE0, SS0, ST0;
+#endif
 
 #endif // PLATFORM_H_
 /*-------------------------------------------------------------------------*
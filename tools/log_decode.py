@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Turn the binary log sent on UART0 (see system/log.h) back into text.
+
+Records are LOG_SYNC (0xA5), message ID, payload length, a 4 byte time
+stamp and the payload.  LOG_MORE in the length joins the data to the next
+record of the same ID.  The message formats are read from
+system/log_messages.h.  Other bytes (ConsolePrintf text) are passed through.
+
+usage: log_decode.py [-m log_messages.h] [-b baud] [file or serial port]
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+LOG_SYNC = 0xA5
+LOG_MORE = 0x80
+HEADER_SIZE = 7
+
+def load_formats(path):
+    """Return the list of formats, indexed by message ID."""
+    text = open(path, encoding='latin-1').read()
+    formats = []
+    for m in re.finditer(r'^\s*LOG_MESSAGE\(\s*(\w+)\s*,\s*((?:"(?:[^"\\]|\\.)*"\s*)+)\)',
+                         text, re.M):
+        parts = re.findall(r'"((?:[^"\\]|\\.)*)"', m.group(2))
+        fmt = ''.join(parts).encode('latin-1').decode('unicode_escape')
+        formats.append((m.group(1), fmt))
+    return formats
+
+def render(fmt, payload):
+    """Apply the format to the record payload."""
+    # Python % has no length modifiers
+    fmt = re.sub(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l)?([diouxXcs])', r'%\1\2', fmt)
+    if '%s' in fmt:
+        data = ''.join(chr(c) for c in payload
+                       if 32 <= c < 127 or c in (9, 10))
+        return fmt.replace('%s', data.replace('%', '%%'), 1) % ()
+    args = [a[0] for a in struct.iter_unpack('<I', payload[:len(payload) // 4 * 4])]
+    signed = re.findall(r'%[-+ #0]*\d*(?:\.\d+)?([diouxXc])', fmt)
+    for i, conv in enumerate(signed[:len(args)]):
+        if conv in 'di' and args[i] & 0x80000000:
+            args[i] -= 1 << 32
+    try:
+        return fmt % tuple(args)
+    except (TypeError, ValueError):
+        return fmt + ' ' + ' '.join('0x%08X' % a for a in args)
+
+def decode(stream, formats, out):
+    """Decode the byte stream, writing text to out."""
+    buf = bytearray()
+    line_start = [True]
+    pending = None      # (ID, time stamp, data) of LOG_MORE records
+
+    def emit(msg_id, stamp, payload):
+        if msg_id < len(formats):
+            text = render(formats[msg_id][1], payload)
+        else:
+            text = '<unknown log ID %d: %s>\n' % (msg_id, payload.hex())
+        for c in text:
+            if line_start[0]:
+                out.write('[%10.3f] ' % (stamp / 1000.0))
+            out.write(c)
+            line_start[0] = (c == '\n')
+
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        buf += chunk
+        while buf:
+            if buf[0] != LOG_SYNC:
+                c = chr(buf.pop(0))
+                if c != '\r':
+                    out.write(c)
+                    line_start[0] = (c == '\n')
+                continue
+            if len(buf) < HEADER_SIZE or len(buf) < HEADER_SIZE + (buf[2] & ~LOG_MORE):
+                break
+            msg_id, more, length = buf[1], buf[2] & LOG_MORE, buf[2] & ~LOG_MORE
+            stamp = struct.unpack_from('<I', buf, 3)[0]
+            payload = bytes(buf[HEADER_SIZE:HEADER_SIZE + length])
+            del buf[:HEADER_SIZE + length]
+            if pending:
+                if pending[0] == msg_id:
+                    stamp, payload = pending[1], pending[2] + payload
+                else:
+                    # The rest was dropped, show what arrived
+                    emit(*pending)
+            if more:
+                pending = (msg_id, stamp, payload)
+            else:
+                pending = None
+                emit(msg_id, stamp, payload)
+        out.flush()
+    if pending:
+        emit(*pending)
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-m', '--messages',
+                        default=os.path.join(here, '..', 'system', 'log_messages.h'),
+                        help='message list (default: system/log_messages.h)')
+    parser.add_argument('-b', '--baud', type=int, default=115200,
+                        help='baud rate when reading a serial port')
+    parser.add_argument('input', nargs='?', help='log file or serial port (default: stdin)')
+    args = parser.parse_args()
+
+    formats = load_formats(args.messages)
+    if not args.input:
+        stream = sys.stdin.buffer
+    elif os.path.isfile(args.input):
+        stream = open(args.input, 'rb')
+    else:
+        import serial
+        stream = serial.Serial(args.input, args.baud)
+    try:
+        decode(stream, formats, sys.stdout)
+    except KeyboardInterrupt:
+        pass
+
+if __name__ == '__main__':
+    main()